@@ -32,6 +32,7 @@ const char *progusage = "[--bond=BOND]";
 
 /* MP Includes */
 #include "mp_common.h"
+#include "mp_procfile.h"
 /* Default Includes */
 #include <stdio.h>
 #include <signal.h>
@@ -159,36 +160,36 @@ int main (int argc, char **argv) {
 }
 
 bonding_info *parseBond(const char *filename) {
-    FILE *input;
-    char buffer[256];
-    char *key, *value;
+    mp_procfile *input;
+    mp_slice line, key;
     int count = 0;
 
     bonding_info *info;
 
-    input = fopen(filename, "r");
+    input = mp_procfile_open(filename);
     if (input == NULL)
         return NULL;
 
-    info = mp_malloc(sizeof(bonding_info));
-    info->slave = NULL;
+    if (mp_procfile_read(input) != OK) {
+        mp_procfile_close(input);
+        return NULL;
+    }
+
+    info = mp_calloc(1, sizeof(bonding_info));
 
-    while (fgets(buffer, 256, input) != NULL) {
+    while (mp_procfile_line(input, &line)) {
 
-        value = buffer;
-        key = strsep(&value, ":");
-        if(!value)
+        if (!mp_slice_token(&line, ':', &key))
             continue;
 
-        value++;
-        value[strlen(value)-1] = '\0';
+        mp_slice_trim(&line);
 
-        if (strcmp(key, "Ethernet Channel Bonding Driver") == 0) {
-            info->version = mp_strdup(value);
-        } else if (strcmp(key, "Bonding Mode") == 0) {
-            info->mode = mp_strdup(value);
-        } else if (strcmp(key, "MII Status") == 0) {
-            if (strcmp(value, "up") == 0) {
+        if (mp_slice_eq(&key, "Ethernet Channel Bonding Driver")) {
+            info->version = mp_slice_strdup(&line);
+        } else if (mp_slice_eq(&key, "Bonding Mode")) {
+            info->mode = mp_slice_strdup(&line);
+        } else if (mp_slice_eq(&key, "MII Status")) {
+            if (mp_slice_eq(&line, "up")) {
                 if(count)
                     info->slave[count-1]->mii_status = 1;
                 else
@@ -199,16 +200,16 @@ bonding_info *parseBond(const char *filename) {
                 else
                     info->mii_status = 0;
             }
-        } else if (strcmp(key, "Slave Interface") == 0) {
+        } else if (mp_slice_eq(&key, "Slave Interface")) {
             count++;
             info->slaves = count;
             info->slave = mp_realloc(info->slave, (count+1)*sizeof(bonding_slave_info *));
             info->slave[count] = NULL;
             info->slave[count-1] = mp_malloc(sizeof(struct bonding_slave_info_s));
-            info->slave[count-1]->interface = mp_strdup(value);
+            info->slave[count-1]->interface = mp_slice_strdup(&line);
         }
     }
-    fclose(input);
+    mp_procfile_close(input);
 
     return info;
 }
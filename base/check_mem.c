@@ -32,26 +32,25 @@ const char *progusage = "[-w <warning usage>] [-c <critical usage>]";
 
 /* MP Includes */
 #include "mp_common.h"
+#include "mp_procfile.h"
 /* Default Includes */
 #include <stdio.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
-#include <ctype.h>
 
 /* Global Vars */
 thresholds *usage_thresholds = NULL;
 
 /* Function prototype */
-float readValue(char *str);
+float readValue(mp_slice *str);
 
 int main (int argc, char **argv) {
     /* Local Vars */
-    FILE    *meminfo;
-    char    line[64];
-    char    *line_ptr;
-    char    *key;
+    mp_procfile *meminfo;
+    mp_slice    line;
+    mp_slice    key;
     float       mem_total = 0, mem_free = 0;
     float       slab = 0;
     float       swap_cached = 0, swap_total = 0, swap_free = 0;
@@ -73,35 +72,35 @@ int main (int argc, char **argv) {
     alarm(mp_timeout);
 
     // Read /proc/meminfo
-    meminfo = fopen("/proc/meminfo", "r");
-    if (meminfo == NULL)
+    meminfo = mp_procfile_open("/proc/meminfo");
+    if (meminfo == NULL || mp_procfile_read(meminfo) != OK)
         unknown("Can't read /proc/meminfo");
 
-    while (fgets(line, 64, meminfo) != NULL) {
-        line_ptr = line;
-
-        key = strsep(&line_ptr, " ");
-
-        if (strcmp("MemTotal:", key) == 0) {
-            mem_total = readValue(line_ptr);
-        } else if (strcmp("MemFree:", key) == 0) {
-            mem_free = readValue(line_ptr);
-        } else if (strcmp("Slab:", key) == 0) {
-            slab = readValue(line_ptr);
-        } else if (strcmp("SwapCached:", key) == 0) {
-            swap_cached = readValue(line_ptr);
-        } else if (strcmp("SwapTotal:", key) == 0) {
-            swap_total = readValue(line_ptr);
-        } else if (strcmp("SwapFree:", key) == 0) {
-            swap_free= readValue(line_ptr);
-        } else if (strcmp("PageTables:", key) == 0) {
-            page_tables = readValue(line_ptr);
-        } else if (strcmp("Buffers:", key) == 0) {
-            buffers = readValue(line_ptr);
-        } else if (strcmp("Cached:", key) == 0) {
-            cached = readValue(line_ptr);
+    while (mp_procfile_line(meminfo, &line)) {
+        if (!mp_slice_token(&line, ':', &key))
+            continue;
+
+        if (mp_slice_eq(&key, "MemTotal")) {
+            mem_total = readValue(&line);
+        } else if (mp_slice_eq(&key, "MemFree")) {
+            mem_free = readValue(&line);
+        } else if (mp_slice_eq(&key, "Slab")) {
+            slab = readValue(&line);
+        } else if (mp_slice_eq(&key, "SwapCached")) {
+            swap_cached = readValue(&line);
+        } else if (mp_slice_eq(&key, "SwapTotal")) {
+            swap_total = readValue(&line);
+        } else if (mp_slice_eq(&key, "SwapFree")) {
+            swap_free= readValue(&line);
+        } else if (mp_slice_eq(&key, "PageTables")) {
+            page_tables = readValue(&line);
+        } else if (mp_slice_eq(&key, "Buffers")) {
+            buffers = readValue(&line);
+        } else if (mp_slice_eq(&key, "Cached")) {
+            cached = readValue(&line);
         }
     }
+    mp_procfile_close(meminfo);
 
     // Calculations
     apps = mem_total - mem_free - buffers - cached - slab - page_tables
@@ -136,18 +135,17 @@ int main (int argc, char **argv) {
     unknown("Memory - %2.2f%% (%s of %s) used", usedp, mp_human_size(used), mp_human_size(mem_total));
 }
 
-float readValue(char *str) {
+float readValue(mp_slice *str) {
     float value;
-    char *unit;
+    size_t end;
 
-    while (isspace(str[0])) {
-        str++;
-    }
+    value = (float)mp_slice_ull(str, &end);
 
-    value = (float)strtod(str, &unit);
+    while (end < str->len && str->ptr[end] == ' ')
+        end++;
 
-    if (unit && !isspace(unit[1])) {
-        switch(unit[1]) {
+    if (end < str->len) {
+        switch(str->ptr[end]) {
             case 'g':
                 value *= 1024;
                 /* no break */
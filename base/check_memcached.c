@@ -28,12 +28,14 @@ const char *progdesc  = "Check memcached status.";
 const char *progvers  = "0.1";
 const char *progcopy  = "2012";
 const char *progauth  = "Marius Rieder <marius.rieder@durchmesser.ch>";
-const char *progusage = "[--host <HOSTNAME>] [--port <PORT>]";
+const char *progusage = "[--host <HOSTNAME>] [--port <PORT>] [--repeat <COUNT>]";
 
 /* MP Includes */
 #include "mp_common.h"
 #include "mp_utils.h"
 #include "mp_net.h"
+#include "mp_state.h"
+#include "mp_repeat.h"
 /* Default Includes */
 #include <stdio.h>
 #include <stdlib.h>
@@ -52,17 +54,19 @@ int port = 11211;
 int ipv = AF_UNSPEC;
 thresholds *time_thresholds = NULL;
 
+/** Connection state kept between repeated probes. */
+struct memcached_probe {
+    int socket;                     /** < Connected socket or -1. */
+    int busy;                       /** < Last probe did not finish. */
+    char *target;                   /** < State store target. */
+    char *version;                  /** < Memcached version. */
+};
+
+void memcached_probe(void *data);
+
 int main (int argc, char **argv) {
     /* Local Vars */
-    int socket;
-    char *line;
-    char *key;
-    char *value;
-    char *mc_version = NULL;
-    int mc_bytes = -1;              /** < Memory used now. */
-    int mc_limit_maxbytes = -1;     /** < Memory limit configured. */
-    struct timeval start_time;
-    double time_delta;
+    struct memcached_probe probe = { -1, 0, NULL, NULL };
 
     /* Set signal handling and alarm */
     if (signal (SIGALRM, timeout_alarm_handler) == SIG_ERR)
@@ -75,23 +79,49 @@ int main (int argc, char **argv) {
     /* Start plugin timeout */
     alarm(mp_timeout);
 
+    mp_asprintf(&probe.target, "%s:%d", hostname, port);
+
+    mp_repeat_run(memcached_probe, &probe);
+}
+
+void memcached_probe(void *data) {
+    struct memcached_probe *probe = data;
+    char *line;
+    char *key;
+    char *value;
+    int mc_bytes = -1;              /** < Memory used now. */
+    int mc_limit_maxbytes = -1;     /** < Memory limit configured. */
+    struct timeval start_time;
+    double time_delta;
+
+    // Drop a connection left over by a failed probe
+    if (probe->busy && probe->socket >= 0) {
+        mp_disconnect(probe->socket);
+        probe->socket = -1;
+    }
+    probe->busy = 1;
+
+    free(probe->version);
+    probe->version = NULL;
+
     // Connect to Server
     gettimeofday(&start_time, NULL);
-    socket = mp_connect(hostname, port, ipv, SOCK_STREAM);
+    if (probe->socket < 0)
+        probe->socket = mp_connect(hostname, port, ipv, SOCK_STREAM);
 
     if (mp_verbose > 3)
         printf("> 'stats'\n");
-    send(socket, "stats\r\n", 7, 0);
+    send(probe->socket, "stats\r\n", 7, 0);
 
     while (1) {
-        line = mp_recv_line(socket);
+        line = mp_recv_line(probe->socket);
 
         if (strncmp(line, "STAT ", 5) == 0) {
             value = line+5;
             key = strsep(&value, " ");
 
             if (strcmp(key, "version") == 0) {
-                mc_version = mp_strdup(value);
+                probe->version = mp_strdup(value);
             } else if (!mp_showperfdata) {
                 // End
             } else if (strcmp(key, "limit_maxbytes") == 0) {
@@ -101,6 +131,8 @@ int main (int argc, char **argv) {
             } else if (strcmp(key, "total_connections") == 0) {
                 mp_perfdata_int("connections", strtol(value, NULL, 10),
                         "c", NULL);
+                mp_perfdata_rate("connections_rate", probe->target,
+                        strtoull(value, NULL, 10), MP_COUNTER64, "");
             } else if (strcmp(key, "total_items") == 0) {
                 mp_perfdata_int("total_items", strtol(value, NULL, 10),
                         "c", NULL);
@@ -110,22 +142,29 @@ int main (int argc, char **argv) {
             } else if (strcmp(key, "evictions") == 0) {
                 mp_perfdata_int("evictions", strtol(value, NULL, 10),
                         "c", NULL);
+                mp_perfdata_rate("evictions_rate", probe->target,
+                        strtoull(value, NULL, 10), MP_COUNTER64, "");
             } else if (strncmp(key, "cmd_", 4) == 0) {
                 mp_perfdata_int(key+4, strtol(value, NULL, 10), "c", NULL);
             }
         } else if (strncmp(line, "END", 3) == 0) {
             break;
         } else {
+            free(line);
             critical("Memcached don't handle stats command.");
         }
         free(line);
     }
     free(line);
 
-    // Dissconnect
-    send(socket, "quit\r\n", 6, 0);
-    mp_disconnect(socket);
+    // Dissconnect, keep the connection for the next repeat
+    if (!mp_repeat) {
+        send(probe->socket, "quit\r\n", 6, 0);
+        mp_disconnect(probe->socket);
+        probe->socket = -1;
+    }
     time_delta = mp_time_delta(start_time);
+    probe->busy = 0;
 
     if (mp_showperfdata) {
         mp_perfdata_int3("bytes", mc_bytes, "", 0, 0, 0, 0,
@@ -135,19 +174,15 @@ int main (int argc, char **argv) {
 
     switch(get_status(time_delta, time_thresholds)) {
         case STATE_OK:
-            free_threshold(time_thresholds);
-            ok("Memcached %s", mc_version);
+            ok("Memcached %s", probe->version);
             break;
         case STATE_WARNING:
-            free_threshold(time_thresholds);
-            ok("Memcached %s is slow.", mc_version);
+            ok("Memcached %s is slow.", probe->version);
             break;
         case STATE_CRITICAL:
-            free_threshold(time_thresholds);
-            ok("Memcached %s is real slow.", mc_version);
+            ok("Memcached %s is real slow.", probe->version);
             break;
     }
-    free_threshold(time_thresholds);
 
     critical("You should never reach this point.");
 }
@@ -160,6 +195,7 @@ int process_arguments (int argc, char **argv) {
         MP_LONGOPTS_DEFAULT,
         MP_LONGOPTS_HOST,
         MP_LONGOPTS_PORT,
+        MP_LONGOPTS_REPEAT,
         // PLUGIN OPTS
         MP_LONGOPTS_END
     };
@@ -217,6 +253,7 @@ void print_help (void) {
 #endif //USE_IPV6
     print_help_warn_time("3s");
     print_help_crit_time("4s");
+    print_help_repeat();
 }
 
 /* vim: set ts=4 sw=4 et syn=c : */
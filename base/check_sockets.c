@@ -32,6 +32,7 @@ const char *progusage = "--tcp <PORT> [-w <warning count>] [-c <critical count>]
 
 /* MP Includes */
 #include "mp_common.h"
+#include "mp_procfile.h"
 /* Default Includes */
 #include <stdio.h>
 #include <signal.h>
@@ -260,33 +261,38 @@ int main (int argc, char **argv) {
 }
 
 int countSocket(const char *filename, int port) {
-    FILE *input;
-    char buffer[256];
-    char *c, *next;
+    mp_procfile *input;
+    mp_slice line, field, local;
     int count = 0;
 
-    input = fopen(filename, "r");
+    input = mp_procfile_open(filename);
     if (input == NULL)
         return -1;
 
-    if (fgets(buffer, 256, input) == NULL) {
+    if (mp_procfile_read(input) != OK) {
+        mp_procfile_close(input);
+        return -1;
+    }
+
+    /* Skip header */
+    if (!mp_procfile_line(input, &line)) {
         warning("Can't read %s.", filename);
     }
 
-    while (fgets(buffer, 256, input) != NULL) {
-        if (port > 0) {
-            next = buffer;
-            strsep(&next, ":");
-            strsep(&next, ":");
-            c = strsep(&next, " ");
-            if(port == strtol(c, NULL, 16)) {
+    if (port > 0) {
+        while (mp_procfile_line(input, &line)) {
+            /* sl, local_address */
+            if (!mp_slice_field(&line, &field) || !mp_slice_field(&line, &local))
+                continue;
+            mp_slice_token(&local, ':', &field);
+            if (port == (int)mp_slice_hex(&local)) {
                 count++;
             }
-        } else {
-            count++;
         }
+    } else {
+        count = (int)mp_procfile_count_lines(input);
     }
-    fclose(input);
+    mp_procfile_close(input);
 
     return count;
 }
@@ -0,0 +1,256 @@
+/***
+ * Monitoring Plugin - mp_stats.c
+ **
+ *
+ * mp_stats - Dump the self-metrics recorded by the plugins.
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+const char *progname  = "mp_stats";
+const char *progdesc  = "Dump the self-metrics recorded by the plugins.";
+const char *progvers  = "0.1";
+const char *progcopy  = "2012";
+const char *progauth  = "Marius Rieder <marius.rieder@durchmesser.ch>";
+const char *progusage = "[--file <FILE>] [--init] [--openmetrics]";
+
+/* MP Includes */
+#include "mp_common.h"
+#include "mp_stats.h"
+/* Default Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Global Vars */
+int init = 0;
+int openmetrics = 0;
+
+/* Function prototype */
+int compare_wall(const void *a, const void *b);
+double bucket_quantile(const struct mp_stats_entry *e, double q);
+void print_text(struct mp_stats_entry **list, int num);
+void print_openmetrics(struct mp_stats_entry **list, int num);
+
+int main (int argc, char **argv) {
+    /* Local Vars */
+    struct mp_stats_entry *slots;
+    struct mp_stats_entry **list;
+    int slots_num = 0;
+    int num = 0;
+    int i;
+
+    /* Process check arguments */
+    if (process_arguments(argc, argv) != OK)
+        unknown("Parsing arguments failed!");
+
+    if (mp_stats_open(init) != OK) {
+        fprintf(stderr, "Can't open stats file %s\n", mp_stats_file);
+        exit(1);
+    }
+    if (init) {
+        mp_stats_close();
+        exit(0);
+    }
+
+    slots = mp_stats_entries(&slots_num);
+    list = mp_malloc(sizeof(struct mp_stats_entry *) * slots_num);
+    for (i = 0; i < slots_num; i++) {
+        if (__atomic_load_n(&slots[i].ready, __ATOMIC_ACQUIRE))
+            list[num++] = &slots[i];
+    }
+    qsort(list, num, sizeof(struct mp_stats_entry *), compare_wall);
+
+    if (openmetrics)
+        print_openmetrics(list, num);
+    else
+        print_text(list, num);
+
+    free(list);
+    mp_stats_close();
+
+    return 0;
+}
+
+int compare_wall(const void *a, const void *b) {
+    const struct mp_stats_entry *ea = *(struct mp_stats_entry * const *)a;
+    const struct mp_stats_entry *eb = *(struct mp_stats_entry * const *)b;
+
+    if (ea->wall_usec != eb->wall_usec)
+        return ea->wall_usec < eb->wall_usec ? 1 : -1;
+    return strcmp(ea->name, eb->name);
+}
+
+double bucket_quantile(const struct mp_stats_entry *e, double q) {
+    uint64_t runs = 0, sum = 0;
+    int i;
+
+    for (i = 0; i < MP_STATS_BUCKETS; i++)
+        runs += e->wall[i];
+    for (i = 0; i < MP_STATS_BUCKETS; i++) {
+        sum += e->wall[i];
+        if (sum && sum >= q * runs)
+            return mp_stats_bucket_le(i);
+    }
+    return 0;
+}
+
+void print_text(struct mp_stats_entry **list, int num) {
+    struct mp_stats_entry *e;
+    double p95;
+    int i;
+
+    printf("%-24s %8s %7s %7s %7s %7s %7s %10s %9s %9s %9s %8s\n",
+            "plugin", "runs", "ok", "warn", "crit", "unknown", "timeout",
+            "wall[s]", "avg[s]", "p95[s]", "cpu[s]", "rss[kB]");
+
+    for (i = 0; i < num; i++) {
+        e = list[i];
+        if (e->runs == 0)
+            continue;
+        p95 = bucket_quantile(e, 0.95);
+        printf("%-24s %8llu %7llu %7llu %7llu %7llu %7llu %10.3f %9.3f ",
+                e->name, (unsigned long long)e->runs,
+                (unsigned long long)e->state[0],
+                (unsigned long long)e->state[1],
+                (unsigned long long)e->state[2],
+                (unsigned long long)e->state[3],
+                (unsigned long long)e->timeouts,
+                e->wall_usec / 1000000.0,
+                e->wall_usec / 1000000.0 / e->runs);
+        if (p95 < 0)
+            printf("%9s ", "+Inf");
+        else
+            printf("%9.3f ", p95);
+        printf("%9.3f %8llu\n", e->cpu_usec / 1000000.0,
+                (unsigned long long)e->maxrss);
+    }
+}
+
+void print_openmetrics(struct mp_stats_entry **list, int num) {
+    const char *states[] = {"ok", "warning", "critical", "unknown"};
+    struct mp_stats_entry *e;
+    uint64_t sum;
+    int i, j;
+
+    printf("# TYPE monitoringplug_runs counter\n");
+    printf("# HELP monitoringplug_runs Plugin runs by exit state.\n");
+    for (i = 0; i < num; i++) {
+        for (j = 0; j < 4; j++)
+            printf("monitoringplug_runs_total{plugin=\"%s\",state=\"%s\"} %llu\n",
+                    list[i]->name, states[j],
+                    (unsigned long long)list[i]->state[j]);
+    }
+
+    printf("# TYPE monitoringplug_timeouts counter\n");
+    printf("# HELP monitoringplug_timeouts Plugin runs hitting the deadline.\n");
+    for (i = 0; i < num; i++)
+        printf("monitoringplug_timeouts_total{plugin=\"%s\"} %llu\n",
+                list[i]->name, (unsigned long long)list[i]->timeouts);
+
+    printf("# TYPE monitoringplug_cpu_seconds counter\n");
+    printf("# HELP monitoringplug_cpu_seconds User and system CPU time.\n");
+    for (i = 0; i < num; i++)
+        printf("monitoringplug_cpu_seconds_total{plugin=\"%s\"} %.6f\n",
+                list[i]->name, list[i]->cpu_usec / 1000000.0);
+
+    printf("# TYPE monitoringplug_maxrss_bytes gauge\n");
+    printf("# HELP monitoringplug_maxrss_bytes Largest max RSS of a run.\n");
+    for (i = 0; i < num; i++)
+        printf("monitoringplug_maxrss_bytes{plugin=\"%s\"} %llu\n",
+                list[i]->name, (unsigned long long)list[i]->maxrss * 1024);
+
+    printf("# TYPE monitoringplug_wall_seconds histogram\n");
+    printf("# HELP monitoringplug_wall_seconds Wall time of a run.\n");
+    for (i = 0; i < num; i++) {
+        e = list[i];
+        for (sum = 0, j = 0; j < MP_STATS_BUCKETS; j++) {
+            sum += e->wall[j];
+            if (j == MP_STATS_BUCKETS - 1)
+                printf("monitoringplug_wall_seconds_bucket{plugin=\"%s\",le=\"+Inf\"} %llu\n",
+                        e->name, (unsigned long long)sum);
+            else
+                printf("monitoringplug_wall_seconds_bucket{plugin=\"%s\",le=\"%g\"} %llu\n",
+                        e->name, mp_stats_bucket_le(j), (unsigned long long)sum);
+        }
+        printf("monitoringplug_wall_seconds_count{plugin=\"%s\"} %llu\n",
+                e->name, (unsigned long long)sum);
+        printf("monitoringplug_wall_seconds_sum{plugin=\"%s\"} %.6f\n",
+                e->name, e->wall_usec / 1000000.0);
+    }
+
+    printf("# EOF\n");
+}
+
+int process_arguments (int argc, char **argv) {
+    int c;
+    int option = 0;
+
+    static struct option longopts[] = {
+        MP_LONGOPTS_DEFAULT,
+        {"file", required_argument, 0, 'f'},
+        {"init", no_argument, 0, 'i'},
+        {"openmetrics", no_argument, 0, 'o'},
+        MP_LONGOPTS_END
+    };
+
+    while (1) {
+        c = mp_getopt(&argc, &argv, MP_OPTSTR_DEFAULT"f:io", longopts, &option);
+
+        if (c == -1 || c == EOF)
+            break;
+
+        switch (c) {
+            case 'f':
+                mp_stats_file = optarg;
+                break;
+            case 'i':
+                init = 1;
+                break;
+            case 'o':
+                openmetrics = 1;
+                break;
+        }
+    }
+
+    return(OK);
+}
+
+void print_help (void) {
+    print_revision();
+    print_copyright();
+
+    printf("\n");
+
+    printf("Description: %s", progdesc);
+
+    printf("\n\n");
+
+    print_usage();
+
+    print_help_default();
+    printf(" -f, --file=FILE\n");
+    printf("      Stats file to read. (Default to %s)\n", MP_STATS_FILE);
+    printf(" -i, --init\n");
+    printf("      Create the stats file. Plugins only record if it exists.\n");
+    printf(" -o, --openmetrics\n");
+    printf("      Print in OpenMetrics text format.\n");
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
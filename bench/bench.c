@@ -0,0 +1,183 @@
+/***
+ * Monitoring Plugin Benchmarks - bench.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+const char *progname  = "bench";
+const char *progdesc  = "Benchmark monitoringplug library functions.";
+const char *progvers  = "0.1";
+const char *progcopy  = "2012";
+const char *progauth  = "Marius Rieder <marius.rieder@durchmesser.ch>";
+const char *progusage = "[-r <repetitions>] [-b <batch time>] [-w <warmup time>] [-f <filter>]";
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Allocation counting by linker --wrap. */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+void * volatile mp_bench_sink;
+
+static unsigned long bench_allocs = 0;
+static unsigned long long bench_alloc_bytes = 0;
+static int bench_repetitions = 21;
+static double bench_batch_time = 0.01;
+static double bench_warmup_time = 0.1;
+static const char *bench_filter = NULL;
+static int bench_count = 0;
+
+void *__wrap_malloc(size_t size) {
+    bench_allocs++;
+    bench_alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+    bench_allocs++;
+    bench_alloc_bytes += nmemb * size;
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    bench_allocs++;
+    bench_alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int bench_cmp(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+void mp_bench_run(const char *name, mp_bench_func func, void *data) {
+    double *samples;
+    double start, elapsed;
+    long iterations = 1;
+    unsigned long allocs;
+    unsigned long long bytes;
+    int i, p99;
+
+    if (bench_filter && strstr(name, bench_filter) == NULL)
+        return;
+
+    /* Calibrate batch size */
+    for (;;) {
+        start = bench_now();
+        func(iterations, data);
+        elapsed = bench_now() - start;
+        if (elapsed >= bench_batch_time || iterations >= (1L << 30))
+            break;
+        iterations *= elapsed > 0 ? 2 : 16;
+    }
+
+    /* Warmup */
+    start = bench_now();
+    while (bench_now() - start < bench_warmup_time)
+        func(iterations, data);
+
+    /* Measure */
+    samples = mp_malloc(sizeof(double) * bench_repetitions);
+    allocs = bench_allocs;
+    bytes = bench_alloc_bytes;
+    for (i = 0; i < bench_repetitions; i++) {
+        start = bench_now();
+        func(iterations, data);
+        samples[i] = (bench_now() - start) * 1e9 / iterations;
+    }
+    allocs = bench_allocs - allocs;
+    bytes = bench_alloc_bytes - bytes;
+
+    qsort(samples, bench_repetitions, sizeof(double), bench_cmp);
+    p99 = (bench_repetitions * 99 + 99) / 100 - 1;
+
+    printf("%s    {\"name\": \"%s\", \"iterations\": %ld, \"repetitions\": %d, "
+            "\"ns_per_op\": {\"min\": %.2f, \"median\": %.2f, \"p99\": %.2f}, "
+            "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f}",
+            bench_count ? ",\n" : "", name, iterations, bench_repetitions,
+            samples[0], samples[bench_repetitions / 2], samples[p99],
+            (double)allocs / ((double)iterations * bench_repetitions),
+            (double)bytes / ((double)iterations * bench_repetitions));
+    fflush(stdout);
+    bench_count++;
+
+    free(samples);
+}
+
+int main(int argc, char **argv) {
+    int c;
+
+    while ((c = getopt(argc, argv, "r:b:w:f:h")) != -1) {
+        switch (c) {
+            case 'r':
+                bench_repetitions = (int)strtol(optarg, NULL, 10);
+                break;
+            case 'b':
+                bench_batch_time = strtod(optarg, NULL);
+                break;
+            case 'w':
+                bench_warmup_time = strtod(optarg, NULL);
+                break;
+            case 'f':
+                bench_filter = optarg;
+                break;
+            default:
+                print_help();
+                exit(STATE_UNKNOWN);
+        }
+    }
+    if (bench_repetitions < 1)
+        bench_repetitions = 1;
+
+    printf("{\"program\": \"%s\", \"version\": \"%s\", \"results\": [\n",
+            argv[0], PACKAGE_VERSION);
+    bench_suite();
+    printf("\n]}\n");
+
+    return 0;
+}
+
+void print_help(void) {
+    print_usage();
+    printf(" -r  Repetitions to time. (default 21)\n");
+    printf(" -b  Minimal batch time in seconds. (default 0.01)\n");
+    printf(" -w  Warmup time in seconds. (default 0.1)\n");
+    printf(" -f  Only run benchmarks containing this string.\n");
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
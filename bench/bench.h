@@ -0,0 +1,60 @@
+/***
+ * Monitoring Plugin Benchmarks - bench.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "mp_common.h"
+
+/**
+ * Benchmark function prototype.
+ * \param[in] iterations Number of operations to run.
+ * \param[in] data Benchmark specific data.
+ */
+typedef void (*mp_bench_func)(long iterations, void *data);
+
+/** Sink to keep the compiler from optimizing results away. */
+extern void * volatile mp_bench_sink;
+
+/** Keep a result alive. */
+#define MP_BENCH_KEEP(x) (mp_bench_sink = (void *)(intptr_t)(x))
+
+/**
+ * Run and report a benchmark.
+ * Warm up, calibrate the batch size and time the configured number of
+ * repetitions. Print the result as JSON object.
+ * \param[in] name Benchmark name.
+ * \param[in] func Benchmark function.
+ * \param[in] data Data passed to func.
+ */
+void mp_bench_run(const char *name, mp_bench_func func, void *data);
+
+/**
+ * Register all benchmarks of a program.
+ * Needs to be implemented by each benchmark program.
+ */
+void bench_suite(void);
+
+#endif /* _BENCH_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
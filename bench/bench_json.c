@@ -0,0 +1,166 @@
+/***
+ * Monitoring Plugin Benchmarks - bench_json.c
+ **
+ *
+ * Copyright (C) 2014 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "bench.h"
+#include "json_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Chunk size like libcurl write callbacks. */
+#define BENCH_JSON_CHUNK    16384
+
+typedef struct {
+    char *doc;
+    size_t len;
+} bench_json_data;
+
+static const char *bench_json_paths[] = {
+    "rabbitmq_version",
+    "queue_totals.messages",
+    "queue_totals.messages_ready",
+    "queue_totals.messages_unacknowledged",
+    "message_stats.publish",
+    "message_stats.publish_details.rate",
+    "object_totals.queues",
+    "object_totals.consumers",
+};
+#define BENCH_JSON_PATHS (sizeof(bench_json_paths) / sizeof(bench_json_paths[0]))
+
+/**
+ * Build a RabbitMQ overview like document with a large queue list in
+ * front of the checked members.
+ */
+static void bench_json_doc(bench_json_data *data, size_t size) {
+    char buf[512];
+    size_t len, alloc = size + 1024;
+    long i;
+
+    data->doc = mp_malloc(alloc);
+    len = (size_t)mp_snprintf(data->doc, alloc,
+            "{\"rabbitmq_version\": \"3.8.2\", \"queues\": [");
+    for (i = 0; len < size; i++) {
+        mp_snprintf(buf, sizeof(buf), "%s{\"name\": \"queue-%ld\", "
+                "\"vhost\": \"/\", \"durable\": true, \"messages\": %ld, "
+                "\"message_stats\": {\"publish\": %ld, \"publish_details\": "
+                "{\"rate\": %ld.5}}, \"arguments\": {}, \"policy\": null, "
+                "\"consumers\": [\"amq.ctag-\\u0041%ld\"]}",
+                i ? ", " : "", i, i * 3, i * 7, i & 31, i);
+        if (len + strlen(buf) + 512 > alloc)
+            break;
+        memcpy(data->doc + len, buf, strlen(buf));
+        len += strlen(buf);
+    }
+    len += (size_t)mp_snprintf(data->doc + len, alloc - len, "], "
+            "\"queue_totals\": {\"messages\": 42, \"messages_ready\": 40, "
+            "\"messages_unacknowledged\": 2}, \"message_stats\": "
+            "{\"publish\": 1234, \"publish_details\": {\"rate\": 12.5}}, "
+            "\"object_totals\": {\"queues\": %ld, \"consumers\": %ld}}",
+            i, i);
+    data->len = len;
+}
+
+static void bench_json_tokener(long n, void *data) {
+    bench_json_data *d = (bench_json_data *)data;
+    struct mp_json_stream stream;
+    struct json_object *obj, *member, *value;
+    size_t off, chunk;
+    long i;
+    size_t j;
+    char *path, *seg, *next;
+
+    for (i = 0; i < n; i++) {
+        mp_json_stream_init(&stream, 0);
+        for (off = 0; off < d->len; off += chunk) {
+            chunk = d->len - off < BENCH_JSON_CHUNK ? d->len - off : BENCH_JSON_CHUNK;
+            mp_json_recv(d->doc + off, 1, chunk, &stream);
+        }
+        obj = mp_json_stream_finish(&stream);
+
+        /* The lookups the checks do on the tree */
+        for (j = 0; j < BENCH_JSON_PATHS; j++) {
+            path = mp_strdup(bench_json_paths[j]);
+            member = obj;
+            for (seg = path; seg; seg = next) {
+                next = strchr(seg, '.');
+                if (next)
+                    *next++ = '\0';
+                if (!mp_json_object_object_get(member, seg, &value))
+                    break;
+                member = value;
+            }
+            MP_BENCH_KEEP(json_object_get_int64(member));
+            free(path);
+        }
+        json_object_put(obj);
+    }
+}
+
+static void bench_json_scan(long n, void *data) {
+    bench_json_data *d = (bench_json_data *)data;
+    struct mp_json_path paths[BENCH_JSON_PATHS];
+    struct mp_json_scan scan;
+    size_t off, chunk;
+    long i;
+    size_t j;
+
+    memset(paths, 0, sizeof(paths));
+    for (j = 0; j < BENCH_JSON_PATHS; j++)
+        paths[j].path = bench_json_paths[j];
+
+    for (i = 0; i < n; i++) {
+        mp_json_scan_init(&scan, paths, BENCH_JSON_PATHS, 0);
+        for (off = 0; off < d->len; off += chunk) {
+            chunk = d->len - off < BENCH_JSON_CHUNK ? d->len - off : BENCH_JSON_CHUNK;
+            mp_json_scan_recv(d->doc + off, 1, chunk, &scan);
+        }
+        MP_BENCH_KEEP(mp_json_scan_finish(&scan));
+        for (j = 0; j < BENCH_JSON_PATHS; j++)
+            MP_BENCH_KEEP(mp_json_path_int(&paths[j], 0));
+    }
+    mp_json_paths_free(paths, BENCH_JSON_PATHS);
+}
+
+void bench_suite(void) {
+    const size_t sizes[] = { 64 * 1024, 10 * 1024 * 1024 };
+    bench_json_data data;
+    char *name;
+    size_t i;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_json_doc(&data, sizes[i]);
+
+        mp_asprintf(&name, "json_tokener_paths_%zuk", sizes[i] / 1024);
+        mp_bench_run(name, bench_json_tokener, &data);
+        free(name);
+
+        mp_asprintf(&name, "mp_json_scan_paths_%zuk", sizes[i] / 1024);
+        mp_bench_run(name, bench_json_scan, &data);
+        free(name);
+
+        free(data.doc);
+    }
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
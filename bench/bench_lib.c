@@ -0,0 +1,243 @@
+/***
+ * Monitoring Plugin Benchmarks - bench_lib.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "bench.h"
+#include "mp_eopt.h"
+#include "mp_procfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void bench_parse_range_string(long n, void *data) {
+    const char **str = (const char **)data;
+    range r;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        parse_range_string(&r, str[i & 3], BISI);
+        MP_BENCH_KEEP(r.alert_on);
+    }
+}
+
+static void bench_get_status(long n, void *data) {
+    thresholds *t = (thresholds *)data;
+    long i;
+
+    for (i = 0; i < n; i++)
+        MP_BENCH_KEEP(get_status((double)(i & 127), t));
+}
+
+static void bench_perfdata_int(long n, void *data) {
+    thresholds *t = (thresholds *)data;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        mp_perfdata_int("label", i, "B", t);
+        if ((i & 15) == 15) {
+            free(mp_perfdata);
+            mp_perfdata = NULL;
+        }
+    }
+    free(mp_perfdata);
+    mp_perfdata = NULL;
+}
+
+static void bench_perfdata_int3(long n, void *data) {
+    long i;
+
+    for (i = 0; i < n; i++) {
+        mp_perfdata_int3("label", i, "B", 1, 50, 1, 100, 1, 0, 1, 1024);
+        if ((i & 15) == 15) {
+            free(mp_perfdata);
+            mp_perfdata = NULL;
+        }
+    }
+    free(mp_perfdata);
+    mp_perfdata = NULL;
+}
+
+static void bench_perfdata_float(long n, void *data) {
+    thresholds *t = (thresholds *)data;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        mp_perfdata_float("label", (float)i / 3, "s", t);
+        if ((i & 15) == 15) {
+            free(mp_perfdata);
+            mp_perfdata = NULL;
+        }
+    }
+    free(mp_perfdata);
+    mp_perfdata = NULL;
+}
+
+static void bench_is_url(long n, void *data) {
+    const char **str = (const char **)data;
+    long i;
+
+    for (i = 0; i < n; i++)
+        MP_BENCH_KEEP(is_url(str[i & 3]));
+}
+
+static void bench_is_hostname(long n, void *data) {
+    const char **str = (const char **)data;
+    long i;
+
+    for (i = 0; i < n; i++)
+        MP_BENCH_KEEP(is_hostname(str[i & 3]));
+}
+
+static void bench_strcat_space(long n, void *data) {
+    char *s = NULL;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        mp_strcat_space(&s, (char *)data);
+        if ((i & 15) == 15) {
+            free(s);
+            s = NULL;
+        }
+    }
+    free(s);
+}
+
+static void bench_strcat_comma(long n, void *data) {
+    char *s = NULL;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        mp_strcat_comma(&s, (char *)data);
+        if ((i & 15) == 15) {
+            free(s);
+            s = NULL;
+        }
+    }
+    free(s);
+}
+
+static void bench_eopt(long n, void *data) {
+    char *argv[] = {"bench", "--eopt", (char *)data, "--last", NULL};
+    char **new_argv;
+    int argc, j;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        argc = 4;
+        optind = 2;
+        new_argv = mp_eopt(&argc, argv, NULL);
+        for (j = 3; j < argc - 1; j++)
+            free(new_argv[j]);
+        free(new_argv);
+    }
+}
+
+static void bench_procfile_sockets(long n, void *data) {
+    mp_procfile *pf;
+    mp_slice line, field, local;
+    long i, count;
+
+    pf = mp_procfile_open((const char *)data);
+    for (i = 0; i < n; i++) {
+        count = 0;
+        mp_procfile_read(pf);
+        mp_procfile_line(pf, &line);
+        while (mp_procfile_line(pf, &line)) {
+            if (!mp_slice_field(&line, &field) || !mp_slice_field(&line, &local))
+                continue;
+            mp_slice_token(&local, ':', &field);
+            if (mp_slice_hex(&local) == 0x50)
+                count++;
+        }
+        MP_BENCH_KEEP(count);
+    }
+    mp_procfile_close(pf);
+}
+
+void bench_suite(void) {
+    const char *ranges[] = {"10", "10:20", "~:20", "@10.5:20.5"};
+    const char *urls[] = {"http://www.example.com/", "https://example.com:8443/path?q=1",
+        "ftp://ftp.example.com/pub/", "no url"};
+    const char *hosts[] = {"localhost", "www.example.com",
+        "a-very-long-host-name.sub.domain.example.com", "-invalid-"};
+    thresholds *t;
+    char tmpl[] = "/tmp/mp_bench_eopt_XXXXXX";
+    char *eopt;
+    FILE *fp;
+    int fd, i;
+
+    mp_showperfdata = 1;
+
+    t = mp_calloc(1, sizeof(thresholds));
+    mp_threshold_set_warning(&t, "50", NOEXT);
+    mp_threshold_set_critical(&t, "100", NOEXT);
+
+    mp_bench_run("parse_range_string", bench_parse_range_string, ranges);
+    mp_bench_run("get_status", bench_get_status, t);
+    mp_bench_run("mp_perfdata_int", bench_perfdata_int, t);
+    mp_bench_run("mp_perfdata_int3", bench_perfdata_int3, t);
+    mp_bench_run("mp_perfdata_float", bench_perfdata_float, t);
+    mp_bench_run("is_url", bench_is_url, urls);
+    mp_bench_run("is_hostname", bench_is_hostname, hosts);
+    mp_bench_run("mp_strcat_space", bench_strcat_space, "value");
+    mp_bench_run("mp_strcat_comma", bench_strcat_comma, "value");
+
+    /* Ini with 64 sections, lookup the last one. */
+    fd = mkstemp(tmpl);
+    if (fd >= 0) {
+        fp = fdopen(fd, "w");
+        for (i = 0; i < 64; i++)
+            fprintf(fp, "[section%d]\nhostname=host%d.example.com\nport=%d\n"
+                    "community=public\nverbose\n\n", i, i, 1000 + i);
+        fclose(fp);
+
+        mp_asprintf(&eopt, "section63@%s", tmpl);
+        mp_bench_run("mp_eopt", bench_eopt, eopt);
+        free(eopt);
+        unlink(tmpl);
+    }
+
+    /* /proc/net/tcp like file with 4096 sockets */
+    strcpy(tmpl, "/tmp/mp_bench_tcp_XXXXXX");
+    fd = mkstemp(tmpl);
+    if (fd >= 0) {
+        fp = fdopen(fd, "w");
+        fprintf(fp, "  sl  local_address rem_address   st tx_queue rx_queue tr "
+                "tm->when retrnsmt   uid  timeout inode\n");
+        for (i = 0; i < 4096; i++)
+            fprintf(fp, "%4d: 0100007F:%04X 0100007F:%04X 01 00000000:00000000 "
+                    "00:00000000 00000000  1000        0 %d 1 0000000000000000 "
+                    "20 4 30 10 -1\n", i, 80 + i % 4, 30000 + i, 100000 + i);
+        fclose(fp);
+
+        mp_bench_run("mp_procfile_sockets_4096", bench_procfile_sockets, tmpl);
+        unlink(tmpl);
+    }
+
+    free(t->warning);
+    free(t->critical);
+    free(t);
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
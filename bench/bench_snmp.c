@@ -0,0 +1,406 @@
+/***
+ * Monitoring Plugin Benchmarks - bench_snmp.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "bench.h"
+#include "snmp_utils.h"
+#include "snmp_v3cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Referenced by snmp_utils.c */
+char *hostname = NULL;
+int port = 0;
+
+typedef struct {
+    mp_snmp_subtree subtree;
+    struct mp_snmp_table table;
+    size_t rows;
+} bench_snmp_data;
+
+static const oid ifEntry[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1 };
+static const oid ifDescr[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2 };
+static const oid ifOperStatus[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 8 };
+
+/**
+ * Init a stack variable to name.idx = value.
+ */
+static void bench_snmp_var(netsnmp_variable_list *var, const oid *name,
+        size_t name_len, oid idx, u_char type, const void *value, size_t len) {
+    oid buf[MAX_OID_LEN];
+
+    memcpy(buf, name, name_len * sizeof(oid));
+    buf[name_len] = idx;
+    memset(var, 0, sizeof(*var));
+    snmp_set_var_objid(var, buf, name_len + 1);
+    snmp_set_var_typed_value(var, type, (const u_char *)value, len);
+}
+
+/**
+ * Build a synthetic ifTable like subtree with descr and oper status
+ * columns.
+ */
+static void bench_snmp_table(bench_snmp_data *data, size_t rows) {
+    netsnmp_variable_list var;
+    char descr[32];
+    long status = 1;
+    size_t i;
+
+    data->rows = rows;
+    memset(&data->subtree, 0, sizeof(data->subtree));
+
+    for (i = 0; i < rows; i++) {
+        mp_snprintf(descr, sizeof(descr), "eth%zu", i);
+        bench_snmp_var(&var, ifDescr, OID_LENGTH(ifDescr), i + 1,
+                ASN_OCTET_STR, descr, strlen(descr));
+        mp_snmp_subtree_add(&data->subtree, &var);
+    }
+
+    for (i = 0; i < rows; i++) {
+        bench_snmp_var(&var, ifOperStatus, OID_LENGTH(ifOperStatus), i + 1,
+                ASN_INTEGER, &status, sizeof(status));
+        mp_snmp_subtree_add(&data->subtree, &var);
+    }
+}
+
+/**
+ * Build a 100k varbind response chain alternating counter and string
+ * columns, as a walk of a large ifTable would receive it.
+ */
+static netsnmp_variable_list *bench_snmp_walk_vars(size_t num) {
+    netsnmp_variable_list *vars;
+    char descr[32];
+    long counter;
+    size_t i;
+
+    vars = mp_calloc(num, sizeof(netsnmp_variable_list));
+    for (i = 0; i < num; i++) {
+        if (i % 2) {
+            counter = i * 1000;
+            bench_snmp_var(&vars[i], ifOperStatus, OID_LENGTH(ifOperStatus),
+                    i / 2 + 1, ASN_COUNTER, &counter, sizeof(counter));
+        } else {
+            mp_snprintf(descr, sizeof(descr), "GigabitEthernet1/0/%zu", i / 2);
+            bench_snmp_var(&vars[i], ifDescr, OID_LENGTH(ifDescr),
+                    i / 2 + 1, ASN_OCTET_STR, descr, strlen(descr));
+        }
+        vars[i].next_variable = i + 1 < num ? &vars[i + 1] : NULL;
+    }
+
+    return vars;
+}
+
+static void bench_subtree_walk(long n, void *data) {
+    netsnmp_variable_list *vars = (netsnmp_variable_list *)data;
+    netsnmp_variable_list *var;
+    mp_snmp_subtree subtree;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        memset(&subtree, 0, sizeof(subtree));
+        for (var = vars; var; var = var->next_variable)
+            mp_snmp_subtree_add(&subtree, var);
+        MP_BENCH_KEEP(subtree.size);
+        mp_snmp_subtree_free(&subtree);
+    }
+}
+
+/**
+ * The former subtree storage, one clone per varbind.
+ */
+static void bench_subtree_walk_clone(long n, void *data) {
+    netsnmp_variable_list *vars = (netsnmp_variable_list *)data;
+    netsnmp_variable_list *var;
+    netsnmp_variable_list **clones = NULL;
+    size_t size, alloc_size, j;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        size = alloc_size = 0;
+        for (var = vars; var; var = var->next_variable) {
+            if (alloc_size <= size) {
+                alloc_size += 16;
+                clones = mp_realloc(clones,
+                        alloc_size * sizeof(netsnmp_variable_list *));
+            }
+            clones[size] = mp_malloc(sizeof(netsnmp_variable_list));
+            snmp_clone_var(var, clones[size]);
+            size++;
+        }
+        MP_BENCH_KEEP(size);
+        for (j = 0; j < size; j++) {
+            snmp_free_var_internals(clones[j]);
+            free(clones[j]);
+        }
+        free(clones);
+        clones = NULL;
+    }
+}
+
+static void bench_subtree_get_value(long n, void *data) {
+    bench_snmp_data *d = (bench_snmp_data *)data;
+    long status, i;
+
+    for (i = 0; i < n; i++) {
+        mp_snmp_subtree_get_value(&d->subtree, ifOperStatus,
+                OID_LENGTH(ifOperStatus), i % d->rows, ASN_INTEGER,
+                (void *)&status, sizeof(status));
+        MP_BENCH_KEEP(status);
+    }
+}
+
+static void bench_subtree_get_value_str(long n, void *data) {
+    bench_snmp_data *d = (bench_snmp_data *)data;
+    char *descr;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        descr = NULL;
+        mp_snmp_subtree_get_value(&d->subtree, ifDescr,
+                OID_LENGTH(ifDescr), i % d->rows, ASN_OCTET_STR,
+                (void *)&descr, 0);
+        MP_BENCH_KEEP(descr);
+        free(descr);
+    }
+}
+
+static void bench_table_get_integer(long n, void *data) {
+    bench_snmp_data *d = (bench_snmp_data *)data;
+    long status, i;
+
+    for (i = 0; i < n; i++) {
+        mp_snmp_table_get_integer(&d->table, 8, i % d->rows, &status);
+        MP_BENCH_KEEP(status);
+    }
+}
+
+static void bench_table_find(long n, void *data) {
+    bench_snmp_data *d = (bench_snmp_data *)data;
+    oid idx;
+    long i;
+    int row;
+
+    for (i = 0; i < n; i++) {
+        idx = i % d->rows + 1;
+        row = mp_snmp_table_find(&d->table, &idx, 1);
+        MP_BENCH_KEEP(row);
+    }
+}
+
+static void bench_parse_oid(long n, void *data) {
+    oid name[MAX_OID_LEN];
+    size_t len;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        len = MAX_OID_LEN;
+        mp_snmp_parse_oid(".1.3.6.1.2.1.31.1.1.1.6.4096", name, &len);
+        MP_BENCH_KEEP(name[len-1]);
+    }
+}
+
+static void bench_read_objid(long n, void *data) {
+    oid name[MAX_OID_LEN];
+    size_t len;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        len = MAX_OID_LEN;
+        read_objid(".1.3.6.1.2.1.31.1.1.1.6.4096", name, &len);
+        MP_BENCH_KEEP(name[len-1]);
+    }
+}
+
+/**
+ * Init and shutdown the library, data is the MIBDIRS to load the MIBs
+ * from or NULL to skip them like mp_snmp_init.
+ */
+static void bench_init_snmp(long n, void *data) {
+    const char *mibdirs = (const char *)data;
+    long i;
+
+    if (mibdirs) {
+        unsetenv("MIBS");
+        setenv("MIBDIRS", mibdirs, 1);
+    } else {
+        setenv("MIBS", "", 1);
+        setenv("MIBDIRS", "", 1);
+    }
+
+    for (i = 0; i < n; i++) {
+        init_snmp("bench_snmp");
+        snmp_shutdown("bench_snmp");
+    }
+}
+
+/**
+ * Password to key (RFC 3414 A.2), paid by every uncached SNMPv3 run,
+ * data is the auth protocol.
+ */
+static void bench_generate_Ku(long n, void *data) {
+    const oid *authproto = (const oid *)data;
+    u_char key[USM_AUTH_KU_LEN];
+    size_t len;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        len = USM_AUTH_KU_LEN;
+        generate_Ku(authproto, 10, (const u_char *)mp_snmp_authpass,
+                strlen(mp_snmp_authpass), key, &len);
+        MP_BENCH_KEEP(key[0]);
+    }
+}
+
+/**
+ * SNMPv3 session template of a cached run, data is the template.
+ */
+static void bench_v3cache_load(long n, void *data) {
+    netsnmp_session *tmpl = (netsnmp_session *)data;
+    netsnmp_session session;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        session = *tmpl;
+        MP_BENCH_KEEP(mp_snmp_v3cache_load(&session));
+        free(session.securityEngineID);
+        free(session.contextEngineID);
+        free(session.securityAuthLocalKey);
+    }
+}
+
+/**
+ * Store one agent in a fresh cache file and return its session
+ * template, NULL if the cache is not usable.
+ */
+static netsnmp_session *bench_v3cache_setup(char *file) {
+    static u_char engine[] = { 0x80, 0x00, 0x1f, 0x88, 0x80, 0x42, 0x42,
+        0x42, 0x42, 0x42, 0x42, 0x42, 0x42 };
+    static netsnmp_session session;
+    netsnmp_session ss;
+    int fd;
+
+    fd = mkstemp(file);
+    if (fd < 0)
+        return NULL;
+    close(fd);
+    mp_snmp_v3cache_file = file;
+
+    snmp_sess_init(&session);
+    session.version = SNMP_VERSION_3;
+    session.peername = "127.0.0.1:161";
+    session.securityName = "bench";
+    session.securityNameLen = strlen(session.securityName);
+    session.securityLevel = SNMP_SEC_LEVEL_AUTHNOPRIV;
+    session.securityAuthProto = usmHMACSHA1AuthProtocol;
+    session.securityAuthProtoLen = 10;
+
+    /* What a uncached run knows after generate_Ku and discovery */
+    ss = session;
+    ss.securityAuthKeyLen = USM_AUTH_KU_LEN;
+    generate_Ku(ss.securityAuthProto, ss.securityAuthProtoLen,
+            (const u_char *)mp_snmp_authpass, strlen(mp_snmp_authpass),
+            ss.securityAuthKey, &ss.securityAuthKeyLen);
+    ss.securityEngineID = engine;
+    ss.securityEngineIDLen = sizeof(engine);
+    set_enginetime(engine, sizeof(engine), 1, 1000, 1);
+    mp_snmp_v3cache_opened(&ss, 0);
+
+    if (!mp_snmp_v3cache_load(&session))
+        return NULL;
+    free(session.securityEngineID);
+    free(session.contextEngineID);
+    free(session.securityAuthLocalKey);
+    session.securityEngineID = NULL;
+    session.securityEngineIDLen = 0;
+    session.contextEngineID = NULL;
+    session.contextEngineIDLen = 0;
+    session.securityAuthLocalKey = NULL;
+    session.securityAuthLocalKeyLen = 0;
+
+    return &session;
+}
+
+void bench_suite(void) {
+    const size_t rows[] = { 16, 256, 4096 };
+    bench_snmp_data data;
+    netsnmp_variable_list *vars;
+    netsnmp_session *session;
+    char file[32];
+    char *name;
+    size_t i;
+
+    mp_bench_run("mp_snmp_parse_oid", bench_parse_oid, NULL);
+    mp_bench_run("read_objid", bench_read_objid, NULL);
+
+    mp_bench_run("init_snmp", bench_init_snmp, NULL);
+    mp_bench_run("init_snmp_mibs", bench_init_snmp,
+            (void *)NETSNMP_DEFAULT_MIBDIRS);
+
+    /* SNMPv3 key and engine cache hit against the work it saves */
+    init_snmp("bench_snmp");
+    mp_snmp_authpass = "benchpassword";
+    mp_bench_run("generate_Ku_md5", bench_generate_Ku,
+            (void *)usmHMACMD5AuthProtocol);
+    mp_bench_run("generate_Ku_sha1", bench_generate_Ku,
+            (void *)usmHMACSHA1AuthProtocol);
+    strcpy(file, "/tmp/bench_snmp.XXXXXX");
+    session = bench_v3cache_setup(file);
+    if (session)
+        mp_bench_run("mp_snmp_v3cache_load", bench_v3cache_load, session);
+    mp_snmp_v3cache_close();
+    unlink(file);
+    snmp_shutdown("bench_snmp");
+
+    vars = bench_snmp_walk_vars(100000);
+    mp_bench_run("mp_snmp_subtree_walk_100k", bench_subtree_walk, vars);
+    mp_bench_run("snmp_clone_var_walk_100k", bench_subtree_walk_clone, vars);
+    free(vars);
+
+    for (i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        bench_snmp_table(&data, rows[i]);
+
+        mp_asprintf(&name, "mp_snmp_subtree_get_value_%zu", rows[i]);
+        mp_bench_run(name, bench_subtree_get_value, &data);
+        free(name);
+
+        mp_asprintf(&name, "mp_snmp_subtree_get_value_str_%zu", rows[i]);
+        mp_bench_run(name, bench_subtree_get_value_str, &data);
+        free(name);
+
+        mp_snmp_table_build(&data.subtree, ifEntry, OID_LENGTH(ifEntry),
+                &data.table);
+
+        mp_asprintf(&name, "mp_snmp_table_get_integer_%zu", rows[i]);
+        mp_bench_run(name, bench_table_get_integer, &data);
+        free(name);
+
+        mp_asprintf(&name, "mp_snmp_table_find_%zu", rows[i]);
+        mp_bench_run(name, bench_table_find, &data);
+        free(name);
+
+        mp_snmp_table_free(&data.table);
+    }
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
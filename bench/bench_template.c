@@ -0,0 +1,49 @@
+/***
+ * Monitoring Plugin Benchmarks - bench_template.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "bench.h"
+#include "mp_template.h"
+
+#include <stdlib.h>
+
+static void bench_template_str(long n, void *data) {
+    char *out;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        out = mp_template_str((const char *)data);
+        MP_BENCH_KEEP(out);
+        free(out);
+    }
+}
+
+void bench_suite(void) {
+    mp_bench_run("mp_template_str_plain", bench_template_str,
+            "Plain template text without any substitution.\n");
+    mp_bench_run("mp_template_str_if", bench_template_str,
+            "Host [% IF 1 < 2 %]up[% ELSE %]down[% END %].\n");
+    mp_bench_run("mp_template_str_expr", bench_template_str,
+            "[% SWITCH 1 + 2 * 3 %][% CASE 6 %]six[% CASE 7 %]seven[% END %]");
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,119 @@
+#!/bin/sh
+#
+# Run the plugins against local stand-in backends and print a JSON
+# array of mp_e2e results.
+#
+# Environment:
+#   BASE      top build directory (default ..)
+#   RUNS      runs per plugin (default 10)
+#   DELAY     injected backend latency in ms (default 0)
+#   SIZE      payload size: stats lines, slaves, scoreboard slots,
+#             interfaces (default 16)
+#   SYSCALLS  count syscalls with ptrace, 0 to disable (default 1)
+#   PORT      first port to use on 127.0.0.1 (default 17700)
+#   WALKDIR   directory with 'snmpwalk -On' recordings named
+#             <plugin>.walk, replayed for the matching snmp plugin
+#   MIBDIRS   MIB directory for the *_mibs runs, which load the MIBs
+#             like the plugins did before startup skipped them
+#             (default from net-snmp-config, unset to skip these runs)
+#
+# $Id$
+
+BASE=${BASE:-..}
+RUNS=${RUNS:-10}
+DELAY=${DELAY:-0}
+SIZE=${SIZE:-16}
+SYSCALLS=${SYSCALLS:-1}
+PORT=${PORT:-17700}
+SRCDIR=${SRCDIR:-$(dirname "$0")/..}
+MIBDIRS_E2E=${MIBDIRS-$(net-snmp-config --default-mibdirs 2>/dev/null)}
+unset MIBS MIBDIRS
+
+STANDIN=./mp_standin
+E2E=./mp_e2e
+PIDS=""
+SEP=""
+
+E2EFLAGS="-n $RUNS"
+test "$SYSCALLS" != "0" && E2EFLAGS="$E2EFLAGS -s"
+
+cleanup() {
+    test -n "$PIDS" && kill $PIDS 2>/dev/null
+}
+trap cleanup EXIT INT TERM
+
+# start_standin <mode> <port> [args]
+start_standin() {
+    mode=$1
+    port=$2
+    shift 2
+    $STANDIN -m $mode -p $port -d $DELAY -n $SIZE "$@" &
+    PIDS="$PIDS $!"
+}
+
+# run <label> <plugin> [args]
+run() {
+    label=$1
+    plugin=$BASE/$2
+    shift 2
+    test -x "$plugin" || return 0
+    test -n "$SEP" && echo "$SEP"
+    $E2E $E2EFLAGS -l "$label" -- "$plugin" "$@"
+    SEP=","
+}
+
+# run_mibs <label> <plugin> [args]
+# Same as run, but with the MIBs loaded.
+run_mibs() {
+    test -n "$MIBDIRS_E2E" || return 0
+    MIBDIRS=$MIBDIRS_E2E
+    export MIBDIRS
+    run "$@"
+    unset MIBDIRS
+}
+
+P_MEMCACHED=$PORT
+P_REDIS=$(($PORT + 1))
+P_HTTP=$(($PORT + 2))
+P_FCGI=$(($PORT + 3))
+P_SNMP=$(($PORT + 4))
+
+start_standin memcached $P_MEMCACHED
+start_standin redis $P_REDIS
+start_standin http $P_HTTP
+start_standin fcgi $P_FCGI
+start_standin snmp $P_SNMP
+sleep 1
+
+echo "["
+run check_memcached base/check_memcached -H 127.0.0.1 -P $P_MEMCACHED
+run check_redis redis/check_redis -H 127.0.0.1 -P $P_REDIS
+run check_redis_slave redis/check_redis_slave -H 127.0.0.1 -P $P_REDIS
+run check_rabbitmq curl/check_rabbitmq -H 127.0.0.1 -P $P_HTTP
+run check_buildbot_slave curl/check_buildbot_slave -H 127.0.0.1 -P $P_HTTP
+run check_apache_status curl/check_apache_status -H 127.0.0.1 -P $P_HTTP
+run check_fcgi_phpfpm fcgi/check_fcgi_phpfpm -s 127.0.0.1:$P_FCGI
+run check_interface snmp/check_interface -H 127.0.0.1 -P $P_SNMP -I 1
+
+# SNMP startup with and without MIB loading
+run_mibs check_interface_mibs snmp/check_interface -H 127.0.0.1 -P $P_SNMP -I 1
+export MP_SNMP_REPLAY=$SRCDIR/tests/testdata/snmp/apc_pdu.walk
+run check_apc_pdu snmp/check_apc_pdu -H 127.0.0.1
+run_mibs check_apc_pdu_mibs snmp/check_apc_pdu -H 127.0.0.1
+unset MP_SNMP_REPLAY
+
+# Replay recorded walks
+if [ -n "$WALKDIR" ]; then
+    port=$(($PORT + 5))
+    for walk in "$WALKDIR"/*.walk; do
+        test -f "$walk" || continue
+        plugin=$(basename "$walk" .walk)
+        test -x "$BASE/snmp/$plugin" || continue
+        start_standin snmp $port -w "$walk"
+        sleep 1
+        run $plugin snmp/$plugin -H 127.0.0.1 -P $port
+        port=$(($port + 1))
+    done
+fi
+echo
+echo "]"
@@ -0,0 +1,209 @@
+/***
+ * Monitoring Plugin Benchmarks - mp_e2e.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+const char *progname  = "mp_e2e";
+const char *progdesc  = "Run a plugin repeatedly and report its resource usage.";
+const char *progvers  = "0.1";
+const char *progcopy  = "2012";
+const char *progauth  = "Marius Rieder <marius.rieder@durchmesser.ch>";
+const char *progusage = "[-n <runs>] [-l <label>] [-s] -- <plugin> [args]";
+
+#include "mp_common.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Global Vars */
+static int runs = 10;
+static int count_syscalls = 0;
+static const char *label = NULL;
+
+static double e2e_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int e2e_cmp(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+/** Fork and exec the plugin with stdout and stderr on /dev/null. */
+static pid_t e2e_spawn(char **argv, int trace) {
+    pid_t pid;
+    int fd;
+
+    pid = fork();
+    if (pid < 0)
+        critical("fork: %s", strerror(errno));
+    if (pid == 0) {
+        fd = open("/dev/null", O_WRONLY);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        if (trace)
+            ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+/**
+ * Count the syscalls of one plugin run by stepping it with ptrace.
+ * Only the main process is traced.
+ */
+static long e2e_syscalls(char **argv) {
+    pid_t pid;
+    long stops = 0;
+    int status, sig = 0;
+
+    pid = e2e_spawn(argv, 1);
+
+    /* Stopped at exec */
+    if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status))
+        return -1;
+    ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)PTRACE_O_TRACESYSGOOD);
+
+    for (;;) {
+        if (ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(long)sig) < 0)
+            return -1;
+        if (waitpid(pid, &status, 0) < 0)
+            return -1;
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+            break;
+        sig = 0;
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80))
+            stops++;
+        else
+            sig = WSTOPSIG(status);
+    }
+
+    /* Entry and exit stop per call, exit_group has no exit stop */
+    return (stops + 1) / 2;
+}
+
+int main(int argc, char **argv) {
+    struct rusage ru;
+    double *wall, *user, *sys;
+    double start;
+    long maxrss = 0, syscalls = -1;
+    int exits[5] = {0, 0, 0, 0, 0};
+    int c, i, status, code, p99;
+    pid_t pid;
+
+    while ((c = getopt(argc, argv, "+n:l:sh")) != -1) {
+        switch (c) {
+            case 'n':
+                runs = (int)strtol(optarg, NULL, 10);
+                break;
+            case 'l':
+                label = optarg;
+                break;
+            case 's':
+                count_syscalls = 1;
+                break;
+            default:
+                print_help();
+                exit(STATE_UNKNOWN);
+        }
+    }
+    argv += optind;
+    argc -= optind;
+    if (argc < 1 || runs < 1) {
+        print_help();
+        exit(STATE_UNKNOWN);
+    }
+    if (!label)
+        label = argv[0];
+
+    wall = mp_malloc(sizeof(double) * runs);
+    user = mp_malloc(sizeof(double) * runs);
+    sys = mp_malloc(sizeof(double) * runs);
+
+    for (i = 0; i < runs; i++) {
+        start = e2e_now();
+        pid = e2e_spawn(argv, 0);
+        if (wait4(pid, &status, 0, &ru) < 0)
+            critical("wait4: %s", strerror(errno));
+        wall[i] = (e2e_now() - start) * 1000;
+        user[i] = ru.ru_utime.tv_sec * 1000.0 + ru.ru_utime.tv_usec / 1000.0;
+        sys[i] = ru.ru_stime.tv_sec * 1000.0 + ru.ru_stime.tv_usec / 1000.0;
+        if (ru.ru_maxrss > maxrss)
+            maxrss = ru.ru_maxrss;
+
+        code = WIFEXITED(status) ? WEXITSTATUS(status) : 4;
+        exits[code > 3 ? 4 : code]++;
+    }
+
+    if (count_syscalls)
+        syscalls = e2e_syscalls(argv);
+
+    qsort(wall, runs, sizeof(double), e2e_cmp);
+    qsort(user, runs, sizeof(double), e2e_cmp);
+    qsort(sys, runs, sizeof(double), e2e_cmp);
+    p99 = (runs * 99 + 99) / 100 - 1;
+
+    printf("    {\"name\": \"%s\", \"runs\": %d, "
+            "\"wall_ms\": {\"min\": %.3f, \"median\": %.3f, \"p99\": %.3f}, "
+            "\"user_ms\": %.3f, \"sys_ms\": %.3f, \"maxrss_kb\": %ld, ",
+            label, runs, wall[0], wall[runs / 2], wall[p99],
+            user[runs / 2], sys[runs / 2], maxrss);
+    if (syscalls >= 0)
+        printf("\"syscalls\": %ld, ", syscalls);
+    else
+        printf("\"syscalls\": null, ");
+    printf("\"exit\": {\"ok\": %d, \"warning\": %d, \"critical\": %d, "
+            "\"unknown\": %d, \"other\": %d}}",
+            exits[0], exits[1], exits[2], exits[3], exits[4]);
+
+    free(wall);
+    free(user);
+    free(sys);
+
+    return 0;
+}
+
+void print_help(void) {
+    print_usage();
+    printf(" -n  Number of runs. (default 10)\n");
+    printf(" -l  Label of the result. (default plugin path)\n");
+    printf(" -s  Count syscalls of one extra run with ptrace.\n");
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
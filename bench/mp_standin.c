@@ -0,0 +1,1059 @@
+/***
+ * Monitoring Plugin Benchmarks - mp_standin.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+const char *progname  = "mp_standin";
+const char *progdesc  = "Local stand-in backends for plugin benchmarks.";
+const char *progvers  = "0.1";
+const char *progcopy  = "2012";
+const char *progauth  = "Marius Rieder <marius.rieder@durchmesser.ch>";
+const char *progusage = "-m <mode> -p <port> [-d <delay ms>] [-n <size>] [-r <docroot>] [-w <walkfile>]";
+
+#include "mp_common.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Global Vars */
+static const char *mode = NULL;
+static int standin_port = 0;
+static int delay = 0;
+static int size = 16;
+static const char *docroot = NULL;
+static const char *walkfile = NULL;
+static time_t started;
+
+/* Function prototypes */
+static void serve_memcached(int sd);
+static void serve_redis(int sd);
+static void serve_http(int sd);
+static void serve_fcgi(int sd);
+static void serve_snmp(int sd);
+
+/** Sleep the configured delay. */
+static void standin_delay(void) {
+    if (delay > 0)
+        usleep(delay * 1000);
+}
+
+/** Write the whole buffer. */
+static int standin_write(int sd, const char *buf, size_t len) {
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(sd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return ERROR;
+        buf += n;
+        len -= n;
+    }
+    return OK;
+}
+
+/** Read exactly len bytes. */
+static int standin_read(int sd, char *buf, size_t len) {
+    ssize_t n;
+
+    while (len > 0) {
+        n = read(sd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return ERROR;
+        buf += n;
+        len -= n;
+    }
+    return OK;
+}
+
+/** Read a line terminated by \n, strip \r\n. */
+static int standin_readline(int sd, char *buf, size_t len) {
+    size_t i = 0;
+    char c;
+
+    while (i + 1 < len) {
+        if (standin_read(sd, &c, 1) != OK)
+            return ERROR;
+        if (c == '\n')
+            break;
+        buf[i++] = c;
+    }
+    if (i > 0 && buf[i-1] == '\r')
+        i--;
+    buf[i] = '\0';
+    return OK;
+}
+
+/** Monotonic growing counter for rate calculations. */
+static unsigned long long standin_counter(int factor) {
+    return (unsigned long long)(time(NULL) - started + 1) * factor * 1000;
+}
+
+/**
+ * memcached text protocol. Answers 'stats' with the usual keys and
+ * size additional slab lines.
+ */
+static void serve_memcached(int sd) {
+    char line[1024];
+    char *out = NULL;
+    char *buf;
+    int i;
+
+    while (standin_readline(sd, line, sizeof(line)) == OK) {
+        if (strcmp(line, "quit") == 0)
+            break;
+        standin_delay();
+        if (strcmp(line, "stats") != 0) {
+            standin_write(sd, "ERROR\r\n", 7);
+            continue;
+        }
+        mp_asprintf(&out, "STAT pid %d\r\nSTAT uptime %ld\r\n"
+                "STAT version 1.4.13\r\nSTAT curr_connections 10\r\n"
+                "STAT total_connections %llu\r\nSTAT cmd_get %llu\r\n"
+                "STAT cmd_set %llu\r\nSTAT get_hits %llu\r\n"
+                "STAT get_misses 0\r\nSTAT bytes 1048576\r\n"
+                "STAT curr_items %d\r\nSTAT total_items %d\r\n"
+                "STAT evictions %llu\r\nSTAT limit_maxbytes 67108864\r\n",
+                (int)getpid(), (long)(time(NULL) - started),
+                standin_counter(1), standin_counter(50), standin_counter(5),
+                standin_counter(45), size * 100, size * 200,
+                standin_counter(0));
+        for (i = 0; i < size; i++) {
+            mp_asprintf(&buf, "STAT slab_%d_chunk_size %d\r\n", i, 96 << (i % 8));
+            mp_strcat(&out, buf);
+            free(buf);
+        }
+        mp_strcat(&out, "END\r\n");
+        standin_write(sd, out, strlen(out));
+        free(out);
+        out = NULL;
+    }
+}
+
+/** Send a redis bulk reply. */
+static void redis_bulk(int sd, const char *str) {
+    char *buf;
+
+    mp_asprintf(&buf, "$%zu\r\n%s\r\n", strlen(str), str);
+    standin_write(sd, buf, strlen(buf));
+    free(buf);
+}
+
+/**
+ * redis protocol. Knows PING, INFO and CONFIG GET. INFO contains
+ * size additional keyspace lines.
+ */
+static void serve_redis(int sd) {
+    char line[1024];
+    char **argv = NULL;
+    char *info, *buf;
+    int argc, i, len;
+
+    while (standin_readline(sd, line, sizeof(line)) == OK) {
+        /* Multi bulk request */
+        if (line[0] != '*')
+            break;
+        argc = (int)strtol(line+1, NULL, 10);
+        if (argc < 1 || argc > 16)
+            break;
+        argv = mp_calloc(argc, sizeof(char *));
+        for (i = 0; i < argc; i++) {
+            if (standin_readline(sd, line, sizeof(line)) != OK || line[0] != '$')
+                goto out;
+            len = (int)strtol(line+1, NULL, 10);
+            if (len < 0 || len > 1000)
+                goto out;
+            argv[i] = mp_malloc(len + 3);
+            if (standin_read(sd, argv[i], len + 2) != OK)
+                goto out;
+            argv[i][len] = '\0';
+        }
+
+        standin_delay();
+
+        if (strcasecmp(argv[0], "PING") == 0) {
+            standin_write(sd, "+PONG\r\n", 7);
+        } else if (strcasecmp(argv[0], "INFO") == 0) {
+            mp_asprintf(&info, "# Server\r\nredis_version:2.6.16\r\n"
+                    "uptime_in_seconds:%ld\r\n# Memory\r\nused_memory:1048576\r\n"
+                    "# Stats\r\ntotal_connections_received:%llu\r\n"
+                    "total_commands_processed:%llu\r\n# Replication\r\n"
+                    "role:slave\r\nmaster_host:127.0.0.1\r\nmaster_port:6379\r\n"
+                    "master_link_status:up\r\nmaster_last_io_seconds_ago:1\r\n"
+                    "# Keyspace\r\n", (long)(time(NULL) - started),
+                    standin_counter(1), standin_counter(100));
+            for (i = 0; i < size; i++) {
+                mp_asprintf(&buf, "db%d:keys=%d,expires=0\r\n", i, i * 10);
+                mp_strcat(&info, buf);
+                free(buf);
+            }
+            redis_bulk(sd, info);
+            free(info);
+        } else if (argc == 3 && strcasecmp(argv[0], "CONFIG") == 0) {
+            mp_asprintf(&buf, "*2\r\n$%zu\r\n%s\r\n$1\r\n0\r\n",
+                    strlen(argv[2]), argv[2]);
+            standin_write(sd, buf, strlen(buf));
+            free(buf);
+        } else {
+            standin_write(sd, "-ERR unknown command\r\n", 22);
+        }
+
+out:
+        for (i = 0; i < argc; i++)
+            free(argv[i]);
+        free(argv);
+        argv = NULL;
+    }
+}
+
+/** Generated rabbitmq /api/overview. */
+static char *http_rabbitmq(void) {
+    char *out;
+    mp_asprintf(&out, "{\"management_version\":\"3.1.1\",\"rabbitmq_version\":\"3.1.1\","
+            "\"message_stats\":{\"publish\":%llu,\"deliver_get\":%llu},"
+            "\"queue_totals\":{\"messages\":%d,\"messages_ready\":%d,"
+            "\"messages_unacknowledged\":%d},\"node\":\"rabbit@localhost\"}",
+            standin_counter(10), standin_counter(10), size, size, 0);
+    return out;
+}
+
+/** Generated buildbot /json/slaves with size slaves. */
+static char *http_buildbot(void) {
+    char *out = mp_strdup("{");
+    char *buf;
+    int i;
+
+    for (i = 0; i < size; i++) {
+        mp_asprintf(&buf, "%s\"slave%d\":{\"access_uri\":null,\"admin\":\"admin\","
+                "\"builders\":{},\"connected\":true,\"host\":\"slave%d.example.com\\n\","
+                "\"name\":\"slave%d\",\"runningBuilds\":[],\"version\":\"0.8.7\"}",
+                i ? "," : "", i, i, i);
+        mp_strcat(&out, buf);
+        free(buf);
+    }
+    mp_strcat(&out, "}");
+    return out;
+}
+
+/** Generated apache mod_status ?auto with a size slot scoreboard. */
+static char *http_apache(void) {
+    const char *slots = "_W_K_.R_C";
+    char *out, *sb;
+    int i;
+
+    sb = mp_malloc(size + 1);
+    for (i = 0; i < size; i++)
+        sb[i] = slots[i % 9];
+    sb[size] = '\0';
+
+    mp_asprintf(&out, "Total Accesses: %llu\nTotal kBytes: %llu\nUptime: %ld\n"
+            "ReqPerSec: 1.5\nBytesPerSec: 2048\nBytesPerReq: 1365.33\n"
+            "BusyWorkers: %d\nIdleWorkers: %d\nScoreboard: %s\n",
+            standin_counter(1), standin_counter(2), (long)(time(NULL) - started),
+            size / 3, size - size / 3, sb);
+    free(sb);
+    return out;
+}
+
+/** Generated php-fpm status json. */
+static char *fcgi_phpfpm(void) {
+    char *out;
+    mp_asprintf(&out, "{\"pool\":\"www\",\"process manager\":\"dynamic\","
+            "\"start time\":%ld,\"start since\":%ld,\"accepted conn\":%llu,"
+            "\"listen queue\":0,\"max listen queue\":0,\"listen queue len\":128,"
+            "\"idle processes\":%d,\"active processes\":1,\"total processes\":%d,"
+            "\"max active processes\":2,\"max children reached\":0}",
+            (long)started, (long)(time(NULL) - started), standin_counter(1),
+            size, size + 1);
+    return out;
+}
+
+/**
+ * Minimal HTTP/1.0 server. Serves files below docroot if given, the
+ * generated payloads otherwise.
+ */
+static void serve_http(int sd) {
+    char line[4096];
+    char path[2048];
+    char *body = NULL;
+    char *head, *file;
+    const char *type = "application/json";
+    long len = 0;
+    int code = 200;
+
+    if (standin_readline(sd, line, sizeof(line)) != OK)
+        return;
+    if (sscanf(line, "%*s %2047s", path) != 1)
+        return;
+    /* Skip headers */
+    do {
+        if (standin_readline(sd, line, sizeof(line)) != OK)
+            return;
+    } while (line[0]);
+
+    standin_delay();
+
+    if (docroot && !strstr(path, "..")) {
+        mp_asprintf(&file, "%s%s", docroot, path);
+        if (strchr(file + strlen(docroot), '?'))
+            *strchr(file + strlen(docroot), '?') = '\0';
+        len = mp_slurp(file, &body);
+        free(file);
+        if (len < 0) {
+            body = NULL;
+            len = 0;
+        }
+    }
+
+    if (body) {
+        /* from docroot */
+    } else if (strncmp(path, "/api/overview", 13) == 0) {
+        body = http_rabbitmq();
+    } else if (strncmp(path, "/json/slaves", 12) == 0) {
+        body = http_buildbot();
+    } else if (strncmp(path, "/server-status", 14) == 0) {
+        body = http_apache();
+        type = "text/plain";
+    } else {
+        body = mp_strdup("Not Found\n");
+        type = "text/plain";
+        code = 404;
+    }
+    if (len == 0)
+        len = strlen(body);
+
+    mp_asprintf(&head, "HTTP/1.0 %d %s\r\nServer: mp_standin\r\n"
+            "Content-Type: %s\r\nContent-Length: %ld\r\nConnection: close\r\n\r\n",
+            code, code == 200 ? "OK" : "Not Found", type, len);
+    standin_write(sd, head, strlen(head));
+    standin_write(sd, body, len);
+    free(head);
+    free(body);
+}
+
+/** Write a FastCGI record. */
+static void fcgi_record(int sd, int type, int id, const char *data, int len) {
+    unsigned char head[8];
+
+    head[0] = 1;
+    head[1] = type;
+    head[2] = (id >> 8) & 0xff;
+    head[3] = id & 0xff;
+    head[4] = (len >> 8) & 0xff;
+    head[5] = len & 0xff;
+    head[6] = 0;
+    head[7] = 0;
+    standin_write(sd, (char *)head, 8);
+    if (len)
+        standin_write(sd, data, len);
+}
+
+/**
+ * FastCGI responder. Waits for the empty STDIN record and answers with
+ * the php-fpm status json.
+ */
+static void serve_fcgi(int sd) {
+    unsigned char head[8];
+    char content[65536 + 256];
+    char end[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    char *out, *json;
+    int id, len, pos;
+
+    while (standin_read(sd, (char *)head, 8) == OK) {
+        id = (head[2] << 8) | head[3];
+        len = ((head[4] << 8) | head[5]) + head[6];
+        if (standin_read(sd, content, len) != OK)
+            return;
+        /* FCGI_STDIN with zero length ends the request */
+        if (head[1] != 5 || ((head[4] << 8) | head[5]) != 0)
+            continue;
+
+        standin_delay();
+
+        json = fcgi_phpfpm();
+        mp_asprintf(&out, "Content-type: application/json\r\n\r\n%s", json);
+        free(json);
+        len = strlen(out);
+        for (pos = 0; pos < len; pos += 32768)
+            fcgi_record(sd, 6, id, out + pos, len - pos > 32768 ? 32768 : len - pos);
+        fcgi_record(sd, 6, id, NULL, 0);
+        fcgi_record(sd, 3, id, end, 8);
+        free(out);
+        return;
+    }
+}
+
+/**
+ * SNMP agent data.
+ */
+typedef struct {
+    unsigned int oid[128];      /**< OID of the value */
+    int oid_len;                /**< Length of oid */
+    unsigned char type;         /**< BER type */
+    unsigned char *val;         /**< BER encoded value content */
+    int val_len;                /**< Length of val */
+} snmp_entry;
+
+static snmp_entry *snmp_entries = NULL;
+static int snmp_count = 0;
+
+static int snmp_oid_cmp(const unsigned int *a, int alen, const unsigned int *b, int blen) {
+    int i;
+    for (i = 0; i < alen && i < blen; i++) {
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+    return alen - blen;
+}
+
+static int snmp_entry_cmp(const void *a, const void *b) {
+    const snmp_entry *ea = a, *eb = b;
+    return snmp_oid_cmp(ea->oid, ea->oid_len, eb->oid, eb->oid_len);
+}
+
+static int snmp_parse_oid(const char *str, unsigned int *oid) {
+    int len = 0;
+    char *end;
+
+    while (*str == '.' || isdigit((unsigned char)*str)) {
+        if (*str == '.')
+            str++;
+        if (!isdigit((unsigned char)*str) || len >= 128)
+            break;
+        oid[len++] = (unsigned int)strtoul(str, &end, 10);
+        str = end;
+    }
+    return len;
+}
+
+/** BER encode an unsigned value with minimal length. */
+static int ber_uint(unsigned char *out, unsigned long long v) {
+    unsigned char tmp[9];
+    int n = 0, i;
+
+    do {
+        tmp[n++] = v & 0xff;
+        v >>= 8;
+    } while (v);
+    if (tmp[n-1] & 0x80)
+        tmp[n++] = 0;
+    for (i = 0; i < n; i++)
+        out[i] = tmp[n - 1 - i];
+    return n;
+}
+
+/** BER encode a signed value with minimal length. */
+static int ber_int(unsigned char *out, long long v) {
+    unsigned char tmp[8];
+    int n = 0, i;
+
+    do {
+        tmp[n++] = v & 0xff;
+        v >>= 8;
+    } while (!((v == 0 && !(tmp[n-1] & 0x80)) || (v == -1 && (tmp[n-1] & 0x80))));
+    for (i = 0; i < n; i++)
+        out[i] = tmp[n - 1 - i];
+    return n;
+}
+
+/** BER encode OID content. */
+static int ber_oid(unsigned char *out, const unsigned int *oid, int len) {
+    unsigned char tmp[5];
+    unsigned int v;
+    int n = 0, i, j;
+
+    if (len < 2) {
+        out[0] = 0;
+        return 1;
+    }
+    out[n++] = oid[0] * 40 + oid[1];
+    for (i = 2; i < len; i++) {
+        v = oid[i];
+        j = 0;
+        do {
+            tmp[j++] = v & 0x7f;
+            v >>= 7;
+        } while (v);
+        while (j > 1)
+            out[n++] = tmp[--j] | 0x80;
+        out[n++] = tmp[0];
+    }
+    return n;
+}
+
+/** BER encode tag and length header. */
+static int ber_head(unsigned char *out, unsigned char tag, int len) {
+    out[0] = tag;
+    if (len < 0x80) {
+        out[1] = len;
+        return 2;
+    } else if (len < 0x100) {
+        out[1] = 0x81;
+        out[2] = len;
+        return 3;
+    }
+    out[1] = 0x82;
+    out[2] = (len >> 8) & 0xff;
+    out[3] = len & 0xff;
+    return 4;
+}
+
+static void snmp_add(const unsigned int *oid, int oid_len, unsigned char type,
+        const unsigned char *val, int val_len) {
+    snmp_entry *e;
+
+    if (oid_len < 2)
+        return;
+    if (val_len > 512)
+        val_len = 512;
+    snmp_entries = mp_realloc(snmp_entries, sizeof(snmp_entry) * (snmp_count + 1));
+    e = &snmp_entries[snmp_count++];
+    memcpy(e->oid, oid, sizeof(unsigned int) * oid_len);
+    e->oid_len = oid_len;
+    e->type = type;
+    e->val = mp_malloc(val_len + 1);
+    memcpy(e->val, val, val_len);
+    e->val_len = val_len;
+}
+
+static void snmp_add_int(const unsigned int *oid, int oid_len, unsigned char type,
+        long long v) {
+    unsigned char buf[9];
+    int n;
+
+    if (type == 0x02)
+        n = ber_int(buf, v);
+    else
+        n = ber_uint(buf, (unsigned long long)v);
+    snmp_add(oid, oid_len, type, buf, n);
+}
+
+/**
+ * Load a walk recorded with 'snmpwalk -On'.
+ */
+static void snmp_load_walk(const char *file) {
+    FILE *fp;
+    char line[4096];
+    unsigned int oid[128], val_oid[128];
+    unsigned char buf[2048];
+    char *p, *v, *t;
+    int oid_len, n;
+
+    fp = fopen(file, "r");
+    if (!fp)
+        critical("Can't open walk %s", file);
+
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        p = strstr(line, " = ");
+        if (line[0] != '.' || !p)
+            continue;
+        oid_len = snmp_parse_oid(line, oid);
+        v = p + 3;
+        t = strstr(v, ": ");
+
+        if (strcmp(v, "\"\"") == 0 || strncmp(v, "STRING:", 7) == 0) {
+            v = t ? t + 2 : v + 2;
+            n = strlen(v);
+            if (n && v[0] == '"') {
+                v++;
+                n -= 2;
+            }
+            snmp_add(oid, oid_len, 0x04, (unsigned char *)v, n < 0 ? 0 : n);
+        } else if (strncmp(v, "Hex-STRING:", 11) == 0) {
+            for (n = 0, p = v + 11; *p && n < (int)sizeof(buf); ) {
+                while (*p == ' ')
+                    p++;
+                if (!isxdigit((unsigned char)*p))
+                    break;
+                buf[n++] = (unsigned char)strtoul(p, &p, 16);
+            }
+            snmp_add(oid, oid_len, 0x04, buf, n);
+        } else if (strncmp(v, "INTEGER:", 8) == 0) {
+            p = strchr(v, '(');
+            snmp_add_int(oid, oid_len, 0x02, strtoll(p ? p + 1 : v + 8, NULL, 10));
+        } else if (strncmp(v, "Counter32:", 10) == 0) {
+            snmp_add_int(oid, oid_len, 0x41, strtoll(v + 10, NULL, 10));
+        } else if (strncmp(v, "Gauge32:", 8) == 0) {
+            snmp_add_int(oid, oid_len, 0x42, strtoll(v + 8, NULL, 10));
+        } else if (strncmp(v, "Timeticks:", 10) == 0) {
+            p = strchr(v, '(');
+            snmp_add_int(oid, oid_len, 0x43, strtoll(p ? p + 1 : v + 10, NULL, 10));
+        } else if (strncmp(v, "Counter64:", 10) == 0) {
+            n = ber_uint(buf, strtoull(v + 10, NULL, 10));
+            snmp_add(oid, oid_len, 0x46, buf, n);
+        } else if (strncmp(v, "IpAddress:", 10) == 0) {
+            struct in_addr addr;
+            inet_aton(v + 11, &addr);
+            snmp_add(oid, oid_len, 0x40, (unsigned char *)&addr, 4);
+        } else if (strncmp(v, "OID:", 4) == 0) {
+            n = snmp_parse_oid(v + 5, val_oid);
+            n = ber_oid(buf, val_oid, n);
+            snmp_add(oid, oid_len, 0x06, buf, n);
+        }
+    }
+    fclose(fp);
+}
+
+/**
+ * Generate system group and ifTable/ifXTable with size interfaces.
+ */
+static void snmp_generate(void) {
+    unsigned int oid[16] = {1, 3, 6, 1, 2, 1, 1, 1, 0};
+    unsigned int val_oid[] = {1, 3, 6, 1, 4, 1, 8072, 3, 2, 10};
+    unsigned char buf[64];
+    const unsigned int ifcols[] = {1, 2, 3, 4, 5, 7, 8, 10, 14, 16, 20};
+    const unsigned int ifxcols[] = {1, 6, 10, 15, 18};
+    char descr[32];
+    unsigned int c, i;
+    int n;
+
+    snmp_add(oid, 9, 0x04, (unsigned char *)"Linux mp_standin", 16);
+    oid[7] = 2;
+    n = ber_oid(buf, val_oid, 10);
+    snmp_add(oid, 9, 0x06, buf, n);
+    oid[7] = 3;
+    snmp_add_int(oid, 9, 0x43, 0);
+    oid[6] = 2; oid[7] = 1;
+    snmp_add_int(oid, 9, 0x02, size);
+
+    /* ifTable */
+    oid[6] = 2; oid[7] = 2; oid[8] = 1;
+    for (c = 0; c < sizeof(ifcols) / sizeof(ifcols[0]); c++) {
+        oid[9] = ifcols[c];
+        for (i = 1; i <= (unsigned int)size; i++) {
+            oid[10] = i;
+            switch (ifcols[c]) {
+                case 2:
+                    n = snprintf(descr, sizeof(descr), "eth%u", i - 1);
+                    snmp_add(oid, 11, 0x04, (unsigned char *)descr, n);
+                    break;
+                case 3:
+                    snmp_add_int(oid, 11, 0x02, 6);
+                    break;
+                case 4:
+                    snmp_add_int(oid, 11, 0x02, 1500);
+                    break;
+                case 5:
+                    snmp_add_int(oid, 11, 0x42, 1000000000);
+                    break;
+                case 7:
+                case 8:
+                    snmp_add_int(oid, 11, 0x02, 1);
+                    break;
+                case 10:
+                case 16:
+                case 14:
+                case 20:
+                    /* Counters are filled on request */
+                    snmp_add_int(oid, 11, 0x41, 0);
+                    break;
+                default:
+                    snmp_add_int(oid, 11, 0x02, i);
+            }
+        }
+    }
+
+    /* ifXTable */
+    oid[6] = 31; oid[7] = 1; oid[8] = 1; oid[9] = 1;
+    for (c = 0; c < sizeof(ifxcols) / sizeof(ifxcols[0]); c++) {
+        oid[10] = ifxcols[c];
+        for (i = 1; i <= (unsigned int)size; i++) {
+            oid[11] = i;
+            switch (ifxcols[c]) {
+                case 1:
+                    n = snprintf(descr, sizeof(descr), "eth%u", i - 1);
+                    snmp_add(oid, 12, 0x04, (unsigned char *)descr, n);
+                    break;
+                case 18:
+                    n = snprintf(descr, sizeof(descr), "uplink %u", i);
+                    snmp_add(oid, 12, 0x04, (unsigned char *)descr, n);
+                    break;
+                case 15:
+                    snmp_add_int(oid, 12, 0x42, 1000);
+                    break;
+                default:
+                    snmp_add_int(oid, 12, 0x46, 0);
+            }
+        }
+    }
+}
+
+/** Encode the value of entry, counters grow with time. */
+static int snmp_value(unsigned char *out, const snmp_entry *e) {
+    unsigned char buf[9];
+    int n;
+
+    if (!walkfile && (e->type == 0x41 || e->type == 0x46)) {
+        n = (e->type == 0x41)
+            ? ber_uint(buf, (standin_counter(e->oid[e->oid_len - 1]) & 0xffffffffULL))
+            : ber_uint(buf, standin_counter(e->oid[e->oid_len - 1]) << 20);
+    } else if (!walkfile && e->type == 0x43) {
+        n = ber_uint(buf, (unsigned long long)(time(NULL) - started) * 100);
+    } else {
+        n = ber_head(out, e->type, e->val_len);
+        memcpy(out + n, e->val, e->val_len);
+        return n + e->val_len;
+    }
+    out[0] = e->type;
+    out[1] = n;
+    memcpy(out + 2, buf, n);
+    return n + 2;
+}
+
+/** Find exact (next == 0) or next entry. */
+static const snmp_entry *snmp_find(const unsigned int *oid, int len, int next) {
+    int lo = 0, hi = snmp_count, mid, cmp;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        cmp = snmp_oid_cmp(snmp_entries[mid].oid, snmp_entries[mid].oid_len, oid, len);
+        if (cmp < 0 || (next && cmp == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo >= snmp_count)
+        return NULL;
+    if (!next && snmp_oid_cmp(snmp_entries[lo].oid, snmp_entries[lo].oid_len, oid, len) != 0)
+        return NULL;
+    return &snmp_entries[lo];
+}
+
+/** Parse BER tag and length. Return header size or -1. */
+static int ber_parse(const unsigned char *in, int avail, unsigned char *tag, int *len) {
+    int n;
+
+    if (avail < 2)
+        return -1;
+    *tag = in[0];
+    if (in[1] < 0x80) {
+        *len = in[1];
+        n = 2;
+    } else if (in[1] == 0x81 && avail >= 3) {
+        *len = in[2];
+        n = 3;
+    } else if (in[1] == 0x82 && avail >= 4) {
+        *len = (in[2] << 8) | in[3];
+        n = 4;
+    } else {
+        return -1;
+    }
+    if (n + *len > avail)
+        return -1;
+    return n;
+}
+
+static long ber_parse_int(const unsigned char *in, int len) {
+    long v = (len > 0 && (in[0] & 0x80)) ? -1 : 0;
+    int i;
+    for (i = 0; i < len; i++)
+        v = (v << 8) | in[i];
+    return v;
+}
+
+static int ber_parse_oid(const unsigned char *in, int len, unsigned int *oid) {
+    int n = 0, i;
+    unsigned int v = 0;
+
+    if (len < 1)
+        return 0;
+    oid[n++] = in[0] / 40;
+    oid[n++] = in[0] % 40;
+    for (i = 1; i < len && n < 128; i++) {
+        v = (v << 7) | (in[i] & 0x7f);
+        if (!(in[i] & 0x80)) {
+            oid[n++] = v;
+            v = 0;
+        }
+    }
+    return n;
+}
+
+/** Append a varbind to out. */
+static int snmp_varbind(unsigned char *out, const unsigned int *oid, int oid_len,
+        const snmp_entry *e, unsigned char exception) {
+    unsigned char body[1024];
+    int n = 0, h;
+
+    h = ber_oid(body + 4, oid, oid_len);
+    n = ber_head(body, 0x06, h);
+    memmove(body + n, body + 4, h);
+    n += h;
+    if (e) {
+        n += snmp_value(body + n, e);
+    } else {
+        body[n++] = exception;
+        body[n++] = 0;
+    }
+    h = ber_head(out, 0x30, n);
+    memcpy(out + h, body, n);
+    return h + n;
+}
+
+/**
+ * SNMP v1/v2c agent answering GET, GETNEXT and GETBULK from the loaded
+ * walk.
+ */
+static void serve_snmp(int sd) {
+    unsigned char in[65536], vbs[65000], pdu[65200], msg[65400];
+    unsigned int oid[128];
+    unsigned char tag, ptype;
+    struct sockaddr_storage peer;
+    socklen_t peer_len;
+    const unsigned char *p, *end, *community, *reqid, *vb;
+    const snmp_entry *e;
+    long version, nonrep, maxrep;
+    int len, h, l, community_len, reqid_len, vb_len, vbn, oid_len, r;
+    int n, pn, mn;
+    ssize_t got;
+
+    for (;;) {
+        peer_len = sizeof(peer);
+        got = recvfrom(sd, in, sizeof(in), 0, (struct sockaddr *)&peer, &peer_len);
+        if (got <= 0)
+            continue;
+
+        /* Message */
+        p = in;
+        end = in + got;
+        if ((h = ber_parse(p, end - p, &tag, &len)) < 0 || tag != 0x30)
+            continue;
+        p += h;
+        if ((h = ber_parse(p, end - p, &tag, &len)) < 0 || tag != 0x02)
+            continue;
+        version = ber_parse_int(p + h, len);
+        p += h + len;
+        if ((h = ber_parse(p, end - p, &tag, &len)) < 0 || tag != 0x04)
+            continue;
+        community = p + h;
+        community_len = len;
+        p += h + len;
+        if ((h = ber_parse(p, end - p, &ptype, &len)) < 0)
+            continue;
+        p += h;
+        /* request-id, error-status/non-repeaters, error-index/max-repetitions */
+        if ((h = ber_parse(p, end - p, &tag, &len)) < 0)
+            continue;
+        reqid = p;
+        reqid_len = h + len;
+        p += h + len;
+        if ((h = ber_parse(p, end - p, &tag, &len)) < 0)
+            continue;
+        nonrep = ber_parse_int(p + h, len);
+        p += h + len;
+        if ((h = ber_parse(p, end - p, &tag, &len)) < 0)
+            continue;
+        maxrep = ber_parse_int(p + h, len);
+        p += h + len;
+        if ((h = ber_parse(p, end - p, &tag, &len)) < 0 || tag != 0x30)
+            continue;
+        vb = p + h;
+        vb_len = len;
+
+        standin_delay();
+
+        /* Build varbinds */
+        n = 0;
+        vbn = 0;
+        p = vb;
+        while (p < vb + vb_len && n < (int)sizeof(vbs) - 2048) {
+            const unsigned char *q;
+            if ((h = ber_parse(p, vb + vb_len - p, &tag, &len)) < 0)
+                break;
+            q = p + h;
+            p += h + len;
+            if ((h = ber_parse(q, p - q, &tag, &l)) < 0 || tag != 0x06)
+                break;
+            oid_len = ber_parse_oid(q + h, l, oid);
+
+            if (ptype == 0xA0) {
+                e = snmp_find(oid, oid_len, 0);
+                n += snmp_varbind(vbs + n, oid, oid_len, e, 0x80);
+            } else if (ptype == 0xA1 || (ptype == 0xA5 && vbn < nonrep)) {
+                e = snmp_find(oid, oid_len, 1);
+                n += e ? snmp_varbind(vbs + n, e->oid, e->oid_len, e, 0)
+                       : snmp_varbind(vbs + n, oid, oid_len, NULL, 0x82);
+            } else if (ptype == 0xA5) {
+                /* Repeaters, one column at a time is fine for net-snmp */
+                for (r = 0; r < maxrep && n < (int)sizeof(vbs) - 2048; r++) {
+                    e = snmp_find(oid, oid_len, 1);
+                    if (!e) {
+                        n += snmp_varbind(vbs + n, oid, oid_len, NULL, 0x82);
+                        break;
+                    }
+                    n += snmp_varbind(vbs + n, e->oid, e->oid_len, e, 0);
+                    memcpy(oid, e->oid, sizeof(unsigned int) * e->oid_len);
+                    oid_len = e->oid_len;
+                }
+            }
+            vbn++;
+        }
+
+        /* PDU */
+        pn = 4 + reqid_len;
+        memcpy(pdu + 4, reqid, reqid_len);
+        pdu[pn++] = 0x02; pdu[pn++] = 1; pdu[pn++] = 0;
+        pdu[pn++] = 0x02; pdu[pn++] = 1; pdu[pn++] = 0;
+        pn += ber_head(pdu + pn, 0x30, n);
+        memcpy(pdu + pn, vbs, n);
+        pn += n;
+        h = ber_head(msg, 0xA2, pn - 4);
+        memmove(pdu + h, pdu + 4, pn - 4);
+        memcpy(pdu, msg, h);
+        pn = pn - 4 + h;
+
+        /* Message */
+        mn = 4;
+        msg[mn++] = 0x02; msg[mn++] = 1; msg[mn++] = (unsigned char)version;
+        mn += ber_head(msg + mn, 0x04, community_len);
+        memcpy(msg + mn, community, community_len);
+        mn += community_len;
+        memcpy(msg + mn, pdu, pn);
+        mn += pn;
+        h = ber_head(in, 0x30, mn - 4);
+        memmove(msg + h, msg + 4, mn - 4);
+        memcpy(msg, in, h);
+        mn = mn - 4 + h;
+
+        sendto(sd, msg, mn, 0, (struct sockaddr *)&peer, peer_len);
+    }
+}
+
+int main(int argc, char **argv) {
+    struct sockaddr_in addr;
+    int c, sd, client, on = 1;
+    int udp;
+
+    while ((c = getopt(argc, argv, "m:p:d:n:r:w:h")) != -1) {
+        switch (c) {
+            case 'm':
+                mode = optarg;
+                break;
+            case 'p':
+                standin_port = (int)strtol(optarg, NULL, 10);
+                break;
+            case 'd':
+                delay = (int)strtol(optarg, NULL, 10);
+                break;
+            case 'n':
+                size = (int)strtol(optarg, NULL, 10);
+                break;
+            case 'r':
+                docroot = optarg;
+                break;
+            case 'w':
+                walkfile = optarg;
+                break;
+            default:
+                print_help();
+                exit(STATE_UNKNOWN);
+        }
+    }
+    if (!mode || standin_port <= 0) {
+        print_help();
+        exit(STATE_UNKNOWN);
+    }
+    if (size < 1)
+        size = 1;
+
+    started = time(NULL);
+    udp = (strcmp(mode, "snmp") == 0);
+
+    if (udp) {
+        if (walkfile)
+            snmp_load_walk(walkfile);
+        else
+            snmp_generate();
+        qsort(snmp_entries, snmp_count, sizeof(snmp_entry), snmp_entry_cmp);
+    }
+
+    sd = socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (sd < 0)
+        critical("socket: %s", strerror(errno));
+    setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(standin_port);
+    if (bind(sd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        critical("bind %d: %s", standin_port, strerror(errno));
+
+    if (udp) {
+        serve_snmp(sd);
+        return 0;
+    }
+
+    if (listen(sd, 64) < 0)
+        critical("listen: %s", strerror(errno));
+    signal(SIGCHLD, SIG_IGN);
+
+    for (;;) {
+        client = accept(sd, NULL, NULL);
+        if (client < 0)
+            continue;
+        if (fork() == 0) {
+            close(sd);
+            if (strcmp(mode, "memcached") == 0)
+                serve_memcached(client);
+            else if (strcmp(mode, "redis") == 0)
+                serve_redis(client);
+            else if (strcmp(mode, "http") == 0)
+                serve_http(client);
+            else if (strcmp(mode, "fcgi") == 0)
+                serve_fcgi(client);
+            close(client);
+            _exit(0);
+        }
+        close(client);
+    }
+
+    return 0;
+}
+
+void print_help(void) {
+    print_usage();
+    printf(" -m  Mode: memcached, redis, http, fcgi or snmp.\n");
+    printf(" -p  Port to listen on 127.0.0.1.\n");
+    printf(" -d  Delay every answer by this many milliseconds.\n");
+    printf(" -n  Payload size (stats lines, slaves, scoreboard slots, interfaces).\n");
+    printf(" -r  HTTP document root, served before the generated payloads.\n");
+    printf(" -w  SNMP walk recorded with 'snmpwalk -On', default is a generated ifTable.\n");
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
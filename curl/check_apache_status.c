@@ -32,7 +32,9 @@ const char *progusage = "--url <URL>";
 
 /* MP Includes */
 #include "mp_common.h"
+#include "mp_state.h"
 #include "curl_utils.h"
+#include "apache_utils.h"
 /* Default Includes */
 #include <signal.h>
 #include <stdio.h>
@@ -49,26 +51,28 @@ const char *hostname = NULL;
 int port = 80;
 thresholds *open_thresholds = NULL;
 
+/* Status of one server */
+struct apache_status_s {
+    char *server;
+    char *target;
+    struct mp_curl_header headers[2];
+    struct mp_curl_lines answer;
+    struct apache_auto_s values;
+};
+
 /* Function prototype */
+CURL *apache_status_init(const char *url, struct apache_status_s *status);
+void apache_status_line(char *line, size_t len, void *userdata);
+void apache_status_eval(mp_curl_transfer *transfer);
 
 int main (int argc, char **argv) {
     /* Local Vars */
     CURL                *curl;
-    struct mp_curl_data answer;
-    long int            code;
-    int                 sb_wait = 0;
-    int                 sb_start = 0;
-    int                 sb_recv = 0;
-    int                 sb_send = 0;
-    int                 sb_keep = 0;
-    int                 sb_dns = 0;
-    int                 sb_close = 0;
-    int                 sb_log = 0;
-    int                 sb_grace = 0;
-    int                 sb_idle = 0;
-    int                 sb_open = 0;
-    char                *buf = NULL, *key, *val;
-    char                *server = NULL;
+    mp_curl_transfer    *transfer;
+    mp_curl_transfer    **transfers;
+    struct apache_status_s *status;
+    char                *host_url;
+    int                 i;
 
     /* Set signal handling and alarm */
     if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
@@ -81,129 +85,190 @@ int main (int argc, char **argv) {
     /* Start plugin timeout */
     alarm(mp_timeout);
 
+    apache_keys_init();
+
     /* Build query */
     if (mp_verbose > 0) {
         printf("CURL Version: %s\n", curl_version());
-        printf("Url: %s\n", url);
+        if (url)
+            printf("Url: %s\n", url);
         print_thresholds("open_thresholds", open_thresholds);
     }
 
+    /* Fetch all hosts concurrently */
+    if (mp_curl_hosts_num > 0) {
+        transfers = mp_calloc(mp_curl_hosts_num, sizeof(mp_curl_transfer *));
+
+        for (i = 0; i < mp_curl_hosts_num; i++) {
+            mp_asprintf(&host_url, "http://%s:%d/server-status?auto",
+                    mp_curl_hosts[i], port);
+            status = mp_calloc(1, sizeof(struct apache_status_s));
+            status->target = mp_strdup(mp_curl_hosts[i]);
+            curl = apache_status_init(host_url, status);
+            transfers[i] = mp_curl_multi_add(curl, mp_curl_hosts[i], status);
+            free(host_url);
+        }
+
+        if (mp_curl_multi_run() != OK)
+            unknown("libcurl multi transfer failed!");
+
+        mp_curl_multi_exit(transfers, mp_curl_hosts_num, apache_status_eval);
+    }
+
+    /* Get url, the answer is parsed line by line */
+    status = mp_calloc(1, sizeof(struct apache_status_s));
+    status->target = mp_strdup(url);
+    curl = apache_status_init(url, status);
+    transfer = mp_curl_multi_add(curl, NULL, status);
+
+    if (mp_curl_multi_run() != OK)
+        unknown("libcurl multi transfer failed!");
+
+    mp_curl_transfer_code(transfer);
+    apache_status_eval(transfer);
+}
+
+CURL *apache_status_init(const char *url, struct apache_status_s *status) {
+    CURL *curl;
+
     /* Headers */
-    struct mp_curl_header headers[] = {
-        {"Server", &server}, {NULL, NULL}
-    };
+    status->headers[0].key = "Server";
+    status->headers[0].value = &(status->server);
 
     /* Init libcurl */
     curl = mp_curl_init();
-    answer.data = NULL;
-    answer.size = 0;
+    status->answer.line = apache_status_line;
+    status->answer.userdata = status;
 
     /* Setup request */
     curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_curl_recv_data);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&answer);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_curl_recv_lines);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&(status->answer));
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, mp_curl_recv_header);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)headers);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)status->headers);
+
+    return curl;
+}
 
-    /* Get url */
-    code = mp_curl_perform(curl);
+void apache_status_eval(mp_curl_transfer *transfer) {
+    struct apache_status_s *status = transfer->data;
+    char **value = status->values.value;
+    int i;
 
-    /* Cleanup libcurl */
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
+    mp_curl_lines_finish(&(status->answer));
 
     if (mp_verbose > 1) {
-        printf("Code: %ld\n", code);
-        printf("Server: %s\n", server);
-        if (mp_verbose > 2) {
-            printf("Answer: '%s'\n", answer.data);
-        }
+        printf("Code: %ld\n", transfer->code);
+        printf("Server: %s\n", status->server);
     }
 
-    /* Parse Answer */
-    buf = answer.data;
+    if (!status->values.scoreboard)
+        critical("Apache HTTPD status - No scoreboard in answer, HTTP Status %ld.",
+                transfer->code);
+    if (!status->server)
+        status->server = value[APACHE_SERVER_VERSION];
 
-    while(*buf) {
-        val = strsep(&buf, "\n");
-        key = strsep(&val, ": ");
-
-        if (mp_verbose > 1) {
-            printf("%s => %s\n", key, val);
-        }
+    for (i = 0; i < APACHE_SCOREBOARD_STATES; i++) {
+        mp_perfdata_int(apache_scoreboard[i].label, status->values.slots[i], "c",
+                i == 0 ? open_thresholds : NULL);
+    }
 
-        if(strcmp(key, "Scoreboard") == 0) {
-            for(; *val; val++) {
-                switch (*val) {
-                    case '.':
-                        sb_open++;
-                        break;
-                    case '_':
-                        sb_wait++;
-                        break;
-                    case 'S':
-                        sb_start++;
-                        break;
-                    case 'R':
-                        sb_recv++;
-                        break;
-                    case 'W':
-                        sb_send++;
-                        break;
-                    case 'K':
-                        sb_keep++;
-                        break;
-                    case 'D':
-                        sb_dns++;
-                        break;
-                    case 'C':
-                        sb_close++;
-                        break;
-                    case 'L':
-                        sb_log++;
-                        break;
-                    case 'G':
-                        sb_grace++;
-                        break;
-                    case 'I':
-                        sb_idle++;
-                        break;
-                }
-            }
-        }
+    /* Counters, the rates need the last sample from the state store */
+    if (value[APACHE_TOTAL_ACCESSES]) {
+        mp_perfdata_int("accesses",
+                strtol(value[APACHE_TOTAL_ACCESSES], NULL, 10), "c", NULL);
+        mp_perfdata_rate("accesses_rate", status->target,
+                strtoull(value[APACHE_TOTAL_ACCESSES], NULL, 10),
+                MP_COUNTER64, "");
+    }
+    if (value[APACHE_TOTAL_KBYTES]) {
+        mp_perfdata_int("kbytes",
+                strtol(value[APACHE_TOTAL_KBYTES], NULL, 10), "c", NULL);
+        mp_perfdata_rate("bytes_rate", status->target,
+                strtoull(value[APACHE_TOTAL_KBYTES], NULL, 10) * 1024,
+                MP_COUNTER64, "B");
+    }
+    if (value[APACHE_TOTAL_DURATION])
+        mp_perfdata_int("duration",
+                strtol(value[APACHE_TOTAL_DURATION], NULL, 10), "c", NULL);
+
+    /* Averages since the start */
+    if (value[APACHE_REQ_PER_SEC])
+        mp_perfdata_float("req_per_sec",
+                strtof(value[APACHE_REQ_PER_SEC], NULL), "", NULL);
+    if (value[APACHE_BYTES_PER_SEC])
+        mp_perfdata_float("bytes_per_sec",
+                strtof(value[APACHE_BYTES_PER_SEC], NULL), "B", NULL);
+    if (value[APACHE_BYTES_PER_REQ])
+        mp_perfdata_float("bytes_per_req",
+                strtof(value[APACHE_BYTES_PER_REQ], NULL), "B", NULL);
+    if (value[APACHE_DURATION_PER_REQ])
+        mp_perfdata_float("duration_per_req",
+                strtof(value[APACHE_DURATION_PER_REQ], NULL), "ms", NULL);
+    if (value[APACHE_CPU_LOAD])
+        mp_perfdata_float("cpu_load",
+                strtof(value[APACHE_CPU_LOAD], NULL), "%", NULL);
+    if (value[APACHE_UPTIME])
+        mp_perfdata_int("uptime",
+                strtol(value[APACHE_UPTIME], NULL, 10), "s", NULL);
+    if (value[APACHE_LOAD1]) {
+        mp_perfdata_float("load1", strtof(value[APACHE_LOAD1], NULL), "", NULL);
+        mp_perfdata_float("load5", value[APACHE_LOAD5] ?
+                strtof(value[APACHE_LOAD5], NULL) : 0, "", NULL);
+        mp_perfdata_float("load15", value[APACHE_LOAD15] ?
+                strtof(value[APACHE_LOAD15], NULL) : 0, "", NULL);
     }
 
-    mp_perfdata_int("open", (long int)sb_open, "c", open_thresholds);
-    mp_perfdata_int("start", (long int)sb_start, "c", NULL);
-    mp_perfdata_int("read", (long int)sb_recv, "c", NULL);
-    mp_perfdata_int("write", (long int)sb_send, "c", NULL);
-    mp_perfdata_int("keep", (long int)sb_keep, "c", NULL);
-    mp_perfdata_int("dns", (long int)sb_dns, "c", NULL);
-    mp_perfdata_int("close", (long int)sb_close, "c", NULL);
-    mp_perfdata_int("log", (long int)sb_log, "c", NULL);
-    mp_perfdata_int("grace", (long int)sb_grace, "c", NULL);
-    mp_perfdata_int("idle", (long int)sb_idle, "c", NULL);
-    mp_perfdata_int("open", (long int)sb_open, "c", NULL);
-
-    /* free */
-    free(answer.data);
+    /* Workers and event MPM connections */
+    if (value[APACHE_BUSY_WORKERS])
+        mp_perfdata_int("busy_workers",
+                strtol(value[APACHE_BUSY_WORKERS], NULL, 10), "", NULL);
+    if (value[APACHE_IDLE_WORKERS])
+        mp_perfdata_int("idle_workers",
+                strtol(value[APACHE_IDLE_WORKERS], NULL, 10), "", NULL);
+    if (value[APACHE_GRACEFUL_WORKERS])
+        mp_perfdata_int("graceful_workers",
+                strtol(value[APACHE_GRACEFUL_WORKERS], NULL, 10), "", NULL);
+    if (value[APACHE_PROCESSES])
+        mp_perfdata_int("processes",
+                strtol(value[APACHE_PROCESSES], NULL, 10), "", NULL);
+    if (value[APACHE_STOPPING])
+        mp_perfdata_int("stopping",
+                strtol(value[APACHE_STOPPING], NULL, 10), "", NULL);
+    if (value[APACHE_CONNS_TOTAL])
+        mp_perfdata_int("conns",
+                strtol(value[APACHE_CONNS_TOTAL], NULL, 10), "", NULL);
+    if (value[APACHE_CONNS_ASYNC_WRITING])
+        mp_perfdata_int("conns_writing",
+                strtol(value[APACHE_CONNS_ASYNC_WRITING], NULL, 10), "", NULL);
+    if (value[APACHE_CONNS_ASYNC_KEEPALIVE])
+        mp_perfdata_int("conns_keepalive",
+                strtol(value[APACHE_CONNS_ASYNC_KEEPALIVE], NULL, 10), "", NULL);
+    if (value[APACHE_CONNS_ASYNC_CLOSING])
+        mp_perfdata_int("conns_closing",
+                strtol(value[APACHE_CONNS_ASYNC_CLOSING], NULL, 10), "", NULL);
+    mp_curl_perfdata();
 
     if (open_thresholds) {
-        switch(get_status(sb_open, open_thresholds)) {
-        case STATE_OK:
-            free_threshold(open_thresholds);
-            ok("Apache HTTPD status - %s", server);
-            break;
+        switch(get_status(status->values.slots[0], open_thresholds)) {
         case STATE_WARNING:
-            free_threshold(open_thresholds);
-            warning("Apache HTTPD low on open slots - %s", server);
+            warning("Apache HTTPD low on open slots - %s", status->server);
             break;
         case STATE_CRITICAL:
-            free_threshold(open_thresholds);
-            critical("Apache HTTPD not enough open slots - %s", server);
+            critical("Apache HTTPD not enough open slots - %s", status->server);
             break;
         }
     }
-    ok("Apache HTTPD status - %s", server);
+    if (value[APACHE_SERVER_MPM])
+        mp_exit("Apache HTTPD status - %s (%s MPM)", status->server,
+                value[APACHE_SERVER_MPM]);
+    mp_exit("Apache HTTPD status - %s", status->server);
+}
+
+void apache_status_line(char *line, size_t len, void *userdata) {
+    struct apache_status_s *status = userdata;
+
+    apache_auto_line(&(status->values), line, len);
 }
 
 int process_arguments (int argc, char **argv) {
@@ -215,6 +280,9 @@ int process_arguments (int argc, char **argv) {
         MP_LONGOPTS_HOST,
         MP_LONGOPTS_PORT,
         {"url", required_argument, 0, 'u'},
+        {"max-body", required_argument, NULL, MP_LONGOPT_CURL_MAXBODY},
+        MP_LONGOPTS_CURL_HOSTS,
+        MP_LONGOPTS_CURL_TIMING,
         MP_LONGOPTS_WC,
         MP_LONGOPTS_END
     };
@@ -245,12 +313,26 @@ int process_arguments (int argc, char **argv) {
             case 'P':
                 getopt_port(optarg, &port);
                 break;
+            case MP_LONGOPT_CURL_MAXBODY:
+            case MP_LONGOPT_HOSTS:
+            case MP_LONGOPT_CURL_PARALLEL:
+            case MP_LONGOPT_CURL_WARN_TTFB:
+            case MP_LONGOPT_CURL_CRIT_TTFB:
+            case MP_LONGOPT_CURL_WARN_TOTAL:
+            case MP_LONGOPT_CURL_CRIT_TOTAL:
+                getopt_curl(c);
+                break;
         }
     }
 
     /* Check requirements */
-    if (!is_url_scheme(url, "http") && !is_url_scheme(url, "https"))
+    if (url && !is_url_scheme(url, "http") && !is_url_scheme(url, "https"))
         usage("Only http and https url allowed.");
+    if (mp_curl_hosts_num > 0) {
+        if (url || hostname)
+            usage("Only Url, Hostname or Hosts allowed.");
+        return(OK);
+    }
     if (!url && !hostname)
         usage("Url or Hostname is mandatory.");
     if (url && hostname)
@@ -294,6 +376,9 @@ void print_help (void) {
     print_help_port("80");
     printf(" -u, --url=URL\n");
     printf("      URL of mod_status.\n");
+    print_help_curl_maxbody();
+    print_help_curl_hosts();
+    print_help_curl_timing();
     print_help_warn("open slots", "none");
     print_help_crit("open slots", "none");
 }
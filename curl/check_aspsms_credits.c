@@ -56,7 +56,6 @@ int main (int argc, char **argv) {
     /* Local Vars */
     CURL        *curl;
     long int    code;
-    double      time;
     struct mp_curl_data query;
     struct mp_curl_data answer;
     struct curl_slist *headers = NULL;
@@ -84,8 +83,7 @@ int main (int argc, char **argv) {
         "<Action>ShowCredits</Action>\n</aspsms>", userkey, password);
     query.size = strlen(query.data);
     query.start = 0;
-    answer.data = NULL;
-    answer.size = 0;
+    memset(&answer, 0, sizeof(struct mp_curl_data));
 
     if (mp_verbose > 0) {
         printf("CURL Version: %s\n", curl_version());
@@ -117,10 +115,6 @@ int main (int argc, char **argv) {
     /* Perform request */
     code = mp_curl_perform(curl);
 
-    /* Get metric */
-    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &time);
-    mp_perfdata_float("time", (float)time, "s", NULL);
-
     /* Cleanup libcurl */
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
@@ -133,6 +127,8 @@ int main (int argc, char **argv) {
 
     if (code != 200)
         critical("API HTTP-Response %ld.", code);
+    if (answer.overflow)
+        critical("API answer larger than %zu bytes.", mp_curl_maxbody);
 
     /* Parse Answer */
     xmlp = answer.data;
@@ -162,10 +158,12 @@ int main (int argc, char **argv) {
     if (errorDescription)
         free(errorDescription);
 
+    mp_curl_perfdata();
+
     switch(get_status((int)credits, credit_thresholds)) {
         case STATE_OK:
             free_threshold(credit_thresholds);
-            ok("ASP SMS %.2f credits left for %s.", credits, userkey);
+            mp_exit("ASP SMS %.2f credits left for %s.", credits, userkey);
             break;
         case STATE_WARNING:
             free_threshold(credit_thresholds);
@@ -189,6 +187,7 @@ int process_arguments (int argc, char **argv) {
         {"userkey", required_argument, 0, 'U'},
         {"password", required_argument, 0, 'P'},
         MP_LONGOPTS_WC,
+        MP_LONGOPTS_CURL_TIMING,
         MP_LONGOPTS_END
     };
 
@@ -216,6 +215,12 @@ int process_arguments (int argc, char **argv) {
             case 'P':
                 password = optarg;
                 break;
+            case MP_LONGOPT_CURL_WARN_TTFB:
+            case MP_LONGOPT_CURL_CRIT_TTFB:
+            case MP_LONGOPT_CURL_WARN_TOTAL:
+            case MP_LONGOPT_CURL_CRIT_TOTAL:
+                getopt_curl(c);
+                break;
         }
     }
 
@@ -247,6 +252,7 @@ void print_help (void) {
     printf("      The password of the ASPSMS account.\n");
     print_help_warn("credits", "100:");
     print_help_crit("credits", "50:");
+    print_help_curl_timing();
 }
 
 /* vim: set ts=4 sw=4 et syn=c : */
@@ -48,22 +48,26 @@ const char *progusage = "--hostname <BUILDBOTHOST> [--slave <SLAVENAME>]";
 /* Global Vars */
 const char *hostname = NULL;
 int port = 8010;
-const char *subpath = "";
-const char *httpuser = NULL;
-const char *httppass = NULL;
 char **slave = NULL;
 int slaves = 0;
 
+/* One request of the slave list or a single slave. */
+struct buildbot_query {
+    char *url;
+    struct mp_json_stream answer;
+    struct mp_curl_cache cache;
+    mp_curl_transfer *transfer;
+};
+
 /* Function prototype */
+static void buildbot_query_add(struct buildbot_query *query, const char *name);
+static struct json_object *buildbot_query_result(struct buildbot_query *query);
 
 int main (int argc, char **argv) {
     /* Local Vars */
-    CURL                *curl;
-    char                *url;
     int                 i, j;
     char                *buf;
-    struct mp_curl_data answer;
-    long int            code;
+    struct buildbot_query *queries;
     struct json_object  *obj;
     struct json_object  *slaveobj;
     struct json_object  *bufobj;
@@ -84,58 +88,42 @@ int main (int argc, char **argv) {
     /* Start plugin timeout */
     alarm(mp_timeout);
 
-    /* Build query */
-    url = mp_curl_url("http", hostname, port, "/json/slaves");
-    if (slaves) {
-        mp_strcat(&url, "?select=");
-        mp_strcat(&url, slave[0]);
-        for(i=1; i<slaves; i++) {
-            mp_strcat(&url, "&select=");
-            mp_strcat(&url, slave[i]);
-        }
-    }
-
     if (mp_verbose > 0) {
         printf("CURL Version: %s\n", curl_version());
-        printf("Url: %s\n", url);
     }
 
-    /* Init libcurl */
-    curl = mp_curl_init();
-    answer.data = NULL;
-    answer.size = 0;
-
-    /* Setup request */
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_curl_recv_data);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&answer);
-
-    if (httpuser || httppass) {
-      curl_easy_setopt(curl, CURLOPT_HTTPAUTH, (long)CURLAUTH_ANY);
-      char *userpwd;
-      mp_asprintf(&userpwd, "%s:%s", httpuser, httppass);
-      curl_easy_setopt(curl, CURLOPT_USERPWD, userpwd);
+    /* Query the given slaves only or the whole list */
+    if (slaves) {
+        queries = mp_calloc(slaves, sizeof(struct buildbot_query));
+        for (i=0; i<slaves; i++)
+            buildbot_query_add(&queries[i], slave[i]);
+    } else {
+        queries = mp_calloc(1, sizeof(struct buildbot_query));
+        buildbot_query_add(&queries[0], NULL);
     }
 
-    /* Get url */
-    code = mp_curl_perform(curl);
+    if (mp_curl_multi_run() != OK)
+        unknown("libcurl multi transfer failed!");
+
+    if (slaves) {
+        obj = json_object_new_object();
+        for (i=0; i<slaves; i++) {
+            slaveobj = buildbot_query_result(&queries[i]);
+            if (slaveobj)
+                json_object_object_add(obj, slave[i], slaveobj);
+        }
+    } else {
+        obj = buildbot_query_result(&queries[0]);
+    }
 
     /* Cleanup libcurl */
-    curl_easy_cleanup(curl);
+    free(queries);
     curl_global_cleanup();
-    free(url);
-
-    if (code != 200) {
-        critical("Buildbot - HTTP Status %ld.", code);
-    }
 
     if (mp_verbose > 1) {
-        printf("Answer: '%s'\n", answer.data);
+        printf("JSON:\n%s\n", mp_json_object_to_json_string(obj));
     }
 
-    /* Parse Answer */
-    obj = mp_json_tokener_parse(answer.data);
-
     if (slaves) {
         for(i=0; i<slaves; i++) {
             // Get Slave from array
@@ -232,16 +220,80 @@ int main (int argc, char **argv) {
     /* free */
     json_object_put(obj);
 
+    mp_curl_perfdata();
+
     if (failed && connected) {
         critical("%s, (OK: %s)", failed, connected);
     } else if (failed) {
         critical(failed);
     } else if (connected) {
-        ok(connected);
+        mp_exit(connected);
     }
     warning("No Slaves found");
 }
 
+static void buildbot_query_add(struct buildbot_query *query, const char *name) {
+    CURL    *curl;
+    char    *path;
+    char    *escaped;
+
+    /* Init libcurl */
+    curl = mp_curl_init();
+
+    /* Build query */
+    if (name) {
+        escaped = curl_easy_escape(curl, name, 0);
+        mp_asprintf(&path, "/json/slaves/%s", escaped);
+        curl_free(escaped);
+    } else {
+        path = mp_strdup("/json/slaves");
+    }
+    query->url = mp_curl_url("http", hostname, port, path);
+    free(path);
+
+    if (mp_verbose > 0) {
+        printf("Url: %s\n", query->url);
+    }
+
+    mp_json_stream_init(&query->answer, mp_curl_maxbody);
+    mp_curl_cache_init(&query->cache, curl, query->url);
+
+    /* Setup request */
+    curl_easy_setopt(curl, CURLOPT_URL, query->url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_json_recv);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&query->answer);
+
+    query->transfer = mp_curl_multi_add(curl, NULL, query);
+}
+
+static struct json_object *buildbot_query_result(struct buildbot_query *query) {
+    struct json_object *obj = NULL;
+    long int code;
+
+    code = mp_curl_transfer_code(query->transfer);
+
+    if (mp_curl_cache_hit(&query->cache, code)) {
+        /* Unchanged, use the last answer */
+        mp_json_stream_free(&query->answer);
+        obj = mp_json_tokener_parse(query->cache.summary);
+    } else if (code == 404 && slaves) {
+        /* Unknown slave */
+        mp_json_stream_free(&query->answer);
+    } else if (code != 200) {
+        critical("Buildbot - HTTP Status %ld.", code);
+    } else {
+        /* Answer was parsed while received */
+        obj = mp_json_stream_finish(&query->answer);
+        mp_curl_cache_store(&query->cache, json_object_to_json_string(obj));
+    }
+
+    mp_curl_cache_free(&query->cache);
+    mp_curl_transfer_free(query->transfer);
+    free(query->url);
+
+    return obj;
+}
+
 int process_arguments (int argc, char **argv) {
     int c;
     int option = 0;
@@ -310,6 +362,8 @@ void print_help (void) {
     print_help_curl_subpath();
     print_help_curl_basic_auth();
     print_help_curl_https();
+    print_help_curl_maxbody();
+    print_help_curl_timing();
     printf(" -S, --slave=SLAVE\n");
     printf("      Check state of defines SLAVE(s).\n");
 }
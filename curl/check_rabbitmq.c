@@ -51,19 +51,97 @@ int port = 15672;
 thresholds *messages_thresholds = NULL;
 thresholds *messages_ready_thresholds = NULL;
 thresholds *messages_unacknowledged_thresholds = NULL;
+thresholds *consumers_thresholds = NULL;
+int queue_mode = 0;
+const char *queue_regex = NULL;
+const char *vhost = NULL;
+long page_size = 500;
+int top = 5;
+
+/* Values of /api/overview the check uses. */
+enum {
+    RABBITMQ_VERSION,
+    RABBITMQ_MESSAGES,
+    RABBITMQ_MESSAGES_READY,
+    RABBITMQ_MESSAGES_UNACKNOWLEDGED,
+    RABBITMQ_PUBLISH,
+    RABBITMQ_PATHS
+};
+static struct mp_json_path paths[RABBITMQ_PATHS] = {
+    { "rabbitmq_version", json_type_null, NULL },
+    { "queue_totals.messages", json_type_null, NULL },
+    { "queue_totals.messages_ready", json_type_null, NULL },
+    { "queue_totals.messages_unacknowledged", json_type_null, NULL },
+    { "message_stats.publish", json_type_null, NULL },
+};
+
+/* Values of an /api/queues page the queue mode uses. */
+enum {
+    QUEUE_NAME,
+    QUEUE_VHOST,
+    QUEUE_MESSAGES,
+    QUEUE_MESSAGES_READY,
+    QUEUE_MESSAGES_UNACKNOWLEDGED,
+    QUEUE_CONSUMERS,
+    QUEUE_PUBLISH_RATE,
+    QUEUE_DELIVER_RATE,
+    QUEUE_PAGE_COUNT,
+    QUEUE_PATHS
+};
+static struct mp_json_path queue_paths[QUEUE_PATHS] = {
+    { "items.*.name", json_type_null, NULL },
+    { "items.*.vhost", json_type_null, NULL },
+    { "items.*.messages", json_type_null, NULL },
+    { "items.*.messages_ready", json_type_null, NULL },
+    { "items.*.messages_unacknowledged", json_type_null, NULL },
+    { "items.*.consumers", json_type_null, NULL },
+    { "items.*.message_stats.publish_details.rate", json_type_null, NULL },
+    { "items.*.message_stats.deliver_get_details.rate", json_type_null, NULL },
+    { "page_count", json_type_null, NULL },
+};
+/* Let the server only send the columns in queue_paths. */
+#define QUEUE_COLUMNS   "name,vhost,messages,messages_ready," \
+    "messages_unacknowledged,consumers," \
+    "message_stats.publish_details.rate," \
+    "message_stats.deliver_get_details.rate"
+
+/* A queue kept for the output. */
+struct rabbitmq_queue {
+    char    *name;
+    int     state;
+    long    messages;
+    long    consumers;
+};
+
+/* Totals of all queues and the worst of them. */
+struct rabbitmq_queues {
+    long    count;
+    long    warning;
+    long    critical;
+    long    messages;
+    long    messages_ready;
+    long    messages_unacknowledged;
+    long    consumers;
+    double  publish_rate;
+    double  deliver_rate;
+    int     num_worst;
+    struct rabbitmq_queue *worst;   /**< Worst first, at most top. */
+};
 
 /* Function prototype */
+static void rabbitmq_queue_item(struct mp_json_scan *scan, void *userdata);
+static void check_queues(void);
 
 int main (int argc, char **argv) {
     /* Local Vars */
     char                *name = "RabbitMQ";
     CURL                *curl;
     char                *url;
-    struct mp_curl_data answer;
+    int                 i;
+    struct mp_json_scan answer;
+    struct mp_curl_cache cache;
     long int            code;
     struct json_object  *obj;
-    struct json_object  *bufobj;
-    struct json_object  *queue_totals;
     long queue_messages = -1;
     long queue_messages_ready = -1;
     long queue_messages_unacknowledged = -1;
@@ -79,6 +157,9 @@ int main (int argc, char **argv) {
     /* Start plugin timeout */
     alarm(mp_timeout);
 
+    if (queue_mode)
+        check_queues();
+
     /* Build URL */
     url = mp_curl_url("http", hostname, port, "/api/overview");
 
@@ -89,12 +170,12 @@ int main (int argc, char **argv) {
 
     /* Init libcurl */
     curl = mp_curl_init();
-    answer.data = NULL;
-    answer.size = 0;
+    mp_json_scan_init(&answer, paths, RABBITMQ_PATHS, mp_curl_maxbody);
+    mp_curl_cache_init(&cache, curl, url);
 
     /* Setup request */
     curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_curl_recv_data);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_json_scan_recv);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&answer);
 
     /* Get url */
@@ -105,37 +186,45 @@ int main (int argc, char **argv) {
     curl_global_cleanup();
     free(url);
 
-    if (code != 200) {
-        critical("RabbitMQ - HTTP Status %ld.", code);
-    }
+    if (mp_curl_cache_hit(&cache, code)) {
+        /* Unchanged, use the summary of the last answer */
+        mp_json_scan_free(&answer);
+        mp_json_scan_string(cache.summary, paths, RABBITMQ_PATHS);
+    } else {
+        if (code != 200) {
+            critical("RabbitMQ - HTTP Status %ld.", code);
+        }
 
-    if (mp_verbose > 2) {
-        printf("Answer: '%s'\n", answer.data);
-    }
+        /* Answer was scanned while received */
+        mp_json_scan_finish(&answer);
 
-    /* Parse Answer */
-    obj = mp_json_tokener_parse(answer.data);
+        /* Only keep what is checked */
+        obj = mp_json_paths_object(paths, RABBITMQ_PATHS);
+        mp_curl_cache_store(&cache, json_object_to_json_string(obj));
+        json_object_put(obj);
+    }
+    mp_curl_cache_free(&cache);
 
     if (mp_verbose > 1) {
-        printf("JSON:\n%s\n", mp_json_object_to_json_string(obj));
+        for (i = 0; i < RABBITMQ_PATHS; i++)
+            printf("%s: %s\n", paths[i].path,
+                    paths[i].value ? paths[i].value : "(missing)");
     }
 
     /* Read Server Version */
-    if (mp_json_object_object_get(obj,"rabbitmq_version", &bufobj)) {
-        mp_asprintf(&name, "RabbitMQ %s:", json_object_get_string(bufobj));
+    if (paths[RABBITMQ_VERSION].value) {
+        mp_asprintf(&name, "RabbitMQ %s:", paths[RABBITMQ_VERSION].value);
     }
 
     /* Get Message Counts */
-    mp_json_object_object_get(obj, "queue_totals", &queue_totals);
-    if (queue_totals != NULL ) {
-        if(mp_json_object_object_get(queue_totals,"messages", &bufobj))
-            queue_messages = json_object_get_int(bufobj);
-
-        if(mp_json_object_object_get(queue_totals,"messages_ready", &bufobj))
-            queue_messages_ready = json_object_get_int(bufobj);
-
-        if(mp_json_object_object_get(queue_totals,"messages_unacknowledged", &bufobj))
-            queue_messages_unacknowledged = json_object_get_int(bufobj);
+    if (paths[RABBITMQ_MESSAGES].value || paths[RABBITMQ_MESSAGES_READY].value
+            || paths[RABBITMQ_MESSAGES_UNACKNOWLEDGED].value) {
+        queue_messages = (long)mp_json_path_int(
+                &paths[RABBITMQ_MESSAGES], -1);
+        queue_messages_ready = (long)mp_json_path_int(
+                &paths[RABBITMQ_MESSAGES_READY], -1);
+        queue_messages_unacknowledged = (long)mp_json_path_int(
+                &paths[RABBITMQ_MESSAGES_UNACKNOWLEDGED], -1);
 
         mp_perfdata_int("messages", queue_messages, "", messages_thresholds);
         mp_perfdata_int("messages_ready", queue_messages_ready,
@@ -148,13 +237,12 @@ int main (int argc, char **argv) {
 
     /* Read message counters */
     if (mp_showperfdata) {
-        mp_json_object_object_get(obj, "message_stats", &queue_totals);
-        mp_json_object_object_get(queue_totals, "publish", &bufobj);
-        mp_perfdata_int("publish", (long int)json_object_get_int(bufobj), "c", NULL);
+        mp_perfdata_int("publish",
+                (long int)mp_json_path_int(&paths[RABBITMQ_PUBLISH], 0), "c", NULL);
     }
 
     /* free */
-    json_object_put(obj);
+    mp_json_paths_free(paths, RABBITMQ_PATHS);
 
     /* Check queue size */
     switch(get_status(queue_messages, messages_thresholds)) {
@@ -182,9 +270,192 @@ int main (int argc, char **argv) {
             break;
     }
     
+    mp_curl_perfdata();
     mp_exit(name);
 }
 
+/* Check a queue of a page and keep it if it is among the worst. */
+static void rabbitmq_queue_item(struct mp_json_scan *scan, void *userdata) {
+    struct rabbitmq_queues  *queues = (struct rabbitmq_queues *)userdata;
+    struct mp_json_path     *item = scan->paths;
+    struct rabbitmq_queue   *worst;
+    long    messages, ready, unacknowledged, consumers;
+    int     state, i;
+
+    if (item[QUEUE_NAME].value == NULL)
+        return;
+
+    messages = (long)mp_json_path_int(&item[QUEUE_MESSAGES], 0);
+    ready = (long)mp_json_path_int(&item[QUEUE_MESSAGES_READY], 0);
+    unacknowledged = (long)mp_json_path_int(
+            &item[QUEUE_MESSAGES_UNACKNOWLEDGED], 0);
+    consumers = (long)mp_json_path_int(&item[QUEUE_CONSUMERS], 0);
+
+    queues->count++;
+    queues->messages += messages;
+    queues->messages_ready += ready;
+    queues->messages_unacknowledged += unacknowledged;
+    queues->consumers += consumers;
+    queues->publish_rate += mp_json_path_double(&item[QUEUE_PUBLISH_RATE], 0);
+    queues->deliver_rate += mp_json_path_double(&item[QUEUE_DELIVER_RATE], 0);
+
+    state = get_status(messages, messages_thresholds);
+    i = get_status(ready, messages_ready_thresholds);
+    state = i > state ? i : state;
+    i = get_status(unacknowledged, messages_unacknowledged_thresholds);
+    state = i > state ? i : state;
+    i = get_status(consumers, consumers_thresholds);
+    state = i > state ? i : state;
+
+    if (state == STATE_CRITICAL)
+        queues->critical++;
+    else if (state == STATE_WARNING)
+        queues->warning++;
+
+    /* Rank by state, then by messages */
+    for (i = queues->num_worst; i > 0; i--) {
+        worst = &queues->worst[i - 1];
+        if (worst->state > state
+                || (worst->state == state && worst->messages >= messages))
+            break;
+    }
+    if (i >= top)
+        return;
+
+    if (queues->num_worst == top)
+        free(queues->worst[top - 1].name);
+    else
+        queues->num_worst++;
+    memmove(&queues->worst[i + 1], &queues->worst[i],
+            (queues->num_worst - i - 1) * sizeof(struct rabbitmq_queue));
+
+    worst = &queues->worst[i];
+    if (item[QUEUE_VHOST].value && strcmp(item[QUEUE_VHOST].value, "/") != 0)
+        mp_asprintf(&worst->name, "%s/%s", item[QUEUE_VHOST].value,
+                item[QUEUE_NAME].value);
+    else
+        worst->name = mp_strdup(item[QUEUE_NAME].value);
+    worst->state = state;
+    worst->messages = messages;
+    worst->consumers = consumers;
+}
+
+/*
+ * Check all queues page by page, only one page is held in memory.
+ */
+static void check_queues(void) {
+    CURL                    *curl;
+    char                    *path;
+    char                    *filter = NULL;
+    char                    *escaped;
+    char                    *url;
+    struct mp_json_scan     answer;
+    struct rabbitmq_queues  queues;
+    long int                code;
+    long int                page;
+    long int                page_count = 1;
+    int                     i;
+
+    memset(&queues, 0, sizeof(struct rabbitmq_queues));
+    queues.worst = mp_malloc(top * sizeof(struct rabbitmq_queue));
+
+    if (mp_verbose > 0)
+        printf("CURL Version: %s\n", curl_version());
+
+    /* Init libcurl, the connection is reused for all pages */
+    curl = mp_curl_init();
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_json_scan_recv);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&answer);
+
+    /* Filter on the server */
+    if (vhost) {
+        escaped = curl_easy_escape(curl, vhost, 0);
+        mp_asprintf(&path, "/api/queues/%s", escaped);
+        curl_free(escaped);
+    } else {
+        path = mp_strdup("/api/queues");
+    }
+    if (queue_regex) {
+        escaped = curl_easy_escape(curl, queue_regex, 0);
+        mp_asprintf(&filter, "&name=%s&use_regex=true", escaped);
+        curl_free(escaped);
+    }
+
+    for (page = 1; page <= page_count; page++) {
+        mp_asprintf(&url, "%s?page=%ld&page_size=%ld%s&columns=%s", path,
+                page, page_size, filter ? filter : "", QUEUE_COLUMNS);
+        escaped = url;
+        url = mp_curl_url("http", hostname, port, escaped);
+        free(escaped);
+
+        if (mp_verbose > 0)
+            printf("Url: %s\n", url);
+
+        mp_json_scan_init(&answer, queue_paths, QUEUE_PATHS, mp_curl_maxbody);
+        mp_json_scan_each(&answer, "items.*", rabbitmq_queue_item, &queues);
+
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        code = mp_curl_perform(curl);
+        free(url);
+
+        if (code != 200)
+            critical("RabbitMQ - HTTP Status %ld.", code);
+
+        /* Page was scanned while received */
+        mp_json_scan_finish(&answer);
+
+        if (queue_paths[QUEUE_PAGE_COUNT].value == NULL)
+            critical("RabbitMQ - Queue list not paginated, needs RabbitMQ 3.6 or newer.");
+        page_count = (long)mp_json_path_int(&queue_paths[QUEUE_PAGE_COUNT], 0);
+    }
+
+    /* Cleanup libcurl */
+    curl_easy_cleanup(curl);
+    curl_global_cleanup();
+    mp_json_paths_free(queue_paths, QUEUE_PATHS);
+    free(path);
+    free(filter);
+
+    if (mp_verbose > 1)
+        printf("Queues: %ld, %ld pages\n", queues.count, page_count);
+
+    mp_perfdata_int("queues", queues.count, "", NULL);
+    mp_perfdata_int("messages", queues.messages, "", NULL);
+    mp_perfdata_int("messages_ready", queues.messages_ready, "", NULL);
+    mp_perfdata_int("messages_unacknowledged", queues.messages_unacknowledged,
+            "", NULL);
+    mp_perfdata_int("consumers", queues.consumers, "", NULL);
+    mp_perfdata_float("publish_rate", (float)queues.publish_rate, "", NULL);
+    mp_perfdata_float("deliver_rate", (float)queues.deliver_rate, "", NULL);
+
+    /* Report the worst queues */
+    for (i = 0; i < queues.num_worst; i++) {
+        switch (queues.worst[i].state) {
+            case STATE_CRITICAL:
+                set_critical("%s %ld messages %ld consumers",
+                        queues.worst[i].name, queues.worst[i].messages,
+                        queues.worst[i].consumers);
+                break;
+            case STATE_WARNING:
+                set_warning("%s %ld messages %ld consumers",
+                        queues.worst[i].name, queues.worst[i].messages,
+                        queues.worst[i].consumers);
+                break;
+            default:
+                set_ok("%s %ld messages %ld consumers",
+                        queues.worst[i].name, queues.worst[i].messages,
+                        queues.worst[i].consumers);
+                break;
+        }
+        free(queues.worst[i].name);
+    }
+    free(queues.worst);
+
+    mp_curl_perfdata();
+    mp_exit("RabbitMQ %ld queues, %ld critical, %ld warning", queues.count,
+            queues.critical, queues.warning);
+}
+
 int process_arguments (int argc, char **argv) {
     int c;
     int option = 0;
@@ -199,6 +470,13 @@ int process_arguments (int argc, char **argv) {
         {"critical-ready", required_argument, 0, MP_LONGOPT_PRIV2},
         {"warning-unacknowledged", required_argument, 0, MP_LONGOPT_PRIV3},
         {"critical-unacknowledged", required_argument, 0, MP_LONGOPT_PRIV4},
+        {"queues", no_argument, NULL, (int)'Q'},
+        {"queue", required_argument, NULL, (int)'q'},
+        {"vhost", required_argument, 0, MP_LONGOPT_PRIV5},
+        {"page-size", required_argument, 0, MP_LONGOPT_PRIV6},
+        {"top", required_argument, NULL, (int)'N'},
+        {"warning-consumers", required_argument, 0, MP_LONGOPT_PRIV7},
+        {"critical-consumers", required_argument, 0, MP_LONGOPT_PRIV8},
         MP_LONGOPTS_END
     };
 
@@ -211,7 +489,7 @@ int process_arguments (int argc, char **argv) {
 
     while (1) {
         c = mp_getopt(&argc, &argv,
-                MP_OPTSTR_DEFAULT"H:P:u:p:"MP_OPTSTR_WC,
+                MP_OPTSTR_DEFAULT"H:P:u:p:Qq:N:"MP_OPTSTR_WC,
                 longopts, &option);
 
         if (c == -1 || c == EOF)
@@ -245,6 +523,36 @@ int process_arguments (int argc, char **argv) {
                 if (mp_threshold_set_critical(&messages_unacknowledged_thresholds, optarg, BISI) == ERROR)
                     usage("Illegal --critical-unacknowledged threshold '%s'.", optarg);
                 break;
+            case MP_LONGOPT_PRIV7:
+                if (mp_threshold_set_warning(&consumers_thresholds, optarg, NOEXT) == ERROR)
+                    usage("Illegal --warning-consumers threshold '%s'.", optarg);
+                break;
+            case MP_LONGOPT_PRIV8:
+                if (mp_threshold_set_critical(&consumers_thresholds, optarg, NOEXT) == ERROR)
+                    usage("Illegal --critical-consumers threshold '%s'.", optarg);
+                break;
+            /* Queue mode opt */
+            case 'Q':
+                queue_mode = 1;
+                break;
+            case 'q':
+                queue_mode = 1;
+                queue_regex = optarg;
+                break;
+            case MP_LONGOPT_PRIV5:
+                queue_mode = 1;
+                vhost = optarg;
+                break;
+            case MP_LONGOPT_PRIV6:
+                page_size = strtol(optarg, NULL, 10);
+                if (page_size < 1)
+                    usage("Illegal --page-size '%s'.", optarg);
+                break;
+            case 'N':
+                top = (int)strtol(optarg, NULL, 10);
+                if (top < 1)
+                    usage("Illegal --top '%s'.", optarg);
+                break;
         }
     }
 
@@ -274,6 +582,8 @@ void print_help (void) {
     print_help_curl_subpath();
     print_help_curl_basic_auth();
     print_help_curl_https();
+    print_help_curl_maxbody();
+    print_help_curl_timing();
     print_help_warn("message count","INF");
     print_help_crit("message count","INF");
     printf("     --warning-ready=LIMIT\n");
@@ -284,6 +594,22 @@ void print_help (void) {
     printf("      Return warning if unacknowledged message count exceeds limit. Defaults to INF\n");
     printf("     --critical-unacknowledged=LIMIT\n");
     printf("      Return critical if unacknowledged message count exceeds limit. Defaults to INF\n");
+    printf("\nQueue mode:\n");
+    printf(" -Q, --queues\n");
+    printf("      Check each queue instead of the overview totals. The thresholds\n");
+    printf("      apply to every queue.\n");
+    printf(" -q, --queue=REGEX\n");
+    printf("      Only check queues with a name matching REGEX.\n");
+    printf("     --vhost=VHOST\n");
+    printf("      Only check queues of VHOST.\n");
+    printf("     --page-size=NUM\n");
+    printf("      Fetch NUM queues per request. Defaults to 500\n");
+    printf(" -N, --top=NUM\n");
+    printf("      Show the NUM worst queues. Defaults to 5\n");
+    printf("     --warning-consumers=LIMIT\n");
+    printf("      Return warning if a queue consumer count is outside limit, like '1:'.\n");
+    printf("     --critical-consumers=LIMIT\n");
+    printf("      Return critical if a queue consumer count is outside limit, like '1:'.\n");
 
 }
 
@@ -40,6 +40,7 @@ const char *progusage = "--url <URL>";
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <ctype.h>
@@ -59,38 +60,76 @@ int allowShoulds = 0;
 char *contentType = NULL;
 char *contentTypeShould = NULL;
 thresholds *fetch_thresholds = NULL;
+thresholds *upload_thresholds = NULL;
+thresholds *download_thresholds = NULL;
 int do_list = 0;
+size_t probe_size = 0;
 
 #ifdef HAVE_EXPAT
-struct webdav_list {
+/* One DAV:response of a PROPFIND answer. */
+struct webdav_entry {
     char *path;
     char *type;
     char *status;
-    struct webdav_list *next;
 };
 
+/* PROPFIND answer state, only the current response is kept. */
 struct webdav_parser {
-    char *name;
-    struct webdav_list *list;
+    int text;                   /**< Element whose text is collected. */
+    struct webdav_entry entry;  /**< Current response. */
+    struct webdav_entry first;  /**< First response, the requested url. */
+    long count;                 /**< Number of responses. */
+};
+
+enum {
+    WEBDAV_TEXT_NONE,
+    WEBDAV_TEXT_HREF,
+    WEBDAV_TEXT_STATUS,
+    WEBDAV_TEXT_RESOURCETYPE,
 };
 #endif
 
+/* Transfer probe object. */
+struct webdav_probe {
+    size_t size;                /**< Object size. */
+    size_t sent;                /**< Bytes uploaded. */
+    size_t received;            /**< Bytes downloaded. */
+    uint32_t seed;              /**< Object content generator state. */
+};
+
 /* Function prototype */
 #ifdef HAVE_EXPAT
 void webdav_startElement(void *userData, const char *name, const char **atts);
 void webdav_stopElement(void *userData, const char *name);
 void webdav_charData(void *userData, const XML_Char *s, int len);
+static void webdav_parser_init(struct mp_expat_stream *answer,
+        struct webdav_parser *parserInfo);
+static void webdav_entry_free(struct webdav_entry *entry);
 #endif
+static int webdav_probe(const char *url, char **output);
+static size_t webdav_probe_send(void *ptr, size_t size, size_t nmemb, void *userdata);
+static size_t webdav_probe_recv(void *ptr, size_t size, size_t nmemb, void *userdata);
 
 int main (int argc, char **argv) {
     /* Local Vars */
     CURL        *curl;
+    CURL        *list_curl = NULL;
+    mp_curl_transfer *options;
+    mp_curl_transfer *propfind = NULL;
     double      time;
     double      time_total;
     long        code;
     int         i;
     char        *output = NULL;
+    char        *probe_output = NULL;
     int         status = STATE_OK;
+    int         probe_status = STATE_OK;
+    struct curl_slist *header = NULL;
+    struct mp_curl_data query;
+#ifdef HAVE_EXPAT
+    struct mp_expat_stream answer;
+    struct webdav_parser parserInfo;
+#endif
 
     /* Set signal handling and alarm */
     if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
@@ -118,47 +157,64 @@ int main (int argc, char **argv) {
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, mp_curl_recv_header);
     curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)headers);
 
-    code = mp_curl_perform(curl);
-
-    if (code != 200)
-        critical("WebDav - HTTP Response Code %ld", code);
-
-    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &time_total);
+    options = mp_curl_multi_add(curl, NULL, NULL);
 
     if (do_list) {
-        struct curl_slist *header = NULL;
-        struct mp_curl_data query;
-        struct mp_curl_data answer;
-
-        /* Init query and answer */
+        /* Init query */
+        memset(&query, 0, sizeof(struct mp_curl_data));
         query.data = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\
                       <D:propfind xmlns:D=\"DAV:\"><D:prop><D:resourcetype/>\
                       </D:prop></D:propfind>";
         query.size = strlen(query.data);
-        query.start = 0;
-        answer.data = NULL;
-        answer.size = 0;
 
-        /* Disable header callback */
-        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, mp_curl_recv_blackhole);
+#ifdef HAVE_EXPAT
+        /* Init streaming answer parser */
+        memset(&parserInfo, 0, sizeof(struct webdav_parser));
+        webdav_parser_init(&answer, &parserInfo);
+#endif
+
+        /* PROPFIND Depth:0 on its own handle, runs along OPTIONS */
+        list_curl = mp_curl_init();
+        curl_easy_setopt(list_curl, CURLOPT_URL, url);
 
         /* Set header */
         header = curl_slist_append(header, "Depth: 0");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header);
+        curl_easy_setopt(list_curl, CURLOPT_HTTPHEADER, header);
 
         /* Set method */
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PROPFIND");
-        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+        curl_easy_setopt(list_curl, CURLOPT_CUSTOMREQUEST, "PROPFIND");
+        curl_easy_setopt(list_curl, CURLOPT_UPLOAD, 1L);
+        curl_easy_setopt(list_curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)query.size);
 
         /* IO Callback */
-        curl_easy_setopt(curl, CURLOPT_READFUNCTION, mp_curl_send_data);
-        curl_easy_setopt(curl, CURLOPT_READDATA, (void *)&query);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_curl_recv_data);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&answer);
+        curl_easy_setopt(list_curl, CURLOPT_READFUNCTION, mp_curl_send_data);
+        curl_easy_setopt(list_curl, CURLOPT_READDATA, (void *)&query);
+#ifdef HAVE_EXPAT
+        curl_easy_setopt(list_curl, CURLOPT_WRITEFUNCTION, mp_expat_recv);
+        curl_easy_setopt(list_curl, CURLOPT_WRITEDATA, (void *)&answer);
+#else
+        curl_easy_setopt(list_curl, CURLOPT_WRITEFUNCTION, mp_curl_recv_blackhole);
+#endif
+
+        propfind = mp_curl_multi_add(list_curl, NULL, NULL);
+    }
+
+    if (mp_curl_multi_run() != OK)
+        unknown("libcurl multi transfer failed!");
+
+    code = mp_curl_transfer_code(options);
+
+    if (code != 200)
+        critical("WebDav - HTTP Response Code %ld", code);
+
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &time_total);
 
-        code = mp_curl_perform(curl);
-        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &time);
-        time_total += time;
+    if (do_list) {
+        code = mp_curl_transfer_code(propfind);
+        /* Concurrent requests, so the slower one counts */
+        curl_easy_getinfo(list_curl, CURLINFO_TOTAL_TIME, &time);
+        if (time > time_total)
+            time_total = time;
 
         if (code != 207) {
             mp_perfdata_float("time", (float)time_total, "s", fetch_thresholds);
@@ -167,79 +223,36 @@ int main (int argc, char **argv) {
         }
 
 #ifdef HAVE_EXPAT
-        XML_Parser  parser;
-        struct webdav_parser *parserInfo;
-        struct webdav_list *list, *nextList;
-
-        parser = XML_ParserCreateNS(NULL, 0);
-
-        parserInfo = mp_malloc(sizeof(struct webdav_parser));
-        parserInfo->name = NULL;
-        parserInfo->list = NULL;
-
-        XML_SetUserData(parser, parserInfo);
-        XML_SetElementHandler(parser, webdav_startElement, webdav_stopElement);
-        XML_SetCharacterDataHandler(parser, webdav_charData);
-
-        if (!XML_Parse(parser, answer.data, answer.size, 1)) {
-            unknown("%s at line %d\n",
-                    XML_ErrorString(XML_GetErrorCode(parser)),
-                    (int) XML_GetCurrentLineNumber(parser));
-        }
-        XML_ParserFree(parser);
+        /* Answer was parsed while received */
+        mp_expat_finish(&answer);
+        XML_ParserFree(answer.parser);
 
         /* Check return */
-        if (parserInfo->list == NULL)
+        if (parserInfo.count == 0)
             critical("WebDAV - Parsing PROPFIND response failed!");
-        if (parserInfo->list->next != NULL)
+        if (parserInfo.count > 1)
             critical("WebDAV - Too many answers for PROPFIND Depth:0!");
-        if(strstr(parserInfo->list->status, "200") == NULL)
-            critical("WebDAV - PROPFIND status is %s", parserInfo->list->status);
+        if (!parserInfo.first.status || strstr(parserInfo.first.status, "200") == NULL)
+            critical("WebDAV - PROPFIND status is %s", parserInfo.first.status);
 
         /* For DAV:collection list Depth:1 */
-        if (parserInfo->list->type && (strcmp(parserInfo->list->type, "DAV:collection") == 0)) {
-
-            /* Free parserInfo */
-            if(mp_verbose > 3)
-                printf("PROPFIND %s (Depth:0)\n", url);
-            for (list = parserInfo->list; list; list = nextList) {
-                if(mp_verbose > 3)
-                    printf(" * %s (%s) [%s]\n", list->path, list->type, list->status);
-
-                free(list->path);
-                free(list->type);
-                free(list->status);
-
-                nextList = list->next;
-                free(list);
-            }
-            parserInfo->list = NULL;
-            parserInfo->name = NULL;
+        if (parserInfo.first.type && (strcmp(parserInfo.first.type, "DAV:collection") == 0)) {
 
             /* New Headers */
             curl_slist_free_all(header);
             header = NULL;
             header = curl_slist_append(header, "Depth: 1");
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header);
+            curl_easy_setopt(list_curl, CURLOPT_HTTPHEADER, header);
 
-            /* Reset query and answer*/
+            /* Reset query and answer */
             query.start = 0;
-            free(answer.data);
-            answer.data = NULL;
-            answer.size = 0;
-
-            /* Set method */
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PROPFIND");
-            curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
-
-            curl_easy_setopt(curl, CURLOPT_READFUNCTION, mp_curl_send_data);
-            curl_easy_setopt(curl, CURLOPT_READDATA, (void *)&query);
+            webdav_entry_free(&parserInfo.first);
+            parserInfo.count = 0;
+            webdav_parser_init(&answer, &parserInfo);
 
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mp_curl_recv_data);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&answer);
-
-            code = mp_curl_perform(curl);
-            curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &time);
+            /* Depth:1 reuses the connection of Depth:0 */
+            code = mp_curl_perform(list_curl);
+            curl_easy_getinfo(list_curl, CURLINFO_TOTAL_TIME, &time);
             time_total += time;
 
             if (code != 207) {
@@ -248,40 +261,30 @@ int main (int argc, char **argv) {
                 critical("WebDav - HTTP Response Code %ld", code);
             }
 
-            parser = XML_ParserCreateNS(NULL, 0);
-            XML_SetUserData(parser, parserInfo);
-            XML_SetElementHandler(parser, webdav_startElement, webdav_stopElement);
-            XML_SetCharacterDataHandler(parser, webdav_charData);
+            /* Listing was parsed while received, one response at a time */
+            mp_expat_finish(&answer);
+            XML_ParserFree(answer.parser);
 
-            if (!XML_Parse(parser, answer.data, answer.size, 1)) {
-                unknown("%s at line %d\n",
-                        XML_ErrorString(XML_GetErrorCode(parser)),
-                        (int) XML_GetCurrentLineNumber(parser));
-            }
-            XML_ParserFree(parser);
-
-            /* Free parserInfo */
-            if(mp_verbose > 3)
-                printf("PROPFIND %s (Depth:1)\n", url);
-            for (list = parserInfo->list; list; list = nextList) {
-                if(mp_verbose > 3)
-                    printf(" * %s (%s) [%s]\n", list->path, list->type, list->status);
-                free(list->path);
-                free(list->type);
-                free(list->status);
-
-                nextList = list->next;
-                free(list);
-            }
+            /* The collection itself is the first response */
+            mp_perfdata_int("entries", parserInfo.count - 1, "", NULL);
         }
+        webdav_entry_free(&parserInfo.first);
 #endif
+        curl_slist_free_all(header);
+        mp_curl_transfer_free(propfind);
     }
 
-    /* Cleanup libcurl */
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
+    mp_curl_transfer_free(options);
 
     mp_perfdata_float("time", (float)time_total, "s", fetch_thresholds);
+    mp_curl_perfdata();
+
+    /* After the request timing, the probe reports its transfers itself */
+    if (probe_size)
+        probe_status = webdav_probe(url, &probe_output);
+
+    /* Cleanup libcurl */
+    curl_global_cleanup();
 
     for (i=0; i < allowShoulds; i++) {
         char *ptr;
@@ -322,9 +325,15 @@ int main (int argc, char **argv) {
 
     free_threshold(fetch_thresholds);
 
+    if (probe_output) {
+        status = probe_status > status ? probe_status : status;
+        mp_strcat_space(&output, probe_output);
+        free(probe_output);
+    }
+
     switch(status) {
         case STATE_OK:
-            ok("WebDAV %s", dav);
+            mp_exit("WebDAV %s", dav);
             break;
         case STATE_WARNING:
             warning("WebDAV %s - %s", dav, output);
@@ -338,61 +347,232 @@ int main (int argc, char **argv) {
 }
 
 #ifdef HAVE_EXPAT
+static void webdav_parser_init(struct mp_expat_stream *answer,
+        struct webdav_parser *parserInfo) {
+    memset(answer, 0, sizeof(struct mp_expat_stream));
+    answer->max = mp_curl_maxbody;
+    answer->parser = XML_ParserCreateNS(NULL, 0);
+
+    XML_SetUserData(answer->parser, parserInfo);
+    XML_SetElementHandler(answer->parser, webdav_startElement, webdav_stopElement);
+    XML_SetCharacterDataHandler(answer->parser, webdav_charData);
+}
+
+static void webdav_entry_free(struct webdav_entry *entry) {
+    free(entry->path);
+    free(entry->type);
+    free(entry->status);
+    memset(entry, 0, sizeof(struct webdav_entry));
+}
+
 void webdav_startElement(void *userData, const char *name, const char **atts) {
     struct webdav_parser *parserInfo = (struct webdav_parser *)userData;
-    struct webdav_list *listNew;
 
-    if (parserInfo->name && (strcmp("DAV:resourcetype", parserInfo->name) == 0)) {
-        parserInfo->list->type = strdup(name);
-    }
-
-    if (parserInfo->name) {
-        free(parserInfo->name);
-        parserInfo->name = NULL;
+    if (parserInfo->text == WEBDAV_TEXT_RESOURCETYPE) {
+        free(parserInfo->entry.type);
+        parserInfo->entry.type = mp_strdup(name);
     }
+    parserInfo->text = WEBDAV_TEXT_NONE;
 
     if (strcmp("DAV:response", name) == 0) {
-        listNew = mp_malloc(sizeof(struct webdav_list));
-        listNew->path = NULL;
-        listNew->next = parserInfo->list;
-        listNew->type = NULL;
-        listNew->status = NULL;
-
-        parserInfo->list = listNew;
+        webdav_entry_free(&parserInfo->entry);
     } else if (strcmp("DAV:href", name) == 0) {
-        parserInfo->name = strdup(name);
+        parserInfo->text = WEBDAV_TEXT_HREF;
+        free(parserInfo->entry.path);
+        parserInfo->entry.path = NULL;
     } else if (strcmp("DAV:status", name) == 0) {
-        parserInfo->name = strdup(name);
+        parserInfo->text = WEBDAV_TEXT_STATUS;
+        free(parserInfo->entry.status);
+        parserInfo->entry.status = NULL;
     } else if (strcmp("DAV:resourcetype", name) == 0) {
-        parserInfo->name = strdup(name);
+        parserInfo->text = WEBDAV_TEXT_RESOURCETYPE;
     }
 }
+
 void webdav_stopElement(void *userData, const char *name) {
     struct webdav_parser *parserInfo = (struct webdav_parser *)userData;
+    struct webdav_entry *entry = &parserInfo->entry;
 
-    if (parserInfo->name) {
-        free(parserInfo->name);
-        parserInfo->name = NULL;
+    parserInfo->text = WEBDAV_TEXT_NONE;
+
+    if (strcmp("DAV:response", name) != 0)
+        return;
+
+    /* Response complete, keep only the first one */
+    if (mp_verbose > 3)
+        printf(" * %s (%s) [%s]\n", entry->path, entry->type, entry->status);
+
+    if (parserInfo->count++ == 0) {
+        parserInfo->first = *entry;
+        memset(entry, 0, sizeof(struct webdav_entry));
+    } else {
+        webdav_entry_free(entry);
     }
 }
+
 void webdav_charData(void *userData, const XML_Char *s, int len) {
     struct webdav_parser *parserInfo = (struct webdav_parser *)userData;
+    char **text;
+    size_t old;
 
-    if (parserInfo->name == NULL)
-        return;
-
-    if (strcmp("DAV:href", parserInfo->name) == 0) {
-        parserInfo->list->path = mp_malloc(len+1);
-        memcpy(parserInfo->list->path, s, len);
-        parserInfo->list->path[len] = '\0';
-    } else if (strcmp("DAV:status", parserInfo->name) == 0) {
-        parserInfo->list->status = mp_malloc(len+1);
-        memcpy(parserInfo->list->status, s, len);
-        parserInfo->list->status[len] = '\0';
+    switch (parserInfo->text) {
+        case WEBDAV_TEXT_HREF:
+            text = &parserInfo->entry.path;
+            break;
+        case WEBDAV_TEXT_STATUS:
+            text = &parserInfo->entry.status;
+            break;
+        default:
+            return;
     }
+
+    /* Text may arrive in pieces split at any receive buffer boundary */
+    old = *text ? strlen(*text) : 0;
+    *text = mp_realloc(*text, old + len + 1);
+    memcpy(*text + old, s, len);
+    (*text)[old + len] = '\0';
 }
 #endif
 
+/*
+ * PUT, GET and DELETE a probe object in the url collection. Returns the
+ * state of the throughput thresholds, failed requests are critical.
+ */
+static int webdav_probe(const char *url, char **output) {
+    CURL        *curl;
+    struct curl_slist *header = NULL;
+    struct webdav_probe probe;
+    char        *probe_url;
+    char        *speed;
+    double      put_time = 0;
+    double      get_time = 0;
+    double      delete_time = 0;
+    double      upload;
+    double      download;
+    long        put_code;
+    long        get_code;
+    size_t      received;
+    long        code;
+    int         state = STATE_OK;
+
+    mp_asprintf(&probe_url, "%s%scheck_webdav.%d.tmp", url,
+            url[strlen(url) - 1] == '/' ? "" : "/", (int)getpid());
+
+    if (mp_verbose > 0)
+        printf("Probe: %s (%zu bytes)\n", probe_url, probe_size);
+
+    memset(&probe, 0, sizeof(struct webdav_probe));
+    probe.size = probe_size;
+    probe.seed = 2463534242U;
+
+    curl = mp_curl_init();
+    curl_easy_setopt(curl, CURLOPT_URL, probe_url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, webdav_probe_recv);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&probe);
+
+    /* PUT, the object is generated while sent */
+    header = curl_slist_append(header, "Expect:");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header);
+    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+    curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)probe_size);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, webdav_probe_send);
+    curl_easy_setopt(curl, CURLOPT_READDATA, (void *)&probe);
+    put_code = mp_curl_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &put_time);
+
+    if (put_code != 200 && put_code != 201 && put_code != 204) {
+        curl_easy_cleanup(curl);
+        curl_slist_free_all(header);
+        free(probe_url);
+        critical("WebDAV - Probe PUT HTTP Response Code %ld", put_code);
+    }
+
+    /* GET, the object is only counted */
+    probe.received = 0;
+    curl_easy_setopt(curl, CURLOPT_UPLOAD, 0L);
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    get_code = mp_curl_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &get_time);
+    received = probe.received;
+
+    /* DELETE, also after a failed GET */
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+    code = mp_curl_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &delete_time);
+
+    curl_easy_cleanup(curl);
+    curl_slist_free_all(header);
+    free(probe_url);
+
+    if (get_code != 200)
+        critical("WebDAV - Probe GET HTTP Response Code %ld", get_code);
+    if (received != probe_size)
+        critical("WebDAV - Probe GET returned %zu of %zu bytes",
+                received, probe_size);
+    if (code != 200 && code != 204)
+        critical("WebDAV - Probe DELETE HTTP Response Code %ld", code);
+
+    upload = put_time > 0 ? probe_size / put_time : 0;
+    download = get_time > 0 ? probe_size / get_time : 0;
+
+    mp_perfdata_float("put_time", (float)put_time, "s", NULL);
+    mp_perfdata_float("get_time", (float)get_time, "s", NULL);
+    mp_perfdata_float("delete_time", (float)delete_time, "s", NULL);
+    mp_perfdata_float("upload", (float)upload, "B", upload_thresholds);
+    mp_perfdata_float("download", (float)download, "B", download_thresholds);
+
+    code = get_status(upload, upload_thresholds);
+    if (code != STATE_OK) {
+        speed = mp_human_size((float)upload);
+        mp_strcat_space(output, "Slow upload");
+        mp_strcat_space(output, speed);
+        free(speed);
+        state = code;
+    }
+    code = get_status(download, download_thresholds);
+    if (code != STATE_OK) {
+        speed = mp_human_size((float)download);
+        mp_strcat_space(output, "Slow download");
+        mp_strcat_space(output, speed);
+        free(speed);
+        state = code > state ? code : state;
+    }
+
+    free_threshold(upload_thresholds);
+    free_threshold(download_thresholds);
+
+    return state;
+}
+
+/* Generate the probe object, random so it does not compress. */
+static size_t webdav_probe_send(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    struct webdav_probe *probe = (struct webdav_probe *)userdata;
+    unsigned char *buf = (unsigned char *)ptr;
+    size_t len = size * nmemb;
+    size_t i;
+
+    if (len > probe->size - probe->sent)
+        len = probe->size - probe->sent;
+
+    for (i = 0; i < len; i++) {
+        probe->seed ^= probe->seed << 13;
+        probe->seed ^= probe->seed >> 17;
+        probe->seed ^= probe->seed << 5;
+        buf[i] = (unsigned char)probe->seed;
+    }
+    probe->sent += len;
+
+    return len;
+}
+
+static size_t webdav_probe_recv(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    struct webdav_probe *probe = (struct webdav_probe *)userdata;
+
+    probe->received += size * nmemb;
+
+    return size * nmemb;
+}
+
 int process_arguments (int argc, char **argv) {
     int c;
     int option = 0;
@@ -404,6 +584,13 @@ int process_arguments (int argc, char **argv) {
         {"content-type", required_argument, 0, (int)'C'},
         {"allow", required_argument, 0, (int)'a'},
         {"ls", no_argument, &do_list, 1},
+        {"max-body", required_argument, NULL, MP_LONGOPT_CURL_MAXBODY},
+        {"probe", required_argument, NULL, MP_LONGOPT_PRIV0},
+        {"warning-upload", required_argument, NULL, MP_LONGOPT_PRIV1},
+        {"critical-upload", required_argument, NULL, MP_LONGOPT_PRIV2},
+        {"warning-download", required_argument, NULL, MP_LONGOPT_PRIV3},
+        {"critical-download", required_argument, NULL, MP_LONGOPT_PRIV4},
+        MP_LONGOPTS_CURL_TIMING,
         MP_LONGOPTS_WC,
         MP_LONGOPTS_END
     };
@@ -435,6 +622,37 @@ int process_arguments (int argc, char **argv) {
             case 'a':
                 mp_array_push(&allowShould, optarg, &allowShoulds);
                 break;
+            case MP_LONGOPT_PRIV0: {
+                char *end;
+                double size = strtod(optarg, &end);
+                if (end == optarg || size <= 0)
+                    usage("Illegal --probe '%s'.", optarg);
+                probe_size = (size_t)(size * parse_multiplier_string(end));
+                break;
+            }
+            case MP_LONGOPT_PRIV1:
+                if (mp_threshold_set_warning(&upload_thresholds, optarg, BISI) == ERROR)
+                    usage("Illegal --warning-upload threshold '%s'.", optarg);
+                break;
+            case MP_LONGOPT_PRIV2:
+                if (mp_threshold_set_critical(&upload_thresholds, optarg, BISI) == ERROR)
+                    usage("Illegal --critical-upload threshold '%s'.", optarg);
+                break;
+            case MP_LONGOPT_PRIV3:
+                if (mp_threshold_set_warning(&download_thresholds, optarg, BISI) == ERROR)
+                    usage("Illegal --warning-download threshold '%s'.", optarg);
+                break;
+            case MP_LONGOPT_PRIV4:
+                if (mp_threshold_set_critical(&download_thresholds, optarg, BISI) == ERROR)
+                    usage("Illegal --critical-download threshold '%s'.", optarg);
+                break;
+            case MP_LONGOPT_CURL_MAXBODY:
+            case MP_LONGOPT_CURL_WARN_TTFB:
+            case MP_LONGOPT_CURL_CRIT_TTFB:
+            case MP_LONGOPT_CURL_WARN_TOTAL:
+            case MP_LONGOPT_CURL_CRIT_TOTAL:
+                getopt_curl(c);
+                break;
         }
     }
 
@@ -472,6 +690,19 @@ void print_help (void) {
     printf("      Method or methods which should be allowed.\n");
     printf("     --ls\n");
     printf("      List the directory and check the response.\n");
+    printf("     --probe=SIZE\n");
+    printf("      PUT, GET and DELETE a object of SIZE bytes in the url collection\n");
+    printf("      and report the throughput.\n");
+    printf("     --warning-upload=LIMIT\n");
+    printf("      Return warning if upload throughput in bytes/s is outside limit, like '1M:'.\n");
+    printf("     --critical-upload=LIMIT\n");
+    printf("      Return critical if upload throughput in bytes/s is outside limit.\n");
+    printf("     --warning-download=LIMIT\n");
+    printf("      Return warning if download throughput in bytes/s is outside limit.\n");
+    printf("     --critical-download=LIMIT\n");
+    printf("      Return critical if download throughput in bytes/s is outside limit.\n");
+    print_help_curl_maxbody();
+    print_help_curl_timing();
     print_help_warn_time("5 sec");
     print_help_crit_time("9 sec");
 }
@@ -32,6 +32,7 @@ const char *progusage = "[-t <timeout>]";
 
 /* MP Includes */
 #include "mp_common.h"
+#include "mp_state.h"
 #include "fcgi_utils.h"
 /* Default Includes */
 #include <string.h>
@@ -51,13 +52,29 @@ const char *progusage = "[-t <timeout>]";
 char *fcgisocket = NULL;
 char *query = "/status";
 
+/* Values of the status the check uses. */
+enum {
+    PHPFPM_POOL,
+    PHPFPM_ACCEPTED_CONN,
+    PHPFPM_LISTEN_QUEUE,
+    PHPFPM_IDLE_PROCESSES,
+    PHPFPM_ACTIVE_PROCESSES,
+    PHPFPM_PATHS
+};
+static struct mp_json_path paths[PHPFPM_PATHS] = {
+    { "pool", json_type_null, NULL },
+    { "accepted conn", json_type_null, NULL },
+    { "listen queue", json_type_null, NULL },
+    { "idle processes", json_type_null, NULL },
+    { "active processes", json_type_null, NULL },
+};
+
 int main (int argc, char **argv) {
     int fcgiSock = -1;
     FCGX_Stream *paramsStream;
     char *pool = NULL;
     char *content, *data;
     int type, count;
-    struct json_object  *obj, *slaveobj;
 
     /* Set signal handling and alarm */
     if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
@@ -110,31 +127,33 @@ int main (int argc, char **argv) {
         (void)strsep(&data, "\n");
     } while (data && data[0] != '\r');
 
-    /* Parse JSON */
-    obj = mp_json_tokener_parse(data);
+    /* Scan JSON */
+    mp_json_scan_string(data, paths, PHPFPM_PATHS);
 
     /* Read pool name */
-    mp_json_object_object_get(obj, "pool", &slaveobj);
-    pool = mp_strdup(json_object_get_string(slaveobj));
+    pool = mp_strdup(paths[PHPFPM_POOL].value ? paths[PHPFPM_POOL].value : "");
 
     /* Read accepted connections */
-    mp_json_object_object_get(obj, "accepted conn", &slaveobj);
-    mp_perfdata_int("accepted_conn", json_object_get_int(slaveobj), "c", NULL);
+    mp_perfdata_int("accepted_conn",
+            (long int)mp_json_path_int(&paths[PHPFPM_ACCEPTED_CONN], 0), "c", NULL);
+    mp_perfdata_rate("accepted_conn_rate", fcgisocket,
+            (uint64_t)mp_json_path_int(&paths[PHPFPM_ACCEPTED_CONN], 0),
+            MP_COUNTER64, "");
 
     /* Read listen queue */
-    mp_json_object_object_get(obj, "listen queue", &slaveobj);
-    mp_perfdata_int("listen_queue", json_object_get_int(slaveobj), "", NULL);
+    mp_perfdata_int("listen_queue",
+            (long int)mp_json_path_int(&paths[PHPFPM_LISTEN_QUEUE], 0), "", NULL);
 
     /* Read idle processes */
-    mp_json_object_object_get(obj, "idle processes", &slaveobj);
-    mp_perfdata_int("idle_processes", json_object_get_int(slaveobj), "", NULL);
+    mp_perfdata_int("idle_processes",
+            (long int)mp_json_path_int(&paths[PHPFPM_IDLE_PROCESSES], 0), "", NULL);
 
     /* Read active processes */
-    mp_json_object_object_get(obj, "active processes", &slaveobj);
-    mp_perfdata_int("active_processes", json_object_get_int(slaveobj), "", NULL);
+    mp_perfdata_int("active_processes",
+            (long int)mp_json_path_int(&paths[PHPFPM_ACTIVE_PROCESSES], 0), "", NULL);
 
     free(content);
-    json_object_put(obj);
+    mp_json_paths_free(paths, PHPFPM_PATHS);
 
     ok("PHP-FPM: %s", pool);
 }
@@ -0,0 +1,162 @@
+/***
+ * Monitoring Plugin - apache_utils.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "apache_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+const char *apache_keys[APACHE_KEYS] = {
+    "ServerVersion", "ServerMPM", "Uptime", "Total Accesses",
+    "Total kBytes", "Total Duration", "CPULoad", "ReqPerSec",
+    "BytesPerSec", "BytesPerReq", "DurationPerReq", "BusyWorkers",
+    "IdleWorkers", "GracefulWorkers", "Processes", "Stopping",
+    "ConnsTotal", "ConnsAsyncWriting", "ConnsAsyncKeepAlive",
+    "ConnsAsyncClosing", "Load1", "Load5", "Load15", "Scoreboard",
+};
+
+const struct apache_scoreboard_s apache_scoreboard[APACHE_SCOREBOARD_STATES] = {
+    { '.', "open" },
+    { 'S', "start" },
+    { 'R', "read" },
+    { 'W', "write" },
+    { 'K', "keep" },
+    { 'D', "dns" },
+    { 'C', "close" },
+    { 'L', "log" },
+    { 'G', "grace" },
+    { 'I', "idle" },
+    { '_', "wait" },
+};
+
+/*
+ * Key lookup table, FNV-1a of the key modulo its size. This size is the
+ * smallest one without collisions for the keys above, so a lookup is one
+ * hash and one compare. Further keys just probe the next slots.
+ */
+#define APACHE_KEY_SLOTS    145
+static signed char apache_key_slots[APACHE_KEY_SLOTS];
+
+static uint32_t apache_key_hash(const char *key, size_t len) {
+    uint32_t hash = 2166136261U;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619U;
+    }
+    return hash % APACHE_KEY_SLOTS;
+}
+
+void apache_keys_init(void) {
+    uint32_t slot;
+    int k;
+
+    memset(apache_key_slots, -1, sizeof(apache_key_slots));
+    for (k = 0; k < APACHE_KEYS; k++) {
+        slot = apache_key_hash(apache_keys[k], strlen(apache_keys[k]));
+        while (apache_key_slots[slot] >= 0)
+            slot = (slot + 1) % APACHE_KEY_SLOTS;
+        apache_key_slots[slot] = k;
+    }
+}
+
+int apache_key(const char *key, size_t len) {
+    uint32_t slot;
+    int k;
+
+    for (slot = apache_key_hash(key, len); apache_key_slots[slot] >= 0;
+            slot = (slot + 1) % APACHE_KEY_SLOTS) {
+        k = apache_key_slots[slot];
+        if (strncmp(apache_keys[k], key, len) == 0 && apache_keys[k][len] == '\0')
+            return k;
+    }
+    return -1;
+}
+
+void apache_auto_line(struct apache_auto_s *status, const char *line, size_t len) {
+    const char *val;
+    int key;
+
+    val = strstr(line, ": ");
+    if (val == NULL)
+        return;
+
+    if (mp_verbose > 1) {
+        printf("%.*s => %s\n", (int)(val - line), line, val + 2);
+    }
+
+    key = apache_key(line, val - line);
+    val += 2;
+
+    if (key == APACHE_SCOREBOARD) {
+        apache_auto_scoreboard(status, val, len - (val - line));
+    } else if (key >= 0) {
+        free(status->value[key]);
+        status->value[key] = mp_strdup(val);
+    }
+}
+
+/*
+ * Event MPM scoreboards have thousands of slots, a byte histogram
+ * counts them without branches.
+ */
+void apache_auto_scoreboard(struct apache_auto_s *status,
+        const char *scoreboard, size_t len) {
+    const unsigned char *sb = (const unsigned char *)scoreboard;
+    uint32_t count[4][256];
+    unsigned char c;
+    size_t i;
+
+    memset(count, 0, sizeof(count));
+
+    /* Four histograms, so the increments do not wait on each other */
+    for (i = 0; i + 4 <= len; i += 4) {
+        count[0][sb[i]]++;
+        count[1][sb[i + 1]]++;
+        count[2][sb[i + 2]]++;
+        count[3][sb[i + 3]]++;
+    }
+    for (; i < len; i++)
+        count[0][sb[i]]++;
+
+    status->scoreboard = 1;
+    for (i = 0; i < APACHE_SCOREBOARD_STATES; i++) {
+        c = apache_scoreboard[i].key;
+        status->slots[i] = count[0][c] + count[1][c] + count[2][c] + count[3][c];
+    }
+}
+
+void apache_auto_free(struct apache_auto_s *status) {
+    int k;
+
+    for (k = 0; k < APACHE_KEYS; k++) {
+        free(status->value[k]);
+        status->value[k] = NULL;
+    }
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,117 @@
+/***
+ * Monitoring Plugin - apache_utils.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _APACHE_UTILS_H_
+#define _APACHE_UTILS_H_
+
+#include <stddef.h>
+
+/** Keys of the mod_status ?auto output. */
+enum {
+    APACHE_SERVER_VERSION,
+    APACHE_SERVER_MPM,
+    APACHE_UPTIME,
+    APACHE_TOTAL_ACCESSES,
+    APACHE_TOTAL_KBYTES,
+    APACHE_TOTAL_DURATION,
+    APACHE_CPU_LOAD,
+    APACHE_REQ_PER_SEC,
+    APACHE_BYTES_PER_SEC,
+    APACHE_BYTES_PER_REQ,
+    APACHE_DURATION_PER_REQ,
+    APACHE_BUSY_WORKERS,
+    APACHE_IDLE_WORKERS,
+    APACHE_GRACEFUL_WORKERS,
+    APACHE_PROCESSES,
+    APACHE_STOPPING,
+    APACHE_CONNS_TOTAL,
+    APACHE_CONNS_ASYNC_WRITING,
+    APACHE_CONNS_ASYNC_KEEPALIVE,
+    APACHE_CONNS_ASYNC_CLOSING,
+    APACHE_LOAD1,
+    APACHE_LOAD5,
+    APACHE_LOAD15,
+    APACHE_SCOREBOARD,
+    APACHE_KEYS
+};
+
+/** Number of scoreboard slot states. */
+#define APACHE_SCOREBOARD_STATES    11
+
+/** Scoreboard slot state struct */
+struct apache_scoreboard_s {
+    unsigned char   key;        /**< Scoreboard character. */
+    const char      *label;     /**< Perfdata label. */
+};
+
+/** Key names by key index. */
+extern const char *apache_keys[APACHE_KEYS];
+/** Scoreboard slot states in perfdata order. */
+extern const struct apache_scoreboard_s apache_scoreboard[APACHE_SCOREBOARD_STATES];
+
+/** Parsed mod_status ?auto answer struct */
+struct apache_auto_s {
+    char *value[APACHE_KEYS];   /**< Values by key, NULL if missing. */
+    int scoreboard;             /**< Scoreboard seen. */
+    long slots[APACHE_SCOREBOARD_STATES]; /**< Slots per scoreboard state. */
+};
+
+/**
+ * Build the key lookup table, call once before parsing.
+ */
+void apache_keys_init(void);
+
+/**
+ * Return the index of a ?auto key.
+ * \param[in] key Key name, not terminated.
+ * \param[in] len Length of the key name.
+ * \return Key index or -1 for unknown keys.
+ */
+int apache_key(const char *key, size_t len);
+
+/**
+ * Parse one 'Key: Value' line of a ?auto answer.
+ * \param[in|out] status Parsed answer to update.
+ * \param[in] line Terminated answer line.
+ * \param[in] len Length of the line.
+ */
+void apache_auto_line(struct apache_auto_s *status, const char *line, size_t len);
+
+/**
+ * Count the scoreboard slots per state.
+ * \param[in|out] status Parsed answer to update.
+ * \param[in] scoreboard Scoreboard value.
+ * \param[in] len Length of the scoreboard.
+ */
+void apache_auto_scoreboard(struct apache_auto_s *status,
+        const char *scoreboard, size_t len);
+
+/**
+ * Free the values of a parsed answer.
+ * \param[in|out] status Parsed answer to free.
+ */
+void apache_auto_free(struct apache_auto_s *status);
+
+#endif /* _APACHE_UTILS_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
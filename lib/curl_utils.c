@@ -22,9 +22,17 @@
  */
 
 #include "mp_common.h"
+#include "mp_repeat.h"
+#include "mp_state.h"
 #include "curl_utils.h"
 
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <curl/curl.h>
 
 char *mp_curl_user = NULL;
@@ -32,16 +40,58 @@ char *mp_curl_pass = NULL;
 char *mp_curl_subpath = "";
 int mp_curl_ssl = 0;
 int mp_curl_insecure = 0;
+size_t mp_curl_maxbody = MP_CURL_MAXBODY;
+char **mp_curl_hosts = NULL;
+int mp_curl_hosts_num = 0;
+int mp_curl_parallel = MP_CURL_PARALLEL;
+const char *mp_curl_cache_dir = MP_CURL_CACHE_DIR;
+thresholds *mp_curl_ttfb_thresholds = NULL;
+thresholds *mp_curl_total_thresholds = NULL;
+
+/* Timing of the requests since the last mp_curl_perfdata. */
+static struct {
+    int requests;
+    int connects;
+    int reused;
+    long redirects;
+    double dns;
+    double connect;
+    double tls;
+    double pretransfer;
+    double ttfb;
+    double total;
+    double sum;
+    double size;
+} mp_curl_timing;
+
+/* Shared DNS, TLS session and connection cache of all handles. */
+static CURLSH *mp_curl_share = NULL;
+/* Multi handle, queued and running transfers. */
+static CURLM *mp_curl_multi = NULL;
+static mp_curl_transfer *mp_curl_queue = NULL;
+static mp_curl_transfer **mp_curl_queue_tail = &mp_curl_queue;
+static int mp_curl_running = 0;
 
 CURL *mp_curl_init(void) {
     CURL        *curl;
     CURLcode    ret;
     char        *buf;
 
-    /* Global init */
-    ret = curl_global_init(CURL_GLOBAL_ALL);
-    if (ret != CURLE_OK)
-        critical("libcurl initialisation failed!");
+    /* Global init, once */
+    if (mp_curl_share == NULL) {
+        ret = curl_global_init(CURL_GLOBAL_ALL);
+        if (ret != CURLE_OK)
+            critical("libcurl initialisation failed!");
+
+        mp_curl_share = curl_share_init();
+        if (!mp_curl_share)
+            critical("libcurl share initialisation failed!");
+        curl_share_setopt(mp_curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(mp_curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+        curl_share_setopt(mp_curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    }
 
     /* Handler init */
     curl = curl_easy_init();
@@ -56,6 +106,21 @@ CURL *mp_curl_init(void) {
         critical("libcurt setting User-Agent failed");
     free(buf);
 
+    /* Share caches */
+    curl_easy_setopt(curl, CURLOPT_SHARE, mp_curl_share);
+
+    /* Accept every compression libcurl was built with */
+#if LIBCURL_VERSION_NUM >= 0x071506
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+#else
+    curl_easy_setopt(curl, CURLOPT_ENCODING, "");
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x072f00
+    /* Prefer HTTP/2 over TLS to multiplex concurrent requests */
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+#endif
+
     /* Debug setup */
     if (mp_verbose > 2) {
         ret = curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
@@ -89,19 +154,389 @@ char *mp_curl_url(const char *scheme, const char *hostname, int port, const char
     return url;
 }
 
+void mp_curl_cache_init(struct mp_curl_cache *cache, CURL *curl,
+        const char *url) {
+    const char  *dir;
+    const char  *p;
+    uint64_t    hash = 0xcbf29ce484222325ULL;
+    FILE        *fp;
+    char        *line = NULL;
+    size_t      len = 0;
+    ssize_t     read;
+    char        buf[4096];
+    size_t      size;
+    struct mp_curl_data summary;
+
+    memset(cache, 0, sizeof(struct mp_curl_cache));
+    cache->recv[0].key = "ETag";
+    cache->recv[0].value = &(cache->recv_etag);
+    cache->recv[1].key = "Last-Modified";
+    cache->recv[1].value = &(cache->recv_modified);
+
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, mp_curl_recv_header);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)cache->recv);
+
+    /* Environment overrides the default, not a set directory. */
+    dir = getenv("MP_CURL_CACHE_DIR");
+    if (dir && *dir && strcmp(mp_curl_cache_dir, MP_CURL_CACHE_DIR) == 0)
+        mp_curl_cache_dir = dir;
+
+    /* FNV-1a of user and URL, answers may differ per user. */
+    if (mp_curl_user)
+        for (p = mp_curl_user; *p; p++)
+            hash = (hash ^ (unsigned char)*p) * 0x100000001b3ULL;
+    hash = (hash ^ '@') * 0x100000001b3ULL;
+    for (p = url; *p; p++)
+        hash = (hash ^ (unsigned char)*p) * 0x100000001b3ULL;
+    mp_asprintf(&(cache->file), "%s/%016llx", mp_curl_cache_dir,
+            (unsigned long long)hash);
+
+    fp = fopen(cache->file, "r");
+    if (fp == NULL)
+        return;
+
+    /* Validator lines, a blank line, the summary. */
+    while ((read = getline(&line, &len, fp)) > 0) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (*line == '\0')
+            break;
+        if (strncmp(line, "ETag: ", 6) == 0)
+            cache->etag = mp_strdup(line+6);
+        else if (strncmp(line, "Last-Modified: ", 15) == 0)
+            cache->modified = mp_strdup(line+15);
+    }
+    free(line);
+
+    memset(&summary, 0, sizeof(struct mp_curl_data));
+    summary.max = SIZE_MAX;
+    while ((size = fread(buf, 1, sizeof(buf), fp)) > 0)
+        mp_curl_recv_data(buf, 1, size, &summary);
+    fclose(fp);
+
+    if (read <= 0 || summary.size == 0 || (!cache->etag && !cache->modified)) {
+        free(summary.data);
+        return;
+    }
+    cache->summary = summary.data;
+
+    if (mp_verbose > 1)
+        printf("Cached: %s\n", cache->file);
+
+    if (cache->etag) {
+        mp_asprintf(&line, "If-None-Match: %s", cache->etag);
+        cache->headers = curl_slist_append(cache->headers, line);
+        free(line);
+    }
+    if (cache->modified) {
+        mp_asprintf(&line, "If-Modified-Since: %s", cache->modified);
+        cache->headers = curl_slist_append(cache->headers, line);
+        free(line);
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, cache->headers);
+}
+
+int mp_curl_cache_hit(struct mp_curl_cache *cache, long code) {
+    return code == 304 && cache->summary != NULL;
+}
+
+void mp_curl_cache_store(struct mp_curl_cache *cache, const char *summary) {
+    char    *tmp;
+    FILE    *fp;
+
+    if (cache->file == NULL)
+        return;
+
+    if (!cache->recv_etag && !cache->recv_modified) {
+        if (cache->summary)
+            unlink(cache->file);
+        return;
+    }
+
+    /* Write a temporary file and rename it for concurrent checks. */
+    mp_asprintf(&tmp, "%s.%d", cache->file, (int)getpid());
+    fp = fopen(tmp, "w");
+    if (fp == NULL && errno == ENOENT) {
+        mkdir(mp_curl_cache_dir, 0775);
+        fp = fopen(tmp, "w");
+    }
+    if (fp == NULL) {
+        if (mp_verbose > 0)
+            printf("Can't write cache %s: %s\n", tmp, strerror(errno));
+        free(tmp);
+        return;
+    }
+
+    if (cache->recv_etag)
+        fprintf(fp, "ETag: %s\n", cache->recv_etag);
+    if (cache->recv_modified)
+        fprintf(fp, "Last-Modified: %s\n", cache->recv_modified);
+    fprintf(fp, "\n%s", summary);
+
+    if (fclose(fp) != 0 || rename(tmp, cache->file) != 0)
+        unlink(tmp);
+    free(tmp);
+}
+
+void mp_curl_cache_free(struct mp_curl_cache *cache) {
+    curl_slist_free_all(cache->headers);
+    free(cache->file);
+    free(cache->etag);
+    free(cache->modified);
+    free(cache->summary);
+    free(cache->recv_etag);
+    free(cache->recv_modified);
+    memset(cache, 0, sizeof(struct mp_curl_cache));
+}
+
+#if LIBCURL_VERSION_NUM >= 0x073d00
+/* The double variants are deprecated, *_T times are in microseconds. */
+#define MP_CURL_TIME(curl, info, var) do { \
+        curl_off_t value = 0; \
+        curl_easy_getinfo(curl, info##_T, &value); \
+        var = (double)value / 1000000; \
+    } while (0)
+#define MP_CURL_SIZE(curl, info, var) do { \
+        curl_off_t value = 0; \
+        curl_easy_getinfo(curl, info##_T, &value); \
+        var = (double)value; \
+    } while (0)
+#else
+#define MP_CURL_TIME(curl, info, var) do { \
+        double value = 0; \
+        curl_easy_getinfo(curl, info, &value); \
+        var = value; \
+    } while (0)
+#define MP_CURL_SIZE MP_CURL_TIME
+#endif
+
+/* Keep the slowest request per phase. */
+#define MP_CURL_TIME_MAX(curl, info, var) do { \
+        double max; \
+        MP_CURL_TIME(curl, info, max); \
+        if (max > var) \
+            var = max; \
+    } while (0)
+
+/* Add the timing of a finished request. */
+static void mp_curl_timing_add(CURL *curl) {
+    double total;
+    double size;
+    long value;
+
+    mp_curl_timing.requests++;
+
+    MP_CURL_TIME_MAX(curl, CURLINFO_NAMELOOKUP_TIME, mp_curl_timing.dns);
+    MP_CURL_TIME_MAX(curl, CURLINFO_CONNECT_TIME, mp_curl_timing.connect);
+    MP_CURL_TIME_MAX(curl, CURLINFO_APPCONNECT_TIME, mp_curl_timing.tls);
+    MP_CURL_TIME_MAX(curl, CURLINFO_PRETRANSFER_TIME, mp_curl_timing.pretransfer);
+    MP_CURL_TIME_MAX(curl, CURLINFO_STARTTRANSFER_TIME, mp_curl_timing.ttfb);
+
+    MP_CURL_TIME(curl, CURLINFO_TOTAL_TIME, total);
+    if (total > mp_curl_timing.total)
+        mp_curl_timing.total = total;
+    mp_curl_timing.sum += total;
+
+    MP_CURL_SIZE(curl, CURLINFO_SIZE_DOWNLOAD, size);
+    mp_curl_timing.size += size;
+
+    value = 0;
+    curl_easy_getinfo(curl, CURLINFO_REDIRECT_COUNT, &value);
+    mp_curl_timing.redirects += value;
+
+    /* No new connection means a kept-alive one was reused */
+    value = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &value);
+    mp_curl_timing.connects += value;
+    if (value == 0)
+        mp_curl_timing.reused++;
+}
+
 long mp_curl_perform(CURL *curl) {
     CURLcode    ret;
     long        code;
 
     ret = curl_easy_perform(curl);
-    if(ret != CURLE_OK)
+    /* A receive callback aborted, its stream reports why. */
+    if(ret != CURLE_OK && ret != CURLE_WRITE_ERROR)
         critical(curl_easy_strerror(ret));
 
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    mp_curl_timing_add(curl);
 
     return code;
 }
 
+void mp_curl_perfdata(void) {
+    double speed = 0;
+
+    if (mp_curl_timing.requests == 0)
+        return;
+
+    if (mp_curl_timing.sum > 0)
+        speed = mp_curl_timing.size / mp_curl_timing.sum;
+
+    mp_perfdata_float("http_dns", (float)mp_curl_timing.dns, "s", NULL);
+    mp_perfdata_float("http_connect", (float)mp_curl_timing.connect, "s", NULL);
+    mp_perfdata_float("http_tls", (float)mp_curl_timing.tls, "s", NULL);
+    mp_perfdata_float("http_pretransfer", (float)mp_curl_timing.pretransfer, "s", NULL);
+    mp_perfdata_float("http_ttfb", (float)mp_curl_timing.ttfb, "s",
+            mp_curl_ttfb_thresholds);
+    mp_perfdata_float("http_total", (float)mp_curl_timing.total, "s",
+            mp_curl_total_thresholds);
+    mp_perfdata_float("http_sum", (float)mp_curl_timing.sum, "s", NULL);
+    mp_perfdata_int("http_size", (long int)mp_curl_timing.size, "B", NULL);
+    mp_perfdata_int("http_speed", (long int)speed, "", NULL);
+    mp_perfdata_int("http_redirects", mp_curl_timing.redirects, "", NULL);
+    mp_perfdata_int("http_connects", (long int)mp_curl_timing.connects, "", NULL);
+    mp_perfdata_int("http_reused", (long int)mp_curl_timing.reused, "", NULL);
+
+    switch (get_status(mp_curl_timing.ttfb, mp_curl_ttfb_thresholds)) {
+        case STATE_WARNING:
+            set_warning("TTFB %.3fs", mp_curl_timing.ttfb);
+            break;
+        case STATE_CRITICAL:
+            set_critical("TTFB %.3fs", mp_curl_timing.ttfb);
+            break;
+    }
+    switch (get_status(mp_curl_timing.total, mp_curl_total_thresholds)) {
+        case STATE_WARNING:
+            set_warning("Total time %.3fs", mp_curl_timing.total);
+            break;
+        case STATE_CRITICAL:
+            set_critical("Total time %.3fs", mp_curl_timing.total);
+            break;
+    }
+
+    memset(&mp_curl_timing, 0, sizeof(mp_curl_timing));
+}
+
+mp_curl_transfer *mp_curl_multi_add(CURL *curl, const char *host, void *data) {
+    mp_curl_transfer *transfer;
+
+    if (mp_curl_multi == NULL) {
+        mp_curl_multi = curl_multi_init();
+        if (!mp_curl_multi)
+            critical("libcurl multi initialisation failed!");
+#if LIBCURL_VERSION_NUM >= 0x072b00
+        curl_multi_setopt(mp_curl_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+    }
+
+    transfer = mp_calloc(1, sizeof(mp_curl_transfer));
+    transfer->host = host ? mp_strdup(host) : NULL;
+    transfer->curl = curl;
+    transfer->data = data;
+
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, (void *)transfer);
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    /* Wait for a connection to multiplex on instead of opening more. */
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+#endif
+
+    *mp_curl_queue_tail = transfer;
+    mp_curl_queue_tail = &(transfer->next);
+
+    return transfer;
+}
+
+/* Start queued transfers up to the parallel limit. */
+static void mp_curl_multi_fill(void) {
+    mp_curl_transfer *transfer;
+
+    while (mp_curl_queue && mp_curl_running < mp_curl_parallel) {
+        transfer = mp_curl_queue;
+        mp_curl_queue = transfer->next;
+        if (mp_curl_queue == NULL)
+            mp_curl_queue_tail = &mp_curl_queue;
+        transfer->next = NULL;
+
+        curl_multi_add_handle(mp_curl_multi, transfer->curl);
+        mp_curl_running++;
+    }
+}
+
+int mp_curl_multi_run(void) {
+    mp_curl_transfer *transfer;
+    CURLMsg     *msg;
+    int         still;
+    int         left;
+    int         numfds;
+
+    if (mp_curl_multi == NULL)
+        return OK;
+
+    mp_curl_multi_fill();
+
+    while (mp_curl_running) {
+        if (curl_multi_perform(mp_curl_multi, &still) != CURLM_OK)
+            return ERROR;
+
+        while ((msg = curl_multi_info_read(mp_curl_multi, &left))) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&transfer);
+            transfer->result = msg->data.result;
+            curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &(transfer->code));
+
+            curl_multi_remove_handle(mp_curl_multi, transfer->curl);
+            mp_curl_running--;
+        }
+
+        mp_curl_multi_fill();
+
+        if (mp_curl_running == 0)
+            break;
+        if (curl_multi_wait(mp_curl_multi, NULL, 0, 1000, &numfds) != CURLM_OK)
+            return ERROR;
+    }
+
+    return OK;
+}
+
+long mp_curl_transfer_code(mp_curl_transfer *transfer) {
+    if (transfer->result != CURLE_OK && transfer->result != CURLE_WRITE_ERROR)
+        critical(curl_easy_strerror(transfer->result));
+
+    mp_curl_timing_add(transfer->curl);
+
+    return transfer->code;
+}
+
+/** Transfers and evaluate function of \ref mp_curl_multi_exit. */
+struct mp_curl_multi_eval {
+    mp_curl_transfer **transfers;
+    mp_curl_eval_func eval;
+};
+
+static void mp_curl_multi_host(void *data, int i) {
+    struct mp_curl_multi_eval *multi = data;
+
+    /* Timing perfdata per host */
+    memset(&mp_curl_timing, 0, sizeof(mp_curl_timing));
+    mp_curl_transfer_code(multi->transfers[i]);
+    multi->eval(multi->transfers[i]);
+}
+
+void mp_curl_multi_exit(mp_curl_transfer **transfers, int num,
+        mp_curl_eval_func eval) {
+    struct mp_curl_multi_eval multi = { transfers, eval };
+    const char **hosts;
+    int i;
+
+    hosts = mp_malloc(num * sizeof(char *));
+    for (i = 0; i < num; i++)
+        hosts[i] = transfers[i]->host;
+
+    mp_multi_exit(hosts, num, mp_curl_multi_host, &multi);
+}
+
+void mp_curl_transfer_free(mp_curl_transfer *transfer) {
+    curl_easy_cleanup(transfer->curl);
+    free(transfer->host);
+    free(transfer);
+}
+
 size_t mp_curl_recv_blackhole(void *contents, size_t size, size_t nmemb, void *userdata) {
     return size*nmemb;
 }
@@ -109,9 +544,26 @@ size_t mp_curl_recv_blackhole(void *contents, size_t size, size_t nmemb, void *u
 size_t mp_curl_recv_data(void *contents, size_t size, size_t nmemb, void *userdata) {
     size_t data_size = size * nmemb;
 
+    size_t max;
+    size_t alloc;
+
     struct mp_curl_data *data = (struct mp_curl_data *)userdata;
 
-    data->data = mp_realloc(data->data, data->size + data_size + 1);
+    /* Abort the transfer, a critical would leave libcurl mid-transfer. */
+    max = data->max ? data->max : mp_curl_maxbody;
+    if (data->overflow || (max && data->size + data_size > max)) {
+        data->overflow = 1;
+        return 0;
+    }
+
+    /* Grow geometrically to keep the copying linear. */
+    if (data->size + data_size + 1 > data->alloc) {
+        alloc = data->alloc ? data->alloc : MP_CURL_CHUNK;
+        while (alloc < data->size + data_size + 1)
+            alloc *= 2;
+        data->data = mp_realloc(data->data, alloc);
+        data->alloc = alloc;
+    }
 
     memcpy(&(data->data[data->size]), contents, data_size);
 
@@ -121,6 +573,52 @@ size_t mp_curl_recv_data(void *contents, size_t size, size_t nmemb, void *userda
     return data_size;
 }
 
+size_t mp_curl_recv_lines(void *contents, size_t size, size_t nmemb, void *userdata) {
+    size_t data_size = size * nmemb;
+    char *ptr = (char *)contents;
+    char *end = ptr + data_size;
+    char *eol;
+
+    struct mp_curl_lines *lines = (struct mp_curl_lines *)userdata;
+
+    while (ptr < end) {
+        eol = memchr(ptr, '\n', end - ptr);
+        if (eol == NULL) {
+            mp_curl_recv_data(ptr, 1, end - ptr, &(lines->buf));
+            break;
+        }
+
+        if (eol > ptr || lines->buf.data == NULL)
+            mp_curl_recv_data(ptr, 1, eol - ptr, &(lines->buf));
+        if (lines->buf.overflow)
+            return 0;
+        if (lines->buf.size && lines->buf.data[lines->buf.size-1] == '\r')
+            lines->buf.data[--lines->buf.size] = '\0';
+
+        lines->line(lines->buf.data, lines->buf.size, lines->userdata);
+        lines->buf.size = 0;
+        lines->buf.data[0] = '\0';
+
+        ptr = eol + 1;
+    }
+
+    return lines->buf.overflow ? 0 : data_size;
+}
+
+void mp_curl_lines_finish(struct mp_curl_lines *lines) {
+    size_t max = lines->buf.max ? lines->buf.max : mp_curl_maxbody;
+    int overflow = lines->buf.overflow;
+
+    if (lines->buf.size && !overflow)
+        lines->line(lines->buf.data, lines->buf.size, lines->userdata);
+
+    free(lines->buf.data);
+    memset(&(lines->buf), 0, sizeof(struct mp_curl_data));
+
+    if (overflow)
+        critical("HTTP answer line larger than %zu bytes.", max);
+}
+
 size_t mp_curl_recv_header(void *contents, size_t size, size_t nmemb, void *userdata) {
     size_t data_size = size * nmemb;
     size_t key_size;
@@ -128,11 +626,20 @@ size_t mp_curl_recv_header(void *contents, size_t size, size_t nmemb, void *user
 
     struct mp_curl_header *header = (struct mp_curl_header *)userdata;
 
+    /* A new status line starts the headers of a followed response. */
+    if (data_size >= 5 && strncmp(contents, "HTTP/", 5) == 0) {
+        for (; header->key; header++) {
+            free(*(header->value));
+            *(header->value) = NULL;
+        }
+        return data_size;
+    }
+
     for (; header->key; header++) {
         key_size = strlen(header->key);
         if (*(header->value) != NULL)
             continue;
-        if (strncmp(header->key, contents, key_size) != 0)
+        if (strncasecmp(header->key, contents, key_size) != 0)
             continue;
         if (((char *)contents)[key_size] != ':')
             continue;
@@ -161,6 +668,9 @@ size_t mp_curl_send_data(void *ptr, size_t size, size_t nmemb, void *userdata) {
 }
 
 void getopt_curl(int c) {
+    char *end;
+    double size;
+
     switch ( c ) {
         case 'u':
             mp_curl_user = optarg;
@@ -171,6 +681,36 @@ void getopt_curl(int c) {
         case MP_LONGOPT_CURL_SUBPATH:
             mp_curl_subpath = optarg;
             break;
+        case MP_LONGOPT_HOSTS:
+            mp_array_push(&mp_curl_hosts, mp_strdup(optarg), &mp_curl_hosts_num);
+            break;
+        case MP_LONGOPT_CURL_PARALLEL:
+            mp_curl_parallel = (int)strtol(optarg, NULL, 10);
+            if (mp_curl_parallel < 1)
+                usage("Illegal --parallel '%s'.", optarg);
+            break;
+        case MP_LONGOPT_CURL_WARN_TTFB:
+            if (mp_threshold_set_warning_time(&mp_curl_ttfb_thresholds, optarg) == ERROR)
+                usage("Illegal --warning-ttfb threshold '%s'.", optarg);
+            break;
+        case MP_LONGOPT_CURL_CRIT_TTFB:
+            if (mp_threshold_set_critical_time(&mp_curl_ttfb_thresholds, optarg) == ERROR)
+                usage("Illegal --critical-ttfb threshold '%s'.", optarg);
+            break;
+        case MP_LONGOPT_CURL_WARN_TOTAL:
+            if (mp_threshold_set_warning_time(&mp_curl_total_thresholds, optarg) == ERROR)
+                usage("Illegal --warning-total threshold '%s'.", optarg);
+            break;
+        case MP_LONGOPT_CURL_CRIT_TOTAL:
+            if (mp_threshold_set_critical_time(&mp_curl_total_thresholds, optarg) == ERROR)
+                usage("Illegal --critical-total threshold '%s'.", optarg);
+            break;
+        case MP_LONGOPT_CURL_MAXBODY:
+            size = strtod(optarg, &end);
+            if (end == optarg || size < 0)
+                usage("Illegal --max-body '%s'.", optarg);
+            mp_curl_maxbody = (size_t)(size * parse_multiplier_string(end));
+            break;
     }
 }
 
@@ -179,6 +719,29 @@ void print_help_curl_subpath(void) {
     printf("      Prepand subpath to url.\n");
 }
 
+void print_help_curl_maxbody(void) {
+    printf("     --max-body=SIZE\n");
+    printf("      Max size of the HTTP answer. (Default: 16M, 0 for unlimited)\n");
+}
+
+void print_help_curl_hosts(void) {
+    printf("     --hosts=ADDRESS[,ADDRESS...]\n");
+    printf("      Check all hosts concurrently and print one line per host.\n");
+    printf("     --parallel=NUM\n");
+    printf("      Max concurrent requests. (Default: %d)\n", MP_CURL_PARALLEL);
+}
+
+void print_help_curl_timing(void) {
+    printf("     --warning-ttfb=TIME\n");
+    printf("      Return warning if time to first byte of a request exceeds limit.\n");
+    printf("     --critical-ttfb=TIME\n");
+    printf("      Return critical if time to first byte of a request exceeds limit.\n");
+    printf("     --warning-total=TIME\n");
+    printf("      Return warning if total time of a request exceeds limit.\n");
+    printf("     --critical-total=TIME\n");
+    printf("      Return critical if total time of a request exceeds limit.\n");
+}
+
 void print_help_curl_basic_auth(void) {
     printf(" -u, --user=USER\n");
     printf("      HTTP Basic Auth user.\n");
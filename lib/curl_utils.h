@@ -25,6 +25,7 @@
 #define _CURL_UTILS_H_
 
 #include "config.h"
+#include "mp_args.h"
 #include <curl/curl.h>
 
 /* The global mysql vars. */
@@ -38,6 +39,30 @@ extern char *mp_curl_subpath;
 extern int mp_curl_ssl;
 /** Holds the curl insecure flag. */
 extern int mp_curl_insecure;
+/** Holds the max body size, 0 for unlimited. */
+extern size_t mp_curl_maxbody;
+
+/** Holds the hosts given by --hosts. */
+extern char **mp_curl_hosts;
+/** Number of hosts given by --hosts. */
+extern int mp_curl_hosts_num;
+/** Max transfers in flight. */
+extern int mp_curl_parallel;
+/** Holds the directory of the conditional request cache. */
+extern const char *mp_curl_cache_dir;
+/** Holds the time to first byte thresholds. */
+extern thresholds *mp_curl_ttfb_thresholds;
+/** Holds the total time thresholds. */
+extern thresholds *mp_curl_total_thresholds;
+
+/** Default max transfers in flight. */
+#define MP_CURL_PARALLEL               8
+/** Default max body size. */
+#define MP_CURL_MAXBODY                (16*1024*1024)
+/** Initial size of a receive buffer. */
+#define MP_CURL_CHUNK                  4096
+/** Default directory of the conditional request cache. */
+#define MP_CURL_CACHE_DIR              MP_STATEDIR "/http"
 
 #define MP_LONGOPT_CURL_SUBPATH        MP_LONGOPT_PRIV0
 #define MP_LONGOPT_CURL_SSL            MP_LONGOPT_PRIV1
@@ -51,14 +76,42 @@ extern int mp_curl_insecure;
                        {"subpath", required_argument, NULL, MP_LONGOPT_PRIV0}, \
                        {"ssl", no_argument, (int *)&mp_curl_ssl, 1}, \
                        {"https", no_argument, (int *)&mp_curl_ssl, 1}, \
-                       {"insecure", no_argument, (int *)&mp_curl_insecure, 1}
+                       {"insecure", no_argument, (int *)&mp_curl_insecure, 1}, \
+                       {"max-body", required_argument, NULL, MP_LONGOPT_CURL_MAXBODY}, \
+                       MP_LONGOPTS_CURL_TIMING
+/** Curl longopts for timing thresholds. */
+#define MP_LONGOPTS_CURL_TIMING {"warning-ttfb", required_argument, NULL, MP_LONGOPT_CURL_WARN_TTFB}, \
+                       {"critical-ttfb", required_argument, NULL, MP_LONGOPT_CURL_CRIT_TTFB}, \
+                       {"warning-total", required_argument, NULL, MP_LONGOPT_CURL_WARN_TOTAL}, \
+                       {"critical-total", required_argument, NULL, MP_LONGOPT_CURL_CRIT_TOTAL}
+/** Curl longopts for concurrent targets. */
+#define MP_LONGOPTS_CURL_HOSTS {"hosts", required_argument, NULL, (int)MP_LONGOPT_HOSTS}, \
+                       {"parallel", required_argument, NULL, MP_LONGOPT_CURL_PARALLEL}
 
 
-/** Data struct. */
+/**
+ * Data struct.
+ * Zero it before use. The receive buffer grows geometrically, so alloc
+ * may exceed size.
+ */
 struct mp_curl_data {
    char *data;          /**< Actual data. */
    size_t start;        /**< Read/write offset. */
    size_t size;         /**< Size of data. */
+   size_t alloc;        /**< Allocated size of data. */
+   size_t max;          /**< Max size of data, 0 for \ref mp_curl_maxbody. */
+   int overflow;        /**< Data exceeded max, the transfer was aborted. */
+};
+
+/**
+ * Line splitter struct.
+ * Only the current line is buffered, the line callback gets it NUL
+ * terminated and without the line end.
+ */
+struct mp_curl_lines {
+   void (*line)(char *line, size_t len, void *userdata); /**< Line callback. */
+   void *userdata;      /**< Line callback user data. */
+   struct mp_curl_data buf; /**< Current line buffer. */
 };
 
 /** HTTP header struct */
@@ -67,8 +120,45 @@ struct mp_curl_header {
    char **value;        /**< Header value(s). */
 };
 
+/**
+ * Conditional request cache of one URL.
+ * Holds the validators and the summary the check stored for the last
+ * answer. Must not be moved after \ref mp_curl_cache_init.
+ */
+struct mp_curl_cache {
+   char *file;          /**< Cache file, NULL if caching failed. */
+   char *etag;          /**< Cached ETag. */
+   char *modified;      /**< Cached Last-Modified. */
+   char *summary;       /**< Cached summary, NULL if nothing cached. */
+   struct curl_slist *headers; /**< Conditional request headers. */
+   char *recv_etag;     /**< Received ETag. */
+   char *recv_modified; /**< Received Last-Modified. */
+   struct mp_curl_header recv[3]; /**< Received header table. */
+};
+
+/**
+ * Transfer run by the curl multi interface.
+ */
+typedef struct mp_curl_transfer_s {
+   char *host;          /**< Target host, NULL if not a --hosts target. */
+   CURL *curl;          /**< Easy handle, setup by the caller. */
+   CURLcode result;     /**< Transfer result. */
+   long code;           /**< HTTP response code. */
+   void *data;          /**< Plugin data. */
+   struct mp_curl_transfer_s *next; /**< Next queued transfer. */
+} mp_curl_transfer;
+
+/**
+ * Evaluate the result of one transfer.
+ * Must end with one of the result functions like \ref ok or \ref mp_exit.
+ * \para[in] transfer Transfer to evaluate.
+ */
+typedef void (*mp_curl_eval_func)(mp_curl_transfer *transfer);
+
 /**
  * Init libcurl
+ * All handles share the DNS cache, TLS sessions and connections and
+ * accept all compressions supported by libcurl.
  * \return Return a pointer to the CURL env.
  */
 CURL *mp_curl_init(void);
@@ -84,12 +174,106 @@ CURL *mp_curl_init(void);
 char *mp_curl_url(const char *scheme, const char *hostname, int port,
        const char *path);
 
+/**
+ * Load the cache of a URL and make the request conditional.
+ * Sets CURLOPT_HTTPHEADER and the header callback of the request, both
+ * must not be used otherwise.
+ * \para[out] cache Cache to init.
+ * \para[in] curl Request to setup.
+ * \para[in] url URL of the request.
+ */
+void mp_curl_cache_init(struct mp_curl_cache *cache, CURL *curl,
+        const char *url);
+
+/**
+ * Check if the answer is unchanged and the cached summary can be used.
+ * \para[in] cache Cache of the request.
+ * \para[in] code HTTP response code of the request.
+ * \return Return 1 if the cached summary is valid, 0 otherwise.
+ */
+int mp_curl_cache_hit(struct mp_curl_cache *cache, long code);
+
+/**
+ * Store the summary of a fresh answer with its validators. Answers
+ * without validators are removed from the cache.
+ * \para[in] cache Cache of the request.
+ * \para[in] summary Summary to serve while the answer is unchanged.
+ */
+void mp_curl_cache_store(struct mp_curl_cache *cache, const char *summary);
+
+/**
+ * Free a cache. Call after the request is cleaned up.
+ * \para[in] cache Cache to free.
+ */
+void mp_curl_cache_free(struct mp_curl_cache *cache);
+
 /**
  * Perform curl request.
+ * The timing of the request is added to \ref mp_curl_perfdata. Exit
+ * critical if the request failed. A transfer aborted by a receive
+ * callback, like for a too large answer, returns the response code, the
+ * receiver reports the error.
  * \para[in] curl Perform setup curl request.
  */
 long mp_curl_perform(CURL *curl);
 
+/**
+ * Add the HTTP timing of all requests since the last call to the
+ * perfdata and reset it. Phase times are those of the slowest request:
+ * http_dns, http_connect, http_tls, http_pretransfer, http_ttfb and
+ * http_total in seconds since the start of the request. http_sum is the
+ * total time of all requests, http_size, http_speed, http_redirects,
+ * http_connects and http_reused are over all requests.
+ * TTFB and total thresholds are checked per request, breaches are set
+ * with \ref set_warning or \ref set_critical, so the check should end
+ * with \ref mp_exit.
+ */
+void mp_curl_perfdata(void);
+
+/**
+ * Queue a setup curl request for \ref mp_curl_multi_run.
+ * Transfers to the same host are multiplexed over one HTTP/2 connection
+ * if the server supports it.
+ * \para[in] curl Setup curl request.
+ * \para[in] host Target host or NULL.
+ * \para[in] data Plugin data.
+ * \return Return the queued transfer.
+ */
+mp_curl_transfer *mp_curl_multi_add(CURL *curl, const char *host, void *data);
+
+/**
+ * Run all queued transfers concurrently, at most \ref mp_curl_parallel
+ * at a time. Result and code of the transfers are set.
+ * \return Return \ref OK or \ref ERROR if the multi interface failed.
+ */
+int mp_curl_multi_run(void);
+
+/**
+ * Get the response code of a finished transfer. Exit critical if the
+ * transfer failed, like \ref mp_curl_perform. Transfers aborted by a
+ * receive callback are left to the receiver to report. The timing of the
+ * transfer is added to \ref mp_curl_perfdata.
+ * \para[in] transfer Finished transfer.
+ * \return Return the HTTP response code.
+ */
+long mp_curl_transfer_code(mp_curl_transfer *transfer);
+
+/**
+ * Evaluate every transfer and exit with the worst state, output as by
+ * \ref mp_multi_exit. Failed transfers are critical.
+ * \para[in] transfers Transfers to evaluate.
+ * \para[in] num Number of transfers.
+ * \para[in] eval Evaluation function.
+ */
+void mp_curl_multi_exit(mp_curl_transfer **transfers, int num,
+        mp_curl_eval_func eval) __attribute__((__noreturn__));
+
+/**
+ * Cleanup the handle of a transfer and free it.
+ * \para[in] transfer Transfer to free.
+ */
+void mp_curl_transfer_free(mp_curl_transfer *transfer);
+
 /**
  * libCurl receive blackhole data callback.
  * \para[in] content Receive data buffer.
@@ -103,16 +287,37 @@ size_t mp_curl_recv_blackhole(void *contents, size_t size,
 
 /**
  * libCurl receive body data callback.
+ * Data beyond max sets overflow and aborts the transfer.
  * \para[in] content Receive data buffer.
  * \para[in] size Data unit size.
  * \para[in] nmemb Number of data units ready.
  * \para[in|out] userdata Callback user data pointer.
- * \return Return number of bytes consumed.
+ * \return Return number of bytes consumed, 0 on overflow.
  */
 size_t mp_curl_recv_data(void *contents, size_t size, size_t nmemb, void *userdata);
 
+/**
+ * libCurl receive body data callback splitting the body into lines.
+ * A line longer than the max of the line buffer aborts the transfer.
+ * \para[in] content Receive data buffer.
+ * \para[in] size Data unit size.
+ * \para[in] nmemb Number of data units ready.
+ * \para[in|out] userdata Line splitter struct.
+ * \return Return number of bytes consumed, 0 on overflow.
+ */
+size_t mp_curl_recv_lines(void *contents, size_t size, size_t nmemb, void *userdata);
+
+/**
+ * Pass a last unterminated line to the line callback and free the line
+ * buffer. Exit critical if a line was too long.
+ * \para[in|out] lines Line splitter struct.
+ */
+void mp_curl_lines_finish(struct mp_curl_lines *lines);
+
 /**
  * libCurl receive header data callback.
+ * Stores the first value of each header in the table and drops them
+ * on a new status line, so the last followed response wins.
  * \para[in] content Receive data buffer.
  * \para[in] size Data unit size.
  * \para[in] nmemb Number of data units ready.
@@ -142,6 +347,21 @@ void getopt_curl(int c);
  */
 void print_help_curl_subpath(void);
 
+/**
+ * Print the help for the max body size command line option.
+ */
+void print_help_curl_maxbody(void);
+
+/**
+ * Print the help for the --hosts and --parallel options.
+ */
+void print_help_curl_hosts(void);
+
+/**
+ * Print the help for the timing threshold options.
+ */
+void print_help_curl_timing(void);
+
 /**
  * Print the help for the HTTP Basic Auth related command line options.
  */
@@ -28,6 +28,43 @@
 
 #include <expat.h>
 
+size_t mp_expat_recv(void *contents, size_t size, size_t nmemb, void *userdata) {
+    size_t data_size = size * nmemb;
+
+    struct mp_expat_stream *stream = (struct mp_expat_stream *)userdata;
+
+    if (stream->overflow)
+        return 0;
+    if (stream->failed)
+        return data_size;
+
+    /* Abort the transfer, mp_expat_finish reports it. */
+    stream->size += data_size;
+    if (stream->max && stream->size > stream->max) {
+        stream->overflow = 1;
+        return 0;
+    }
+
+    if (!XML_Parse(stream->parser, (const char *)contents, (int)data_size, 0))
+        stream->failed = 1;
+
+    return data_size;
+}
+
+void mp_expat_finish(struct mp_expat_stream *stream) {
+    if (stream->overflow)
+        critical("XML answer larger than %zu bytes.", stream->max);
+
+    if (!stream->failed && !XML_Parse(stream->parser, NULL, 0, 1))
+        stream->failed = 1;
+
+    if (stream->failed) {
+        unknown("%s at line %d\n",
+                XML_ErrorString(XML_GetErrorCode(stream->parser)),
+                (int) XML_GetCurrentLineNumber(stream->parser));
+    }
+}
+
 void print_revision_expat(void) {
     printf(" %s\n", XML_ExpatVersion());
 }
@@ -25,8 +25,38 @@
 #define _EXPAT_UTILS_H_
 
 #include "config.h"
+#include <stddef.h>
 #include <expat.h>
 
+/** Incremental XML parser struct. */
+struct mp_expat_stream {
+    XML_Parser parser;          /**< Expat parser, setup by the caller. */
+    int failed;                 /**< Parse error, reported on finish. */
+    size_t size;                /**< Bytes received so far. */
+    size_t max;                 /**< Max bytes to receive, 0 for unlimited. */
+    int overflow;               /**< Answer exceeded max, reported on finish. */
+};
+
+/**
+ * Receive data callback feeding a expat parser. Matches the libcurl
+ * write callback signature. Data after a parse error is ignored, so a
+ * error page does not hide the HTTP status. Data beyond max sets overflow
+ * and aborts the transfer.
+ * \param[in] contents Receive data buffer.
+ * \param[in] size Data unit size.
+ * \param[in] nmemb Number of data units ready.
+ * \param[in|out] userdata Parser struct.
+ * \return Return number of bytes consumed, 0 on overflow.
+ */
+size_t mp_expat_recv(void *contents, size_t size, size_t nmemb, void *userdata);
+
+/**
+ * Finish the document of a expat parser. Exit critical on overflow and
+ * unknown on parse errors. The parser is not freed.
+ * \param[in|out] stream Parser struct.
+ */
+void mp_expat_finish(struct mp_expat_stream *stream);
+
 /**
  * Print the expat revision.
  */
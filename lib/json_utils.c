@@ -24,7 +24,10 @@
 #include "mp_common.h"
 #include "json_utils.h"
 
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <json.h>
 
@@ -68,6 +71,693 @@ extern const char* mp_json_object_to_json_string(struct json_object *obj) {
 #endif
 }
 
+void mp_json_stream_init(struct mp_json_stream *stream, size_t max) {
+    stream->tok = json_tokener_new();
+    if (stream->tok == NULL)
+        critical("JSON tokener initialisation failed!");
+    stream->obj = NULL;
+    stream->err = json_tokener_success;
+    stream->size = 0;
+    stream->max = max;
+    stream->overflow = 0;
+}
+
+/* Feed data into the tokener and keep parse errors. */
+static void mp_json_stream_parse(struct mp_json_stream *stream,
+        const char *str, int len) {
+    enum json_tokener_error jerr;
+
+    stream->obj = json_tokener_parse_ex(stream->tok, str, len);
+#if JSON_C_VERSION_NUM < (10 << 8)
+    jerr = stream->tok->err;
+#else
+    jerr = json_tokener_get_error(stream->tok);
+#endif
+    if (jerr != json_tokener_continue)
+        stream->err = jerr;
+}
+
+size_t mp_json_recv(void *contents, size_t size, size_t nmemb, void *userdata) {
+    size_t data_size = size * nmemb;
+
+    struct mp_json_stream *stream = (struct mp_json_stream *)userdata;
+
+    if (stream->overflow)
+        return 0;
+    if (stream->obj || stream->err != json_tokener_success)
+        return data_size;
+
+    /* Abort the transfer, mp_json_stream_finish reports it. */
+    stream->size += data_size;
+    if (stream->max && stream->size > stream->max) {
+        stream->overflow = 1;
+        return 0;
+    }
+
+    mp_json_stream_parse(stream, (const char *)contents, (int)data_size);
+
+    return data_size;
+}
+
+struct json_object *mp_json_stream_finish(struct mp_json_stream *stream) {
+    /* The terminating NUL completes top-level numbers and literals. */
+    if (stream->obj == NULL && stream->err == json_tokener_success
+            && stream->size && !stream->overflow)
+        mp_json_stream_parse(stream, "", 1);
+
+    json_tokener_free(stream->tok);
+    stream->tok = NULL;
+
+    if (stream->overflow) {
+        if (stream->obj)
+            json_object_put(stream->obj);
+        stream->obj = NULL;
+        critical("JSON answer larger than %zu bytes.", stream->max);
+    }
+
+    if (stream->err != json_tokener_success) {
+#if JSON_C_VERSION_NUM < (10 << 8)
+        critical("JSON Parsing failed!");
+#else
+        critical("JSON Parsing failed: %s",
+                json_tokener_error_desc(stream->err));
+#endif
+    }
+    if (stream->obj == NULL)
+        critical("JSON Parsing failed: incomplete answer");
+
+    return stream->obj;
+}
+
+void mp_json_stream_free(struct mp_json_stream *stream) {
+    if (stream->tok)
+        json_tokener_free(stream->tok);
+    stream->tok = NULL;
+
+    if (stream->obj)
+        json_object_put(stream->obj);
+    stream->obj = NULL;
+}
+
+/* Scanner states */
+enum {
+    MP_JSON_SCAN_VALUE,     /* Expect a value */
+    MP_JSON_SCAN_FIRST,     /* Expect a value or end of array */
+    MP_JSON_SCAN_KEY,       /* Expect a member name or end of object */
+    MP_JSON_SCAN_COLON,     /* Expect a name separator */
+    MP_JSON_SCAN_STRING,    /* In a string */
+    MP_JSON_SCAN_ESCAPE,    /* After a backslash in a string */
+    MP_JSON_SCAN_UNICODE,   /* In a unicode escape */
+    MP_JSON_SCAN_LITERAL,   /* In a number, true, false or null */
+    MP_JSON_SCAN_AFTER,     /* After a value */
+    MP_JSON_SCAN_DONE,      /* Document complete or failed */
+};
+
+/* Max length of a number, true, false or null. */
+#define MP_JSON_SCAN_LITERAL_MAX    64
+
+#define MP_JSON_IS_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+/* Append to a growing buffer, keeping it NUL terminated. */
+static void mp_json_scan_put(char **buf, size_t *len, size_t *alloc,
+        const char *str, size_t n) {
+    if (*len + n + 1 > *alloc) {
+        *alloc = *alloc ? *alloc : 64;
+        while (*len + n + 1 > *alloc)
+            *alloc *= 2;
+        *buf = mp_realloc(*buf, *alloc);
+    }
+    memcpy(*buf + *len, str, n);
+    *len += n;
+    (*buf)[*len] = '\0';
+}
+
+static void mp_json_scan_error(struct mp_json_scan *scan, const char *err) {
+    scan->err = err;
+    scan->state = MP_JSON_SCAN_DONE;
+}
+
+/*
+ * Match a path against a requested path, a '*' segment matches any
+ * member or index. With prefix the requested path may continue below.
+ */
+static int mp_json_path_match(const char *want, const char *path, int prefix) {
+    while (*path) {
+        if (want[0] == '*' && (want[1] == '.' || want[1] == '\0')) {
+            want++;
+            while (*path && *path != '.')
+                path++;
+        } else {
+            while (*path && *path != '.' && *want == *path) {
+                want++;
+                path++;
+            }
+            if ((*path && *path != '.') || (*want != '.' && *want != '\0'))
+                return 0;
+        }
+        if (*path == '.') {
+            if (*want != '.')
+                return 0;
+            want++;
+            path++;
+        }
+    }
+    return prefix ? *want == '.' : *want == '\0';
+}
+
+/* Index of the path matching the current path, -1 if none. */
+static int mp_json_scan_match(struct mp_json_scan *scan) {
+    int i;
+
+    if (scan->depth == 0 || !scan->live[scan->depth])
+        return -1;
+
+    for (i = 0; i < scan->num; i++) {
+        if (mp_json_path_match(scan->paths[i].path, scan->path, 0))
+            return i;
+    }
+    return -1;
+}
+
+/* Check if any path is below the current path. */
+static int mp_json_scan_prefix(struct mp_json_scan *scan) {
+    int i;
+
+    if (scan->path_len == 0)
+        return 1;
+
+    for (i = 0; i < scan->num; i++) {
+        if (mp_json_path_match(scan->paths[i].path, scan->path, 1))
+            return 1;
+    }
+    return 0;
+}
+
+/* Pass a complete element to the item callback and reset its values. */
+static void mp_json_scan_item(struct mp_json_scan *scan) {
+    size_t len;
+    int i;
+
+    if (!mp_json_path_match(scan->each, scan->path, 0))
+        return;
+
+    scan->item(scan, scan->userdata);
+
+    len = strlen(scan->each);
+    for (i = 0; i < scan->num; i++) {
+        if (strncmp(scan->paths[i].path, scan->each, len) == 0
+                && scan->paths[i].path[len] == '.') {
+            free(scan->paths[i].value);
+            scan->paths[i].value = NULL;
+            scan->paths[i].type = json_type_null;
+        }
+    }
+}
+
+/* Set the last path segment to a member name or array index. */
+static void mp_json_scan_segment(struct mp_json_scan *scan, const char *seg,
+        size_t len) {
+    scan->path_len = scan->base[scan->depth];
+    if (!scan->live[scan->depth])
+        return;
+    if (scan->path_len)
+        mp_json_scan_put(&scan->path, &scan->path_len, &scan->path_alloc,
+                ".", 1);
+    mp_json_scan_put(&scan->path, &scan->path_len, &scan->path_alloc,
+            seg, len);
+}
+
+static void mp_json_scan_index(struct mp_json_scan *scan) {
+    char seg[24];
+
+    mp_snprintf(seg, sizeof(seg), "%ld", scan->index[scan->depth]);
+    mp_json_scan_segment(scan, seg, strlen(seg));
+}
+
+static void mp_json_scan_push(struct mp_json_scan *scan, char type) {
+    int live;
+
+    if (scan->depth == MP_JSON_SCAN_DEPTH) {
+        mp_json_scan_error(scan, "nesting too deep");
+        return;
+    }
+
+    live = scan->live[scan->depth] && mp_json_scan_prefix(scan);
+    scan->depth++;
+    scan->stack[scan->depth] = type;
+    scan->live[scan->depth] = live;
+    scan->base[scan->depth] = scan->path_len;
+    scan->index[scan->depth] = 0;
+    scan->empty = 1;
+
+    if (type == '[') {
+        mp_json_scan_index(scan);
+        scan->state = MP_JSON_SCAN_FIRST;
+    } else {
+        scan->state = MP_JSON_SCAN_KEY;
+    }
+}
+
+static void mp_json_scan_pop(struct mp_json_scan *scan) {
+    scan->path_len = scan->base[scan->depth];
+    if (scan->path)
+        scan->path[scan->path_len] = '\0';
+    scan->depth--;
+
+    if (scan->each && scan->depth && scan->live[scan->depth])
+        mp_json_scan_item(scan);
+
+    scan->state = scan->depth ? MP_JSON_SCAN_AFTER : MP_JSON_SCAN_DONE;
+}
+
+/* Keep the scalar in buf if its path was requested. */
+static void mp_json_scan_value(struct mp_json_scan *scan, json_type type) {
+    struct mp_json_path *path;
+
+    scan->state = scan->depth ? MP_JSON_SCAN_AFTER : MP_JSON_SCAN_DONE;
+
+    if (scan->match >= 0) {
+        path = &scan->paths[scan->match];
+        free(path->value);
+        path->value = mp_malloc(scan->buf_len + 1);
+        memcpy(path->value, scan->buf ? scan->buf : "", scan->buf_len);
+        path->value[scan->buf_len] = '\0';
+        path->type = type;
+    }
+
+    if (scan->each && scan->depth && scan->live[scan->depth])
+        mp_json_scan_item(scan);
+}
+
+static void mp_json_scan_literal(struct mp_json_scan *scan) {
+    json_type type = json_type_int;
+    char *end;
+
+    if (strcmp(scan->buf, "true") == 0 || strcmp(scan->buf, "false") == 0) {
+        type = json_type_boolean;
+    } else if (strcmp(scan->buf, "null") == 0) {
+        type = json_type_null;
+    } else {
+        (void)strtod(scan->buf, &end);
+        if (end == scan->buf || *end != '\0' ||
+                !(isdigit(scan->buf[0]) || scan->buf[0] == '-')) {
+            mp_json_scan_error(scan, "invalid literal");
+            return;
+        }
+        if (strpbrk(scan->buf, ".eE"))
+            type = json_type_double;
+    }
+
+    mp_json_scan_value(scan, type);
+}
+
+/* Append a code point as UTF-8. */
+static void mp_json_scan_utf8(struct mp_json_scan *scan, unsigned int cp) {
+    char utf8[4];
+    size_t len;
+
+    if (cp < 0x80) {
+        utf8[0] = (char)cp;
+        len = 1;
+    } else if (cp < 0x800) {
+        utf8[0] = (char)(0xC0 | (cp >> 6));
+        utf8[1] = (char)(0x80 | (cp & 0x3F));
+        len = 2;
+    } else if (cp < 0x10000) {
+        utf8[0] = (char)(0xE0 | (cp >> 12));
+        utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (cp & 0x3F));
+        len = 3;
+    } else {
+        utf8[0] = (char)(0xF0 | (cp >> 18));
+        utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[3] = (char)(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+    mp_json_scan_put(&scan->buf, &scan->buf_len, &scan->buf_alloc, utf8, len);
+}
+
+/* Start a value with its first character. */
+static void mp_json_scan_begin(struct mp_json_scan *scan, char c) {
+    scan->match = mp_json_scan_match(scan);
+    scan->buf_len = 0;
+
+    if (c == '{' || c == '[') {
+        mp_json_scan_push(scan, c);
+    } else if (c == '"') {
+        scan->key = 0;
+        scan->state = MP_JSON_SCAN_STRING;
+    } else if (c == '-' || isalnum((unsigned char)c)) {
+        mp_json_scan_put(&scan->buf, &scan->buf_len, &scan->buf_alloc, &c, 1);
+        scan->state = MP_JSON_SCAN_LITERAL;
+    } else {
+        mp_json_scan_error(scan, "unexpected character");
+    }
+}
+
+/* Scan a chunk, returns at the end of the chunk or the document. */
+static void mp_json_scan_parse(struct mp_json_scan *scan, const char *ptr,
+        const char *end) {
+    const char *run;
+    char c;
+
+    while (ptr < end && scan->state != MP_JSON_SCAN_DONE) {
+        c = *ptr;
+
+        switch (scan->state) {
+            case MP_JSON_SCAN_FIRST:
+                if (c == ']') {
+                    mp_json_scan_pop(scan);
+                    break;
+                }
+                /* Fall through */
+            case MP_JSON_SCAN_VALUE:
+                if (!MP_JSON_IS_SPACE(c))
+                    mp_json_scan_begin(scan, c);
+                break;
+            case MP_JSON_SCAN_KEY:
+                if (c == '"') {
+                    scan->key = 1;
+                    scan->match = -1;
+                    scan->buf_len = 0;
+                    scan->state = MP_JSON_SCAN_STRING;
+                } else if (c == '}' && scan->empty) {
+                    mp_json_scan_pop(scan);
+                } else if (!MP_JSON_IS_SPACE(c)) {
+                    mp_json_scan_error(scan, "expected member name");
+                }
+                break;
+            case MP_JSON_SCAN_COLON:
+                if (c == ':')
+                    scan->state = MP_JSON_SCAN_VALUE;
+                else if (!MP_JSON_IS_SPACE(c))
+                    mp_json_scan_error(scan, "expected ':'");
+                break;
+            case MP_JSON_SCAN_STRING:
+                /* Copy plain runs at once, only kept strings are copied */
+                run = ptr;
+                while (ptr < end && *ptr != '"' && *ptr != '\\'
+                        && (unsigned char)*ptr >= 0x20)
+                    ptr++;
+                if (ptr > run && (scan->match >= 0 ||
+                            (scan->key && scan->live[scan->depth]))) {
+                    if (scan->high) {
+                        mp_json_scan_utf8(scan, scan->high);
+                        scan->high = 0;
+                    }
+                    mp_json_scan_put(&scan->buf, &scan->buf_len,
+                            &scan->buf_alloc, run, ptr - run);
+                }
+                if (ptr == end)
+                    return;
+                c = *ptr;
+                if (c == '\\') {
+                    scan->state = MP_JSON_SCAN_ESCAPE;
+                } else if (c != '"') {
+                    mp_json_scan_error(scan, "control character in string");
+                } else if (scan->key) {
+                    if (scan->high)
+                        mp_json_scan_utf8(scan, scan->high);
+                    scan->high = 0;
+                    mp_json_scan_segment(scan, scan->buf ? scan->buf : "",
+                            scan->buf_len);
+                    scan->empty = 0;
+                    scan->state = MP_JSON_SCAN_COLON;
+                } else {
+                    if (scan->high)
+                        mp_json_scan_utf8(scan, scan->high);
+                    scan->high = 0;
+                    mp_json_scan_value(scan, json_type_string);
+                }
+                break;
+            case MP_JSON_SCAN_ESCAPE:
+                scan->state = MP_JSON_SCAN_STRING;
+                switch (c) {
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'n': c = '\n'; break;
+                    case 'r': c = '\r'; break;
+                    case 't': c = '\t'; break;
+                    case '"':
+                    case '\\':
+                    case '/':
+                        break;
+                    case 'u':
+                        scan->ucs = 0;
+                        scan->hex = 0;
+                        scan->state = MP_JSON_SCAN_UNICODE;
+                        break;
+                    default:
+                        mp_json_scan_error(scan, "invalid escape");
+                        break;
+                }
+                if (scan->state == MP_JSON_SCAN_STRING && (scan->match >= 0
+                            || (scan->key && scan->live[scan->depth]))) {
+                    if (scan->high) {
+                        mp_json_scan_utf8(scan, scan->high);
+                        scan->high = 0;
+                    }
+                    mp_json_scan_put(&scan->buf, &scan->buf_len,
+                            &scan->buf_alloc, &c, 1);
+                }
+                break;
+            case MP_JSON_SCAN_UNICODE:
+                if (!isxdigit((unsigned char)c)) {
+                    mp_json_scan_error(scan, "invalid unicode escape");
+                    break;
+                }
+                scan->ucs = (scan->ucs << 4) |
+                    (isdigit((unsigned char)c) ? c - '0' : (tolower((unsigned char)c) - 'a' + 10));
+                if (++scan->hex < 4)
+                    break;
+                scan->state = MP_JSON_SCAN_STRING;
+                if (scan->match < 0 && !(scan->key && scan->live[scan->depth]))
+                    break;
+                if (scan->ucs >= 0xD800 && scan->ucs < 0xDC00) {
+                    /* High surrogate, wait for the low one */
+                    if (scan->high)
+                        mp_json_scan_utf8(scan, scan->high);
+                    scan->high = scan->ucs;
+                } else if (scan->ucs >= 0xDC00 && scan->ucs < 0xE000
+                        && scan->high) {
+                    mp_json_scan_utf8(scan, 0x10000 +
+                            ((scan->high - 0xD800) << 10) + (scan->ucs - 0xDC00));
+                    scan->high = 0;
+                } else {
+                    if (scan->high)
+                        mp_json_scan_utf8(scan, scan->high);
+                    scan->high = 0;
+                    mp_json_scan_utf8(scan, scan->ucs);
+                }
+                break;
+            case MP_JSON_SCAN_LITERAL:
+                if (isalnum((unsigned char)c) || c == '-' || c == '+' || c == '.') {
+                    if (scan->buf_len == MP_JSON_SCAN_LITERAL_MAX)
+                        mp_json_scan_error(scan, "invalid literal");
+                    else
+                        mp_json_scan_put(&scan->buf, &scan->buf_len,
+                                &scan->buf_alloc, &c, 1);
+                    break;
+                }
+                mp_json_scan_literal(scan);
+                /* The delimiter belongs to the next state. */
+                continue;
+            case MP_JSON_SCAN_AFTER:
+                if (MP_JSON_IS_SPACE(c))
+                    break;
+                if (c == ',' && scan->stack[scan->depth] == '{') {
+                    scan->state = MP_JSON_SCAN_KEY;
+                    scan->empty = 0;
+                } else if (c == ',') {
+                    scan->index[scan->depth]++;
+                    mp_json_scan_index(scan);
+                    scan->state = MP_JSON_SCAN_VALUE;
+                } else if ((c == '}' && scan->stack[scan->depth] == '{')
+                        || (c == ']' && scan->stack[scan->depth] == '[')) {
+                    mp_json_scan_pop(scan);
+                } else {
+                    mp_json_scan_error(scan, "expected ',' or end of container");
+                }
+                break;
+        }
+        ptr++;
+    }
+}
+
+void mp_json_scan_init(struct mp_json_scan *scan, struct mp_json_path *paths,
+        int num, size_t max) {
+    int i;
+
+    memset(scan, 0, sizeof(struct mp_json_scan));
+    scan->paths = paths;
+    scan->num = num;
+    scan->max = max;
+    scan->match = -1;
+    scan->live[0] = 1;
+    scan->state = MP_JSON_SCAN_VALUE;
+
+    for (i = 0; i < num; i++) {
+        free(paths[i].value);
+        paths[i].value = NULL;
+        paths[i].type = json_type_null;
+    }
+}
+
+void mp_json_scan_each(struct mp_json_scan *scan, const char *each,
+        void (*item)(struct mp_json_scan *scan, void *userdata),
+        void *userdata) {
+    scan->each = each;
+    scan->item = item;
+    scan->userdata = userdata;
+}
+
+size_t mp_json_scan_recv(void *contents, size_t size, size_t nmemb,
+        void *userdata) {
+    size_t data_size = size * nmemb;
+
+    struct mp_json_scan *scan = (struct mp_json_scan *)userdata;
+
+    if (scan->overflow)
+        return 0;
+    if (scan->state == MP_JSON_SCAN_DONE)
+        return data_size;
+
+    /* Abort the transfer, mp_json_scan_finish reports it. */
+    scan->size += data_size;
+    if (scan->max && scan->size > scan->max) {
+        scan->overflow = 1;
+        return 0;
+    }
+
+    mp_json_scan_parse(scan, (const char *)contents,
+            (const char *)contents + data_size);
+
+    return data_size;
+}
+
+int mp_json_scan_finish(struct mp_json_scan *scan) {
+    int i, found = 0;
+
+    /* The end completes top-level numbers and literals. */
+    if (scan->state == MP_JSON_SCAN_LITERAL && scan->depth == 0)
+        mp_json_scan_literal(scan);
+
+    if (scan->err == NULL && scan->state != MP_JSON_SCAN_DONE)
+        scan->err = "incomplete answer";
+
+    mp_json_scan_free(scan);
+
+    if (scan->overflow)
+        critical("JSON answer larger than %zu bytes.", scan->max);
+    if (scan->err)
+        critical("JSON Parsing failed: %s", scan->err);
+
+    for (i = 0; i < scan->num; i++) {
+        if (scan->paths[i].value)
+            found++;
+    }
+
+    return found;
+}
+
+void mp_json_scan_free(struct mp_json_scan *scan) {
+    free(scan->path);
+    scan->path = NULL;
+    scan->path_len = scan->path_alloc = 0;
+    free(scan->buf);
+    scan->buf = NULL;
+    scan->buf_len = scan->buf_alloc = 0;
+}
+
+int mp_json_scan_string(const char *str, struct mp_json_path *paths, int num) {
+    struct mp_json_scan scan;
+
+    mp_json_scan_init(&scan, paths, num, 0);
+    mp_json_scan_parse(&scan, str, str + strlen(str));
+
+    return mp_json_scan_finish(&scan);
+}
+
+long long mp_json_path_int(const struct mp_json_path *path, long long def) {
+    if (path->value == NULL || (path->type != json_type_int
+                && path->type != json_type_double))
+        return def;
+    if (path->type == json_type_double)
+        return (long long)strtod(path->value, NULL);
+    return strtoll(path->value, NULL, 10);
+}
+
+double mp_json_path_double(const struct mp_json_path *path, double def) {
+    if (path->value == NULL || (path->type != json_type_int
+                && path->type != json_type_double))
+        return def;
+    return strtod(path->value, NULL);
+}
+
+struct json_object *mp_json_paths_object(const struct mp_json_path *paths,
+        int num) {
+    struct json_object *root;
+    struct json_object *obj;
+    struct json_object *child;
+    struct json_object *value;
+    char *path;
+    char *seg;
+    char *next;
+    int i;
+
+    root = json_object_new_object();
+
+    for (i = 0; i < num; i++) {
+        if (paths[i].value == NULL)
+            continue;
+
+        switch (paths[i].type) {
+            case json_type_boolean:
+                value = json_object_new_boolean(paths[i].value[0] == 't');
+                break;
+            case json_type_int:
+                value = json_object_new_int64(strtoll(paths[i].value, NULL, 10));
+                break;
+            case json_type_double:
+                value = json_object_new_double(strtod(paths[i].value, NULL));
+                break;
+            case json_type_string:
+                value = json_object_new_string(paths[i].value);
+                break;
+            default:
+                value = NULL;
+                break;
+        }
+
+        /* Array indexes become member names, scanning them works alike. */
+        path = mp_strdup(paths[i].path);
+        obj = root;
+        for (seg = path; (next = strchr(seg, '.')); seg = next + 1) {
+            *next = '\0';
+            if (!mp_json_object_object_get(obj, seg, &child)
+                    || !json_object_is_type(child, json_type_object)) {
+                child = json_object_new_object();
+                json_object_object_add(obj, seg, child);
+            }
+            obj = child;
+        }
+        json_object_object_add(obj, seg, value);
+        free(path);
+    }
+
+    return root;
+}
+
+void mp_json_paths_free(struct mp_json_path *paths, int num) {
+    int i;
+
+    for (i = 0; i < num; i++) {
+        free(paths[i].value);
+        paths[i].value = NULL;
+    }
+}
+
 void print_revision_json(void) {
 #if JSON_C_VERSION_NUM > (10 << 8)
     printf(" json-c v%s\n", json_c_version());
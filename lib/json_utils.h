@@ -24,8 +24,69 @@
 #ifndef _JSON_UTILS_H_
 #define _JSON_UTILS_H_
 
+#include <stddef.h>
 #include <json.h>
 
+/** Incremental JSON parser struct. */
+struct mp_json_stream {
+    json_tokener *tok;          /**< json-c tokener. */
+    struct json_object *obj;    /**< Parsed object, once complete. */
+    int err;                    /**< Parse error, reported on finish. */
+    size_t size;                /**< Bytes received so far. */
+    size_t max;                 /**< Max bytes to receive, 0 for unlimited. */
+    int overflow;               /**< Answer exceeded max, reported on finish. */
+};
+
+/** Max nesting depth of the JSON path scanner. */
+#define MP_JSON_SCAN_DEPTH  32
+
+/**
+ * JSON path to extract and its value.
+ * Paths are member names and array indexes joined by '.', like
+ * "queue_totals.messages" or "queues.0.name". A '*' matches any member
+ * name or index, like "queues.*.name".
+ */
+struct mp_json_path {
+    const char *path;           /**< Path of the value. */
+    json_type type;             /**< Type of the value. */
+    char *value;                /**< Scalar as string, NULL if not found. */
+};
+
+/**
+ * Incremental JSON path scanner struct.
+ * Scans the document without building objects, only the values of the
+ * requested paths are kept.
+ */
+struct mp_json_scan {
+    struct mp_json_path *paths; /**< Paths to extract. */
+    int num;                    /**< Number of paths. */
+    const char *err;            /**< Parse error, reported on finish. */
+    size_t size;                /**< Bytes received so far. */
+    size_t max;                 /**< Max bytes to receive, 0 for unlimited. */
+    int overflow;               /**< Answer exceeded max, reported on finish. */
+    const char *each;           /**< Path of the elements passed to item. */
+    void (*item)(struct mp_json_scan *scan, void *userdata); /**< Element callback. */
+    void *userdata;             /**< Element callback user data. */
+    int state;                  /**< Scanner state. */
+    int depth;                  /**< Current nesting depth. */
+    int match;                  /**< Path index of the current value or -1. */
+    int key;                    /**< Current string is a member name. */
+    int empty;                  /**< Current container has no member yet. */
+    int hex;                    /**< Hex digits of a unicode escape read. */
+    unsigned int ucs;           /**< Code point of a unicode escape. */
+    unsigned int high;          /**< Pending high surrogate. */
+    char stack[MP_JSON_SCAN_DEPTH+1];   /**< Open containers. */
+    char live[MP_JSON_SCAN_DEPTH+1];    /**< Containers holding paths. */
+    long index[MP_JSON_SCAN_DEPTH+1];   /**< Current array indexes. */
+    size_t base[MP_JSON_SCAN_DEPTH+1];  /**< Path lengths of containers. */
+    char *path;                 /**< Current path. */
+    size_t path_len;            /**< Length of current path. */
+    size_t path_alloc;          /**< Allocated size of current path. */
+    char *buf;                  /**< Current string or literal. */
+    size_t buf_len;             /**< Length of current string or literal. */
+    size_t buf_alloc;           /**< Allocated size of buf. */
+};
+
 /**
  * json_tokener_parse(_verbose) wrapper to support more json-c versions
  */
@@ -41,6 +102,135 @@ int mp_json_object_object_get(struct json_object* jso, const char *key, struct j
   */
 extern const char* mp_json_object_to_json_string(struct json_object *obj);
 
+/**
+ * Init a incremental JSON parser.
+ * \param[out] stream Parser struct to init.
+ * \param[in] max Max bytes to receive, 0 for unlimited.
+ */
+void mp_json_stream_init(struct mp_json_stream *stream, size_t max);
+
+/**
+ * Receive data callback feeding a incremental JSON parser. Matches the
+ * libcurl write callback signature. Data after a complete object or a
+ * parse error is ignored, so a error page does not hide the HTTP status.
+ * Data beyond max sets overflow and aborts the transfer.
+ * \param[in] contents Receive data buffer.
+ * \param[in] size Data unit size.
+ * \param[in] nmemb Number of data units ready.
+ * \param[in|out] userdata Parser struct.
+ * \return Return number of bytes consumed, 0 on overflow.
+ */
+size_t mp_json_recv(void *contents, size_t size, size_t nmemb, void *userdata);
+
+/**
+ * Finish a incremental JSON parser and free the tokener. Exit critical on
+ * parse errors or overflow.
+ * \param[in|out] stream Parser struct.
+ * \return Return the parsed object.
+ */
+struct json_object *mp_json_stream_finish(struct mp_json_stream *stream);
+
+/**
+ * Free a incremental JSON parser without using its result, like for a
+ * answer without body.
+ * \param[in|out] stream Parser struct.
+ */
+void mp_json_stream_free(struct mp_json_stream *stream);
+
+/**
+ * Init a incremental JSON path scanner. The values of the paths are
+ * reset.
+ * \param[out] scan Scanner struct to init.
+ * \param[in|out] paths Paths to extract.
+ * \param[in] num Number of paths.
+ * \param[in] max Max bytes to receive, 0 for unlimited.
+ */
+void mp_json_scan_init(struct mp_json_scan *scan, struct mp_json_path *paths,
+        int num, size_t max);
+
+/**
+ * Call item for every complete element matching each, like "items.*".
+ * The values of the paths below each are reset after every element, so
+ * a list of any length is scanned in constant memory.
+ * \param[in|out] scan Scanner struct.
+ * \param[in] each Path of the elements.
+ * \param[in] item Element callback, the values are in scan->paths.
+ * \param[in] userdata Element callback user data.
+ */
+void mp_json_scan_each(struct mp_json_scan *scan, const char *each,
+        void (*item)(struct mp_json_scan *scan, void *userdata),
+        void *userdata);
+
+/**
+ * Receive data callback feeding a JSON path scanner. Matches the libcurl
+ * write callback signature. Data after the document or a parse error is
+ * ignored. Data beyond max sets overflow and aborts the transfer.
+ * \param[in] contents Receive data buffer.
+ * \param[in] size Data unit size.
+ * \param[in] nmemb Number of data units ready.
+ * \param[in|out] userdata Scanner struct.
+ * \return Return number of bytes consumed, 0 on overflow.
+ */
+size_t mp_json_scan_recv(void *contents, size_t size, size_t nmemb,
+        void *userdata);
+
+/**
+ * Finish a JSON path scanner and free its buffers. Exit critical on parse
+ * errors, overflow or a incomplete document.
+ * \param[in|out] scan Scanner struct.
+ * \return Return the number of paths found.
+ */
+int mp_json_scan_finish(struct mp_json_scan *scan);
+
+/**
+ * Free the buffers of a JSON path scanner without checking the document.
+ * \param[in|out] scan Scanner struct.
+ */
+void mp_json_scan_free(struct mp_json_scan *scan);
+
+/**
+ * Scan a NUL-terminated JSON document for paths.
+ * Exit critical on parse errors.
+ * \param[in] str JSON document.
+ * \param[in|out] paths Paths to extract.
+ * \param[in] num Number of paths.
+ * \return Return the number of paths found.
+ */
+int mp_json_scan_string(const char *str, struct mp_json_path *paths, int num);
+
+/**
+ * Get a path value as integer.
+ * \param[in] path Scanned path.
+ * \param[in] def Default if not found or not a number.
+ * \return Return the value.
+ */
+long long mp_json_path_int(const struct mp_json_path *path, long long def);
+
+/**
+ * Get a path value as double.
+ * \param[in] path Scanned path.
+ * \param[in] def Default if not found or not a number.
+ * \return Return the value.
+ */
+double mp_json_path_double(const struct mp_json_path *path, double def);
+
+/**
+ * Build a object tree of the found paths, like to cache them as JSON
+ * and scan them again.
+ * \param[in] paths Scanned paths.
+ * \param[in] num Number of paths.
+ * \return Return a new object.
+ */
+struct json_object *mp_json_paths_object(const struct mp_json_path *paths,
+        int num);
+
+/**
+ * Free the values of scanned paths.
+ * \param[in|out] paths Scanned paths.
+ * \param[in] num Number of paths.
+ */
+void mp_json_paths_free(struct mp_json_path *paths, int num);
+
 /**
  * Print the json revision.
  */
@@ -22,6 +22,8 @@
  */
 
 #include "mp_common.h"
+#include "mp_repeat.h"
+#include "mp_stats.h"
 
 #include <signal.h>
 #include <stdarg.h>
@@ -38,18 +40,58 @@ char *mp_out_okonly = NULL;
 char *mp_out_warning = NULL;
 char *mp_out_critical = NULL;
 
+/**
+ * Start a result line with the state name and the formatted message.
+ */
+static char *mp_result_start(const char *state, const char *fmt, va_list ap) {
+    va_list aq;
+    char *text;
+    size_t len;
+    int msg;
+
+    va_copy(aq, ap);
+    msg = vsnprintf(NULL, 0, fmt, aq);
+    va_end(aq);
+
+    len = strlen(state);
+    text = mp_malloc(len + msg + 1);
+    memcpy(text, state, len);
+    vsnprintf(text + len, msg + 1, fmt, ap);
+
+    return text;
+}
+
+/**
+ * Finish a result line. Print it and exit with state or, if a jump
+ * target is set, keep it in \ref mp_result_text and jump back to
+ * \ref mp_repeat_run or \ref mp_multi_exit.
+ */
+static void mp_result(int state, char *text) __attribute__((__noreturn__));
+static void mp_result(int state, char *text) {
+    if (mp_result_jmp) {
+        free(mp_result_text);
+        mp_result_text = text;
+        siglongjmp(*mp_result_jmp, state + 1);
+    }
+    printf("%s", text);
+    if (mp_showperfdata && mp_perfdata) {
+       printf(" | %s", mp_perfdata);
+    }
+    printf("\n");
+    free(text);
+    free(mp_perfdata);
+    fflush(stdout);
+    mp_stats_record(state);
+    exit(state);
+}
+
 void ok(const char *fmt, ...) {
     va_list ap;
-    printf("OK - ");
+    char *text;
     va_start(ap, fmt);
-    vprintf(fmt, ap);
+    text = mp_result_start("OK - ", fmt, ap);
     va_end(ap);
-    if (mp_showperfdata && mp_perfdata) {
-       printf("| %s", mp_perfdata);
-       free(mp_perfdata);
-    }
-    printf("\n");
-    exit(STATE_OK);
+    mp_result(STATE_OK, text);
 }
 
 void set_ok(const char *fmt, ...) {
@@ -69,7 +111,7 @@ void set_ok(const char *fmt, ...) {
         mp_out_ok = mp_realloc(mp_out_ok, strlen(mp_out_ok) + len + 3);
         strcpy(mp_out_ok+strlen(mp_out_ok), ", ");
     } else {
-        mp_out_ok = mp_malloc(len);
+        mp_out_ok = mp_malloc(len + 1);
         *mp_out_ok = '\0';
     }
 
@@ -92,7 +134,7 @@ void set_okonly(const char *fmt, ...) {
     va_end(ap);
 
     // Get buffer
-    mp_out_okonly = mp_malloc(len);
+    mp_out_okonly = mp_malloc(len + 1);
      *mp_out_okonly = '\0';
 
     // sprintf
@@ -103,16 +145,11 @@ void set_okonly(const char *fmt, ...) {
 
 void warning(const char *fmt, ...) {
     va_list ap;
-    printf("WARNING - ");
+    char *text;
     va_start(ap, fmt);
-    vprintf(fmt, ap);
+    text = mp_result_start("WARNING - ", fmt, ap);
     va_end(ap);
-    if (mp_showperfdata && mp_perfdata) {
-       printf(" | %s", mp_perfdata);
-       free(mp_perfdata);
-    }
-    printf("\n");
-    exit(STATE_WARNING);
+    mp_result(STATE_WARNING, text);
 }
 
 void set_warning(const char *fmt, ...) {
@@ -132,7 +169,7 @@ void set_warning(const char *fmt, ...) {
         mp_out_warning = mp_realloc(mp_out_warning, strlen(mp_out_warning) + len + 3);
         strcpy(mp_out_warning+strlen(mp_out_warning), ", ");
     } else {
-        mp_out_warning = mp_malloc(len);
+        mp_out_warning = mp_malloc(len + 1);
         *mp_out_warning = '\0';
     }
 
@@ -144,16 +181,11 @@ void set_warning(const char *fmt, ...) {
 
 void critical(const char *fmt, ...) {
     va_list ap;
-    printf("CRITICAL - ");
+    char *text;
     va_start(ap, fmt);
-    vprintf(fmt, ap);
+    text = mp_result_start("CRITICAL - ", fmt, ap);
     va_end(ap);
-    if (mp_showperfdata && mp_perfdata) {
-       printf(" | %s", mp_perfdata);
-       free(mp_perfdata);
-    }
-    printf("\n");
-    exit(STATE_CRITICAL);
+    mp_result(STATE_CRITICAL, text);
 }
 
 void set_critical(const char *fmt, ...) {
@@ -173,7 +205,7 @@ void set_critical(const char *fmt, ...) {
         mp_out_critical = mp_realloc(mp_out_critical, strlen(mp_out_critical) + len + 3);
         strcpy(mp_out_critical+strlen(mp_out_critical), ", ");
     } else {
-        mp_out_critical = mp_malloc(len);
+        mp_out_critical = mp_malloc(len + 1);
         *mp_out_critical = '\0';
     }
 
@@ -185,58 +217,50 @@ void set_critical(const char *fmt, ...) {
 
 void unknown(const char *fmt, ...) {
     va_list ap;
-    printf("UNKNOWN - ");
+    char *text;
     va_start(ap, fmt);
-    vprintf(fmt, ap);
+    text = mp_result_start("UNKNOWN - ", fmt, ap);
     va_end(ap);
-    if (mp_showperfdata && mp_perfdata) {
-       printf(" | %s", mp_perfdata);
-       free(mp_perfdata);
-    }
-    printf("\n");
-    exit(STATE_UNKNOWN);
+    mp_result(STATE_UNKNOWN, text);
 }
 
 void mp_exit(const char *fmt, ...) {
     va_list ap;
+    const char *state = "";
+    char *text;
     switch (mp_state) {
         case -1:
         case STATE_OK:
             mp_state = STATE_OK;
-            printf("OK - ");
+            state = "OK - ";
             break;
         case STATE_WARNING:
-            printf("WARNING - ");
+            state = "WARNING - ";
             break;
         case STATE_CRITICAL:
-            printf("CRITICAL - ");
+            state = "CRITICAL - ";
             break;
     }
     va_start(ap, fmt);
-    vprintf(fmt, ap);
+    text = mp_result_start(state, fmt, ap);
     va_end(ap);
     if (mp_out_critical) {
-        printf(" %s", mp_out_critical);
+        mp_strcat_space(&text, mp_out_critical);
     }
     if (mp_out_warning) {
         if (mp_state > STATE_WARNING)
-            printf(" Warning:");
-        printf(" %s", mp_out_warning);
+            mp_strcat(&text, " Warning:");
+        mp_strcat_space(&text, mp_out_warning);
     }
     if (mp_out_ok) {
         if (mp_state > STATE_OK)
-            printf(" OK:");
-        printf(" %s", mp_out_ok);
+            mp_strcat(&text, " OK:");
+        mp_strcat_space(&text, mp_out_ok);
     }
     if (mp_out_okonly && mp_state == STATE_OK) {
-        printf(" %s", mp_out_okonly);
-    }
-    if (mp_showperfdata && mp_perfdata) {
-        printf(" | %s", mp_perfdata);
-        free(mp_perfdata);
+        mp_strcat_space(&text, mp_out_okonly);
     }
-    printf("\n");
-    exit(mp_state);
+    mp_result(mp_state, text);
 }
 
 void usage(const char *fmt, ...) {
@@ -265,6 +289,7 @@ void print_copyright (void) {
 
 void timeout_alarm_handler(int signo) {
     if (signo == SIGALRM) {
+        mp_stats_timeout = 1;
         critical("Plugin timed out after %d seconds\n", mp_timeout);
     }
 }
@@ -56,6 +56,8 @@ extern unsigned int mp_verbose;
 extern int mp_state;
 /** The global ok string. */
 extern char *mp_out_ok;
+/** The global ok-only string. */
+extern char *mp_out_okonly;
 /** The global warning string. */
 extern char *mp_out_warning;
 /** The global critical string. */
@@ -37,10 +37,11 @@ char **mp_eopt(int *argc, char **orig_argv, char *optarg) {
     char *esection;
     char **eargv;
     char *arg;
+    char *dup = NULL;
     int i = 0;
 
     if (optarg == NULL && strncmp(orig_argv[optind], "-",1) != 0) {
-        optarg = mp_strdup(orig_argv[optind]);
+        optarg = dup = mp_strdup(orig_argv[optind]);
         optind++;
     }
 
@@ -62,6 +63,7 @@ char **mp_eopt(int *argc, char **orig_argv, char *optarg) {
     fd = fopen(efile, "r");
     if (!fd) {
         printf("Can't open: %s\n", efile);
+        free(dup);
         return orig_argv;
     }
 
@@ -80,6 +82,9 @@ char **mp_eopt(int *argc, char **orig_argv, char *optarg) {
         // Test if line is complete.
         if (buffer[len] != '\n') {
             printf("Line %d in file %s too long.\n", lineno, efile);
+            fclose(fd);
+            free(buffer);
+            free(dup);
             return orig_argv;
         }
 
@@ -110,7 +115,7 @@ char **mp_eopt(int *argc, char **orig_argv, char *optarg) {
             val = buffer;
             key = strsep(&val, "=");
 
-            if(*val) {
+            if(val && *val) {
                 new_argv = mp_realloc(new_argv, sizeof(char *)*(new_argc+2));
             } else {
                 new_argv = mp_realloc(new_argv, sizeof(char *)*(new_argc+1));
@@ -128,12 +133,15 @@ char **mp_eopt(int *argc, char **orig_argv, char *optarg) {
             new_argv[new_argc] = arg;
             new_argc++;
 
-            if(*val) {
+            if(val && *val) {
                 new_argv[new_argc] = mp_strdup(val);
                 new_argc++;
             }
         }
     }
+    fclose(fd);
+    free(buffer);
+    free(dup);
 
     eargv = (char**)mp_malloc(sizeof(char *)*(*argc+new_argc));
     for (i=0; i<optind; i++) eargv[i]=orig_argv[i];
@@ -141,6 +149,7 @@ char **mp_eopt(int *argc, char **orig_argv, char *optarg) {
     for (i=optind; i<*argc; i++) eargv[new_argc+i]=orig_argv[i];
 
     *argc += new_argc;
+    free(new_argv);
 
     return eargv;
 }
@@ -24,6 +24,7 @@
 #include "mp_getopt.h"
 #include "mp_common.h"
 #include "mp_notify.h"
+#include "mp_repeat.h"
 
 #include <stdio.h>
 
@@ -58,6 +59,10 @@ int mp_getopt(int *argc, char **argv[], const char *optstring,
             case 't':
                 mp_timeout = (int)strtol(optarg, NULL, 10);
                 break;
+            case MP_LONGOPT_REPEAT:
+            case MP_LONGOPT_INTERVAL:
+                getopt_repeat(c, optarg);
+                break;
             default:
                 // Let the caller handle this option
                 return c;
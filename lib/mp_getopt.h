@@ -29,6 +29,16 @@
 /** Longopt only defines */
 #define MP_LONGOPT_EOPT         0x0080  //*< --eopt */
 #define MP_LONGOPT_PERFDATA     0x0081  //*< --perfdata */
+#define MP_LONGOPT_REPEAT       0x0082  //*< --repeat */
+#define MP_LONGOPT_INTERVAL     0x0083  //*< --interval */
+#define MP_LONGOPT_HOSTS        0x0084  //*< --hosts */
+#define MP_LONGOPT_SNMP_STATS   0x0085  //*< --snmp-stats */
+#define MP_LONGOPT_CURL_MAXBODY 0x0086  //*< --max-body */
+#define MP_LONGOPT_CURL_PARALLEL 0x0087 //*< --parallel */
+#define MP_LONGOPT_CURL_WARN_TTFB 0x0088 //*< --warning-ttfb */
+#define MP_LONGOPT_CURL_CRIT_TTFB 0x0089 //*< --critical-ttfb */
+#define MP_LONGOPT_CURL_WARN_TOTAL 0x008A //*< --warning-total */
+#define MP_LONGOPT_CURL_CRIT_TOTAL 0x008B //*< --critical-total */
 #define MP_LONGOPT_PRIV0        0x0090
 #define MP_LONGOPT_PRIV1        0x0091
 #define MP_LONGOPT_PRIV2        0x0092
@@ -37,6 +47,7 @@
 #define MP_LONGOPT_PRIV5        0x0095
 #define MP_LONGOPT_PRIV6        0x0096
 #define MP_LONGOPT_PRIV7        0x0097
+#define MP_LONGOPT_PRIV8        0x0098
 
 /**
  * Wrapper around getopt_long for check commands.
@@ -21,8 +21,10 @@
  * $Id$
  */
 
+#include "mp_common.h"
 #include "mp_perfdata.h"
 #include "mp_args.h"
+#include "mp_state.h"
 #include "mp_utils.h"
 
 #include <stdio.h>
@@ -206,6 +208,16 @@ void mp_perfdata_float3(const char *label, float value, const char *unit,
     free_threshold(threshold);
 }
 
+void mp_perfdata_rate(const char *label, const char *target, uint64_t value,
+      int width, const char *unit) {
+    double rate;
+
+    if (mp_state_rate(target, label, value, width, &rate) != OK)
+        return;
+
+    mp_perfdata_float(label, (float)rate, unit, NULL);
+}
+
 void mp_perfdata_percent_resolv(thresholds *threshold, float max) {
     if (threshold && threshold->warning) {
         if (threshold->warning->start_percent) {
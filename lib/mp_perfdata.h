@@ -30,6 +30,8 @@
 
 #include "mp_args.h"
 
+#include <stdint.h>
+
 /* The global perfdata vars. */
 /** The global perfdata variable. */
 extern unsigned int mp_showperfdata;
@@ -124,6 +126,19 @@ void mp_perfdata_float3(const char *label, float value, const char *unit,
       int have_warn, float warn, int have_crit, float crit,
       int have_min, float min, int have_max, float max);
 
+/**
+ * Add per second rate perfdata of a counter. The counter sample is kept in
+ * the state store, no perfdata is added for the first sample or after a
+ * counter reset.
+ * \param[in] label perfdata label string, also used as counter key
+ * \param[in] target target the counter belongs to, may be NULL
+ * \param[in] value current counter value
+ * \param[in] width counter width, \ref MP_COUNTER32 or \ref MP_COUNTER64
+ * \param[in] unit perfdata unit string
+ */
+void mp_perfdata_rate(const char *label, const char *target, uint64_t value,
+      int width, const char *unit);
+
 /**
  * Resolve percent values to absolute ones.
  * \param[in|out] thresholds thresholds to operate on
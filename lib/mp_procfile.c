@@ -0,0 +1,248 @@
+/***
+ * Monitoring Plugin - mp_procfile.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "mp_procfile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * /proc files report a size of 0, so the buffer is filled by pread
+ * from offset 0 until EOF and doubled whenever it runs full. The
+ * buffer is kept for re-reads, so a steady state read is a single
+ * pread plus the one returning EOF.
+ */
+
+mp_procfile *mp_procfile_open(const char *filename) {
+    mp_procfile *pf;
+    int fd;
+
+    fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    pf = mp_calloc(1, sizeof(mp_procfile));
+    pf->fd = fd;
+
+    return pf;
+}
+
+int mp_procfile_read(mp_procfile *pf) {
+    ssize_t n;
+
+    if (!pf)
+        return ERROR;
+
+    if (!pf->buf) {
+        pf->size = MP_PROCFILE_BUFSIZE;
+        pf->buf = mp_malloc(pf->size);
+    }
+
+    pf->len = 0;
+    pf->pos = 0;
+
+    for (;;) {
+        /* Keep one byte for a terminating null */
+        if (pf->len + 1 >= pf->size) {
+            pf->size *= 2;
+            pf->buf = mp_realloc(pf->buf, pf->size);
+        }
+
+        n = pread(pf->fd, pf->buf + pf->len, pf->size - pf->len - 1, pf->len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return ERROR;
+        }
+        if (n == 0)
+            break;
+        pf->len += n;
+    }
+    pf->buf[pf->len] = '\0';
+
+    return OK;
+}
+
+void mp_procfile_close(mp_procfile *pf) {
+    if (!pf)
+        return;
+
+    close(pf->fd);
+    free(pf->buf);
+    free(pf);
+}
+
+int mp_procfile_line(mp_procfile *pf, mp_slice *line) {
+    const char *start, *end;
+
+    if (pf->pos >= pf->len)
+        return 0;
+
+    start = pf->buf + pf->pos;
+    end = memchr(start, '\n', pf->len - pf->pos);
+    if (end) {
+        line->len = end - start;
+        pf->pos += line->len + 1;
+    } else {
+        line->len = pf->len - pf->pos;
+        pf->pos = pf->len;
+    }
+    line->ptr = start;
+
+    return 1;
+}
+
+size_t mp_procfile_count_lines(mp_procfile *pf) {
+    const char *p, *end;
+    size_t count = 0;
+
+    p = pf->buf + pf->pos;
+    end = pf->buf + pf->len;
+
+    while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+        count++;
+        p++;
+    }
+    /* Last line without newline */
+    if (pf->len > pf->pos && pf->buf[pf->len - 1] != '\n')
+        count++;
+
+    pf->pos = pf->len;
+
+    return count;
+}
+
+static inline int mp_slice_isspace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+int mp_slice_field(mp_slice *s, mp_slice *field) {
+    const char *p = s->ptr;
+    const char *end = s->ptr + s->len;
+
+    while (p < end && mp_slice_isspace(*p))
+        p++;
+    if (p == end) {
+        s->ptr = end;
+        s->len = 0;
+        return 0;
+    }
+
+    field->ptr = p;
+    while (p < end && !mp_slice_isspace(*p))
+        p++;
+    field->len = p - field->ptr;
+
+    s->ptr = p;
+    s->len = end - p;
+
+    return 1;
+}
+
+int mp_slice_token(mp_slice *s, char sep, mp_slice *token) {
+    const char *p;
+
+    token->ptr = s->ptr;
+    p = memchr(s->ptr, sep, s->len);
+    if (!p) {
+        token->len = s->len;
+        s->ptr += s->len;
+        s->len = 0;
+        return 0;
+    }
+
+    token->len = p - s->ptr;
+    s->len -= token->len + 1;
+    s->ptr = p + 1;
+
+    return 1;
+}
+
+void mp_slice_trim(mp_slice *s) {
+    while (s->len && mp_slice_isspace(s->ptr[0])) {
+        s->ptr++;
+        s->len--;
+    }
+    while (s->len && mp_slice_isspace(s->ptr[s->len - 1]))
+        s->len--;
+}
+
+int mp_slice_eq(const mp_slice *s, const char *str) {
+    return strncmp(s->ptr, str, s->len) == 0 && str[s->len] == '\0';
+}
+
+unsigned long long mp_slice_ull(const mp_slice *s, size_t *end) {
+    unsigned long long value = 0;
+    size_t i = 0;
+
+    while (i < s->len && mp_slice_isspace(s->ptr[i]))
+        i++;
+    for (; i < s->len; i++) {
+        unsigned int d = (unsigned char)s->ptr[i] - '0';
+        if (d > 9)
+            break;
+        value = value * 10 + d;
+    }
+    if (end)
+        *end = i;
+
+    return value;
+}
+
+unsigned long long mp_slice_hex(const mp_slice *s) {
+    unsigned long long value = 0;
+    unsigned int d;
+    size_t i;
+    char c;
+
+    for (i = 0; i < s->len; i++) {
+        c = s->ptr[i];
+        if (c >= '0' && c <= '9')
+            d = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            d = c - 'A' + 10;
+        else
+            break;
+        value = (value << 4) | d;
+    }
+
+    return value;
+}
+
+char *mp_slice_strdup(const mp_slice *s) {
+    char *str;
+
+    str = mp_malloc(s->len + 1);
+    memcpy(str, s->ptr, s->len);
+    str[s->len] = '\0';
+
+    return str;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
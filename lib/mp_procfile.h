@@ -0,0 +1,143 @@
+/***
+ * Monitoring Plugin - mp_procfile.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _MP_PROCFILE_H_
+#define _MP_PROCFILE_H_
+
+#include <stdlib.h>
+
+/** Initial buffer size of a procfile. */
+#define MP_PROCFILE_BUFSIZE     4096
+
+/**
+ * A not null terminated part of a procfile buffer.
+ */
+typedef struct mp_slice_s {
+    const char  *ptr;           /**< Start of the slice */
+    size_t      len;            /**< Length of the slice */
+} mp_slice;
+
+/**
+ * A /proc or sysfs file kept open for re-reads.
+ */
+typedef struct mp_procfile_s {
+    int         fd;             /**< Open file descriptor */
+    char        *buf;           /**< Read buffer, grows as needed */
+    size_t      size;           /**< Allocated size of buf */
+    size_t      len;            /**< Bytes read into buf */
+    size_t      pos;            /**< Line iterator position */
+} mp_procfile;
+
+/**
+ * Open a procfile. Does not read it.
+ * \param[in] filename File to open.
+ * \return Opened procfile or NULL on error.
+ */
+mp_procfile *mp_procfile_open(const char *filename);
+
+/**
+ * (Re-)read the whole file from offset 0 into the buffer and reset
+ * the line iterator. Slices of a previous read become invalid.
+ * \param[in] pf Procfile to read.
+ * \return \ref OK or \ref ERROR.
+ */
+int mp_procfile_read(mp_procfile *pf);
+
+/**
+ * Close a procfile and free its buffer.
+ * \param[in] pf Procfile to close.
+ */
+void mp_procfile_close(mp_procfile *pf);
+
+/**
+ * Get the next line without the trailing newline.
+ * \param[in] pf Procfile to iterate.
+ * \param[out] line Next line.
+ * \return 1 if a line was found, 0 at the end.
+ */
+int mp_procfile_line(mp_procfile *pf, mp_slice *line);
+
+/**
+ * Count the remaining lines.
+ * \param[in] pf Procfile to count.
+ * \return Number of lines.
+ */
+size_t mp_procfile_count_lines(mp_procfile *pf);
+
+/**
+ * Consume the next whitespace separated field of a slice.
+ * \param[in,out] s Slice to consume from.
+ * \param[out] field Next field.
+ * \return 1 if a field was found, 0 at the end.
+ */
+int mp_slice_field(mp_slice *s, mp_slice *field);
+
+/**
+ * Consume a slice up to the next separator. The separator is dropped.
+ * If the separator is not found the whole slice is consumed.
+ * \param[in,out] s Slice to consume from.
+ * \param[in] sep Separator char.
+ * \param[out] token Part before the separator.
+ * \return 1 if the separator was found, 0 otherwise.
+ */
+int mp_slice_token(mp_slice *s, char sep, mp_slice *token);
+
+/**
+ * Strip leading and trailing whitespace.
+ * \param[in,out] s Slice to trim.
+ */
+void mp_slice_trim(mp_slice *s);
+
+/**
+ * Compare a slice to a string.
+ * \param[in] s Slice to compare.
+ * \param[in] str String to compare.
+ * \return 1 if equal, 0 otherwise.
+ */
+int mp_slice_eq(const mp_slice *s, const char *str);
+
+/**
+ * Parse a unsigned decimal number, leading whitespace is skipped.
+ * \param[in] s Slice to parse.
+ * \param[out] end Number of consumed chars, may be NULL.
+ * \return Parsed value.
+ */
+unsigned long long mp_slice_ull(const mp_slice *s, size_t *end);
+
+/**
+ * Parse a unsigned hexadecimal number without prefix.
+ * \param[in] s Slice to parse.
+ * \return Parsed value.
+ */
+unsigned long long mp_slice_hex(const mp_slice *s);
+
+/**
+ * Copy a slice to a new null terminated string.
+ * \param[in] s Slice to copy.
+ * \return Newly allocated string.
+ */
+char *mp_slice_strdup(const mp_slice *s);
+
+#endif /* _MP_PROCFILE_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
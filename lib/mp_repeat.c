@@ -0,0 +1,369 @@
+/***
+ * Monitoring Plugin - mp_repeat.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "mp_repeat.h"
+#include "mp_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+int mp_repeat = 0;
+double mp_interval = 1.0;
+sigjmp_buf *mp_result_jmp = NULL;
+char *mp_result_text = NULL;
+
+/** Values of one perfdata label over all samples. */
+struct mp_repeat_series {
+    char *label;        /**< Perfdata label */
+    char *unit;         /**< Unit of the first sample */
+    double *values;     /**< Sample values */
+    int num;            /**< Number of values */
+};
+
+static struct mp_repeat_series *series = NULL;
+static int series_num = 0;
+
+static void mp_repeat_add(const char *label, size_t len, double value,
+        const char *unit, size_t ulen) {
+    int i;
+
+    for (i = 0; i < series_num; i++) {
+        if (strncmp(series[i].label, label, len) == 0 &&
+                series[i].label[len] == '\0')
+            break;
+    }
+
+    if (i == series_num) {
+        series = mp_realloc(series, sizeof(struct mp_repeat_series)*(series_num+1));
+        series[i].label = strndup(label, len);
+        series[i].unit = strndup(unit, ulen);
+        series[i].values = mp_malloc(sizeof(double)*mp_repeat);
+        series[i].num = 0;
+        series_num++;
+    }
+
+    if (series[i].num < mp_repeat)
+        series[i].values[series[i].num++] = value;
+}
+
+/**
+ * Split a perfdata string into label, value and unit and add the values
+ * to the series.
+ */
+static void mp_repeat_collect(const char *perfdata) {
+    const char *p = perfdata;
+    const char *label, *unit;
+    char *eptr;
+    size_t len;
+    double value;
+
+    while (p && *p) {
+        while (*p == ' ')
+            p++;
+        if (*p == '\0')
+            break;
+
+        // Label, quoted or plain
+        if (*p == '\'') {
+            label = ++p;
+            while (*p && *p != '\'')
+                p++;
+            len = p - label;
+            if (*p)
+                p++;
+        } else {
+            label = p;
+            while (*p && *p != '=' && *p != ' ')
+                p++;
+            len = p - label;
+        }
+        if (*p != '=')
+            break;
+        p++;
+
+        value = strtod(p, &eptr);
+        if (eptr != p) {
+            unit = eptr;
+            while (*eptr && *eptr != ';' && *eptr != ' ')
+                eptr++;
+            mp_repeat_add(label, len, value, unit, eptr - unit);
+        }
+
+        p = strchr(eptr, ' ');
+    }
+}
+
+static int mp_repeat_cmp(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+void mp_repeat_reset(void) {
+    mp_state = -1;
+    free(mp_out_ok);
+    mp_out_ok = NULL;
+    free(mp_out_okonly);
+    mp_out_okonly = NULL;
+    free(mp_out_warning);
+    mp_out_warning = NULL;
+    free(mp_out_critical);
+    mp_out_critical = NULL;
+    free(mp_perfdata);
+    mp_perfdata = NULL;
+    free(mp_result_text);
+    mp_result_text = NULL;
+}
+
+/**
+ * Print the result line of the last sample with its perfdata.
+ */
+static void mp_repeat_print(void) {
+    printf("%s", mp_result_text ? mp_result_text : "UNKNOWN - No result from probe.");
+    if (mp_showperfdata && mp_perfdata)
+        printf(" | %s", mp_perfdata);
+    printf("\n");
+}
+
+void mp_repeat_run(mp_probe_func probe, void *data) {
+    sigjmp_buf jmp;
+    struct timeval start, sample;
+    volatile int i;
+    int j, prec, state, worst = STATE_OK;
+    int count[4] = {0, 0, 0, 0};
+    const char *names[] = {"OK", "WARNING", "CRITICAL", "UNKNOWN"};
+    double delay, sum;
+
+    if (mp_repeat < 1) {
+        probe(data);
+        unknown("No result from probe.");
+    }
+
+    mp_result_jmp = &jmp;
+    gettimeofday(&start, NULL);
+
+    for (i = 0; i < mp_repeat; i++) {
+        gettimeofday(&sample, NULL);
+        alarm(mp_timeout);
+
+        state = sigsetjmp(jmp, 1);
+        if (state == 0) {
+            probe(data);
+            state = STATE_UNKNOWN + 1;
+        }
+        alarm(0);
+        state--;
+        mp_repeat_print();
+
+        if (state < STATE_OK || state > STATE_UNKNOWN)
+            state = STATE_UNKNOWN;
+        count[state]++;
+        if (state == STATE_UNKNOWN || (worst != STATE_UNKNOWN && state > worst))
+            worst = state;
+
+        if (mp_verbose > 0)
+            printf(" sample %d took %.3fs\n", i+1, mp_time_delta(sample));
+
+        mp_repeat_collect(mp_perfdata);
+        mp_repeat_reset();
+
+        if (i+1 == mp_repeat)
+            break;
+
+        delay = (i+1) * mp_interval - mp_time_delta(start);
+        if (delay > 0)
+            usleep((useconds_t)(delay * 1000000));
+    }
+    mp_result_jmp = NULL;
+
+    printf("--- %d samples in %.3fs, %d OK, %d WARNING, %d CRITICAL, %d UNKNOWN\n",
+            mp_repeat, mp_time_delta(start),
+            count[STATE_OK], count[STATE_WARNING],
+            count[STATE_CRITICAL], count[STATE_UNKNOWN]);
+
+    for (i = 0; i < series_num; i++) {
+        struct mp_repeat_series *s = &series[i];
+
+        qsort(s->values, s->num, sizeof(double), mp_repeat_cmp);
+        // Integer counters print without decimals
+        for (sum = 0, prec = 0, j = 0; j < s->num; j++) {
+            sum += s->values[j];
+            if (s->values[j] != (long long)s->values[j])
+                prec = 3;
+        }
+        j = (95 * s->num + 99) / 100 - 1;
+
+        printf("%s min/avg/max/p95 = %.*f/%.3f/%.*f/%.*f%s\n", s->label,
+                prec, s->values[0], sum / s->num, prec, s->values[s->num-1],
+                prec, s->values[j < 0 ? 0 : j], s->unit);
+
+        free(s->label);
+        free(s->unit);
+        free(s->values);
+    }
+    free(series);
+
+    printf("%s - worst of %d samples\n", names[worst], mp_repeat);
+    fflush(stdout);
+    mp_stats_record(worst);
+    exit(worst);
+}
+
+/**
+ * Append perfdata to out with each label prefixed by the host name.
+ */
+static void mp_multi_perfdata(char **out, const char *host,
+        const char *perfdata) {
+    const char *p = perfdata;
+    const char *label, *value;
+    char *item;
+    size_t len;
+    int quote;
+
+    while (p && *p) {
+        while (*p == ' ')
+            p++;
+        if (*p == '\0')
+            break;
+
+        // Label, quoted or plain
+        if (*p == '\'') {
+            label = ++p;
+            while (*p && *p != '\'')
+                p++;
+            len = p - label;
+            if (*p)
+                p++;
+        } else {
+            label = p;
+            while (*p && *p != '=' && *p != ' ')
+                p++;
+            len = p - label;
+        }
+        if (*p != '=')
+            break;
+
+        value = p;
+        while (*p && *p != ' ')
+            p++;
+
+        quote = strpbrk(host, " =") || memchr(label, ' ', len) ||
+            memchr(label, '=', len);
+        mp_asprintf(&item, quote ? "'%s_%.*s'%.*s" : "%s_%.*s%.*s", host,
+                (int)len, label, (int)(p - value), value);
+        mp_strcat_space(out, item);
+        free(item);
+    }
+}
+
+void mp_multi_exit(const char * const *hosts, int num, mp_multi_func eval,
+        void *data) {
+    sigjmp_buf jmp;
+    volatile int i;
+    int state, worst = STATE_OK;
+    int count[4] = {0, 0, 0, 0};
+    const char *names[] = {"OK", "WARNING", "CRITICAL", "UNKNOWN"};
+    char *perfdata, *output = NULL, *line;
+
+    // Perfdata added before covers all hosts and keeps its labels
+    perfdata = mp_perfdata;
+    mp_perfdata = NULL;
+
+    mp_result_jmp = &jmp;
+
+    for (i = 0; i < num; i++) {
+        state = sigsetjmp(jmp, 1);
+        if (state == 0) {
+            eval(data, i);
+            state = STATE_UNKNOWN + 1;
+        }
+        state--;
+
+        if (state < STATE_OK || state > STATE_UNKNOWN)
+            state = STATE_UNKNOWN;
+        count[state]++;
+        if (state == STATE_UNKNOWN || (worst != STATE_UNKNOWN && state > worst))
+            worst = state;
+
+        mp_asprintf(&line, "%s%s: %s", output ? "\n" : "", hosts[i],
+                mp_result_text ? mp_result_text : "UNKNOWN - No result from host.");
+        mp_strcat(&output, line);
+        free(line);
+        if (mp_showperfdata)
+            mp_multi_perfdata(&perfdata, hosts[i], mp_perfdata);
+
+        mp_repeat_reset();
+    }
+    mp_result_jmp = NULL;
+
+    // Summary first, the hosts as long output, all perfdata at the end
+    printf("%s - worst of %d hosts, %d OK, %d WARNING, %d CRITICAL, %d UNKNOWN\n",
+            names[worst], num, count[STATE_OK], count[STATE_WARNING],
+            count[STATE_CRITICAL], count[STATE_UNKNOWN]);
+    if (output)
+        printf("%s", output);
+    if (mp_showperfdata && perfdata)
+        printf(" | %s", perfdata);
+    printf("\n");
+    free(output);
+    free(perfdata);
+    fflush(stdout);
+    mp_stats_record(worst);
+    exit(worst);
+}
+
+void getopt_repeat(int c, const char *optarg) {
+    char *eptr;
+
+    switch (c) {
+        case MP_LONGOPT_REPEAT:
+            mp_repeat = (int)strtol(optarg, &eptr, 10);
+            if (*eptr != '\0' || mp_repeat < 1)
+                usage("Illegal repeat count '%s'.", optarg);
+            mp_showperfdata = 1;
+            break;
+        case MP_LONGOPT_INTERVAL:
+            mp_interval = strtod(optarg, &eptr);
+            if (eptr == optarg || mp_interval < 0)
+                usage("Illegal interval '%s'.", optarg);
+            if (strncmp(eptr, "ms", 2) == 0)
+                mp_interval /= 1000;
+            else
+                mp_interval *= parse_time_multiplier_string(eptr);
+            break;
+    }
+}
+
+void print_help_repeat(void) {
+    printf("\
+     --repeat=COUNT\n\
+      Run the check COUNT times in-process and print a summary.\n\
+     --interval=DURATION\n\
+      Time between repeated checks. (e.g. 500ms, 2s, 1m) Defaults to 1s.\n");
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,106 @@
+/***
+ * Monitoring Plugin - mp_repeat.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _MP_REPEAT_H_
+#define _MP_REPEAT_H_
+
+#include <setjmp.h>
+
+/** Number of in-process samples, 0 for a normal single run. */
+extern int mp_repeat;
+/** Seconds from the start of one sample to the start of the next. */
+extern double mp_interval;
+/** Jump target for the non-exiting result path, see \ref mp_repeat_run. */
+extern sigjmp_buf *mp_result_jmp;
+/** Result line of the last jump to \ref mp_result_jmp, without perfdata. */
+extern char *mp_result_text;
+
+/**
+ * Probe function prototype.
+ * The probe must end with one of the result functions like \ref ok,
+ * \ref critical or \ref mp_exit. In repeat mode they siglongjmp back to
+ * \ref mp_repeat_run, so before calling one the probe has to free or
+ * close everything it got for this sample, and never call one from
+ * within a library call like a libcurl or net-snmp callback. Anything
+ * kept between samples belongs in data. The curl and SNMP plugins do
+ * not meet this and must not offer --repeat.
+ * \param[in] data Plugin specific data kept between samples.
+ */
+typedef void (*mp_probe_func)(void *data);
+
+/**
+ * Run the probe once, or mp_repeat times every mp_interval seconds.
+ * In repeat mode every sample's status line and perfdata is printed,
+ * followed by a min/avg/max/p95 summary. Exits with the worst state.
+ * \param[in] probe Probe function.
+ * \param[in] data Data passed to probe.
+ */
+void mp_repeat_run(mp_probe_func probe, void *data) __attribute__((__noreturn__));
+
+/**
+ * Clear the global result state for the next run of a probe.
+ */
+void mp_repeat_reset(void);
+
+/**
+ * Evaluate function prototype of one host of a multi host run.
+ * Must end with one of the result functions like \ref ok or \ref mp_exit,
+ * which siglongjmp back like for a \ref mp_probe_func. Runs after all
+ * transfers finished, so no library call is in progress.
+ * \param[in] data Data passed to \ref mp_multi_exit.
+ * \param[in] i Index of the host.
+ */
+typedef void (*mp_multi_func)(void *data, int i);
+
+/**
+ * Evaluate every host and exit with the worst state.
+ * Prints a summary line first and one line per host as long output.
+ * The perfdata of all hosts follows at the end, each label prefixed with
+ * the host name. Perfdata set before the call is kept as is.
+ * \param[in] hosts Host names.
+ * \param[in] num Number of hosts.
+ * \param[in] eval Evaluate function.
+ * \param[in] data Data passed to eval.
+ */
+void mp_multi_exit(const char * const *hosts, int num, mp_multi_func eval,
+        void *data) __attribute__((__noreturn__));
+
+/**
+ * Parse the option for repeat and interval.
+ * \param[in] c commantline switch
+ * \param[in] optarg option argument
+ */
+void getopt_repeat(int c, const char *optarg);
+
+/**
+ * Print the help for the repeat and interval options.
+ */
+void print_help_repeat(void);
+
+/** longopts option for repeat, only for plugins with a \ref mp_probe_func */
+#define MP_LONGOPTS_REPEAT  {"repeat", required_argument, NULL, (int)MP_LONGOPT_REPEAT}, \
+                            {"interval", required_argument, NULL, (int)MP_LONGOPT_INTERVAL}
+
+#endif /* _MP_REPEAT_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
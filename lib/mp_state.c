@@ -0,0 +1,413 @@
+/***
+ * Monitoring Plugin - mp_state.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "mp_state.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+/**
+ * The state store is a open-addressing hash table in a mmap'd file.
+ * Slots are claimed by CAS on the key, values are protected by a
+ * per slot sequence lock so readers never block.
+ */
+
+/** State store magic "MPSTATE1" */
+#define MP_STATE_MAGIC      0x314554415453504DULL
+/** Spin count after which a odd sequence is considered stale. */
+#define MP_STATE_SPIN       1024
+
+struct mp_state_header {
+    uint64_t magic;             /**< File magic */
+    uint32_t bits;              /**< Hash bits, slots = 1 << bits */
+    uint32_t entry_size;        /**< sizeof(struct mp_state_entry) */
+    uint64_t used;              /**< Claimed slots */
+    uint64_t reserved[5];
+};
+
+struct mp_state_entry {
+    uint64_t key;               /**< Key hash, 0 is free */
+    uint64_t check;             /**< Second key hash, never 0 */
+    uint64_t seq;               /**< Sequence lock, odd while writing */
+    uint64_t value;             /**< Last value */
+    int64_t  time;              /**< Last timestamp in usec */
+};
+
+const char *mp_state_file = MP_STATE_FILE;
+
+static struct mp_state_header *mp_state_map = NULL;
+static size_t mp_state_size = 0;
+
+/* Local functions */
+static int mp_state_mkdir(const char *file);
+static void mp_state_hash(const char *target, const char *label,
+        uint64_t *key, uint64_t *check);
+static struct mp_state_entry *mp_state_lookup(const char *target,
+        const char *label, int create);
+static void mp_state_lock(struct mp_state_entry *e, uint64_t *seq);
+static int64_t mp_state_now(void);
+
+int mp_state_open(void) {
+    struct stat st;
+    struct mp_state_header head;
+    size_t size;
+    int fd;
+
+    if (mp_state_map)
+        return OK;
+
+    fd = open(mp_state_file, O_RDWR | O_CREAT, 0664);
+    if (fd < 0 && errno == ENOENT) {
+        if (mp_state_mkdir(mp_state_file) != OK)
+            return ERROR;
+        fd = open(mp_state_file, O_RDWR | O_CREAT, 0664);
+    }
+    if (fd < 0) {
+        if (mp_verbose > 0)
+            printf("Can't open state %s: %s\n", mp_state_file,
+                    strerror(errno));
+        return ERROR;
+    }
+
+    /* Initialize a new store exclusive. */
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &st) != 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return ERROR;
+    }
+    if (st.st_size == 0) {
+        memset(&head, 0, sizeof(head));
+        head.magic = MP_STATE_MAGIC;
+        head.bits = MP_STATE_BITS;
+        head.entry_size = sizeof(struct mp_state_entry);
+        size = sizeof(head) + (sizeof(struct mp_state_entry) << head.bits);
+        if (ftruncate(fd, size) != 0 ||
+                pwrite(fd, &head, sizeof(head), 0) != sizeof(head)) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return ERROR;
+        }
+    } else if (pread(fd, &head, sizeof(head), 0) != sizeof(head)) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return ERROR;
+    }
+    flock(fd, LOCK_UN);
+
+    size = sizeof(head) + (sizeof(struct mp_state_entry) << head.bits);
+    if (head.magic != MP_STATE_MAGIC || head.bits > 32 ||
+            head.entry_size != sizeof(struct mp_state_entry) ||
+            (fstat(fd, &st) == 0 && (size_t)st.st_size < size)) {
+        if (mp_verbose > 0)
+            printf("Invalid state %s\n", mp_state_file);
+        close(fd);
+        return ERROR;
+    }
+
+    mp_state_map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+    close(fd);
+    if (mp_state_map == MAP_FAILED) {
+        mp_state_map = NULL;
+        return ERROR;
+    }
+    mp_state_size = size;
+
+    return OK;
+}
+
+void mp_state_close(void) {
+    if (!mp_state_map)
+        return;
+    munmap(mp_state_map, mp_state_size);
+    mp_state_map = NULL;
+    mp_state_size = 0;
+}
+
+int mp_state_get(const char *target, const char *label,
+        uint64_t *value, double *time) {
+    struct mp_state_entry *e;
+    uint64_t seq;
+    uint64_t v;
+    int64_t t;
+    int i;
+
+    e = mp_state_lookup(target, label, 0);
+    if (!e)
+        return ERROR;
+
+    for (i = 0; i < MP_STATE_SPIN; i++) {
+        seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        v = __atomic_load_n(&e->value, __ATOMIC_RELAXED);
+        t = __atomic_load_n(&e->time, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&e->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+        if (t == 0)
+            return ERROR;
+        *value = v;
+        *time = (double)t / 1000000.0;
+        return OK;
+    }
+
+    return ERROR;
+}
+
+int mp_state_set(const char *target, const char *label,
+        uint64_t value, double time) {
+    struct mp_state_entry *e;
+    uint64_t seq;
+
+    e = mp_state_lookup(target, label, 1);
+    if (!e)
+        return ERROR;
+
+    mp_state_lock(e, &seq);
+    __atomic_store_n(&e->value, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&e->time, (int64_t)(time * 1000000.0), __ATOMIC_RELAXED);
+    __atomic_store_n(&e->seq, seq + 1, __ATOMIC_RELEASE);
+
+    return OK;
+}
+
+int mp_state_delta(const char *target, const char *label, uint64_t value,
+        int width, uint64_t *delta, double *interval) {
+    struct mp_state_entry *e;
+    uint64_t seq;
+    uint64_t last;
+    uint64_t max;
+    int64_t last_time;
+    int64_t now;
+
+    e = mp_state_lookup(target, label, 1);
+    if (!e)
+        return ERROR;
+
+    now = mp_state_now();
+
+    /* Swap old and new sample within one write section. */
+    mp_state_lock(e, &seq);
+    last = __atomic_load_n(&e->value, __ATOMIC_RELAXED);
+    last_time = __atomic_load_n(&e->time, __ATOMIC_RELAXED);
+    __atomic_store_n(&e->value, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&e->time, now, __ATOMIC_RELAXED);
+    __atomic_store_n(&e->seq, seq + 1, __ATOMIC_RELEASE);
+
+    if (last_time == 0 || now <= last_time)
+        return ERROR;
+
+    max = (width > 0 && width < 64) ? ((uint64_t)1 << width) - 1 : UINT64_MAX;
+
+    if (value >= last) {
+        *delta = value - last;
+    } else if (last > max) {
+        return ERROR;
+    } else {
+        /* A wrap can only advance less than half the counter range. */
+        *delta = (max - last) + value + 1;
+        if (*delta > max / 2) {
+            if (mp_verbose > 1)
+                printf("Counter %s reset.\n", label);
+            return ERROR;
+        }
+    }
+    *interval = (double)(now - last_time) / 1000000.0;
+
+    return OK;
+}
+
+int mp_state_rate(const char *target, const char *label, uint64_t value,
+        int width, double *rate) {
+    uint64_t delta;
+    double interval;
+
+    if (mp_state_delta(target, label, value, width, &delta, &interval) != OK)
+        return ERROR;
+
+    *rate = (double)delta / interval;
+
+    return OK;
+}
+
+/* Create all missing directories of file, like mkdir -p. */
+static int mp_state_mkdir(const char *file) {
+    char *dir = mp_strdup(file);
+    char *p;
+
+    for (p = strchr(dir + 1, '/'); p; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        if (mkdir(dir, 0775) != 0 && errno != EEXIST) {
+            if (mp_verbose > 0)
+                printf("Can't create state dir %s: %s\n", dir,
+                        strerror(errno));
+            free(dir);
+            return ERROR;
+        }
+        *p = '/';
+    }
+    free(dir);
+
+    return OK;
+}
+
+static void mp_state_hash(const char *target, const char *label,
+        uint64_t *key, uint64_t *check) {
+    const char *parts[3];
+    const unsigned char *p;
+    uint64_t h1 = 0xcbf29ce484222325ULL;
+    uint64_t h2 = 0x84222325cbf29ce4ULL;
+    int i;
+
+    parts[0] = progname;
+    parts[1] = target ? target : "";
+    parts[2] = label;
+
+    /* FNV-1a for the slot, a second seed for the check. */
+    for (i = 0; i < 3; i++) {
+        for (p = (const unsigned char *)parts[i]; ; p++) {
+            h1 = (h1 ^ *p) * 0x100000001b3ULL;
+            h2 = (h2 ^ *p) * 0x100000001b3ULL;
+            if (*p == '\0')
+                break;
+        }
+    }
+
+    /* splitmix64 finalizer to decorrelate the check. */
+    h2 ^= h2 >> 30;
+    h2 *= 0xbf58476d1ce4e5b9ULL;
+    h2 ^= h2 >> 27;
+    h2 *= 0x94d049bb133111ebULL;
+    h2 ^= h2 >> 31;
+
+    *key = h1 ? h1 : 1;
+    *check = h2 ? h2 : 1;
+}
+
+static struct mp_state_entry *mp_state_lookup(const char *target,
+        const char *label, int create) {
+    struct mp_state_entry *slots;
+    struct mp_state_entry *e;
+    uint64_t key, check, cur;
+    uint64_t mask;
+    int i, spin;
+
+    if (mp_state_open() != OK)
+        return NULL;
+
+    mp_state_hash(target, label, &key, &check);
+
+    slots = (struct mp_state_entry *)(mp_state_map + 1);
+    mask = ((uint64_t)1 << mp_state_map->bits) - 1;
+
+    for (i = 0; i < MP_STATE_PROBE; i++) {
+        e = &slots[(key + i) & mask];
+        cur = __atomic_load_n(&e->key, __ATOMIC_ACQUIRE);
+
+        if (cur == 0) {
+            if (!create)
+                return NULL;
+            if (!__atomic_compare_exchange_n(&e->key, &cur, key, 0,
+                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                /* Lost the race, look again at what won. */
+                if (cur != key)
+                    continue;
+            } else {
+                __atomic_store_n(&e->check, check, __ATOMIC_RELEASE);
+                __atomic_add_fetch(&mp_state_map->used, 1, __ATOMIC_RELAXED);
+                return e;
+            }
+        }
+
+        if (cur != key)
+            continue;
+
+        /* Slot may just be claimed, wait for the check to appear. */
+        for (spin = 0; spin < MP_STATE_SPIN; spin++) {
+            cur = __atomic_load_n(&e->check, __ATOMIC_ACQUIRE);
+            if (cur)
+                break;
+            sched_yield();
+        }
+        if (cur == check)
+            return e;
+    }
+
+    if (create && mp_verbose > 0)
+        printf("State store %s full.\n", mp_state_file);
+
+    return NULL;
+}
+
+static void mp_state_lock(struct mp_state_entry *e, uint64_t *seq) {
+    uint64_t cur;
+    int spin = 0;
+
+    cur = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+    for (;;) {
+        if (cur & 1) {
+            /* A writer holding the lock for that long died. */
+            if (++spin < MP_STATE_SPIN) {
+                sched_yield();
+                cur = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+                continue;
+            }
+            if (__atomic_compare_exchange_n(&e->seq, &cur, cur + 2, 0,
+                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                *seq = cur + 2;
+                break;
+            }
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&e->seq, &cur, cur + 1, 0,
+                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            *seq = cur + 1;
+            break;
+        }
+    }
+    /* Odd sequence must be visible before the data changes. */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static int64_t mp_state_now(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,120 @@
+/***
+ * Monitoring Plugin - mp_state.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _MP_STATE_H_
+#define _MP_STATE_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+
+#ifndef MP_STATEDIR
+#define MP_STATEDIR "/var/lib/monitoringplug"
+#endif
+
+/** Default state store file. */
+#define MP_STATE_FILE       MP_STATEDIR "/state.db"
+/** Number of hash bits of a new state store. (4M slots, sparse file) */
+#define MP_STATE_BITS       22
+/** Max linear probe length before a lookup gives up. */
+#define MP_STATE_PROBE      64
+
+/** Holds the path of the state store file. */
+extern const char *mp_state_file;
+
+/**
+ * Helper enum for counter width.
+ */
+enum {
+    MP_COUNTER32 = 32,          /**< 32-bit counter, wraps at 2^32 */
+    MP_COUNTER64 = 64           /**< 64-bit counter, wraps at 2^64 */
+};
+
+/**
+ * Open and map the state store. Create it and its missing directories
+ * if missing.
+ * Called implicit by the other mp_state_ functions.
+ * \return \ref OK or \ref ERROR.
+ */
+int mp_state_open(void);
+
+/**
+ * Unmap and close the state store.
+ */
+void mp_state_close(void);
+
+/**
+ * Read a stored sample without locking.
+ * \param[in] target Target (host) the sample belongs to, may be NULL.
+ * \param[in] label Label of the sample.
+ * \param[out] value Stored value.
+ * \param[out] time Stored timestamp in seconds.
+ * \return \ref OK if found, \ref ERROR otherwise.
+ */
+int mp_state_get(const char *target, const char *label,
+        uint64_t *value, double *time);
+
+/**
+ * Store a sample.
+ * \param[in] target Target (host) the sample belongs to, may be NULL.
+ * \param[in] label Label of the sample.
+ * \param[in] value Value to store.
+ * \param[in] time Timestamp in seconds.
+ * \return \ref OK or \ref ERROR.
+ */
+int mp_state_set(const char *target, const char *label,
+        uint64_t value, double time);
+
+/**
+ * Store a counter sample and return the difference to the previous one.
+ * Counter wraps are detected according to width, larger drops are
+ * treated as counter reset.
+ * \param[in] target Target (host) the counter belongs to, may be NULL.
+ * \param[in] label Label of the counter.
+ * \param[in] value Current counter value.
+ * \param[in] width Counter width, \ref MP_COUNTER32 or \ref MP_COUNTER64.
+ * \param[out] delta Counter increase since last sample.
+ * \param[out] interval Seconds since last sample.
+ * \return \ref OK if delta is valid, \ref ERROR on first sample or reset.
+ */
+int mp_state_delta(const char *target, const char *label, uint64_t value,
+        int width, uint64_t *delta, double *interval);
+
+/**
+ * Store a counter sample and return the per-second rate since the
+ * previous one.
+ * \param[in] target Target (host) the counter belongs to, may be NULL.
+ * \param[in] label Label of the counter.
+ * \param[in] value Current counter value.
+ * \param[in] width Counter width, \ref MP_COUNTER32 or \ref MP_COUNTER64.
+ * \param[out] rate Per second rate.
+ * \return \ref OK if rate is valid, \ref ERROR on first sample or reset.
+ */
+int mp_state_rate(const char *target, const char *label, uint64_t value,
+        int width, double *rate);
+
+#endif /* _MP_STATE_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,266 @@
+/***
+ * Monitoring Plugin - mp_stats.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "mp_stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+/**
+ * The stats file is a fixed size table of plugin slots in a mmap'd
+ * file. Slots are claimed by CAS on the name hash, counters are only
+ * ever changed by atomic adds so concurrent plugins need no lock.
+ */
+
+/** Stats file magic "MPSTATS1" */
+#define MP_STATS_MAGIC      0x315354415453504DULL
+
+struct mp_stats_header {
+    uint64_t magic;             /**< File magic */
+    uint32_t slots;             /**< Number of slots */
+    uint32_t entry_size;        /**< sizeof(struct mp_stats_entry) */
+    uint64_t created;           /**< Creation time in seconds */
+    uint64_t reserved[5];
+};
+
+const char *mp_stats_file = MP_STATS_FILE;
+int mp_stats_timeout = 0;
+
+static struct mp_stats_header *mp_stats_map = NULL;
+static size_t mp_stats_size = 0;
+static struct timeval mp_stats_start;
+
+/* Local functions */
+static void mp_stats_init(void) __attribute__((constructor));
+static struct mp_stats_entry *mp_stats_lookup(const char *name);
+
+static void mp_stats_init(void) {
+    gettimeofday(&mp_stats_start, NULL);
+}
+
+int mp_stats_open(int create) {
+    struct mp_stats_header head;
+    struct stat st;
+    const char *file;
+    size_t size;
+    int fd;
+
+    if (mp_stats_map)
+        return OK;
+
+    /* Environment overrides the default, not a set file. */
+    file = getenv("MP_STATS_FILE");
+    if (file && *file && strcmp(mp_stats_file, MP_STATS_FILE) == 0)
+        mp_stats_file = file;
+
+    size = sizeof(head) + sizeof(struct mp_stats_entry) * MP_STATS_SLOTS;
+
+    fd = open(mp_stats_file, create ? O_RDWR | O_CREAT : O_RDWR, 0664);
+    if (fd < 0 && create && errno == ENOENT) {
+        char *dir = mp_strdup(mp_stats_file);
+        char *p = strrchr(dir, '/');
+        if (p && p != dir) {
+            *p = '\0';
+            mkdir(dir, 0775);
+        }
+        free(dir);
+        fd = open(mp_stats_file, O_RDWR | O_CREAT, 0664);
+    }
+    if (fd < 0) {
+        if (mp_verbose > 1)
+            printf("Can't open stats %s: %s\n", mp_stats_file,
+                    strerror(errno));
+        return ERROR;
+    }
+
+    /* Initialize a new file exclusive. */
+    if (create) {
+        flock(fd, LOCK_EX);
+        if (fstat(fd, &st) == 0 && st.st_size == 0) {
+            memset(&head, 0, sizeof(head));
+            head.magic = MP_STATS_MAGIC;
+            head.slots = MP_STATS_SLOTS;
+            head.entry_size = sizeof(struct mp_stats_entry);
+            head.created = time(NULL);
+            if (ftruncate(fd, size) != 0 ||
+                    pwrite(fd, &head, sizeof(head), 0) != sizeof(head)) {
+                flock(fd, LOCK_UN);
+                close(fd);
+                return ERROR;
+            }
+        }
+        flock(fd, LOCK_UN);
+    }
+
+    if (pread(fd, &head, sizeof(head), 0) != sizeof(head) ||
+            head.magic != MP_STATS_MAGIC || head.slots != MP_STATS_SLOTS ||
+            head.entry_size != sizeof(struct mp_stats_entry) ||
+            fstat(fd, &st) != 0 || (size_t)st.st_size < size) {
+        if (mp_verbose > 0)
+            printf("Invalid stats %s\n", mp_stats_file);
+        close(fd);
+        return ERROR;
+    }
+
+    mp_stats_map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+    close(fd);
+    if (mp_stats_map == MAP_FAILED) {
+        mp_stats_map = NULL;
+        return ERROR;
+    }
+    mp_stats_size = size;
+
+    return OK;
+}
+
+void mp_stats_close(void) {
+    if (!mp_stats_map)
+        return;
+    munmap(mp_stats_map, mp_stats_size);
+    mp_stats_map = NULL;
+    mp_stats_size = 0;
+}
+
+void mp_stats_record(int state) {
+    struct mp_stats_entry *e;
+    struct rusage self, children;
+    uint64_t wall, cpu, rss, cur;
+    int opened = (mp_stats_map == NULL);
+
+    if (mp_stats_open(0) != OK)
+        return;
+
+    e = mp_stats_lookup(progname);
+    if (!e) {
+        if (opened)
+            mp_stats_close();
+        return;
+    }
+
+    wall = (uint64_t)(mp_time_delta(mp_stats_start) * 1000000.0);
+
+    /* Count subprocesses like check_by_ssh to the plugin. */
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    cpu = (uint64_t)(self.ru_utime.tv_sec + self.ru_stime.tv_sec +
+            children.ru_utime.tv_sec + children.ru_stime.tv_sec) * 1000000 +
+        self.ru_utime.tv_usec + self.ru_stime.tv_usec +
+        children.ru_utime.tv_usec + children.ru_stime.tv_usec;
+    rss = self.ru_maxrss > children.ru_maxrss ?
+        self.ru_maxrss : children.ru_maxrss;
+
+    if (state < STATE_OK || state > STATE_UNKNOWN)
+        state = STATE_UNKNOWN;
+
+    __atomic_add_fetch(&e->runs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&e->state[state], 1, __ATOMIC_RELAXED);
+    if (mp_stats_timeout)
+        __atomic_add_fetch(&e->timeouts, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&e->wall_usec, wall, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&e->cpu_usec, cpu, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&e->wall[mp_stats_bucket(wall)], 1, __ATOMIC_RELAXED);
+
+    cur = __atomic_load_n(&e->maxrss, __ATOMIC_RELAXED);
+    while (rss > cur && !__atomic_compare_exchange_n(&e->maxrss, &cur, rss,
+                1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    if (opened)
+        mp_stats_close();
+}
+
+struct mp_stats_entry *mp_stats_entries(int *num) {
+    if (!mp_stats_map)
+        return NULL;
+    *num = mp_stats_map->slots;
+    return (struct mp_stats_entry *)(mp_stats_map + 1);
+}
+
+int mp_stats_bucket(uint64_t usec) {
+    int i;
+
+    for (i = 0; i < MP_STATS_BUCKETS - 1; i++) {
+        if (usec <= (uint64_t)1000 << i)
+            return i;
+    }
+    return MP_STATS_BUCKETS - 1;
+}
+
+double mp_stats_bucket_le(int bucket) {
+    if (bucket >= MP_STATS_BUCKETS - 1)
+        return -1;
+    return (double)((uint64_t)1 << bucket) / 1000.0;
+}
+
+static struct mp_stats_entry *mp_stats_lookup(const char *name) {
+    struct mp_stats_entry *slots;
+    struct mp_stats_entry *e;
+    const unsigned char *p;
+    uint64_t key = 0xcbf29ce484222325ULL;
+    uint64_t cur;
+    int i;
+
+    for (p = (const unsigned char *)name; *p; p++)
+        key = (key ^ *p) * 0x100000001b3ULL;
+    if (key == 0)
+        key = 1;
+
+    slots = (struct mp_stats_entry *)(mp_stats_map + 1);
+
+    for (i = 0; i < MP_STATS_SLOTS; i++) {
+        e = &slots[(key + i) % MP_STATS_SLOTS];
+        cur = __atomic_load_n(&e->key, __ATOMIC_ACQUIRE);
+
+        if (cur == 0) {
+            if (__atomic_compare_exchange_n(&e->key, &cur, key, 0,
+                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                strncpy(e->name, name, MP_STATS_NAMELEN - 1);
+                __atomic_store_n(&e->ready, 1, __ATOMIC_RELEASE);
+                return e;
+            }
+            /* Lost the race, look again at what won. */
+        }
+
+        if (cur == key)
+            return e;
+    }
+
+    if (mp_verbose > 0)
+        printf("Stats %s full.\n", mp_stats_file);
+
+    return NULL;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,109 @@
+/***
+ * Monitoring Plugin - mp_stats.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _MP_STATS_H_
+#define _MP_STATS_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+
+#ifndef MP_STATEDIR
+#define MP_STATEDIR "/var/lib/monitoringplug"
+#endif
+
+/** Default stats file. Runs are only recorded if it exists. */
+#define MP_STATS_FILE       MP_STATEDIR "/stats.db"
+/** Number of plugin slots in the stats file. */
+#define MP_STATS_SLOTS      256
+/** Max length of a plugin name including the terminating null. */
+#define MP_STATS_NAMELEN    48
+/** Wall time histogram buckets, bucket i counts runs <= 2^i ms, last is +Inf. */
+#define MP_STATS_BUCKETS    24
+
+/** Holds the path of the stats file. */
+extern const char *mp_stats_file;
+/** Set if the plugin deadline fired. */
+extern int mp_stats_timeout;
+
+/**
+ * Per plugin counters. All fields are updated with atomic adds.
+ */
+struct mp_stats_entry {
+    uint64_t key;                       /**< Name hash, 0 is free */
+    uint64_t ready;                     /**< Set once name is written */
+    char name[MP_STATS_NAMELEN];        /**< Plugin name */
+    uint64_t runs;                      /**< Recorded runs */
+    uint64_t state[4];                  /**< Runs per exit state */
+    uint64_t timeouts;                  /**< Runs the deadline fired */
+    uint64_t wall_usec;                 /**< Sum of wall time */
+    uint64_t cpu_usec;                  /**< Sum of user and system time */
+    uint64_t maxrss;                    /**< Largest max RSS in kB */
+    uint64_t wall[MP_STATS_BUCKETS];    /**< Wall time histogram */
+};
+
+/**
+ * Open and map the stats file.
+ * \param[in] create Create the file if missing.
+ * \return \ref OK or \ref ERROR.
+ */
+int mp_stats_open(int create);
+
+/**
+ * Unmap the stats file.
+ */
+void mp_stats_close(void);
+
+/**
+ * Record the current run of progname with its exit state.
+ * Does nothing if the stats file does not exist.
+ * \param[in] state Exit state of the plugin.
+ */
+void mp_stats_record(int state);
+
+/**
+ * Return the slot array of the mapped stats file.
+ * \param[out] num Number of slots.
+ * \return Slot array or NULL if not open.
+ */
+struct mp_stats_entry *mp_stats_entries(int *num);
+
+/**
+ * Return the histogram bucket of a wall time.
+ * \param[in] usec Wall time in microseconds.
+ * \return Bucket index.
+ */
+int mp_stats_bucket(uint64_t usec);
+
+/**
+ * Return the upper bound of a histogram bucket.
+ * \param[in] bucket Bucket index.
+ * \return Upper bound in seconds, -1 for +Inf.
+ */
+double mp_stats_bucket_le(int bucket);
+
+#endif /* _MP_STATS_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
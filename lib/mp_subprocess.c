@@ -32,6 +32,7 @@
 
 #include "mp_subprocess.h"
 #include "mp_common.h"
+#include "mp_stats.h"
 
 /* Type of a signal handler.  */
 typedef void (*sighandler_t) (int);
@@ -130,6 +131,7 @@ int mp_subprocess_close(mp_subprocess_t *subprocess) {
 
 void subprocess_timeout_alarm_handler(int signo) {
     if (signo == SIGALRM) {
+        mp_stats_timeout = 1;
         critical("Plugin timed out in subprocess after %d seconds\n", mp_timeout);
     }
 }
@@ -0,0 +1,514 @@
+/***
+ * Monitoring Plugin - snmp_async.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "mp_repeat.h"
+#include "snmp_async.h"
+#include "snmp_replay.h"
+#include "snmp_stats.h"
+#include "snmp_v3cache.h"
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+int mp_snmp_async_window = MP_SNMP_ASYNC_WINDOW;
+char **mp_snmp_hosts = NULL;
+int mp_snmp_hosts_num = 0;
+
+/** Queued or running request of an agent. */
+struct mp_snmp_request {
+    /** Next queued request */
+    struct mp_snmp_request *next;
+    /** Agent the request belongs to */
+    mp_snmp_agent *agent;
+    /** First GET of the request or NULL for a walk */
+    const mp_snmp_query_cmd *querycmd;
+    /** Number of GETs in the request */
+    size_t count;
+    /** Walk result */
+    mp_snmp_subtree *subtree;
+    /** Walk start OID */
+    oid subtree_oid[MAX_OID_LEN];
+    /** Size of subtree_oid */
+    size_t subtree_len;
+    /** Last OID fetched by the walk */
+    oid last_oid[MAX_OID_LEN];
+    /** Size of last_oid */
+    size_t last_len;
+    /** Send time for --snmp-stats */
+    struct timeval sent;
+};
+
+/** Requests queued or in flight over all agents. */
+static int mp_snmp_async_pending = 0;
+/** Open agent sessions. */
+static int mp_snmp_async_agents = 0;
+
+static void mp_snmp_async_pump(mp_snmp_agent *agent);
+static void mp_snmp_async_slice(mp_snmp_agent *agent,
+                                const mp_snmp_query_cmd *querycmd,
+                                size_t count);
+static int mp_snmp_async_cb(int operation, netsnmp_session *sp, int reqid,
+                            netsnmp_pdu *pdu, void *magic);
+
+/**
+ * Send a request over the network or to the replay fixture.
+ */
+static int mp_snmp_async_send(netsnmp_session *ss, netsnmp_pdu *pdu,
+                              struct mp_snmp_request *req) {
+    if (mp_snmp_stats_enabled)
+        mp_snmp_stats_request(ss, pdu, &req->sent);
+    if (mp_snmp_replay_active())
+        return mp_snmp_replay_send(ss, pdu, mp_snmp_async_cb, req);
+    return snmp_async_send(ss, pdu, mp_snmp_async_cb, req);
+}
+
+
+/**
+ * Mark an agent failed. Only the first error is kept.
+ */
+static void mp_snmp_async_fail(mp_snmp_agent *agent, int status,
+                               const char *error) {
+    if (agent->status != STAT_SUCCESS)
+        return;
+
+    agent->status = status;
+    agent->error = mp_strdup(error);
+
+    if (mp_verbose > 1)
+        printf("%s: %s\n", agent->host, error);
+}
+
+/**
+ * Expected BER size of the answer varbind of a GET.
+ * Strings without a target size are guessed.
+ */
+static size_t mp_snmp_async_varsize(const mp_snmp_query_cmd *p) {
+    size_t size = 6 + mp_snmp_oid_size(p->oid, p->oid_len);
+
+    switch (p->type) {
+        case ASN_COUNTER64:
+            return size + 11;
+        case ASN_OCTET_STR:
+            return size + 3 + (p->target_len ? p->target_len : 64);
+        case ASN_OBJECT_ID:
+            return size + 3 + MAX_OID_LEN;
+        default:
+            return size + 6;
+    }
+}
+
+/**
+ * Bytes a request of a session has for varbinds.
+ */
+static size_t mp_snmp_async_msgmax(const netsnmp_session *ss) {
+    size_t max = MP_SNMP_MSGMAX;
+    size_t head = mp_snmp_head_size(ss);
+
+    if (ss->sndMsgMaxSize > 0 && (size_t) ss->sndMsgMaxSize < max)
+        max = ss->sndMsgMaxSize;
+    if (ss->rcvMsgMaxSize > 0 && (size_t) ss->rcvMsgMaxSize < max)
+        max = ss->rcvMsgMaxSize;
+
+    return max > 2 * head ? max - head : head;
+}
+
+/**
+ * Build the GET request of a request.
+ */
+static netsnmp_pdu *mp_snmp_async_query_pdu(const struct mp_snmp_request *req) {
+    netsnmp_pdu *pdu;
+    size_t i;
+
+    pdu = snmp_pdu_create(SNMP_MSG_GET);
+    for (i = 0; i < req->count; i++)
+        snmp_add_null_var(pdu, req->querycmd[i].oid, req->querycmd[i].oid_len);
+
+    return pdu;
+}
+
+/**
+ * Process the answer of a GET request.
+ */
+static void mp_snmp_async_query_answer(struct mp_snmp_request *req,
+                                       const netsnmp_pdu *pdu) {
+    mp_snmp_agent *agent = req->agent;
+    size_t half;
+    long idx = pdu->errindex;
+
+    if (pdu->errstat == SNMP_ERR_NOERROR) {
+        mp_snmp_query_copy(req->querycmd, pdu);
+        return;
+    }
+
+    if (mp_verbose > 2)
+        printf("%s: %s at %ld of %zu varbinds\n", agent->host,
+               snmp_errstring(pdu->errstat), idx, req->count);
+
+    /* Split the request, a single varbind can't be answered at all */
+    if (pdu->errstat == SNMP_ERR_TOOBIG) {
+        if (req->count < 2) {
+            mp_snmp_async_fail(agent, STAT_ERROR,
+                               snmp_errstring(pdu->errstat));
+            return;
+        }
+        half = req->count / 2;
+        mp_snmp_async_slice(agent, req->querycmd, half);
+        mp_snmp_async_slice(agent, req->querycmd + half, req->count - half);
+        return;
+    }
+
+    if (idx < 1 || (size_t) idx > req->count) {
+        mp_snmp_async_fail(agent, STAT_ERROR, snmp_errstring(pdu->errstat));
+        return;
+    }
+
+    /* Resend the varbinds around the failed one */
+    if (idx > 1)
+        mp_snmp_async_slice(agent, req->querycmd, idx - 1);
+    if ((size_t) idx < req->count)
+        mp_snmp_async_slice(agent, req->querycmd + idx, req->count - idx);
+}
+
+/**
+ * Finish a request and hand its slot to the next queued one.
+ */
+static void mp_snmp_async_done(struct mp_snmp_request *req) {
+    mp_snmp_agent *agent = req->agent;
+
+    agent->outstanding--;
+    mp_snmp_async_pending--;
+    free(req);
+
+    mp_snmp_async_pump(agent);
+}
+
+/**
+ * Net-SNMP response callback.
+ */
+static int mp_snmp_async_cb(int operation, netsnmp_session *sp, int reqid,
+                            netsnmp_pdu *pdu, void *magic) {
+    struct mp_snmp_request *req = (struct mp_snmp_request *) magic;
+    mp_snmp_agent *agent = req->agent;
+    netsnmp_pdu *next = NULL;
+    int more;
+
+    if (operation == NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE)
+        mp_snmp_record(sp, pdu);
+    if (mp_snmp_stats_enabled)
+        mp_snmp_stats_response(sp,
+                operation == NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE ? pdu : NULL,
+                &req->sent);
+
+    if (operation != NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE) {
+        mp_snmp_async_fail(agent, STAT_TIMEOUT, "Timeout");
+    } else if (req->querycmd) {
+        mp_snmp_async_query_answer(req, pdu);
+    } else {
+        more = mp_snmp_subtree_response(sp, pdu, req->subtree_oid,
+                                        req->subtree_len, req->last_oid,
+                                        &req->last_len, req->subtree);
+        /* The pdu belongs to net-snmp, only this agent fails */
+        if (more > 0)
+            next = mp_snmp_subtree_pdu(sp, req->last_oid, req->last_len);
+        else if (more == -2)
+            mp_snmp_async_fail(agent, STAT_ERROR, "OIDs are not increasing");
+        else if (more < 0)
+            mp_snmp_async_fail(agent, STAT_ERROR,
+                               snmp_errstring(pdu->errstat));
+    }
+
+    if (next) {
+        if (mp_snmp_async_send(sp, next, req))
+            return 1;
+        snmp_free_pdu(next);
+        mp_snmp_async_fail(agent, STAT_ERROR,
+                           snmp_api_errstring(sp->s_snmp_errno));
+    }
+
+    mp_snmp_async_done(req);
+    return 1;
+}
+
+/**
+ * Send queued requests of agent while it has free slots.
+ */
+static void mp_snmp_async_pump(mp_snmp_agent *agent) {
+    struct mp_snmp_request *req;
+    netsnmp_pdu *pdu;
+
+    while (agent->queue && agent->outstanding < mp_snmp_async_window) {
+        req = agent->queue;
+        agent->queue = req->next;
+        agent->outstanding++;
+
+        /* Don't keep a dead agent busy */
+        if (agent->status != STAT_SUCCESS) {
+            mp_snmp_async_done(req);
+            continue;
+        }
+
+        if (req->querycmd)
+            pdu = mp_snmp_async_query_pdu(req);
+        else
+            pdu = mp_snmp_subtree_pdu(agent->ss, req->last_oid,
+                                      req->last_len);
+
+        if (!mp_snmp_async_send(agent->ss, pdu, req)) {
+            snmp_free_pdu(pdu);
+            mp_snmp_async_fail(agent, STAT_ERROR,
+                               snmp_api_errstring(agent->ss->s_snmp_errno));
+            mp_snmp_async_done(req);
+        }
+    }
+}
+
+/**
+ * Append a request to the agent queue.
+ */
+static void mp_snmp_async_queue(mp_snmp_agent *agent,
+                                struct mp_snmp_request *req) {
+    struct mp_snmp_request **p;
+
+    req->agent = agent;
+    for (p = &agent->queue; *p; p = &(*p)->next);
+    *p = req;
+    mp_snmp_async_pending++;
+
+    mp_snmp_async_pump(agent);
+}
+
+mp_snmp_agent *mp_snmp_async_agent(const char *host, int host_port,
+                                   void *data) {
+    mp_snmp_agent *agent;
+
+    /* Each agent has its own socket in the select set */
+    if (mp_snmp_async_agents >= FD_SETSIZE - 16)
+        unknown("Too many SNMP agents, max is %d.", FD_SETSIZE - 16);
+
+    agent = mp_calloc(1, sizeof(mp_snmp_agent));
+    agent->host = mp_strdup(host);
+    agent->port = host_port;
+    agent->data = data;
+    agent->status = STAT_SUCCESS;
+    agent->ss = mp_snmp_open(host, host_port);
+    mp_snmp_async_agents++;
+
+    return agent;
+}
+
+/**
+ * Queue a GET request of count query commands.
+ */
+static void mp_snmp_async_slice(mp_snmp_agent *agent,
+                                const mp_snmp_query_cmd *querycmd,
+                                size_t count) {
+    struct mp_snmp_request *req;
+
+    req = mp_calloc(1, sizeof(struct mp_snmp_request));
+    req->querycmd = querycmd;
+    req->count = count;
+
+    mp_snmp_async_queue(agent, req);
+}
+
+void mp_snmp_async_query(mp_snmp_agent *agent,
+                         const mp_snmp_query_cmd *querycmd) {
+    const mp_snmp_query_cmd *p;
+    const mp_snmp_query_cmd *first = querycmd;
+    size_t max, size = 0, var;
+
+    max = mp_snmp_async_msgmax(agent->ss);
+
+    for (p = querycmd; p->oid_len; p++) {
+        var = mp_snmp_async_varsize(p);
+        if (p > first && size + var > max) {
+            mp_snmp_async_slice(agent, first, p - first);
+            first = p;
+            size = 0;
+        }
+        size += var;
+    }
+
+    if (p > first)
+        mp_snmp_async_slice(agent, first, p - first);
+}
+
+/**
+ * Queue a walk adding to subtree.
+ */
+static void mp_snmp_async_walk(mp_snmp_agent *agent,
+                               const oid *subtree_oid,
+                               const size_t subtree_len,
+                               mp_snmp_subtree *subtree) {
+    struct mp_snmp_request *req;
+
+    req = mp_calloc(1, sizeof(struct mp_snmp_request));
+    req->subtree = subtree;
+    memcpy(req->subtree_oid, subtree_oid, subtree_len * sizeof(oid));
+    req->subtree_len = subtree_len;
+    memcpy(req->last_oid, subtree_oid, subtree_len * sizeof(oid));
+    req->last_len = subtree_len;
+
+    mp_snmp_async_queue(agent, req);
+}
+
+void mp_snmp_async_subtree(mp_snmp_agent *agent,
+                           const oid *subtree_oid,
+                           const size_t subtree_len,
+                           mp_snmp_subtree *subtree) {
+    memset(subtree, 0, sizeof(*subtree));
+
+    mp_snmp_async_walk(agent, subtree_oid, subtree_len, subtree);
+}
+
+void mp_snmp_async_columns(mp_snmp_agent *agent,
+                           const oid *entry_oid,
+                           const size_t entry_len,
+                           const oid *columns,
+                           const size_t num_columns,
+                           mp_snmp_subtree *subtree) {
+    oid column_oid[MAX_OID_LEN];
+    size_t i;
+
+    memset(subtree, 0, sizeof(*subtree));
+
+    if (entry_len + 1 > MAX_OID_LEN) {
+        mp_snmp_async_fail(agent, STAT_ERROR, "Table entry OID too long");
+        return;
+    }
+
+    /* One walk per column, they share the agent window */
+    memcpy(column_oid, entry_oid, entry_len * sizeof(oid));
+    for (i = 0; i < num_columns; i++) {
+        column_oid[entry_len] = columns[i];
+        mp_snmp_async_walk(agent, column_oid, entry_len + 1, subtree);
+    }
+}
+
+int mp_snmp_async_run(void) {
+    fd_set fdset;
+    struct timeval timeout;
+    int fds, block;
+
+    while (mp_snmp_async_pending > 0) {
+        if (mp_snmp_replay_active()) {
+            if (mp_snmp_replay_dispatch() != OK)
+                return ERROR;
+            continue;
+        }
+
+        fds = 0;
+        block = 1;
+        FD_ZERO(&fdset);
+        snmp_select_info(&fds, &fdset, &timeout, &block);
+
+        fds = select(fds, &fdset, NULL, NULL, block ? NULL : &timeout);
+        if (fds < 0) {
+            if (errno == EINTR)
+                continue;
+            if (mp_verbose > 0)
+                perror("select");
+            return ERROR;
+        }
+
+        if (fds)
+            snmp_read(&fdset);
+        else
+            snmp_timeout();
+    }
+
+    return OK;
+}
+
+/** Agents and evaluate function of \ref mp_snmp_async_exit. */
+struct mp_snmp_async_eval {
+    mp_snmp_agent **agents;
+    mp_snmp_eval_func eval;
+};
+
+static void mp_snmp_async_host(void *data, int i) {
+    struct mp_snmp_async_eval *multi = data;
+    mp_snmp_agent *agent = multi->agents[i];
+
+    if (agent->status != STAT_SUCCESS) {
+        /* Cached SNMPv3 engine data may be stale, rediscover next run */
+        mp_snmp_v3cache_invalidate(agent->ss);
+        unknown("SNMP error: %s", agent->error);
+    }
+    multi->eval(agent);
+}
+
+void mp_snmp_async_exit(mp_snmp_agent **agents, int num,
+                        mp_snmp_eval_func eval) {
+    struct mp_snmp_async_eval multi = { agents, eval };
+    const char **hosts;
+    int i;
+
+    hosts = mp_malloc(num * sizeof(char *));
+    for (i = 0; i < num; i++)
+        hosts[i] = agents[i]->host;
+
+    /* Transport stats cover all agents */
+    mp_snmp_stats_perfdata();
+
+    mp_multi_exit(hosts, num, mp_snmp_async_host, &multi);
+}
+
+void mp_snmp_async_free(mp_snmp_agent *agent) {
+    struct mp_snmp_request *req;
+
+    while ((req = agent->queue)) {
+        agent->queue = req->next;
+        mp_snmp_async_pending--;
+        free(req);
+    }
+
+    if (agent->ss) {
+        if (!mp_snmp_replay_active())
+            snmp_close(agent->ss);
+        mp_snmp_async_agents--;
+    }
+    free(agent->host);
+    free(agent->error);
+    free(agent);
+}
+
+void getopt_snmp_hosts(const char *optarg) {
+    mp_array_push(&mp_snmp_hosts, mp_strdup(optarg), &mp_snmp_hosts_num);
+}
+
+void print_help_snmp_hosts(void) {
+    printf("\
+     --hosts=ADDRESS[,ADDRESS...]\n\
+      Poll all hosts concurrently and print one line per host.\n");
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
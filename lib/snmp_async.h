@@ -0,0 +1,172 @@
+/***
+ * Monitoring Plugin - snmp_async.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _SNMP_ASYNC_H_
+#define _SNMP_ASYNC_H_
+
+#include "snmp_utils.h"
+
+/** Default max requests in flight per agent. */
+#define MP_SNMP_ASYNC_WINDOW    2
+/** Max message size assumed for agents, fits a ethernet frame. */
+#define MP_SNMP_MSGMAX          1472
+
+/** Max requests in flight per agent. */
+extern int mp_snmp_async_window;
+/** Holds the hosts given by --hosts. */
+extern char **mp_snmp_hosts;
+/** Number of hosts given by --hosts. */
+extern int mp_snmp_hosts_num;
+
+/** Queued or running request of an agent. */
+struct mp_snmp_request;
+
+/**
+ * SNMP agent polled by the async engine
+ */
+typedef struct mp_snmp_agent_s {
+    /** Agent hostname */
+    char *host;
+    /** Agent port */
+    int port;
+    /** Session to the agent */
+    netsnmp_session *ss;
+    /** STAT_SUCCESS or the status of the first failed request */
+    int status;
+    /** Error message if status is not STAT_SUCCESS */
+    char *error;
+    /** Plugin data */
+    void *data;
+    /** Requests in flight */
+    int outstanding;
+    /** Requests waiting for a free slot */
+    struct mp_snmp_request *queue;
+} mp_snmp_agent;
+
+/**
+ * Evaluate the results of one agent.
+ * Must end with one of the result functions like \ref ok or \ref mp_exit.
+ * \param[in] agent agent to evaluate
+ */
+typedef void (*mp_snmp_eval_func)(mp_snmp_agent *agent);
+
+/**
+ * Open a session to an agent for the async engine.
+ *
+ * \param[in] host agent hostname
+ * \param[in] host_port agent port
+ * \param[in] data plugin data
+ * \return new agent
+ */
+mp_snmp_agent *mp_snmp_async_agent(const char *host, int host_port,
+                                   void *data);
+
+/**
+ * Queue the GETs of querycmd. Values are stored to the query targets
+ * like \ref mp_snmp_query does.
+ *
+ * The GETs are packed into as few requests as fit into the message size
+ * of the agent. A request answered with tooBig is split in halves, a
+ * failed varbind is dropped and only the rest of its request resent.
+ *
+ * \param[in] agent agent to query
+ * \param[in] querycmd query, must stay valid until the engine ran
+ */
+void mp_snmp_async_query(mp_snmp_agent *agent,
+                         const mp_snmp_query_cmd *querycmd);
+
+/**
+ * Queue a walk of a subtree like \ref mp_snmp_subtree_query.
+ *
+ * \param[in] agent agent to query
+ * \param[in] subtree_oid start OID
+ * \param[in] subtree_len the size of subtree_oid
+ * \param[out] subtree store fetched OIDs result
+ */
+void mp_snmp_async_subtree(mp_snmp_agent *agent,
+                           const oid *subtree_oid,
+                           const size_t subtree_len,
+                           mp_snmp_subtree *subtree);
+
+/**
+ * Queue walks of selected table columns like
+ * \ref mp_snmp_table_query_columns. Index the result with
+ * \ref mp_snmp_table_build after \ref mp_snmp_async_run.
+ *
+ * \param[in] agent agent to query
+ * \param[in] entry_oid table entry OID
+ * \param[in] entry_len the size of entry_oid
+ * \param[in] columns column sub-identifiers to fetch
+ * \param[in] num_columns number of columns
+ * \param[out] subtree store fetched OIDs result
+ */
+void mp_snmp_async_columns(mp_snmp_agent *agent,
+                           const oid *entry_oid,
+                           const size_t entry_len,
+                           const oid *columns,
+                           const size_t num_columns,
+                           mp_snmp_subtree *subtree);
+
+/**
+ * Run all queued requests of all agents concurrently.
+ * Failed agents get status and error set.
+ *
+ * \return \ref OK or \ref ERROR if the event loop failed.
+ */
+int mp_snmp_async_run(void);
+
+/**
+ * Evaluate every agent and exit with the worst state, output as by
+ * \ref mp_multi_exit.
+ *
+ * \param[in] agents agents to evaluate
+ * \param[in] num number of agents
+ * \param[in] eval evaluation function
+ */
+void mp_snmp_async_exit(mp_snmp_agent **agents, int num,
+                        mp_snmp_eval_func eval) __attribute__((__noreturn__));
+
+/**
+ * Close the session and free an agent.
+ *
+ * \param[in] agent agent to free
+ */
+void mp_snmp_async_free(mp_snmp_agent *agent);
+
+/**
+ * Parse the --hosts option.
+ * \param[in] optarg comma separated host list
+ */
+void getopt_snmp_hosts(const char *optarg);
+
+/**
+ * Print the help for the --hosts option.
+ */
+void print_help_snmp_hosts(void);
+
+/** longopts option for hosts */
+#define MP_LONGOPTS_SNMP_HOSTS  {"hosts", required_argument, NULL, (int)MP_LONGOPT_HOSTS}
+
+#endif /* _SNMP_ASYNC_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,48 @@
+# Generate snmp_oids.h from snmp_oids.def
+#
+# Each "name 1.3.6..." line becomes
+#   #define MP_OID_name      1,3,6,...
+#   #define MP_OID_name_LEN  n
+#   #define MP_OID_name_COL  last sub-identifier (the column of table columns)
+
+BEGIN {
+    print "/* Generated by snmp_oids.awk from snmp_oids.def, do not edit. */"
+    print ""
+    print "#ifndef _SNMP_OIDS_H_"
+    print "#define _SNMP_OIDS_H_"
+    print ""
+    err = 0
+}
+
+/^[ \t]*(#|$)/ { next }
+
+{
+    name = $1
+    str = $2
+    sub(/^\./, "", str)
+    dotted = str
+    if (NF != 2 || name !~ /^[A-Za-z][A-Za-z0-9_]*$/ ||
+            str !~ /^[0-9]+(\.[0-9]+)*$/) {
+        printf("%s:%d: invalid OID line '%s'\n", FILENAME, FNR, $0) > "/dev/stderr"
+        err = 1
+        next
+    }
+    if (name in seen) {
+        printf("%s:%d: duplicate OID name '%s'\n", FILENAME, FNR, name) > "/dev/stderr"
+        err = 1
+        next
+    }
+    seen[name] = 1
+    n = split(str, sub_ids, ".")
+    gsub(/\./, ",", str)
+    printf("/** %s .%s */\n", name, dotted)
+    printf("#define MP_OID_%-28s %s\n", name, str)
+    printf("#define MP_OID_%-28s %d\n", name "_LEN", n)
+    printf("#define MP_OID_%-28s %s\n", name "_COL", sub_ids[n])
+}
+
+END {
+    print ""
+    print "#endif /* _SNMP_OIDS_H_ */"
+    exit err
+}
@@ -0,0 +1,778 @@
+/***
+ * Monitoring Plugin - snmp_replay.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "snmp_replay.h"
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+/**
+ * A replay fixture is loaded into a subtree arena, sorted by OID with
+ * duplicates removed, and answers GET, GETNEXT and GETBULK like an
+ * agent holding exactly these variables. A record fixture is appended
+ * to while the plugin runs, so a aborted run still leaves a usable
+ * fixture.
+ */
+
+/** A fixture file, one per agent if the path contains '%s'. */
+struct mp_snmp_fixture {
+    /** Next fixture */
+    struct mp_snmp_fixture *next;
+    /** Fixture path */
+    char *path;
+    /** Record file */
+    FILE *record;
+    /** Replay variables, sorted and unique */
+    mp_snmp_subtree data;
+};
+
+/** A queued asynchronous replay response. */
+struct mp_snmp_replay_pending {
+    /** Next pending response, ordered by due */
+    struct mp_snmp_replay_pending *next;
+    /** Time the response arrives */
+    double due;
+    /** Session of the request */
+    netsnmp_session *ss;
+    /** The request */
+    netsnmp_pdu *request;
+    /** The response, NULL if timed out */
+    netsnmp_pdu *response;
+    /** Response callback */
+    netsnmp_callback callback;
+    /** Callback data */
+    void *magic;
+    /** Request id */
+    int reqid;
+};
+
+static const char *mp_snmp_record_path = NULL;
+static const char *mp_snmp_replay_path = NULL;
+/** Latency in seconds. */
+static double mp_snmp_replay_latency = 0;
+/** Loss probability 0 to 1. */
+static double mp_snmp_replay_loss = 0;
+/** Max response size in bytes, 0 for unlimited. */
+static size_t mp_snmp_replay_maxsize = 0;
+/** Loss is pseudo random but the same for each run. */
+static unsigned int mp_snmp_replay_seed = 1;
+static int mp_snmp_replay_reqid = 0;
+
+static struct mp_snmp_fixture *mp_snmp_record_fixtures = NULL;
+static struct mp_snmp_fixture *mp_snmp_replay_fixtures = NULL;
+static struct mp_snmp_replay_pending *mp_snmp_replay_queue = NULL;
+
+/** Arena used by fixture_cmp. */
+static const mp_snmp_subtree *fixture_sort;
+
+static double replay_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void replay_sleep(double seconds) {
+    struct timespec ts;
+
+    if (seconds <= 0)
+        return;
+
+    ts.tv_sec = (time_t) seconds;
+    ts.tv_nsec = (long) ((seconds - ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+}
+
+static double replay_env(const char *name) {
+    const char *val = getenv(name);
+
+    return val ? strtod(val, NULL) : 0;
+}
+
+void mp_snmp_replay_init(void) {
+    double val;
+
+    mp_snmp_record_path = getenv(MP_SNMP_RECORD_ENV);
+    if (mp_snmp_record_path && *mp_snmp_record_path == '\0')
+        mp_snmp_record_path = NULL;
+
+    mp_snmp_replay_path = getenv(MP_SNMP_REPLAY_ENV);
+    if (mp_snmp_replay_path && *mp_snmp_replay_path == '\0')
+        mp_snmp_replay_path = NULL;
+
+    mp_snmp_replay_latency = replay_env(MP_SNMP_REPLAY_LATENCY_ENV) / 1000;
+    val = replay_env(MP_SNMP_REPLAY_LOSS_ENV) / 100;
+    mp_snmp_replay_loss = val < 0 ? 0 : (val > 1 ? 1 : val);
+    val = replay_env(MP_SNMP_REPLAY_MAXSIZE_ENV);
+    mp_snmp_replay_maxsize = val > 0 ? (size_t) val : 0;
+    mp_snmp_replay_seed = 1;
+
+    if (mp_verbose > 1 && mp_snmp_replay_path)
+        printf("Replay SNMP from %s\n", mp_snmp_replay_path);
+    if (mp_verbose > 1 && mp_snmp_record_path)
+        printf("Record SNMP to %s\n", mp_snmp_record_path);
+}
+
+int mp_snmp_replay_active(void) {
+    return mp_snmp_replay_path != NULL;
+}
+
+/**
+ * Expand the fixture path of a session, '%s' is the agent host.
+ */
+static char *fixture_path(const char *tmpl, const netsnmp_session *ss) {
+    const char *s = strstr(tmpl, "%s");
+    char *host, *path, *p;
+
+    if (!s)
+        return mp_strdup(tmpl);
+
+    host = mp_strdup(ss->peername ? ss->peername : "");
+    p = strrchr(host, ':');
+    if (p && p != host)
+        *p = '\0';
+
+    path = mp_malloc(strlen(tmpl) + strlen(host) + 1);
+    memcpy(path, tmpl, s - tmpl);
+    strcpy(path + (s - tmpl), host);
+    strcat(path, s + 2);
+    free(host);
+
+    return path;
+}
+
+static int fixture_cmp(const void *a, const void *b) {
+    const mp_snmp_varbind *va = a;
+    const mp_snmp_varbind *vb = b;
+    int cmp;
+
+    cmp = snmp_oid_compare(mp_snmp_varbind_name(fixture_sort, va),
+                           va->name_len,
+                           mp_snmp_varbind_name(fixture_sort, vb),
+                           vb->name_len);
+    if (cmp)
+        return cmp;
+
+    /* Later lines first, they win over earlier duplicates */
+    return va->name_off < vb->name_off ? 1 : -1;
+}
+
+/**
+ * Parse a 'snmpwalk -On' line into var.
+ * Returns 1 if the line holds a supported variable.
+ */
+static int fixture_parse(char *line, netsnmp_variable_list *var, oid *name,
+                         u_char *buf, size_t buf_len) {
+    size_t name_len = MAX_OID_LEN;
+    char *v, *p, *t;
+    size_t n;
+
+    line[strcspn(line, "\r\n")] = '\0';
+    p = strstr(line, " = ");
+    if (line[0] != '.' || !p)
+        return 0;
+
+    *p = '\0';
+    if (!mp_snmp_parse_oid(line, name, &name_len))
+        return 0;
+    v = p + 3;
+    t = strstr(v, ": ");
+
+    memset(var, 0, sizeof(netsnmp_variable_list));
+    var->name = name;
+    var->name_length = name_len;
+    var->val.string = buf;
+
+    if (strcmp(v, "\"\"") == 0 || strncmp(v, "STRING:", 7) == 0) {
+        v = t ? t + 2 : v + 2;
+        n = strlen(v);
+        if (n >= 2 && v[0] == '"' && v[n - 1] == '"') {
+            v++;
+            n -= 2;
+        }
+        var->type = ASN_OCTET_STR;
+        var->val_len = n < buf_len ? n : buf_len;
+        memcpy(buf, v, var->val_len);
+    } else if (strncmp(v, "Hex-STRING:", 11) == 0) {
+        for (n = 0, p = v + 11; *p && n < buf_len; ) {
+            while (*p == ' ')
+                p++;
+            if (!isxdigit((unsigned char)*p))
+                break;
+            buf[n++] = (u_char) strtoul(p, &p, 16);
+        }
+        var->type = ASN_OCTET_STR;
+        var->val_len = n;
+    } else if (strncmp(v, "INTEGER:", 8) == 0) {
+        p = strchr(v, '(');
+        *(long *) buf = strtol(p ? p + 1 : v + 8, NULL, 10);
+        var->type = ASN_INTEGER;
+        var->val_len = sizeof(long);
+    } else if (strncmp(v, "Counter32:", 10) == 0 ||
+               strncmp(v, "Gauge32:", 8) == 0 ||
+               strncmp(v, "Timeticks:", 10) == 0) {
+        p = strchr(v, '(');
+        *(long *) buf = (long) (strtoul(p ? p + 1 : t + 1, NULL, 10)
+                                & 0xffffffffUL);
+        var->type = v[0] == 'C' ? ASN_COUNTER :
+            (v[0] == 'G' ? ASN_GAUGE : ASN_TIMETICKS);
+        var->val_len = sizeof(long);
+    } else if (strncmp(v, "Counter64:", 10) == 0) {
+        unsigned long long c = strtoull(v + 10, NULL, 10);
+        struct counter64 *c64 = (struct counter64 *) buf;
+        c64->high = (u_long) (c >> 32);
+        c64->low = (u_long) (c & 0xffffffffULL);
+        var->type = ASN_COUNTER64;
+        var->val_len = sizeof(struct counter64);
+    } else if (strncmp(v, "IpAddress:", 10) == 0) {
+        struct in_addr addr;
+        if (!inet_aton(v + 11, &addr))
+            return 0;
+        memcpy(buf, &addr, 4);
+        var->type = ASN_IPADDRESS;
+        var->val_len = 4;
+    } else if (strncmp(v, "OID:", 4) == 0) {
+        n = buf_len / sizeof(oid);
+        if (!mp_snmp_parse_oid(v + 5, (oid *) buf, &n))
+            return 0;
+        var->type = ASN_OBJECT_ID;
+        var->val_len = n * sizeof(oid);
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Load, sort and deduplicate a replay fixture.
+ */
+static void fixture_load(struct mp_snmp_fixture *f) {
+    netsnmp_variable_list var;
+    oid name[MAX_OID_LEN];
+    oid buf[1024];
+    char *line = NULL;
+    size_t line_len = 0;
+    size_t i, n;
+    FILE *fp;
+
+    fp = fopen(f->path, "r");
+    if (!fp)
+        unknown("Can't open SNMP fixture %s: %s", f->path, strerror(errno));
+
+    while (getline(&line, &line_len, fp) > 0) {
+        if (fixture_parse(line, &var, name, (u_char *) buf, sizeof(buf)))
+            mp_snmp_subtree_add(&f->data, &var);
+    }
+    free(line);
+    fclose(fp);
+
+    fixture_sort = &f->data;
+    qsort(f->data.vars, f->data.size, sizeof(mp_snmp_varbind), fixture_cmp);
+
+    for (i = 0, n = 0; i < f->data.size; i++) {
+        if (n > 0 && snmp_oid_compare(
+                mp_snmp_varbind_name(&f->data, &f->data.vars[n - 1]),
+                f->data.vars[n - 1].name_len,
+                mp_snmp_varbind_name(&f->data, &f->data.vars[i]),
+                f->data.vars[i].name_len) == 0)
+            continue;
+        f->data.vars[n++] = f->data.vars[i];
+    }
+    f->data.size = n;
+
+    if (mp_verbose > 1)
+        printf("Loaded %zu variables from %s\n", n, f->path);
+}
+
+/**
+ * Get the fixture of a session, opening or loading it on first use.
+ */
+static struct mp_snmp_fixture *fixture_get(struct mp_snmp_fixture **list,
+                                           const char *tmpl,
+                                           const netsnmp_session *ss,
+                                           int replay) {
+    struct mp_snmp_fixture *f;
+    char *path;
+
+    path = fixture_path(tmpl, ss);
+    for (f = *list; f; f = f->next) {
+        if (strcmp(f->path, path) == 0) {
+            free(path);
+            return f;
+        }
+    }
+
+    f = mp_calloc(1, sizeof(struct mp_snmp_fixture));
+    f->path = path;
+
+    if (replay) {
+        fixture_load(f);
+    } else {
+        f->record = fopen(path, "w");
+        if (!f->record && mp_verbose > 0)
+            printf("Can't record SNMP to %s: %s\n", path, strerror(errno));
+    }
+
+    f->next = *list;
+    *list = f;
+
+    return f;
+}
+
+/**
+ * Find the variable name (next == 0) or the one after it.
+ * Returns the index or -1.
+ */
+static long fixture_find(const struct mp_snmp_fixture *f, const oid *name,
+                         size_t name_len, int next) {
+    const mp_snmp_varbind *vb;
+    size_t lo = 0, hi = f->data.size, mid;
+    int cmp;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        vb = &f->data.vars[mid];
+        cmp = snmp_oid_compare(mp_snmp_varbind_name(&f->data, vb),
+                               vb->name_len, name, name_len);
+        if (cmp < 0 || (next && cmp == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo >= f->data.size)
+        return -1;
+    vb = &f->data.vars[lo];
+    if (!next && snmp_oid_compare(mp_snmp_varbind_name(&f->data, vb),
+                                  vb->name_len, name, name_len) != 0)
+        return -1;
+
+    return (long) lo;
+}
+
+/**
+ * Append a fixture variable or, with idx -1, a exception to pdu if it
+ * fits into max bytes.
+ * Returns the approximate encoded size or 0 if it does not fit.
+ */
+static size_t replay_add(netsnmp_pdu *pdu, const struct mp_snmp_fixture *f,
+                         long idx, const oid *name, size_t name_len,
+                         u_char exception, size_t max) {
+    const mp_snmp_varbind *vb;
+    netsnmp_variable_list *var;
+    size_t size;
+
+    if (idx < 0) {
+        size = mp_snmp_var_size(name, name_len, exception, NULL, 0);
+        if (size > max)
+            return 0;
+        var = snmp_add_null_var(pdu, name, name_len);
+        var->type = exception;
+    } else {
+        vb = &f->data.vars[idx];
+        size = mp_snmp_var_size(mp_snmp_varbind_name(&f->data, vb),
+                               vb->name_len, vb->type,
+                               mp_snmp_varbind_value(&f->data, vb),
+                               vb->val_len);
+        if (size > max)
+            return 0;
+        var = snmp_add_null_var(pdu, mp_snmp_varbind_name(&f->data, vb),
+                                vb->name_len);
+        snmp_set_var_typed_value(var, vb->type,
+                                 mp_snmp_varbind_value(&f->data, vb),
+                                 vb->val_len);
+    }
+
+    return size;
+}
+
+/**
+ * Turn response into a error response echoing the request varbinds.
+ */
+static void replay_error(netsnmp_pdu *response, const netsnmp_pdu *pdu,
+                         long errstat, long errindex) {
+    netsnmp_variable_list *var;
+
+    snmp_free_varbind(response->variables);
+    response->variables = NULL;
+    for (var = pdu->variables; var; var = var->next_variable)
+        snmp_add_null_var(response, var->name, var->name_length);
+
+    response->errstat = errstat;
+    response->errindex = errindex;
+}
+
+/**
+ * Answer a request from the fixture.
+ */
+static netsnmp_pdu *replay_answer(const netsnmp_session *ss,
+                                  const struct mp_snmp_fixture *f,
+                                  const netsnmp_pdu *pdu) {
+    netsnmp_pdu *response;
+    netsnmp_variable_list *var;
+    oid (*cursor)[MAX_OID_LEN] = NULL;
+    size_t *cursor_len = NULL;
+    size_t size, max, add, num, i;
+    long idx, r;
+    int done;
+
+    response = snmp_pdu_create(SNMP_MSG_RESPONSE);
+    response->version = pdu->version;
+    response->reqid = pdu->reqid;
+    response->errstat = SNMP_ERR_NOERROR;
+    response->errindex = 0;
+
+    max = mp_snmp_replay_maxsize ? mp_snmp_replay_maxsize : (size_t) -1;
+    size = mp_snmp_head_size(ss);
+
+    switch (pdu->command) {
+        case SNMP_MSG_GET:
+        case SNMP_MSG_GETNEXT:
+            for (var = pdu->variables, i = 1; var;
+                 var = var->next_variable, i++) {
+                idx = fixture_find(f, var->name, var->name_length,
+                                   pdu->command == SNMP_MSG_GETNEXT);
+                if (idx < 0 && ss->version == SNMP_VERSION_1) {
+                    replay_error(response, pdu, SNMP_ERR_NOSUCHNAME, i);
+                    return response;
+                }
+                add = replay_add(response, f, idx, var->name,
+                                 var->name_length,
+                                 pdu->command == SNMP_MSG_GET ?
+                                 SNMP_NOSUCHINSTANCE : SNMP_ENDOFMIBVIEW,
+                                 max - size);
+                if (!add) {
+                    replay_error(response, pdu, SNMP_ERR_TOOBIG, 0);
+                    return response;
+                }
+                size += add;
+            }
+            break;
+        case SNMP_MSG_GETBULK:
+            /* Non-repeaters */
+            for (var = pdu->variables, i = 0;
+                 var && (long) i < pdu->non_repeaters;
+                 var = var->next_variable, i++) {
+                idx = fixture_find(f, var->name, var->name_length, 1);
+                add = replay_add(response, f, idx, var->name,
+                                 var->name_length, SNMP_ENDOFMIBVIEW,
+                                 max - size);
+                if (!add) {
+                    replay_error(response, pdu, SNMP_ERR_TOOBIG, 0);
+                    return response;
+                }
+                size += add;
+            }
+
+            /* Repeaters, truncated to fit like a real agent does */
+            for (num = 0; var; var = var->next_variable, num++) {
+                cursor = mp_realloc(cursor, (num + 1) * sizeof(*cursor));
+                cursor_len = mp_realloc(cursor_len, (num + 1) * sizeof(size_t));
+                memcpy(cursor[num], var->name, var->name_length * sizeof(oid));
+                cursor_len[num] = var->name_length;
+            }
+            for (r = 0, done = 0; r < pdu->max_repetitions && !done; r++) {
+                done = 1;
+                for (i = 0; i < num; i++) {
+                    idx = fixture_find(f, cursor[i], cursor_len[i], 1);
+                    add = replay_add(response, f, idx, cursor[i],
+                                     cursor_len[i], SNMP_ENDOFMIBVIEW,
+                                     max - size);
+                    if (!add) {
+                        done = 1;
+                        break;
+                    }
+                    size += add;
+                    if (idx < 0)
+                        continue;
+                    done = 0;
+                    memcpy(cursor[i], mp_snmp_varbind_name(&f->data,
+                           &f->data.vars[idx]),
+                           f->data.vars[idx].name_len * sizeof(oid));
+                    cursor_len[i] = f->data.vars[idx].name_len;
+                }
+            }
+            free(cursor);
+            free(cursor_len);
+
+            /* Not even one repetition fits */
+            if (num > 0 && !response->variables)
+                replay_error(response, pdu, SNMP_ERR_TOOBIG, 0);
+            break;
+        default:
+            replay_error(response, pdu, SNMP_ERR_GENERR, 1);
+            break;
+    }
+
+    return response;
+}
+
+/**
+ * Roll the loss of each try of a request.
+ * Returns the time until the response and sets lost if all tries were.
+ */
+static double replay_delay(const netsnmp_session *ss, int *lost) {
+    long timeout = ss->timeout > 0 ? ss->timeout : MP_SNMP_TIMEOUT;
+    int tries = (ss->retries >= 0 ? ss->retries : MP_SNMP_RETRIES) + 1;
+    double delay = 0;
+
+    *lost = 1;
+    while (tries--) {
+        if (mp_snmp_replay_loss > 0 &&
+                rand_r(&mp_snmp_replay_seed) <
+                mp_snmp_replay_loss * ((double) RAND_MAX + 1)) {
+            delay += timeout / 1e6;
+            continue;
+        }
+        *lost = 0;
+        return delay + mp_snmp_replay_latency;
+    }
+
+    return delay;
+}
+
+netsnmp_session *mp_snmp_replay_open(const netsnmp_session *session) {
+    netsnmp_session *ss;
+
+    ss = mp_malloc(sizeof(netsnmp_session));
+    memcpy(ss, session, sizeof(netsnmp_session));
+
+    /* Keep nothing the caller frees */
+    ss->peername = mp_strdup(session->peername);
+    ss->securityName = NULL;
+    ss->contextName = NULL;
+    ss->securityEngineID = NULL;
+    ss->contextEngineID = NULL;
+    ss->securityAuthLocalKey = NULL;
+
+    /* Load it now, a missing fixture is a usage error */
+    fixture_get(&mp_snmp_replay_fixtures, mp_snmp_replay_path, ss, 1);
+
+    return ss;
+}
+
+int mp_snmp_replay_response(netsnmp_session *ss, netsnmp_pdu *pdu,
+                            netsnmp_pdu **response) {
+    struct mp_snmp_fixture *f;
+    int lost;
+
+    *response = NULL;
+    f = fixture_get(&mp_snmp_replay_fixtures, mp_snmp_replay_path, ss, 1);
+
+    replay_sleep(replay_delay(ss, &lost));
+
+    if (lost) {
+        ss->s_snmp_errno = SNMPERR_TIMEOUT;
+        snmp_free_pdu(pdu);
+        return STAT_TIMEOUT;
+    }
+
+    *response = replay_answer(ss, f, pdu);
+    snmp_free_pdu(pdu);
+
+    return STAT_SUCCESS;
+}
+
+int mp_snmp_replay_send(netsnmp_session *ss, netsnmp_pdu *pdu,
+                        netsnmp_callback callback, void *magic) {
+    struct mp_snmp_replay_pending *p, **pp;
+    struct mp_snmp_fixture *f;
+    int lost;
+
+    f = fixture_get(&mp_snmp_replay_fixtures, mp_snmp_replay_path, ss, 1);
+
+    p = mp_calloc(1, sizeof(struct mp_snmp_replay_pending));
+    p->ss = ss;
+    p->request = pdu;
+    p->callback = callback;
+    p->magic = magic;
+    p->reqid = ++mp_snmp_replay_reqid;
+    p->due = replay_now() + replay_delay(ss, &lost);
+    if (!lost)
+        p->response = replay_answer(ss, f, pdu);
+
+    for (pp = &mp_snmp_replay_queue; *pp && (*pp)->due <= p->due;
+         pp = &(*pp)->next);
+    p->next = *pp;
+    *pp = p;
+
+    return p->reqid;
+}
+
+int mp_snmp_replay_dispatch(void) {
+    struct mp_snmp_replay_pending *p = mp_snmp_replay_queue;
+
+    if (!p)
+        return ERROR;
+    mp_snmp_replay_queue = p->next;
+
+    replay_sleep(p->due - replay_now());
+
+    if (p->response) {
+        p->callback(NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE, p->ss, p->reqid,
+                    p->response, p->magic);
+        snmp_free_pdu(p->response);
+    } else {
+        p->ss->s_snmp_errno = SNMPERR_TIMEOUT;
+        p->callback(NETSNMP_CALLBACK_OP_TIMED_OUT, p->ss, p->reqid,
+                    p->request, p->magic);
+    }
+    snmp_free_pdu(p->request);
+    free(p);
+
+    return OK;
+}
+
+/**
+ * Write a variable as 'snmpwalk -On' line.
+ */
+static void record_var(FILE *fp, const netsnmp_variable_list *var) {
+    unsigned long long c64;
+    size_t i;
+    int hex;
+
+    switch (var->type) {
+        case ASN_OCTET_STR:
+        case ASN_INTEGER:
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+        case ASN_COUNTER64:
+        case ASN_IPADDRESS:
+        case ASN_OBJECT_ID:
+            break;
+        default:
+            if (mp_verbose > 1)
+                printf("Can't record type 0x%X\n", var->type);
+            return;
+    }
+
+    for (i = 0; i < var->name_length; i++)
+        fprintf(fp, ".%lu", (unsigned long) var->name[i]);
+    fputs(" = ", fp);
+
+    switch (var->type) {
+        case ASN_OCTET_STR:
+            for (i = 0, hex = 0; i < var->val_len && !hex; i++)
+                hex = !isprint(var->val.string[i]) ||
+                    var->val.string[i] == '"' || var->val.string[i] == '\\';
+            if (hex) {
+                fputs("Hex-STRING: ", fp);
+                for (i = 0; i < var->val_len; i++)
+                    fprintf(fp, "%02X ", var->val.string[i]);
+            } else {
+                fprintf(fp, "STRING: \"%.*s\"", (int) var->val_len,
+                        (const char *) var->val.string);
+            }
+            break;
+        case ASN_INTEGER:
+            fprintf(fp, "INTEGER: %ld", *var->val.integer);
+            break;
+        case ASN_COUNTER:
+            fprintf(fp, "Counter32: %lu",
+                    (unsigned long) *var->val.integer & 0xffffffffUL);
+            break;
+        case ASN_GAUGE:
+            fprintf(fp, "Gauge32: %lu",
+                    (unsigned long) *var->val.integer & 0xffffffffUL);
+            break;
+        case ASN_TIMETICKS:
+            fprintf(fp, "Timeticks: (%lu)",
+                    (unsigned long) *var->val.integer & 0xffffffffUL);
+            break;
+        case ASN_COUNTER64:
+            c64 = ((unsigned long long) var->val.counter64->high << 32) |
+                (var->val.counter64->low & 0xffffffffUL);
+            fprintf(fp, "Counter64: %llu", c64);
+            break;
+        case ASN_IPADDRESS:
+            fprintf(fp, "IpAddress: %u.%u.%u.%u", var->val.string[0],
+                    var->val.string[1], var->val.string[2],
+                    var->val.string[3]);
+            break;
+        case ASN_OBJECT_ID:
+            fputs("OID: ", fp);
+            for (i = 0; i < var->val_len / sizeof(oid); i++)
+                fprintf(fp, ".%lu", (unsigned long) var->val.objid[i]);
+            break;
+    }
+    fputc('\n', fp);
+}
+
+void mp_snmp_record(const netsnmp_session *ss, const netsnmp_pdu *response) {
+    struct mp_snmp_fixture *f;
+    netsnmp_variable_list *var;
+
+    if (!mp_snmp_record_path || !response)
+        return;
+
+    f = fixture_get(&mp_snmp_record_fixtures, mp_snmp_record_path, ss, 0);
+    if (!f->record)
+        return;
+
+    for (var = response->variables; var; var = var->next_variable)
+        record_var(f->record, var);
+    fflush(f->record);
+}
+
+void mp_snmp_replay_close(void) {
+    struct mp_snmp_replay_pending *p;
+    struct mp_snmp_fixture *f;
+
+    while ((p = mp_snmp_replay_queue)) {
+        mp_snmp_replay_queue = p->next;
+        snmp_free_pdu(p->request);
+        snmp_free_pdu(p->response);
+        free(p);
+    }
+
+    while ((f = mp_snmp_record_fixtures)) {
+        mp_snmp_record_fixtures = f->next;
+        if (f->record)
+            fclose(f->record);
+        free(f->path);
+        free(f);
+    }
+
+    while ((f = mp_snmp_replay_fixtures)) {
+        mp_snmp_replay_fixtures = f->next;
+        mp_snmp_subtree_free(&f->data);
+        free(f->path);
+        free(f);
+    }
+
+    mp_snmp_record_path = NULL;
+    mp_snmp_replay_path = NULL;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
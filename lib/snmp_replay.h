@@ -0,0 +1,119 @@
+/***
+ * Monitoring Plugin - snmp_replay.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _SNMP_REPLAY_H_
+#define _SNMP_REPLAY_H_
+
+#include "snmp_utils.h"
+
+/**
+ * Record and replay of SNMP agents.
+ *
+ * Fixtures are walks in 'snmpwalk -On' format, so a recorded fixture,
+ * a real snmpwalk and the mp_standin bench agent share one format.
+ * A '%s' in the fixture path is replaced by the agent host name, which
+ * gives each agent of a --hosts run its own fixture.
+ *
+ * Both are enabled by environment, so every SNMP plugin supports them
+ * without options:
+ */
+/** Fixture to record all received varbinds to. */
+#define MP_SNMP_RECORD_ENV          "MP_SNMP_RECORD"
+/** Fixture to answer requests from instead of the network. */
+#define MP_SNMP_REPLAY_ENV          "MP_SNMP_REPLAY"
+/** Replay latency per request in milliseconds. */
+#define MP_SNMP_REPLAY_LATENCY_ENV  "MP_SNMP_REPLAY_LATENCY"
+/** Replay request loss in percent, lost requests are retried. */
+#define MP_SNMP_REPLAY_LOSS_ENV     "MP_SNMP_REPLAY_LOSS"
+/** Replay max response size in bytes, larger answers are tooBig. */
+#define MP_SNMP_REPLAY_MAXSIZE_ENV  "MP_SNMP_REPLAY_MAXSIZE"
+
+/**
+ * Read the record and replay settings from the environment.
+ * Called by the SNMP library init.
+ */
+void mp_snmp_replay_init(void);
+
+/**
+ * Check if requests are answered from a fixture.
+ * \return 1 in replay mode, 0 otherwise
+ */
+int mp_snmp_replay_active(void);
+
+/**
+ * Create a replay session from a session template. No socket is opened.
+ *
+ * \param[in] session session template
+ * \return replay session
+ */
+netsnmp_session *mp_snmp_replay_open(const netsnmp_session *session);
+
+/**
+ * Answer a request from the fixture like snmp_synch_response.
+ * Latency and loss are waited for. The request is freed.
+ *
+ * \param[in] ss replay session
+ * \param[in] pdu request to answer
+ * \param[out] response response or NULL on timeout
+ * \return STAT_SUCCESS, STAT_TIMEOUT or STAT_ERROR
+ */
+int mp_snmp_replay_response(netsnmp_session *ss, netsnmp_pdu *pdu,
+                            netsnmp_pdu **response);
+
+/**
+ * Queue a request like snmp_async_send. The callback is called from
+ * \ref mp_snmp_replay_dispatch once the latency passed. Requests of all
+ * sessions overlap like on the network.
+ *
+ * \param[in] ss replay session
+ * \param[in] pdu request to answer, freed
+ * \param[in] callback response callback
+ * \param[in] magic callback data
+ * \return request id, never 0
+ */
+int mp_snmp_replay_send(netsnmp_session *ss, netsnmp_pdu *pdu,
+                        netsnmp_callback callback, void *magic);
+
+/**
+ * Wait for the next queued response and call its callback.
+ * \return \ref OK or \ref ERROR if nothing is queued.
+ */
+int mp_snmp_replay_dispatch(void);
+
+/**
+ * Append the varbinds of a response to the record fixture of the session.
+ * Does nothing unless recording.
+ *
+ * \param[in] ss session the response was received on
+ * \param[in] response received response
+ */
+void mp_snmp_record(const netsnmp_session *ss, const netsnmp_pdu *response);
+
+/**
+ * Close record fixtures and free replay fixtures.
+ */
+void mp_snmp_replay_close(void);
+
+#endif /* _SNMP_REPLAY_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
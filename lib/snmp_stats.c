@@ -0,0 +1,147 @@
+/***
+ * Monitoring Plugin - snmp_stats.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "snmp_stats.h"
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+int mp_snmp_stats_enabled = 0;
+struct mp_snmp_stats mp_snmp_stats;
+
+void mp_snmp_stats_request(const netsnmp_session *ss, const netsnmp_pdu *pdu,
+                           struct timeval *sent) {
+    mp_snmp_stats.pdus++;
+    mp_snmp_stats.bytes_out += mp_snmp_pdu_size(ss, pdu);
+    gettimeofday(sent, NULL);
+}
+
+void mp_snmp_stats_response(const netsnmp_session *ss,
+                            const netsnmp_pdu *response,
+                            const struct timeval *sent) {
+    struct timeval now;
+    uint64_t usec;
+    long timeout = ss->timeout > 0 ? ss->timeout : MP_SNMP_TIMEOUT;
+
+    gettimeofday(&now, NULL);
+    usec = (uint64_t) (now.tv_sec - sent->tv_sec) * 1000000 +
+        now.tv_usec - sent->tv_usec;
+
+    if (!response) {
+        mp_snmp_stats.timeouts++;
+        mp_snmp_stats.retries += ss->retries >= 0 ? ss->retries :
+            MP_SNMP_RETRIES;
+        return;
+    }
+
+    /* Net-SNMP retransmits silently, each passed timeout was a retry */
+    mp_snmp_stats.retries += usec / timeout;
+
+    mp_snmp_stats.bytes_in += mp_snmp_pdu_size(ss, response);
+    if (response->errstat == SNMP_ERR_TOOBIG)
+        mp_snmp_stats.toobig++;
+
+    mp_snmp_stats.rtt[mp_snmp_stats_bucket(usec)]++;
+    if (usec > mp_snmp_stats.rtt_max)
+        mp_snmp_stats.rtt_max = usec;
+}
+
+int mp_snmp_stats_bucket(uint64_t usec) {
+    int msb;
+    int bucket;
+
+    if (usec < 4)
+        return (int) usec;
+
+    for (msb = 2; usec >> (msb + 1); msb++);
+    bucket = (msb - 1) * 4 + (int) ((usec >> (msb - 2)) & 3);
+
+    return bucket < MP_SNMP_STATS_BUCKETS ? bucket : MP_SNMP_STATS_BUCKETS - 1;
+}
+
+uint64_t mp_snmp_stats_bucket_le(int bucket) {
+    int msb;
+
+    if (bucket < 4)
+        return (uint64_t) bucket;
+
+    msb = bucket / 4 + 1;
+    return ((uint64_t) (5 + bucket % 4) << (msb - 2)) - 1;
+}
+
+uint64_t mp_snmp_stats_percentile(double p) {
+    uint64_t count = 0;
+    uint64_t rank;
+    uint64_t le;
+    int i;
+
+    for (i = 0; i < MP_SNMP_STATS_BUCKETS; i++)
+        count += mp_snmp_stats.rtt[i];
+    if (count == 0)
+        return 0;
+
+    rank = (uint64_t) (p * count + 0.5);
+    if (rank < 1)
+        rank = 1;
+
+    for (i = 0, count = 0; i < MP_SNMP_STATS_BUCKETS - 1; i++) {
+        count += mp_snmp_stats.rtt[i];
+        if (count >= rank)
+            break;
+    }
+
+    le = mp_snmp_stats_bucket_le(i);
+    return le < mp_snmp_stats.rtt_max ? le : mp_snmp_stats.rtt_max;
+}
+
+void mp_snmp_stats_perfdata(void) {
+    if (!mp_snmp_stats_enabled)
+        return;
+
+    mp_perfdata_int("snmp_pdus", (long int) mp_snmp_stats.pdus, "c", NULL);
+    mp_perfdata_float("snmp_rtt_p50",
+            mp_snmp_stats_percentile(0.5) / 1000.0, "ms", NULL);
+    mp_perfdata_float("snmp_rtt_p95",
+            mp_snmp_stats_percentile(0.95) / 1000.0, "ms", NULL);
+    mp_perfdata_float("snmp_rtt_max",
+            mp_snmp_stats.rtt_max / 1000.0, "ms", NULL);
+    mp_perfdata_int("snmp_retries", (long int) mp_snmp_stats.retries,
+            "c", NULL);
+    mp_perfdata_int("snmp_timeouts", (long int) mp_snmp_stats.timeouts,
+            "c", NULL);
+    mp_perfdata_int("snmp_toobig", (long int) mp_snmp_stats.toobig,
+            "c", NULL);
+    mp_perfdata_int("snmp_bytes_out", (long int) mp_snmp_stats.bytes_out,
+            "B", NULL);
+    mp_perfdata_int("snmp_bytes_in", (long int) mp_snmp_stats.bytes_in,
+            "B", NULL);
+
+    memset(&mp_snmp_stats, 0, sizeof(mp_snmp_stats));
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
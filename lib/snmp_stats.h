@@ -0,0 +1,111 @@
+/***
+ * Monitoring Plugin - snmp_stats.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _SNMP_STATS_H_
+#define _SNMP_STATS_H_
+
+#include "snmp_utils.h"
+
+#include <stdint.h>
+#include <sys/time.h>
+
+/**
+ * RTT histogram buckets. Below 4us a bucket per microsecond, above each
+ * power of two is split in quarters.
+ */
+#define MP_SNMP_STATS_BUCKETS   128
+
+/** Set by --snmp-stats. */
+extern int mp_snmp_stats_enabled;
+
+/**
+ * SNMP transport counters of the plugin run.
+ */
+struct mp_snmp_stats {
+    uint64_t pdus;                          /**< Requests sent */
+    uint64_t bytes_out;                     /**< Approximate bytes sent */
+    uint64_t bytes_in;                      /**< Approximate bytes received */
+    uint64_t retries;                       /**< Retransmissions */
+    uint64_t timeouts;                      /**< Requests without answer */
+    uint64_t toobig;                        /**< tooBig answers */
+    uint64_t rtt_max;                       /**< Max RTT in microseconds */
+    uint64_t rtt[MP_SNMP_STATS_BUCKETS];    /**< RTT histogram */
+};
+
+/** Counters of the plugin run. */
+extern struct mp_snmp_stats mp_snmp_stats;
+
+/**
+ * Count a request about to be sent.
+ * Only call if \ref mp_snmp_stats_enabled is set.
+ *
+ * \param[in] ss session of the request
+ * \param[in] pdu request
+ * \param[out] sent send time to pass to \ref mp_snmp_stats_response
+ */
+void mp_snmp_stats_request(const netsnmp_session *ss, const netsnmp_pdu *pdu,
+                           struct timeval *sent);
+
+/**
+ * Count the answer of a request.
+ * Retransmissions are derived from the RTT and the session timeout.
+ * Only call if \ref mp_snmp_stats_enabled is set.
+ *
+ * \param[in] ss session of the request
+ * \param[in] response response or NULL on timeout
+ * \param[in] sent send time of the request
+ */
+void mp_snmp_stats_response(const netsnmp_session *ss,
+                            const netsnmp_pdu *response,
+                            const struct timeval *sent);
+
+/**
+ * Return the RTT histogram bucket of a RTT.
+ * \param[in] usec RTT in microseconds.
+ * \return Bucket index.
+ */
+int mp_snmp_stats_bucket(uint64_t usec);
+
+/**
+ * Return the upper bound of a RTT histogram bucket.
+ * \param[in] bucket Bucket index.
+ * \return Upper bound in microseconds.
+ */
+uint64_t mp_snmp_stats_bucket_le(int bucket);
+
+/**
+ * Return a RTT percentile of the histogram, capped at the max RTT.
+ * \param[in] p Percentile between 0 and 1.
+ * \return RTT in microseconds.
+ */
+uint64_t mp_snmp_stats_percentile(double p);
+
+/**
+ * Append the counters as perfdata and reset them.
+ * Does nothing unless \ref mp_snmp_stats_enabled is set.
+ */
+void mp_snmp_stats_perfdata(void);
+
+#endif /* _SNMP_STATS_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -23,10 +23,15 @@
 
 #include "mp_common.h"
 #include "snmp_utils.h"
+#include "snmp_async.h"
+#include "snmp_replay.h"
+#include "snmp_stats.h"
+#include "snmp_v3cache.h"
 
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 
+#include <ctype.h>
 #include <getopt.h>
 #include <string.h>
 #include <stdlib.h>
@@ -34,7 +39,10 @@
 #include <stdio.h>
 
 /* Local functions */
-static int copy_value(const netsnmp_variable_list *var, const u_char type,
+static int mp_snmp_synch_response(netsnmp_session *ss, netsnmp_pdu *pdu,
+                                  netsnmp_pdu **response);
+static int copy_value(const u_char var_type, const void *val,
+                      const size_t val_len, const u_char type,
                       size_t target_len, void **target);
 
 char *mp_snmp_community;
@@ -48,25 +56,56 @@ char *mp_snmp_privpass;
 int mp_snmp_timeout = 0;
 int mp_snmp_retries = 0;
 
+/** Set once the MIBs are loaded. */
+static int mp_snmp_mibs = 0;
+
 char *ifOperStatusText[] = {"", "up", "down", "testing", "unknown",
        "dormant", "notPresent", "lowerLayerDown", ""};
 
 extern char* hostname;
-extern int* port;
+extern int port;
+
+/** Set once init_snmp was called. */
+static int mp_snmp_initialized = 0;
 
 netsnmp_session *mp_snmp_init(void) {
+    return mp_snmp_open(hostname, port);
+}
+
+netsnmp_session *mp_snmp_open(const char *host, int host_port) {
 
     netsnmp_session session, *ss;
     int status;
+    int cached = 0;
+
+    if (!mp_snmp_initialized) {
+        /*
+         * Plugins only use numeric OIDs, so skip parsing the MIB directory
+         * unless the user asked for MIBs. See mp_snmp_read_objid.
+         */
+        if (getenv("MIBS") || getenv("MIBDIRS")) {
+            mp_snmp_mibs = 1;
+        } else {
+            setenv("MIBS", "", 1);
+            setenv("MIBDIRS", "", 1);
+        }
 
-    init_snmp(progname);
+        init_snmp(progname);
+
+        netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_DONT_PERSIST_STATE, 1);
+
+        SOCK_STARTUP;
+        mp_snmp_replay_init();
+        mp_snmp_initialized = 1;
+    }
 
     snmp_sess_init( &session );
 
     if (mp_snmp_community == NULL)
         mp_snmp_community = mp_strdup("public");
 
-    mp_asprintf(&(session.peername), "%s:%d", hostname, port);
+    mp_asprintf(&(session.peername), "%s:%d", host, host_port);
 
     switch(mp_snmp_version) {
         case SNMP_VERSION_1:
@@ -96,6 +135,11 @@ netsnmp_session *mp_snmp_init(void) {
             session.securityAuthProtoLen = 10;
             session.securityAuthKeyLen = USM_AUTH_KU_LEN;
 
+            /* Cached localized key and engine skip Ku and discovery */
+            cached = mp_snmp_v3cache_load(&session);
+            if (cached)
+                break;
+
             status = generate_Ku(session.securityAuthProto,
                     session.securityAuthProtoLen,
                     (u_char *) mp_snmp_authpass, strlen(mp_snmp_authpass),
@@ -111,11 +155,10 @@ netsnmp_session *mp_snmp_init(void) {
             break;
     }
 
-    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
-                           NETSNMP_DS_LIB_DONT_PERSIST_STATE, 1);
-
-    SOCK_STARTUP;
-    ss = snmp_open(&session);
+    if (mp_snmp_replay_active())
+        ss = mp_snmp_replay_open(&session);
+    else
+        ss = snmp_open(&session);
 
     if (!ss) {
       snmp_sess_perror("ack", &session);
@@ -124,6 +167,14 @@ netsnmp_session *mp_snmp_init(void) {
     }
 
     free(session.peername);
+    free(session.securityName);
+    free(session.contextName);
+    free(session.securityEngineID);
+    free(session.contextEngineID);
+    free(session.securityAuthLocalKey);
+
+    if (mp_snmp_version == SNMP_VERSION_3 && !mp_snmp_replay_active())
+        mp_snmp_v3cache_opened(ss, cached);
 
     if (mp_snmp_retries > 0)
         ss->retries = mp_snmp_retries;
@@ -135,178 +186,233 @@ netsnmp_session *mp_snmp_init(void) {
 }
 
 void mp_snmp_deinit(void) {
+    if (!mp_snmp_initialized)
+        return;
+    mp_snmp_stats_perfdata();
+    mp_snmp_v3cache_close();
+    mp_snmp_replay_close();
     snmp_shutdown(progname);
     SOCK_CLEANUP;
+    mp_snmp_initialized = 0;
 }
 
+int mp_snmp_parse_oid(const char *str, oid *name, size_t *len) {
+    const char *p = str;
+    unsigned long sub;
+    size_t n = 0;
 
-int mp_snmp_query(netsnmp_session *ss, const mp_snmp_query_cmd *querycmd) {
+    if (*p == '.')
+        p++;
 
-    netsnmp_pdu *pdu;
-    netsnmp_pdu *response;
-    netsnmp_variable_list *vars;
-    int status;
-    const mp_snmp_query_cmd *p;
+    while (*p) {
+        if (!isdigit((unsigned char)*p) || n >= *len)
+            return 0;
 
-    pdu = snmp_pdu_create(SNMP_MSG_GET);
+        sub = 0;
+        while (isdigit((unsigned char)*p)) {
+            sub = sub * 10 + (*p - '0');
+            if (sub > 0xFFFFFFFFUL)
+                return 0;
+            p++;
+        }
+        name[n++] = (oid)sub;
 
-    for(p = querycmd; p->oid_len; p++) {
-        snmp_add_null_var(pdu, p->oid, p->oid_len);
+        if (*p == '.') {
+            p++;
+            if (*p == '\0')
+                return 0;
+        } else if (*p != '\0') {
+            return 0;
+        }
     }
 
-    /* Send the SNMP Query */
-    do {
-        status = snmp_synch_response(ss, pdu, &response);
+    if (n == 0)
+        return 0;
 
-        if (mp_verbose > 3)
-            printf("snmp_synch_response() rc=%d\n", status);
+    *len = n;
+    return 1;
+}
 
-        if (!response)
-            return STAT_ERROR;
+int mp_snmp_read_objid(const char *str, oid *name, size_t *len) {
+    const char *p;
 
-        if (status == STAT_SUCCESS && response->errindex == 0)
-            break;
+    if (mp_snmp_parse_oid(str, name, len))
+        return 1;
 
-        if (mp_verbose > 3)
-            printf(" errindex=%ld\n", response->errindex);
+    /* Only fall back to the MIB parser for symbolic OIDs. */
+    for (p = str; *p == '.' || isdigit((unsigned char)*p); p++)
+        ;
+    if (*p == '\0')
+        return 0;
 
-        pdu = snmp_fix_pdu(response, SNMP_MSG_GET);
-        snmp_free_pdu(response);
-        response = NULL;
-    } while (status == STAT_SUCCESS && pdu);
-
-    if (!response)
-        return status;
-
-    /* Process the response. */
-    if (status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR) {
-        for(vars = response->variables; vars; vars = vars->next_variable) {
-            if (mp_verbose > 1)
-                print_variable(vars->name, vars->name_length, vars);
-            // Skip non existing vars
-            if (vars->type == SNMP_NOSUCHOBJECT ||
-                    vars->type == SNMP_NOSUCHINSTANCE ||
-                    vars->type == SNMP_ENDOFMIBVIEW)
-                continue;
-            for(p = querycmd; p->oid_len; p++) {
-                if (snmp_oid_compare(vars->name, vars->name_length,
-                                     p->oid, p->oid_len) == 0) {
-                    copy_value(vars, p->type, p->target_len, p->target);
-                    break;
-                }
-            }
-        }
-    } else if (status != STAT_SUCCESS) {
-        char *err;
-        snmp_error(ss, NULL, NULL, &err);
+    if (!mp_snmp_mibs) {
+        if (mp_verbose > 1)
+            printf("Loading MIBs for OID %s\n", str);
+        unsetenv("MIBS");
+        unsetenv("MIBDIRS");
+        shutdown_mib();
+        netsnmp_init_mib();
+        mp_snmp_mibs = 1;
+    }
 
-        if (response)
-            snmp_free_pdu(response);
-        mp_snmp_deinit();
+    return read_objid(str, name, len);
+}
+
+
+size_t mp_snmp_oid_size(const oid *name, size_t len) {
+    size_t size = 1;
+    size_t i;
+    oid v;
 
-        critical("SNMP Error: %s", err);
+    for (i = 2; i < len; i++)
+        for (v = name[i], size++; v >= 0x80; v >>= 7, size++);
+
+    return size;
+}
+
+size_t mp_snmp_var_size(const oid *name, size_t name_len, u_char type,
+                        const void *val, size_t val_len) {
+    size_t size = 6 + mp_snmp_oid_size(name, name_len);
+
+    switch (type) {
+        case ASN_OBJECT_ID:
+            size += mp_snmp_oid_size(val, val_len / sizeof(oid));
+            break;
+        case ASN_INTEGER:
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+            size += 5;
+            break;
+        case ASN_COUNTER64:
+            size += 9;
+            break;
+        default:
+            size += val_len;
+            break;
     }
 
-    if (response)
-      snmp_free_pdu(response);
+    return size;
+}
 
-    return status;
+size_t mp_snmp_head_size(const netsnmp_session *ss) {
+    if (ss->version == SNMP_VERSION_3)
+        return 96 + ss->securityNameLen + ss->contextNameLen +
+            2 * ss->contextEngineIDLen;
+    return 32 + ss->community_len;
 }
 
-int mp_snmp_values_fetch1(netsnmp_session *ss,
-                          const mp_snmp_query_cmd *values) {
-    netsnmp_pdu *request;
-    netsnmp_pdu *response;
+size_t mp_snmp_pdu_size(const netsnmp_session *ss, const netsnmp_pdu *pdu) {
     const netsnmp_variable_list *var;
-    const mp_snmp_query_cmd *vp;
-    int rc;
+    size_t size = mp_snmp_head_size(ss);
 
-    /*
-     *  set-up request
-     */
-    request = snmp_pdu_create(SNMP_MSG_GET);
-    for (vp = values; vp->oid_len && vp->oid; vp++) {
-        snmp_add_null_var(request, vp->oid, vp->oid_len);
-    }
+    for (var = pdu->variables; var; var = var->next_variable)
+        size += mp_snmp_var_size(var->name, var->name_length, var->type,
+                                 var->val.string, var->val_len);
 
-    /*
-     * commence request
-     */
-    do {
-        rc = snmp_synch_response(ss, request, &response);
+    return size;
+}
 
-        if (mp_verbose > 3)
-            printf("snmp_synch_response(): rc=%d\n", rc);
+netsnmp_pdu *mp_snmp_query_pdu(const mp_snmp_query_cmd *querycmd) {
+    netsnmp_pdu *pdu;
+    const mp_snmp_query_cmd *p;
 
-        /* no result, so something went wrong ... */
-        if (!response)
-            return STAT_ERROR;
+    pdu = snmp_pdu_create(SNMP_MSG_GET);
 
-        if ((rc == STAT_SUCCESS) && (response->errindex == 0))
-            break;
+    for(p = querycmd; p->oid_len; p++) {
+        snmp_add_null_var(pdu, p->oid, p->oid_len);
+    }
 
-        /* rety with fixed request */
-        request = snmp_fix_pdu(response, SNMP_MSG_GET);
-        snmp_free_pdu(response);
-        response = NULL;
-    } while (request && (rc == STAT_SUCCESS));
+    return pdu;
+}
 
-    /*
-     * process results
-     */
-    if ((rc == STAT_SUCCESS) && response) {
-        if (response->errstat == SNMP_ERR_NOERROR) {
-            /*
-             * extract values from response
-             */
-            for(var = response->variables; var; var = var->next_variable) {
-                for (vp = values; vp->oid_len && vp->oid; vp++) {
-                    if (snmp_oid_compare(var->name, var->name_length,
-                                         vp->oid, vp->oid_len) == 0) {
-                        if (mp_verbose > 1)
-                            print_variable(var->name, var->name_length, var);
-
-                        /* copy value, if not erroneous */
-                        if ((var->type != SNMP_NOSUCHOBJECT) &&
-                            (var->type != SNMP_NOSUCHINSTANCE) &&
-                            (var->type != SNMP_ENDOFMIBVIEW))
-                            copy_value(var, vp->type,
-                                       vp->target_len, vp->target);
-                        else
-                            if (mp_verbose > 2)
-                                printf("OID not available: type=0x%X\n",
-                                       var->type);
-
-                        /* short-circuit to next result variable */
-                        break;
-                    }
-                }
+void mp_snmp_query_copy(const mp_snmp_query_cmd *querycmd,
+                        const netsnmp_pdu *response) {
+    netsnmp_variable_list *vars;
+    const mp_snmp_query_cmd *p;
+
+    for(vars = response->variables; vars; vars = vars->next_variable) {
+        if (mp_verbose > 1)
+            print_variable(vars->name, vars->name_length, vars);
+        // Skip non existing vars
+        if (vars->type == SNMP_NOSUCHOBJECT ||
+                vars->type == SNMP_NOSUCHINSTANCE ||
+                vars->type == SNMP_ENDOFMIBVIEW)
+            continue;
+        for(p = querycmd; p->oid_len; p++) {
+            if (snmp_oid_compare(vars->name, vars->name_length,
+                                 p->oid, p->oid_len) == 0) {
+                copy_value(vars->type, vars->val.string, vars->val_len,
+                           p->type, p->target_len, p->target);
+                break;
             }
-        } else if ((ss->version == SNMP_VERSION_1) &&
-                   (response->errstat == SNMP_ERR_NOSUCHNAME)) {
-            if (mp_verbose > 3)
-                printf("SNMP-V1: end of tree\n");
-        } else {
-            /*
-             * some other error occured
-             */
-            if (mp_verbose > 0)
-                printf("SNMP error: respose->errstat = %ld",
-                       response->errstat);
-            rc = STAT_ERROR;
         }
-    } else {
-        /*
-         * no response (i.e. all vars have been removed by
-         * snmp_pid_fixup()) go ahead an assume an error
-         */
-        rc = STAT_ERROR;
     }
+}
 
-    if (response)
-        snmp_free_pdu(response);
+/**
+ * Run the querys on the async engine, error is set unless it succeeds.
+ */
+static int mp_snmp_query_run(netsnmp_session *ss,
+                             const mp_snmp_query_cmd *querycmd, char **error) {
+    mp_snmp_agent agent;
+    int retry;
 
-    return rc;
+    memset(&agent, 0, sizeof(agent));
+    agent.host = ss->peername;
+    agent.ss = ss;
+
+    /* A session opened from the SNMPv3 cache gets one rediscovery */
+    retry = mp_snmp_v3cache_cached(ss);
+
+    /* The GETs are packed and pipelined by the async engine */
+    do {
+        agent.status = STAT_SUCCESS;
+        free(agent.error);
+        agent.error = NULL;
+
+        mp_snmp_async_query(&agent, querycmd);
+        if (mp_snmp_async_run() != OK)
+            unknown("SNMP event loop failed.");
+    } while (agent.status != STAT_SUCCESS && retry-- > 0 &&
+             mp_snmp_v3cache_recover(ss));
+
+    if (mp_verbose > 3)
+        printf("mp_snmp_query() rc=%d\n", agent.status);
+
+    *error = agent.error;
+
+    return agent.status;
+}
+
+int mp_snmp_query(netsnmp_session *ss, const mp_snmp_query_cmd *querycmd) {
+    char *err = NULL;
+    int status;
+
+    status = mp_snmp_query_run(ss, querycmd, &err);
+
+    if (status != STAT_SUCCESS) {
+        mp_snmp_deinit();
+        critical("SNMP Error: %s", err ? err : "Unknown error");
+    }
+
+    return status;
+}
+
+int mp_snmp_values_fetch1(netsnmp_session *ss,
+                          const mp_snmp_query_cmd *values) {
+    char *err = NULL;
+    int status;
+
+    /* Planned like mp_snmp_query, packed, split on tooBig and
+     * resent without failing varbinds, but errors are returned */
+    status = mp_snmp_query_run(ss, values, &err);
+
+    if (status != STAT_SUCCESS && mp_verbose > 0)
+        printf("SNMP error: %s\n", err);
+    free(err);
+
+    return status;
 }
 
 
@@ -322,11 +428,11 @@ int mp_snmp_values_fetch2(netsnmp_session *ss,
         ;
 
     oid_values = (mp_snmp_query_cmd *)
-        mp_malloc(count * sizeof(mp_snmp_query_cmd));
+        mp_calloc(count + 1, sizeof(mp_snmp_query_cmd));
 
     for (vp1 = values, vp2 = oid_values; vp1->oid; vp1++, vp2++) {
         vp2->oid_len = MAX_OID_LEN;
-        if (!read_objid(vp1->oid, vp2->oid, &vp2->oid_len)) {
+        if (!mp_snmp_read_objid(vp1->oid, vp2->oid, &vp2->oid_len)) {
             if (mp_verbose > 3)
                 printf("Invalid OID: %s\n", vp1->oid);
             goto done;
@@ -359,7 +465,7 @@ int mp_snmp_values_fetch3(netsnmp_session *ss,
         ;
 
     oid_values = (mp_snmp_query_cmd *)
-        mp_malloc(count * sizeof(mp_snmp_query_cmd));
+        mp_calloc(count + 1, sizeof(mp_snmp_query_cmd));
 
     for (vp1 = values, vp2 = oid_values; vp1->oid; vp1++, vp2++) {
         va_start(ap, values);
@@ -367,7 +473,7 @@ int mp_snmp_values_fetch3(netsnmp_session *ss,
         va_end(ap);
 
         vp2->oid_len = MAX_OID_LEN;
-        if (!read_objid(formatted_oid, vp2->oid, &vp2->oid_len)) {
+        if (!mp_snmp_read_objid(formatted_oid, vp2->oid, &vp2->oid_len)) {
             if (mp_verbose > 3)
                 printf("Invalid OID: %s\n", vp1->oid);
             goto done;
@@ -385,6 +491,98 @@ int mp_snmp_values_fetch3(netsnmp_session *ss,
 }
 
 
+netsnmp_pdu *mp_snmp_subtree_pdu(netsnmp_session *ss,
+                                 const oid *last_oid,
+                                 const size_t last_len) {
+    netsnmp_pdu *request;
+
+    if (ss->version == SNMP_VERSION_1) {
+        request = snmp_pdu_create(SNMP_MSG_GETNEXT);
+    } else {
+        request = snmp_pdu_create(SNMP_MSG_GETBULK);
+        request->non_repeaters   = 0;
+        request->max_repetitions = 16;
+    }
+    snmp_add_null_var(request, last_oid, last_len);
+
+    if (mp_verbose > 2) {
+        char buf[128];
+
+        snprint_objid((char *) &buf, sizeof(buf), last_oid, last_len);
+        printf("Fetching next from OID %s\n", buf);
+    }
+
+    return request;
+}
+
+
+int mp_snmp_subtree_response(netsnmp_session *ss,
+                             netsnmp_pdu *response,
+                             const oid *subtree_oid,
+                             const size_t subtree_len,
+                             oid *last_oid,
+                             size_t *last_len,
+                             mp_snmp_subtree *subtree) {
+    netsnmp_variable_list *var;
+
+    if ((ss->version == SNMP_VERSION_1) &&
+        (response->errstat == SNMP_ERR_NOSUCHNAME)) {
+        if (mp_verbose > 3)
+            printf("SNMP-V1: end of tree\n");
+        return 0;
+    }
+
+    if (response->errstat != SNMP_ERR_NOERROR) {
+        /*
+         * some other error occured
+         */
+        if (mp_verbose > 0)
+            printf("SNMP error: respose->errstat = %ld",
+                   response->errstat);
+        return -1;
+    }
+
+    /*
+     * loop over results (may only be one result in case of SNMP v1)
+     */
+    for (var = response->variables; var; var = var->next_variable) {
+
+        /*
+         * check, if OIDs are incresing to prevent infinite
+         * loop with broken SNMP agents
+         */
+        if (snmp_oidtree_compare(var->name, var->name_length,
+                                 last_oid, *last_len) < 0)
+            return -2;
+
+        /*
+         * terminate, if oid does not belong to subtree anymore
+         */
+        if ((var->type == SNMP_ENDOFMIBVIEW) ||
+            (snmp_oidtree_compare(subtree_oid,
+                                  subtree_len,
+                                  var->name,
+                                  var->name_length) != 0))
+            return 0;
+
+        if (mp_verbose > 2)
+            print_variable(var->name, var->name_length, var);
+
+        if (var->type != SNMP_NOSUCHOBJECT &&
+            var->type != SNMP_NOSUCHINSTANCE)
+            mp_snmp_subtree_add(subtree, var);
+
+        /*
+         * save last fetched oid
+         */
+        memcpy(last_oid, var->name, var->name_length * sizeof(oid));
+        *last_len = var->name_length;
+    } /* for */
+
+    return response->variables ? 1 : 0;
+}
+
+
 int mp_snmp_subtree_query(netsnmp_session *ss,
                            const oid *subtree_oid,
                            const size_t subtree_len,
@@ -394,132 +592,44 @@ int mp_snmp_subtree_query(netsnmp_session *ss,
     size_t last_len;
     netsnmp_pdu *request  = NULL;
     netsnmp_pdu *response = NULL;
-    netsnmp_variable_list *var;
-    size_t alloc_size = 0;
-    int rc;
+    int rc, more;
 
     /* prepare result */
     memset(subtree, '\0', sizeof(*subtree));
-    subtree->vars = NULL;
 
     memcpy(last_oid, subtree_oid, subtree_len * sizeof(oid));
     last_len = subtree_len;
 
-    for (;;) {
-        /*
-         * setup request
-         */
-        if (ss->version == SNMP_VERSION_1) {
-            request = snmp_pdu_create(SNMP_MSG_GETNEXT);
-        } else {
-            request = snmp_pdu_create(SNMP_MSG_GETBULK);
-            request->non_repeaters   = 0;
-            request->max_repetitions = 16;
-        }
-        snmp_add_null_var(request, last_oid, last_len);
-
-        /*
-         * commence request
-         */
-        if (response) {
-            snmp_free_pdu(response);
-            response = NULL;
-        }
-
-        if (mp_verbose > 2) {
-            char buf[128];
-
-            snprint_objid((char *) &buf, sizeof(buf), last_oid, last_len);
-            printf("Fetching next from OID %s\n", buf);
-        }
+    do {
+        request = mp_snmp_subtree_pdu(ss, last_oid, last_len);
 
-        rc = snmp_synch_response(ss, request, &response);
+        rc = mp_snmp_synch_response(ss, request, &response);
 
         if (mp_verbose > 3)
-            printf("snmp_synch_response(): rc=%d, errstat=%ld\n",
-                   rc, response->errstat);
-
-        if ((rc == STAT_SUCCESS) && response) {
-            if (response->errstat == SNMP_ERR_NOERROR) {
-                /*
-                 * loop over results (may only be one result in case of SNMP v1)
-                 */
-                for (var = response->variables; var; var = var->next_variable) {
-
-                    /*
-                     * check, if OIDs are incresing to prevent infinite
-                     * loop with broken SNMP agents
-                     */
-                    if (snmp_oidtree_compare(var->name, var->name_length,
-                                             last_oid, last_len) < 0) {
-                        if (response)
-                            snmp_free_pdu(response);
-
-                        mp_snmp_deinit();
-
-                        critical("SNMP error: OIDs are not incresing");
-                    }
-
-                    /*
-                     * terminate, if oid does not belong to subtree anymore
-                     */
-                    if ((var->type == SNMP_ENDOFMIBVIEW) ||
-                        (snmp_oidtree_compare(subtree_oid,
-                                              subtree_len,
-                                              var->name,
-                                              var->name_length) != 0)) {
-                        snmp_free_pdu(response);
-                        return rc;
-                    }
-
-                    if (mp_verbose > 2)
-                        print_variable(var->name, var->name_length, var);
-
-                    if (var->type != SNMP_NOSUCHOBJECT ||
-                        var->type != SNMP_NOSUCHINSTANCE) {
-                        if (alloc_size <= subtree->size) {
-                            alloc_size += 16;
-                            subtree->vars =
-                                mp_realloc(subtree->vars,
-                                           alloc_size *
-                                           sizeof(netsnmp_variable_list*));
-                        }
-
-                        subtree->vars[subtree->size] =
-                            mp_malloc(sizeof(netsnmp_variable_list));
-                        snmp_clone_var(var, subtree->vars[subtree->size]);
-                        subtree->size++;
-                    }
-
-                    /*
-                     * save last fetched oid
-                     */
-                    memcpy(last_oid, var->name,
-                           var->name_length * sizeof(oid));
-                    last_len = var->name_length;
-                } /* for */
-            } else if ((ss->version == SNMP_VERSION_1) &&
-                       (response->errstat == SNMP_ERR_NOSUCHNAME)) {
-                if (mp_verbose > 3)
-                    printf("SNMP-V1: end of tree\n");
-            } else {
-                /*
-                 * some other error occured
-                 */
-                if (mp_verbose > 0)
-                    printf("SNMP error: respose->errstat = %ld",
-                           response->errstat);
+            printf("snmp_synch_response(): rc=%d\n", rc);
 
-                rc = STAT_ERROR;
-                //goto done;
-                break;
-            }
-        } else {
+        if ((rc != STAT_SUCCESS) || !response) {
             /* no response, assume an error */
             rc = STAT_ERROR;
             break;
         }
-    }
+
+        more = mp_snmp_subtree_response(ss, response, subtree_oid,
+                                        subtree_len, last_oid, &last_len,
+                                        subtree);
+        if (more == -2) {
+            snmp_free_pdu(response);
+
+            mp_snmp_deinit();
+
+            critical("SNMP error: OIDs are not incresing");
+        }
+        if (more < 0)
+            rc = STAT_ERROR;
+
+        snmp_free_pdu(response);
+        response = NULL;
+    } while (more > 0);
 
     if (response)
         snmp_free_pdu(response);
@@ -533,7 +643,7 @@ int mp_snmp_subtree_query_string(netsnmp_session *ss, const char *subtree_oid,
     oid subtree_oid_prefix[MAX_OID_LEN];
     size_t subtree_oid_prefix_len = MAX_OID_LEN;
 
-    if (!read_objid(subtree_oid, subtree_oid_prefix, &subtree_oid_prefix_len)) {
+    if (!mp_snmp_read_objid(subtree_oid, subtree_oid_prefix, &subtree_oid_prefix_len)) {
         if (mp_verbose > 3)
             printf("Invalid OID: %s\n", subtree_oid);
 
@@ -552,18 +662,22 @@ int mp_snmp_subtree_get_value(const mp_snmp_subtree *subtree,
                                const u_char type,
                                void **target,
                                const size_t target_len) {
+    const mp_snmp_varbind *vb;
     size_t i, j = 0;
 
     if (!subtree || (subtree->size < 1))
         return 0;
 
     for (i = 0; i < subtree->size; i++) {
+        vb = &subtree->vars[i];
         if (snmp_oidtree_compare(oid_prefix,
                                  oid_prefix_len,
-                                 subtree->vars[i]->name,
-                                 subtree->vars[i]->name_length) == 0) {
+                                 mp_snmp_varbind_name(subtree, vb),
+                                 vb->name_len) == 0) {
             if (j == idx) {
-                return copy_value(subtree->vars[i], type, target_len, target);
+                return copy_value(vb->type,
+                                  mp_snmp_varbind_value(subtree, vb),
+                                  vb->val_len, type, target_len, target);
             }
             j++;
         }
@@ -584,7 +698,7 @@ int mp_snmp_subtree_get_value_string(const mp_snmp_subtree *subtree,
     if (!subtree || (subtree->size < 1))
         return 0;
 
-    if (!read_objid(value_oid, oid_prefix, &oid_prefix_len)) {
+    if (!mp_snmp_read_objid(value_oid, oid_prefix, &oid_prefix_len)) {
         if (mp_verbose > 3)
             printf("Invalid OID: %s\n", value_oid);
 
@@ -610,7 +724,7 @@ int mp_snmp_subtree_get_values(const mp_snmp_subtree *subtree,
 
     for (vp = values; vp->oid; vp++) {
         oid_prefix_len = MAX_OID_LEN;
-        read_objid(vp->oid, oid_prefix, &oid_prefix_len);
+        mp_snmp_read_objid(vp->oid, oid_prefix, &oid_prefix_len);
 
         if (mp_snmp_subtree_get_value(subtree, oid_prefix, oid_prefix_len,
                                        idx, vp->type, vp->target,
@@ -622,29 +736,634 @@ int mp_snmp_subtree_get_values(const mp_snmp_subtree *subtree,
 }
 
 
+/**
+ * Reserve len bytes in the subtree arena and return their offset.
+ * Chunks are aligned for oid and long access.
+ */
+static size_t subtree_arena_alloc(mp_snmp_subtree *subtree, size_t len) {
+    size_t off;
+
+    off = (subtree->arena_len + sizeof(oid) - 1) & ~(sizeof(oid) - 1);
+    if (off + len > subtree->arena_alloc) {
+        subtree->arena_alloc = subtree->arena_alloc ?
+            subtree->arena_alloc * 2 : 4096;
+        while (off + len > subtree->arena_alloc)
+            subtree->arena_alloc *= 2;
+        subtree->arena = mp_realloc(subtree->arena, subtree->arena_alloc);
+    }
+    subtree->arena_len = off + len;
+
+    return off;
+}
+
+
+void mp_snmp_subtree_add(mp_snmp_subtree *subtree,
+                         const netsnmp_variable_list *var) {
+    mp_snmp_varbind *vb;
+
+    if (subtree->size >= subtree->alloc) {
+        subtree->alloc = subtree->alloc ? subtree->alloc * 2 : 64;
+        subtree->vars = mp_realloc(subtree->vars,
+                                   subtree->alloc * sizeof(mp_snmp_varbind));
+    }
+
+    vb = &subtree->vars[subtree->size++];
+    vb->type = var->type;
+    vb->name_len = var->name_length;
+    vb->val_len = var->val_len;
+    vb->name_off = subtree_arena_alloc(subtree,
+                                       var->name_length * sizeof(oid));
+    memcpy(subtree->arena + vb->name_off, var->name,
+           var->name_length * sizeof(oid));
+    vb->val_off = subtree_arena_alloc(subtree, var->val_len);
+    if (var->val_len)
+        memcpy(subtree->arena + vb->val_off, var->val.string, var->val_len);
+}
+
+
 void mp_snmp_subtree_free(mp_snmp_subtree *subtree) {
+    if (!subtree)
+        return;
+
+    free(subtree->vars);
+    free(subtree->arena);
+    memset(subtree, 0, sizeof(*subtree));
+}
+
+
+/**
+ * FNV-1a hash of a row index.
+ */
+static size_t table_hash(const oid *index, size_t index_len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
     size_t i;
 
-    if (!subtree || (subtree->size < 1))
-        return;
+    for (i = 0; i < index_len; i++) {
+        h ^= (uint64_t) index[i];
+        h *= 0x100000001b3ULL;
+    }
+    return (size_t) (h ^ (h >> 32));
+}
 
-    for (i = 0; i < subtree->size; i++) {
-        free(subtree->vars[i]);
+/**
+ * Lookup a row index in the table hash.
+ * Returns the hash slot holding the row or the free slot to insert it.
+ */
+static size_t table_slot(const struct mp_snmp_table *table,
+                         const oid *index, size_t index_len) {
+    size_t mask = table->hash_size - 1;
+    size_t slot = table_hash(index, index_len) & mask;
+    int r;
+
+    while ((r = table->hash[slot]) >= 0) {
+        if (table->index_len[r] == index_len &&
+            memcmp(table->index + table->index_off[r], index,
+                   index_len * sizeof(oid)) == 0)
+            break;
+        slot = (slot + 1) & mask;
     }
-    free(subtree->vars);
+    return slot;
+}
+
+/**
+ * Find a column sub-identifier in the sorted column list.
+ * Returns the position of the column or the position to insert it.
+ */
+static int table_column(const oid *column, int col, oid c) {
+    int lo = 0, hi = col;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (column[mid] < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+int mp_snmp_table_query(netsnmp_session *ss,
+                        const oid *entry_oid,
+                        const size_t entry_len,
+                        struct mp_snmp_table *table) {
+    mp_snmp_subtree subtree;
+    int rc;
+
+    memset(table, 0, sizeof(*table));
+
+    rc = mp_snmp_subtree_query(ss, entry_oid, entry_len, &subtree);
+    if (rc != STAT_SUCCESS) {
+        mp_snmp_subtree_free(&subtree);
+        return rc;
+    }
+
+    if (mp_snmp_table_build(&subtree, entry_oid, entry_len, table) != OK)
+        return STAT_ERROR;
+
+    return rc;
+}
+
+
+int mp_snmp_table_query_columns(netsnmp_session *ss,
+                                const oid *entry_oid,
+                                const size_t entry_len,
+                                const oid *columns,
+                                const size_t num_columns,
+                                struct mp_snmp_table *table) {
+    mp_snmp_subtree subtree;
+    netsnmp_pdu *request;
+    netsnmp_pdu *response = NULL;
+    netsnmp_variable_list *var;
+    oid (*last_oid)[MAX_OID_LEN];
+    size_t *last_len;
+    size_t *active;
+    char *finished;
+    size_t num_active, asked, requested, received, bytes, i, k;
+    long repetitions = MP_SNMP_BULK_START;
+    long too_big = MP_SNMP_BULK_MAX + 1;
+    int rc = STAT_SUCCESS;
+
+    memset(table, 0, sizeof(*table));
+    memset(&subtree, 0, sizeof(subtree));
+
+    if (entry_len + 1 > MAX_OID_LEN)
+        return STAT_ERROR;
+
+    last_oid = mp_malloc(num_columns * sizeof(*last_oid));
+    last_len = mp_malloc(num_columns * sizeof(size_t));
+    active = mp_malloc(num_columns * sizeof(size_t));
+    finished = mp_calloc(num_columns, sizeof(char));
+
+    for (i = 0; i < num_columns; i++) {
+        memcpy(last_oid[i], entry_oid, entry_len * sizeof(oid));
+        last_oid[i][entry_len] = columns[i];
+        last_len[i] = entry_len + 1;
+        active[i] = i;
+    }
+    num_active = num_columns;
+
+    while (num_active > 0) {
+        /*
+         * setup request, one varbind per column still walked
+         */
+        if (ss->version == SNMP_VERSION_1) {
+            request = snmp_pdu_create(SNMP_MSG_GETNEXT);
+            requested = num_active;
+        } else {
+            request = snmp_pdu_create(SNMP_MSG_GETBULK);
+            request->non_repeaters   = 0;
+            request->max_repetitions = repetitions;
+            requested = num_active * repetitions;
+        }
+        for (k = 0; k < num_active; k++)
+            snmp_add_null_var(request, last_oid[active[k]],
+                              last_len[active[k]]);
+
+        if (mp_verbose > 2)
+            printf("Fetching %zu columns, %zu varbinds\n",
+                   num_active, requested);
+
+        rc = mp_snmp_synch_response(ss, request, &response);
+
+        if (rc != STAT_SUCCESS || !response) {
+            /* no response, assume an error */
+            if (rc == STAT_SUCCESS)
+                rc = STAT_ERROR;
+            break;
+        }
+
+        if (response->errstat == SNMP_ERR_TOOBIG && repetitions > 1) {
+            /* never grow back to a size the agent refused */
+            too_big = repetitions;
+            repetitions /= 2;
+            if (mp_verbose > 3)
+                printf("SNMP tooBig: retry with %ld repetitions\n",
+                       repetitions);
+            snmp_free_pdu(response);
+            response = NULL;
+            continue;
+        }
+
+        if ((ss->version == SNMP_VERSION_1) &&
+            (response->errstat == SNMP_ERR_NOSUCHNAME) &&
+            (response->errindex > 0) &&
+            ((size_t) response->errindex <= num_active)) {
+            /* errindex points to the column which reached the end */
+            if (mp_verbose > 3)
+                printf("SNMP-V1: end of tree\n");
+            k = response->errindex - 1;
+            memmove(active + k, active + k + 1,
+                    (num_active - k - 1) * sizeof(size_t));
+            num_active--;
+            snmp_free_pdu(response);
+            response = NULL;
+            continue;
+        }
+
+        if (response->errstat != SNMP_ERR_NOERROR) {
+            /*
+             * some other error occured
+             */
+            if (mp_verbose > 0)
+                printf("SNMP error: respose->errstat = %ld",
+                       response->errstat);
+            rc = STAT_ERROR;
+            break;
+        }
+
+        /*
+         * varbinds repeat the requested columns in request order
+         */
+        received = bytes = 0;
+        for (var = response->variables, k = 0; var;
+             var = var->next_variable, k = (k + 1) % num_active) {
+            i = active[k];
+            received++;
+            bytes += var->name_length + var->val_len + 8;
+
+            if (finished[i])
+                continue;
+
+            if ((var->type == SNMP_ENDOFMIBVIEW) ||
+                (snmp_oidtree_compare(last_oid[i], entry_len + 1,
+                                      var->name, var->name_length) != 0)) {
+                finished[i] = 1;
+                continue;
+            }
+
+            /*
+             * check, if OIDs are incresing to prevent infinite
+             * loop with broken SNMP agents
+             */
+            if (snmp_oid_compare(var->name, var->name_length,
+                                 last_oid[i], last_len[i]) <= 0) {
+                snmp_free_pdu(response);
+
+                mp_snmp_deinit();
+
+                critical("SNMP error: OIDs are not incresing");
+            }
+
+            if (mp_verbose > 2)
+                print_variable(var->name, var->name_length, var);
+
+            if (var->type != SNMP_NOSUCHOBJECT &&
+                var->type != SNMP_NOSUCHINSTANCE)
+                mp_snmp_subtree_add(&subtree, var);
+
+            memcpy(last_oid[i], var->name, var->name_length * sizeof(oid));
+            last_len[i] = var->name_length;
+        }
+        snmp_free_pdu(response);
+        response = NULL;
+
+        if (received == 0) {
+            rc = STAT_ERROR;
+            break;
+        }
+
+        asked = num_active;
+        for (i = k = 0; k < num_active; k++)
+            if (!finished[active[k]])
+                active[i++] = active[k];
+        num_active = i;
+
+        if (num_active == 0 || ss->version == SNMP_VERSION_1)
+            continue;
+
+        /*
+         * size the next request: shrink to what the agent fit into a
+         * truncated response, grow towards MP_SNMP_BULK_BYTES otherwise
+         */
+        if (received < requested) {
+            repetitions = received / asked;
+        } else {
+            long fit = MP_SNMP_BULK_BYTES / (bytes / received) / num_active;
+            repetitions = fit < repetitions * 2 ? fit : repetitions * 2;
+        }
+        if (repetitions >= too_big)
+            repetitions = too_big - 1;
+        if (repetitions > MP_SNMP_BULK_MAX)
+            repetitions = MP_SNMP_BULK_MAX;
+        if (repetitions < 1)
+            repetitions = 1;
+    }
+
+    if (response)
+        snmp_free_pdu(response);
+    free(last_oid);
+    free(last_len);
+    free(active);
+    free(finished);
+
+    if (rc != STAT_SUCCESS) {
+        mp_snmp_subtree_free(&subtree);
+        return rc;
+    }
+
+    if (mp_snmp_table_build(&subtree, entry_oid, entry_len, table) != OK)
+        return STAT_ERROR;
+
+    return rc;
+}
+
+
+int mp_snmp_table_build(mp_snmp_subtree *subtree,
+                        const oid *entry_oid,
+                        const size_t entry_len,
+                        struct mp_snmp_table *table) {
+    const mp_snmp_varbind *vb;
+    const oid *name;
+    int *rows;
+    size_t i, index_size = 0;
+    int c;
+
+    memset(table, 0, sizeof(*table));
+    table->subtree = *subtree;
     subtree->size = 0;
     subtree->vars = NULL;
+
+    if (table->subtree.size == 0)
+        return OK;
+
+    /* Collect columns and index space. */
+    for (i = 0; i < table->subtree.size; i++) {
+        vb = &table->subtree.vars[i];
+        name = mp_snmp_varbind_name(&table->subtree, vb);
+        if (vb->name_len <= entry_len + 1 ||
+            snmp_oidtree_compare(entry_oid, entry_len,
+                                 name, vb->name_len) != 0)
+            continue;
+
+        index_size += vb->name_len - entry_len - 1;
+
+        c = table_column(table->column, table->col, name[entry_len]);
+        if (c < table->col && table->column[c] == name[entry_len])
+            continue;
+        table->column = mp_realloc(table->column,
+                                   (table->col + 1) * sizeof(oid));
+        memmove(table->column + c + 1, table->column + c,
+                (table->col - c) * sizeof(oid));
+        table->column[c] = name[entry_len];
+        table->col++;
+    }
+
+    if (table->col == 0)
+        return OK;
+
+    /* Assign rows in walk order. */
+    table->hash_size = 16;
+    while (table->hash_size < 2 * table->subtree.size)
+        table->hash_size <<= 1;
+    table->hash = mp_malloc(table->hash_size * sizeof(int));
+    memset(table->hash, 0xff, table->hash_size * sizeof(int));
+    table->index = mp_malloc(index_size * sizeof(oid));
+    table->index_off = mp_malloc(table->subtree.size * sizeof(size_t));
+    table->index_len = mp_malloc(table->subtree.size * sizeof(size_t));
+    rows = mp_malloc(table->subtree.size * sizeof(int));
+
+    index_size = 0;
+    for (i = 0; i < table->subtree.size; i++) {
+        const oid *index;
+        size_t index_len, slot;
+
+        vb = &table->subtree.vars[i];
+        name = mp_snmp_varbind_name(&table->subtree, vb);
+        rows[i] = -1;
+        if (vb->name_len <= entry_len + 1 ||
+            snmp_oidtree_compare(entry_oid, entry_len,
+                                 name, vb->name_len) != 0)
+            continue;
+
+        index = name + entry_len + 1;
+        index_len = vb->name_len - entry_len - 1;
+
+        slot = table_slot(table, index, index_len);
+        if (table->hash[slot] < 0) {
+            memcpy(table->index + index_size, index, index_len * sizeof(oid));
+            table->index_off[table->row] = index_size;
+            table->index_len[table->row] = index_len;
+            index_size += index_len;
+            table->hash[slot] = table->row++;
+        }
+        rows[i] = table->hash[slot];
+    }
+
+    /* Fill the cells. */
+    table->var = mp_calloc((size_t) table->col * table->row,
+                           sizeof(mp_snmp_varbind *));
+    for (i = 0; i < table->subtree.size; i++) {
+        if (rows[i] < 0)
+            continue;
+        vb = &table->subtree.vars[i];
+        name = mp_snmp_varbind_name(&table->subtree, vb);
+        c = table_column(table->column, table->col, name[entry_len]);
+        table->var[c * table->row + rows[i]] = vb;
+    }
+    free(rows);
+
+    return OK;
 }
 
 
-static int copy_value(const netsnmp_variable_list *var, const u_char type,
+const mp_snmp_varbind *mp_snmp_table_get(const struct mp_snmp_table *table,
+                                         const oid column,
+                                         const int row) {
+    int c;
+
+    if (!table || row < 0 || row >= table->row)
+        return NULL;
+
+    c = table_column(table->column, table->col, column);
+    if (c >= table->col || table->column[c] != column)
+        return NULL;
+
+    return table->var[c * table->row + row];
+}
+
+
+int mp_snmp_table_get_value(const struct mp_snmp_table *table,
+                            const oid column,
+                            const int row,
+                            const u_char type,
+                            void **target,
+                            const size_t target_len) {
+    const mp_snmp_varbind *vb;
+
+    vb = mp_snmp_table_get(table, column, row);
+    if (!vb)
+        return 0;
+
+    return copy_value(vb->type, mp_snmp_varbind_value(&table->subtree, vb),
+                      vb->val_len, type, target_len, target);
+}
+
+
+int mp_snmp_table_get_integer(const struct mp_snmp_table *table,
+                              const oid column,
+                              const int row,
+                              long *value) {
+    const mp_snmp_varbind *vb;
+    const void *val;
+
+    vb = mp_snmp_table_get(table, column, row);
+    if (!vb)
+        return 0;
+    val = mp_snmp_varbind_value(&table->subtree, vb);
+
+    switch (vb->type) {
+        case ASN_INTEGER:
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+            *value = *(const long *) val;
+            return 1;
+    }
+    if (mp_verbose > 1)
+        printf("TYPE Mismatch: unexpected type 0x%X\n", vb->type);
+    return 0;
+}
+
+
+int mp_snmp_table_get_counter64(const struct mp_snmp_table *table,
+                                const oid column,
+                                const int row,
+                                uint64_t *value) {
+    const mp_snmp_varbind *vb;
+    const void *val;
+
+    vb = mp_snmp_table_get(table, column, row);
+    if (!vb)
+        return 0;
+    val = mp_snmp_varbind_value(&table->subtree, vb);
+
+    switch (vb->type) {
+        case ASN_COUNTER64:
+            *value = ((uint64_t) ((const struct counter64 *) val)->high << 32) |
+                     (((const struct counter64 *) val)->low & 0xffffffffUL);
+            return 1;
+        case ASN_INTEGER:
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+            *value = (uint64_t) *(const unsigned long *) val & 0xffffffffUL;
+            return 1;
+    }
+    if (mp_verbose > 1)
+        printf("TYPE Mismatch: unexpected type 0x%X\n", vb->type);
+    return 0;
+}
+
+
+char *mp_snmp_table_get_string(const struct mp_snmp_table *table,
+                               const oid column,
+                               const int row) {
+    const mp_snmp_varbind *vb;
+    char *str;
+
+    vb = mp_snmp_table_get(table, column, row);
+    if (!vb || vb->type != ASN_OCTET_STR)
+        return NULL;
+
+    str = mp_malloc(vb->val_len + 1);
+    memcpy(str, mp_snmp_varbind_value(&table->subtree, vb), vb->val_len);
+    str[vb->val_len] = '\0';
+
+    return str;
+}
+
+
+int mp_snmp_table_find(const struct mp_snmp_table *table,
+                       const oid *index,
+                       const size_t index_len) {
+    if (!table || table->row == 0)
+        return -1;
+
+    return table->hash[table_slot(table, index, index_len)];
+}
+
+
+const oid *mp_snmp_table_index(const struct mp_snmp_table *table,
+                               const int row,
+                               size_t *index_len) {
+    if (!table || row < 0 || row >= table->row) {
+        *index_len = 0;
+        return NULL;
+    }
+
+    *index_len = table->index_len[row];
+    return table->index + table->index_off[row];
+}
+
+
+void mp_snmp_table_free(struct mp_snmp_table *table) {
+    if (!table)
+        return;
+
+    free(table->var);
+    free(table->column);
+    free(table->index);
+    free(table->index_off);
+    free(table->index_len);
+    free(table->hash);
+    mp_snmp_subtree_free(&table->subtree);
+    memset(table, 0, sizeof(*table));
+}
+
+
+/**
+ * snmp_synch_response which redoes the SNMPv3 discovery and retries once
+ * if cached engine data turned out stale. Answers from the replay fixture
+ * and records responses if enabled.
+ */
+static int mp_snmp_synch_response(netsnmp_session *ss, netsnmp_pdu *pdu,
+                                  netsnmp_pdu **response) {
+    netsnmp_pdu *retry = NULL;
+    struct timeval sent;
+    int status;
+
+    if (mp_snmp_stats_enabled)
+        mp_snmp_stats_request(ss, pdu, &sent);
+
+    if (mp_snmp_replay_active()) {
+        status = mp_snmp_replay_response(ss, pdu, response);
+    } else {
+        if (mp_snmp_v3cache_cached(ss))
+            retry = snmp_clone_pdu(pdu);
+
+        status = snmp_synch_response(ss, pdu, response);
+
+        if (retry && status != STAT_SUCCESS && mp_snmp_v3cache_recover(ss)) {
+            if (*response)
+                snmp_free_pdu(*response);
+            status = snmp_synch_response(ss, retry, response);
+            retry = NULL;
+        }
+
+        if (retry)
+            snmp_free_pdu(retry);
+    }
+
+    if (mp_snmp_stats_enabled && status != STAT_ERROR)
+        mp_snmp_stats_response(ss, status == STAT_SUCCESS ? *response : NULL,
+                               &sent);
+
+    if (status == STAT_SUCCESS)
+        mp_snmp_record(ss, *response);
+
+    return status;
+}
+
+static int copy_value(const u_char var_type, const void *val,
+                      const size_t val_len, const u_char type,
                       size_t target_len, void **target) {
-    if (var->type != type) {
+    if (var_type != type) {
         if (mp_verbose > 1)
-            printf("TYPE Mismatch: 0x%X ~ 0x%X\n", var->type, type);
+            printf("TYPE Mismatch: 0x%X ~ 0x%X\n", var_type, type);
         return 0;
     }
-    switch(var->type) {
+    switch(var_type) {
         case ASN_INTEGER:       // 0x02
             /* FALL-TROUGH */
         case ASN_COUNTER:       // 0x41
@@ -652,37 +1371,49 @@ static int copy_value(const netsnmp_variable_list *var, const u_char type,
         case ASN_GAUGE:         // 0x42
             /* FALL-TROUGH */
         case ASN_TIMETICKS:
-            if (var->val_len > target_len) {
+            if (val_len > target_len) {
                 if (mp_verbose > 1)
                     printf("TARGET size mismatch: provided storage "
                            "to small (have %zu, need %zu)\n",
-                           target_len, var->val_len);
+                           target_len, val_len);
                 return 0;
             } else {
-                memcpy(target, var->val.integer, var->val_len);
+                memcpy(target, val, val_len);
             }
             break;
+        case ASN_COUNTER64:     // 0x46
+            if (target_len < sizeof(uint64_t)) {
+                if (mp_verbose > 1)
+                    printf("TARGET size mismatch: provided storage "
+                           "to small (have %zu, need %zu)\n",
+                           target_len, sizeof(uint64_t));
+                return 0;
+            }
+            *(uint64_t *) target =
+                ((uint64_t) ((const struct counter64 *) val)->high << 32) |
+                (((const struct counter64 *) val)->low & 0xffffffffUL);
+            break;
         case ASN_OCTET_STR:    // 0x04
             {
                 if (target_len > 0) {
-                    if ((var->val_len + 1) > target_len) {
+                    if ((val_len + 1) > target_len) {
                         if (mp_verbose > 1)
                             printf("TARGET size mismatch: provided storage "
                                    "to small (have %zu, need %zu)\n",
-                                   target_len, var->val_len);
+                                   target_len, val_len);
                         return 0;
                     }
                 } else {
                     char *buffer;
-                    buffer = mp_malloc(var->val_len + 1);
+                    buffer = mp_malloc(val_len + 1);
                     *target = (void*) buffer;
                 }
-                memcpy(*target, var->val.string, var->val_len);
-                ((char *) *target)[var->val_len] = '\0';
+                memcpy(*target, val, val_len);
+                ((char *) *target)[val_len] = '\0';
             }
             break;
         default:
-            printf("TYPE Mismatch: unexpected type 0x%X\n", var->type);
+            printf("TYPE Mismatch: unexpected type 0x%X\n", var_type);
             return 0;
     } /* switch */
     return 1;
@@ -746,6 +1477,10 @@ void getopt_snmp(int c) {
         case 'R':
             mp_snmp_retries = (int)strtol(optarg, NULL, 10);
             break;
+        case MP_LONGOPT_SNMP_STATS:
+            mp_snmp_stats_enabled = 1;
+            mp_showperfdata = 1;
+            break;
     }
 }
 
@@ -776,6 +1511,8 @@ void print_help_snmp(void) {
     printf("      SNMP request timeout.\n");
     printf(" -R, --snmpretries=RETRIES\n");
     printf("      SNMP request retries.\n");
+    printf("     --snmp-stats\n");
+    printf("      Add SNMP request counts, RTT and retries to the perfdata.\n");
 }
 
 void print_revision_snmp(void) {
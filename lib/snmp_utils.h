@@ -26,9 +26,12 @@
 
 #include "config.h"
 #include <getopt.h>
+#include <stdint.h>
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 
+#include "snmp_oids.h"
+
 /* The global snmp vars. */
 /** Holds the community for the snmp connection. */
 extern char *mp_snmp_community;
@@ -56,6 +59,18 @@ extern char *ifOperStatusText[];
 /** Wrapper to simplify 'oid[], len' notation */
 #define MP_OID(...) (oid[]){__VA_ARGS__}, (sizeof((oid[]){__VA_ARGS__})/sizeof(oid))
 
+/** Net-SNMP default timeout in usec if the session has none. */
+#define MP_SNMP_TIMEOUT     1000000L
+/** Net-SNMP default retries if the session has none. */
+#define MP_SNMP_RETRIES     5
+
+/** Initial GETBULK max-repetitions of a table walk. */
+#define MP_SNMP_BULK_START  16
+/** Upper limit of the GETBULK max-repetitions of a table walk. */
+#define MP_SNMP_BULK_MAX    256
+/** Response size in bytes a table walk sizes max-repetitions for. */
+#define MP_SNMP_BULK_BYTES  16384
+
 /** SNMP specific short option string. */
 #define SNMP_OPTSTR "C:S:L:U:K:A:a:X:T:R:"
 /** SNMP specific longopt struct. */
@@ -67,7 +82,8 @@ extern char *ifOperStatusText[];
                       {"authproto", required_argument, NULL, (int)'a'}, \
                       {"privpass", required_argument, NULL, (int)'X'}, \
                       {"snmptimeout", required_argument, NULL, (int)'T'}, \
-                      {"snmpretries", required_argument, NULL, (int)'R'}
+                      {"snmpretries", required_argument, NULL, (int)'R'}, \
+                      {"snmp-stats", no_argument, NULL, (int)MP_LONGOPT_SNMP_STATS}
 
 /**
  * SNMP Query struct
@@ -86,16 +102,23 @@ typedef struct mp_snmp_query_cmd_s {
 } mp_snmp_query_cmd;
 
 /**
- * SNMP Table Query struct
+ * SNMP subtree varbind record
+ *
+ * OID and value are stored in the subtree arena, use
+ * \ref mp_snmp_varbind_name and \ref mp_snmp_varbind_value to access them.
  */
-struct mp_snmp_table {
-    /** Table row count */
-    int row;
-    /** Table column count */
-    int col;
-    /** Table data count */
-    netsnmp_variable_list **var;
-};
+typedef struct {
+    /** Offset of the OID in the arena */
+    uint32_t name_off;
+    /** Offset of the value in the arena */
+    uint32_t val_off;
+    /** Value length in bytes */
+    uint32_t val_len;
+    /** OID length */
+    uint16_t name_len;
+    /** ASN type of the value */
+    u_char type;
+} mp_snmp_varbind;
 
 /**
  * SNMP subtree struct
@@ -103,26 +126,103 @@ struct mp_snmp_table {
 typedef struct {
     /** subtree size */
     size_t size;
-    /** subtree data */
-    netsnmp_variable_list **vars;
+    /** subtree data, size records */
+    mp_snmp_varbind *vars;
+    /** allocated records */
+    size_t alloc;
+    /** OIDs and values of all records */
+    u_char *arena;
+    /** used arena bytes */
+    size_t arena_len;
+    /** allocated arena bytes */
+    size_t arena_alloc;
 } mp_snmp_subtree;
 
+/** Get the OID of a subtree varbind. */
+#define mp_snmp_varbind_name(subtree, vb) \
+    ((const oid *)((subtree)->arena + (vb)->name_off))
+/** Get the value of a subtree varbind. */
+#define mp_snmp_varbind_value(subtree, vb) \
+    ((const void *)((subtree)->arena + (vb)->val_off))
+
+/**
+ * SNMP Table struct
+ *
+ * Built from a walk of a table entry OID. Cells are stored column-major
+ * in var[c * row + r], rows are in walk order and can be looked up by
+ * their index with \ref mp_snmp_table_find.
+ */
+struct mp_snmp_table {
+    /** Table row count */
+    int row;
+    /** Table column count */
+    int col;
+    /** Table data, column-major, NULL for missing cells */
+    const mp_snmp_varbind **var;
+    /** Column sub-identifiers, sorted */
+    oid *column;
+    /** Row index sub-identifiers */
+    oid *index;
+    /** Offset of each row index in index */
+    size_t *index_off;
+    /** Length of each row index */
+    size_t *index_len;
+    /** Row index hash, -1 for free slots */
+    int *hash;
+    /** Hash size, power of 2 */
+    size_t hash_size;
+    /** Walked variables backing the table */
+    mp_snmp_subtree subtree;
+};
+
 /**
  * Init the Net-SNMP library and return a new session.
  * \return netsnmp_session created
  */
 netsnmp_session *mp_snmp_init(void);
 
+/**
+ * Open a new session to host with the global snmp settings.
+ * Inits the Net-SNMP library on first use.
+ * \param[in] host agent hostname
+ * \param[in] host_port agent port
+ * \return netsnmp_session created
+ */
+netsnmp_session *mp_snmp_open(const char *host, int host_port);
+
 /**
  * Cleanup the Net-SNMP library.
  */
 void mp_snmp_deinit(void);
 
+/**
+ * Parse a OID string like read_objid.
+ * Numeric OIDs are parsed without the Net-SNMP MIB parser, the MIBs are
+ * only loaded on the first symbolic OID.
+ * \param[in] str OID string.
+ * \param[out] name Parsed OID.
+ * \param[in|out] len Size of name, set to the OID length.
+ * \return 1 on success, 0 otherwise.
+ */
+int mp_snmp_read_objid(const char *str, oid *name, size_t *len);
+
+/**
+ * Parse a numeric OID string like .1.3.6.1.2.1.1.5.0
+ * \param[in] str OID string.
+ * \param[out] name Parsed OID.
+ * \param[in|out] len Size of name, set to the OID length.
+ * \return 1 on success, 0 otherwise.
+ */
+int mp_snmp_parse_oid(const char *str, oid *name, size_t *len);
+
 /**
  * Run all querys in querycmd and save result to pointer in querycmd struct.
+ * The querys are packed into as few GET requests as the agent accepts,
+ * see \ref mp_snmp_async_query. Unavailable OIDs keep their target.
+ * Exits critical with the error if the agent does not answer.
  * \param[in] ss Session to use.
  * \param[in|out] querycmd Query commands
- * \return return a status value like snmp.
+ * \return return STAT_SUCCESS.
  */
 int mp_snmp_query(netsnmp_session *ss, const mp_snmp_query_cmd *querycmd);
 
@@ -139,7 +239,7 @@ typedef struct {
 
 /**
  * Fetch all OIDs given in values and save results to target pointer
- * given in values.
+ * given in values. Same as \ref mp_snmp_query, but returns errors.
  *
  * \param[in] ss snmp session to use.
  * \param[in|out] values the OIDs to be fetched and where store the results
@@ -164,6 +264,95 @@ int mp_snmp_values_fetch2(netsnmp_session *ss,
 int mp_snmp_values_fetch3(netsnmp_session *ss,
                           const mp_snmp_value *values, ...);
 
+/**
+ * Approximate BER size of a OID.
+ *
+ * \param[in] name OID
+ * \param[in] len size of name
+ * \return size in bytes
+ */
+size_t mp_snmp_oid_size(const oid *name, size_t len);
+
+/**
+ * Approximate BER size of a varbind.
+ *
+ * \param[in] name varbind OID
+ * \param[in] name_len size of name
+ * \param[in] type value type
+ * \param[in] val value
+ * \param[in] val_len size of val
+ * \return size in bytes
+ */
+size_t mp_snmp_var_size(const oid *name, size_t name_len, u_char type,
+                        const void *val, size_t val_len);
+
+/**
+ * Approximate size of the message and PDU headers of a session.
+ *
+ * \param[in] ss session
+ * \return size in bytes
+ */
+size_t mp_snmp_head_size(const netsnmp_session *ss);
+
+/**
+ * Approximate encoded size of a PDU.
+ *
+ * \param[in] ss session the PDU is sent over
+ * \param[in] pdu PDU
+ * \return size in bytes
+ */
+size_t mp_snmp_pdu_size(const netsnmp_session *ss, const netsnmp_pdu *pdu);
+
+/**
+ * Build the GET request of a query.
+ *
+ * \param[in] querycmd query to request
+ * \return new request pdu
+ */
+netsnmp_pdu *mp_snmp_query_pdu(const mp_snmp_query_cmd *querycmd);
+
+/**
+ * Copy the values of a GET response to the query targets.
+ *
+ * \param[in] querycmd query to store the values
+ * \param[in] response response pdu
+ */
+void mp_snmp_query_copy(const mp_snmp_query_cmd *querycmd,
+                        const netsnmp_pdu *response);
+
+/**
+ * Build the next request of a subtree walk.
+ *
+ * \param[in] ss snmp session to use.
+ * \param[in] last_oid last OID fetched
+ * \param[in] last_len the size of last_oid
+ * \return new request pdu
+ */
+netsnmp_pdu *mp_snmp_subtree_pdu(netsnmp_session *ss,
+                                 const oid *last_oid,
+                                 const size_t last_len);
+
+/**
+ * Add the variables of a walk response to subtree.
+ *
+ * \param[in] ss snmp session to use.
+ * \param[in] response response pdu
+ * \param[in] subtree_oid start OID
+ * \param[in] subtree_len the size of subtree_oid
+ * \param[in|out] last_oid last OID fetched
+ * \param[in|out] last_len the size of last_oid
+ * \param[in|out] subtree store fetched OIDs result
+ * \return 1 if the walk continues, 0 at the end, -1 on error, -2 if the
+ *         OIDs are not increasing. The response is not freed.
+ */
+int mp_snmp_subtree_response(netsnmp_session *ss,
+                             netsnmp_pdu *response,
+                             const oid *subtree_oid,
+                             const size_t subtree_len,
+                             oid *last_oid,
+                             size_t *last_len,
+                             mp_snmp_subtree *subtree);
+
 /**
  * Fetch a subtree of OIDs starting on subtree_oid and save results to subtree.
  *
@@ -244,6 +433,161 @@ int mp_snmp_subtree_get_values(const mp_snmp_subtree *subtree,
                                const mp_snmp_value *values);
 
 
+/**
+ * Walk a table entry OID and index the result.
+ *
+ * \param[in] ss snmp session to use.
+ * \param[in] entry_oid table entry OID, columns are the next sub-identifier
+ * \param[in] entry_len the size of entry_oid
+ * \param[out] table indexed table
+ * \return returns STAT_SUCESS on success, other value otherwise
+ */
+int mp_snmp_table_query(netsnmp_session *ss,
+                        const oid *entry_oid,
+                        const size_t entry_len,
+                        struct mp_snmp_table *table);
+
+/**
+ * Walk selected columns of a table in lockstep and index the result.
+ *
+ * All columns still walked are requested in each GETBULK (GETNEXT for
+ * SNMPv1) and finish independently. The max-repetitions start at
+ * \ref MP_SNMP_BULK_START and adapt to the observed response size,
+ * truncated responses and tooBig errors.
+ *
+ * \param[in] ss snmp session to use.
+ * \param[in] entry_oid table entry OID
+ * \param[in] entry_len the size of entry_oid
+ * \param[in] columns column sub-identifiers to fetch
+ * \param[in] num_columns number of columns
+ * \param[out] table indexed table
+ * \return returns STAT_SUCESS on success, other value otherwise
+ */
+int mp_snmp_table_query_columns(netsnmp_session *ss,
+                                const oid *entry_oid,
+                                const size_t entry_len,
+                                const oid *columns,
+                                const size_t num_columns,
+                                struct mp_snmp_table *table);
+
+/**
+ * Index a walked subtree as table. The table takes over the subtree.
+ *
+ * \param[in|out] subtree walked variables
+ * \param[in] entry_oid table entry OID
+ * \param[in] entry_len the size of entry_oid
+ * \param[out] table indexed table
+ * \return \ref OK or \ref ERROR.
+ */
+int mp_snmp_table_build(mp_snmp_subtree *subtree,
+                        const oid *entry_oid,
+                        const size_t entry_len,
+                        struct mp_snmp_table *table);
+
+/**
+ * Get a table cell.
+ *
+ * \param[in] table the table
+ * \param[in] column column sub-identifier
+ * \param[in] row row number; 0-based
+ * \return the varbind or NULL if missing
+ */
+const mp_snmp_varbind *mp_snmp_table_get(const struct mp_snmp_table *table,
+                                         const oid column,
+                                         const int row);
+
+/**
+ * Get a table cell value like \ref mp_snmp_subtree_get_value.
+ *
+ * \return returns 1, if value was found, 0 otherwise
+ */
+int mp_snmp_table_get_value(const struct mp_snmp_table *table,
+                            const oid column,
+                            const int row,
+                            const u_char type,
+                            void **target,
+                            const size_t target_len);
+
+/**
+ * Get a INTEGER, Counter32, Gauge32 or TimeTicks table cell.
+ *
+ * \param[in] table the table
+ * \param[in] column column sub-identifier
+ * \param[in] row row number; 0-based
+ * \param[out] value cell value
+ * \return returns 1, if value was found, 0 otherwise
+ */
+int mp_snmp_table_get_integer(const struct mp_snmp_table *table,
+                              const oid column,
+                              const int row,
+                              long *value);
+
+/**
+ * Get a Counter64 or 32-bit integer table cell.
+ *
+ * \param[in] table the table
+ * \param[in] column column sub-identifier
+ * \param[in] row row number; 0-based
+ * \param[out] value cell value
+ * \return returns 1, if value was found, 0 otherwise
+ */
+int mp_snmp_table_get_counter64(const struct mp_snmp_table *table,
+                                const oid column,
+                                const int row,
+                                uint64_t *value);
+
+/**
+ * Get a OCTET STRING table cell.
+ *
+ * \param[in] table the table
+ * \param[in] column column sub-identifier
+ * \param[in] row row number; 0-based
+ * \return null terminated copy to free or NULL if missing
+ */
+char *mp_snmp_table_get_string(const struct mp_snmp_table *table,
+                               const oid column,
+                               const int row);
+
+/**
+ * Find a row by its index.
+ *
+ * \param[in] table the table
+ * \param[in] index row index sub-identifiers
+ * \param[in] index_len the size of index
+ * \return row number or -1 if not found
+ */
+int mp_snmp_table_find(const struct mp_snmp_table *table,
+                       const oid *index,
+                       const size_t index_len);
+
+/**
+ * Get the index of a row.
+ *
+ * \param[in] table the table
+ * \param[in] row row number; 0-based
+ * \param[out] index_len the size of the index
+ * \return row index sub-identifiers
+ */
+const oid *mp_snmp_table_index(const struct mp_snmp_table *table,
+                               const int row,
+                               size_t *index_len);
+
+/**
+ * Free memory used by a table.
+ *
+ * \param[in|out] table table to free
+ */
+void mp_snmp_table_free(struct mp_snmp_table *table);
+
+/**
+ * Append a copy of a variable to a subtree.
+ *
+ * \param[in|out] subtree subtree to append to
+ * \param[in] var variable to copy
+ */
+void mp_snmp_subtree_add(mp_snmp_subtree *subtree,
+                         const netsnmp_variable_list *var);
+
 /**
  * Free memory used by a subtree.
  *
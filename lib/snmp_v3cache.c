@@ -0,0 +1,460 @@
+/***
+ * Monitoring Plugin - snmp_v3cache.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "snmp_v3cache.h"
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+/**
+ * The cache is a small hash table file of fixed size entries keyed by
+ * agent, user, auth protocol and password. Entries are read with a
+ * single pread and validated by a checksum, so a torn read is just a
+ * miss. Writers hold a exclusive flock.
+ *
+ * The file holds localized keys and must not be readable by others, so
+ * it is only used if owned by the effective user and mode 0600.
+ */
+
+/** Cache magic "MPV3KEY1" */
+#define MP_SNMP_V3CACHE_MAGIC   0x3159454B3356504DULL
+/** Max engineID size. (RFC 3411) */
+#define MP_SNMP_V3CACHE_ENGINE  32
+/** Max localized key size. */
+#define MP_SNMP_V3CACHE_KEY     64
+
+struct mp_snmp_v3cache_header {
+    uint64_t magic;             /**< File magic */
+    uint32_t bits;              /**< Hash bits, slots = 1 << bits */
+    uint32_t entry_size;        /**< sizeof(struct mp_snmp_v3cache_entry) */
+    uint64_t reserved[6];
+};
+
+struct mp_snmp_v3cache_entry {
+    uint64_t key;               /**< Key hash, 0 is free */
+    uint64_t check;             /**< Checksum of key and data */
+    int64_t  stamp;             /**< Local time boots/time were valid */
+    uint32_t boots;             /**< snmpEngineBoots */
+    uint32_t time;              /**< snmpEngineTime */
+    uint32_t engine_len;        /**< Size of engine */
+    uint32_t kul_len;           /**< Size of kul */
+    u_char   engine[MP_SNMP_V3CACHE_ENGINE];    /**< snmpEngineID */
+    u_char   kul[MP_SNMP_V3CACHE_KEY];          /**< Localized auth key */
+};
+
+const char *mp_snmp_v3cache_file = MP_SNMP_V3CACHE_FILE;
+
+/** Cache file descriptor, -1 if not open. */
+static int mp_snmp_v3cache_fd = -1;
+/** Hash bits of the open cache. */
+static uint32_t mp_snmp_v3cache_bits = 0;
+/** Sessions opened from the cache. */
+static const netsnmp_session **mp_snmp_v3cache_sessions = NULL;
+/** Number of mp_snmp_v3cache_sessions. */
+static int mp_snmp_v3cache_sessions_num = 0;
+
+/* Local functions */
+static int mp_snmp_v3cache_open(void);
+static uint64_t mp_snmp_v3cache_key(const char *peername,
+        const char *secname, const oid *authproto, size_t authproto_len);
+static uint64_t mp_snmp_v3cache_check(const struct mp_snmp_v3cache_entry *e);
+static int mp_snmp_v3cache_find(uint64_t key,
+        struct mp_snmp_v3cache_entry *e, off_t *off);
+static void mp_snmp_v3cache_store(uint64_t key,
+        const struct mp_snmp_v3cache_entry *e);
+static int mp_snmp_v3cache_untrack(const netsnmp_session *ss);
+static void mp_snmp_v3cache_drop(const netsnmp_session *ss);
+
+int mp_snmp_v3cache_load(netsnmp_session *session) {
+    struct mp_snmp_v3cache_entry e;
+    uint64_t key;
+    int64_t age;
+
+    if (session->securityLevel != SNMP_SEC_LEVEL_NOAUTH &&
+            (!mp_snmp_authpass || !session->securityAuthProto))
+        return 0;
+
+    key = mp_snmp_v3cache_key(session->peername, session->securityName,
+            session->securityAuthProto, session->securityAuthProtoLen);
+    if (!mp_snmp_v3cache_find(key, &e, NULL))
+        return 0;
+
+    /* Agent clock advanced since the sample was stored. */
+    age = (int64_t)time(NULL) - e.stamp;
+    if (age < 0 || age > 0x7FFFFFFF - (int64_t)e.time)
+        return 0;
+
+    session->securityEngineID = mp_malloc(e.engine_len);
+    memcpy(session->securityEngineID, e.engine, e.engine_len);
+    session->securityEngineIDLen = e.engine_len;
+    session->contextEngineID = mp_malloc(e.engine_len);
+    memcpy(session->contextEngineID, e.engine, e.engine_len);
+    session->contextEngineIDLen = e.engine_len;
+    session->engineBoots = e.boots;
+    session->engineTime = e.time + (uint32_t)age;
+
+    if (e.kul_len) {
+        session->securityAuthLocalKey = mp_malloc(e.kul_len);
+        memcpy(session->securityAuthLocalKey, e.kul, e.kul_len);
+        session->securityAuthLocalKeyLen = e.kul_len;
+        session->securityAuthKeyLen = 0;
+    }
+
+    if (mp_verbose > 2)
+        printf("SNMPv3 cache hit for %s\n", session->peername);
+
+    return 1;
+}
+
+void mp_snmp_v3cache_opened(netsnmp_session *ss, int cached) {
+    struct mp_snmp_v3cache_entry e;
+    u_int boots, engine_time;
+    size_t kul_len = MP_SNMP_V3CACHE_KEY;
+
+    if (cached) {
+        mp_snmp_v3cache_sessions = mp_realloc(mp_snmp_v3cache_sessions,
+                sizeof(netsnmp_session *) * (mp_snmp_v3cache_sessions_num + 1));
+        mp_snmp_v3cache_sessions[mp_snmp_v3cache_sessions_num++] = ss;
+        return;
+    }
+
+    if (ss->securityEngineIDLen == 0 ||
+            ss->securityEngineIDLen > MP_SNMP_V3CACHE_ENGINE)
+        return;
+
+    memset(&e, 0, sizeof(e));
+    memcpy(e.engine, ss->securityEngineID, ss->securityEngineIDLen);
+    e.engine_len = ss->securityEngineIDLen;
+
+    if (get_enginetime(ss->securityEngineID, ss->securityEngineIDLen,
+                &boots, &engine_time, 0) != SNMPERR_SUCCESS)
+        return;
+    e.boots = boots;
+    e.time = engine_time;
+    e.stamp = (int64_t)time(NULL);
+
+    if (ss->securityLevel != SNMP_SEC_LEVEL_NOAUTH) {
+        if (!mp_snmp_authpass || ss->securityAuthKeyLen == 0)
+            return;
+        if (generate_kul(ss->securityAuthProto, ss->securityAuthProtoLen,
+                    ss->securityEngineID, ss->securityEngineIDLen,
+                    ss->securityAuthKey, ss->securityAuthKeyLen,
+                    e.kul, &kul_len) != SNMPERR_SUCCESS)
+            return;
+        e.kul_len = kul_len;
+    }
+
+    mp_snmp_v3cache_store(mp_snmp_v3cache_key(ss->peername,
+                ss->securityName, ss->securityAuthProto,
+                ss->securityAuthProtoLen), &e);
+}
+
+int mp_snmp_v3cache_cached(const netsnmp_session *ss) {
+    int i;
+
+    for (i = 0; i < mp_snmp_v3cache_sessions_num; i++) {
+        if (mp_snmp_v3cache_sessions[i] == ss)
+            return 1;
+    }
+
+    return 0;
+}
+
+int mp_snmp_v3cache_recover(netsnmp_session *ss) {
+    int status;
+
+    switch (ss->s_snmp_errno) {
+        case SNMPERR_UNKNOWN_ENG_ID:
+        case SNMPERR_NOT_IN_TIME_WINDOW:
+        case SNMPERR_AUTHENTICATION_FAILURE:
+            break;
+        default:
+            return 0;
+    }
+
+    if (!mp_snmp_v3cache_untrack(ss))
+        return 0;
+
+    if (mp_verbose > 2)
+        printf("SNMPv3 cache stale for %s: %s\n", ss->peername,
+                snmp_api_errstring(ss->s_snmp_errno));
+
+    mp_snmp_v3cache_drop(ss);
+
+    /* Full key generation and discovery like a uncached session. */
+    if (ss->securityLevel != SNMP_SEC_LEVEL_NOAUTH) {
+        ss->securityAuthKeyLen = USM_AUTH_KU_LEN;
+        status = generate_Ku(ss->securityAuthProto,
+                ss->securityAuthProtoLen,
+                (u_char *) mp_snmp_authpass, strlen(mp_snmp_authpass),
+                ss->securityAuthKey, &ss->securityAuthKeyLen);
+        if (status != SNMPERR_SUCCESS)
+            return 0;
+    }
+
+    free(ss->securityAuthLocalKey);
+    ss->securityAuthLocalKey = NULL;
+    ss->securityAuthLocalKeyLen = 0;
+    free(ss->securityEngineID);
+    ss->securityEngineID = NULL;
+    ss->securityEngineIDLen = 0;
+    free(ss->contextEngineID);
+    ss->contextEngineID = NULL;
+    ss->contextEngineIDLen = 0;
+    ss->engineBoots = 0;
+    ss->engineTime = 0;
+
+    if (!snmpv3_engineID_probe(snmp_sess_pointer(ss), ss))
+        return 0;
+
+    mp_snmp_v3cache_opened(ss, 0);
+
+    return 1;
+}
+
+void mp_snmp_v3cache_invalidate(netsnmp_session *ss) {
+    if (mp_snmp_v3cache_untrack(ss))
+        mp_snmp_v3cache_drop(ss);
+}
+
+void mp_snmp_v3cache_close(void) {
+    if (mp_snmp_v3cache_fd >= 0)
+        close(mp_snmp_v3cache_fd);
+    mp_snmp_v3cache_fd = -1;
+
+    free(mp_snmp_v3cache_sessions);
+    mp_snmp_v3cache_sessions = NULL;
+    mp_snmp_v3cache_sessions_num = 0;
+}
+
+static void mp_snmp_v3cache_drop(const netsnmp_session *ss) {
+    struct mp_snmp_v3cache_entry e;
+    uint64_t key;
+    off_t off;
+
+    key = mp_snmp_v3cache_key(ss->peername, ss->securityName,
+            ss->securityAuthProto, ss->securityAuthProtoLen);
+    if (!mp_snmp_v3cache_find(key, &e, &off))
+        return;
+
+    memset(&e, 0, sizeof(e));
+    flock(mp_snmp_v3cache_fd, LOCK_EX);
+    if (pwrite(mp_snmp_v3cache_fd, &e, sizeof(e), off) != sizeof(e) &&
+            mp_verbose > 0)
+        printf("Can't write %s: %s\n", mp_snmp_v3cache_file,
+                strerror(errno));
+    flock(mp_snmp_v3cache_fd, LOCK_UN);
+}
+
+static int mp_snmp_v3cache_open(void) {
+    struct mp_snmp_v3cache_header head;
+    struct stat st;
+    int fd;
+
+    if (mp_snmp_v3cache_fd >= 0)
+        return OK;
+    if (!mp_snmp_v3cache_file || !*mp_snmp_v3cache_file)
+        return ERROR;
+
+    fd = open(mp_snmp_v3cache_file, O_RDWR | O_CREAT | O_NOFOLLOW, 0600);
+    if (fd < 0) {
+        if (mp_verbose > 1)
+            printf("Can't open %s: %s\n", mp_snmp_v3cache_file,
+                    strerror(errno));
+        return ERROR;
+    }
+
+    /* Never use keys others could have read or written. */
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+            st.st_uid != geteuid() || (st.st_mode & 077) != 0) {
+        if (mp_verbose > 0)
+            printf("Ignore %s: not a 0600 file owned by uid %d\n",
+                    mp_snmp_v3cache_file, (int)geteuid());
+        close(fd);
+        return ERROR;
+    }
+
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &st) == 0 && st.st_size == 0) {
+        memset(&head, 0, sizeof(head));
+        head.magic = MP_SNMP_V3CACHE_MAGIC;
+        head.bits = MP_SNMP_V3CACHE_BITS;
+        head.entry_size = sizeof(struct mp_snmp_v3cache_entry);
+        if (ftruncate(fd, sizeof(head) + (sizeof(struct mp_snmp_v3cache_entry)
+                        << head.bits)) != 0 ||
+                pwrite(fd, &head, sizeof(head), 0) != sizeof(head)) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return ERROR;
+        }
+    } else if (pread(fd, &head, sizeof(head), 0) != sizeof(head)) {
+        head.magic = 0;
+    }
+    flock(fd, LOCK_UN);
+
+    if (head.magic != MP_SNMP_V3CACHE_MAGIC || head.bits > 20 ||
+            head.entry_size != sizeof(struct mp_snmp_v3cache_entry)) {
+        if (mp_verbose > 0)
+            printf("Invalid SNMPv3 cache %s\n", mp_snmp_v3cache_file);
+        close(fd);
+        return ERROR;
+    }
+
+    mp_snmp_v3cache_fd = fd;
+    mp_snmp_v3cache_bits = head.bits;
+
+    return OK;
+}
+
+static uint64_t mp_snmp_v3cache_key(const char *peername,
+        const char *secname, const oid *authproto, size_t authproto_len) {
+    const char *parts[3];
+    const unsigned char *p;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    parts[0] = peername ? peername : "";
+    parts[1] = secname ? secname : "";
+    parts[2] = mp_snmp_authpass ? mp_snmp_authpass : "";
+
+    /* FNV-1a, a changed password is a different entry. */
+    for (i = 0; i < 3; i++) {
+        for (p = (const unsigned char *)parts[i]; ; p++) {
+            h = (h ^ *p) * 0x100000001b3ULL;
+            if (*p == '\0')
+                break;
+        }
+    }
+    for (i = 0; authproto && i < authproto_len; i++)
+        h = (h ^ authproto[i]) * 0x100000001b3ULL;
+
+    return h ? h : 1;
+}
+
+static uint64_t mp_snmp_v3cache_check(const struct mp_snmp_v3cache_entry *e) {
+    const unsigned char *p = (const unsigned char *)&e->stamp;
+    const unsigned char *end = (const unsigned char *)(e + 1);
+    uint64_t h = e->key ^ 0x84222325cbf29ce4ULL;
+
+    for (; p < end; p++)
+        h = (h ^ *p) * 0x100000001b3ULL;
+
+    return h;
+}
+
+static int mp_snmp_v3cache_find(uint64_t key,
+        struct mp_snmp_v3cache_entry *e, off_t *off) {
+    uint64_t mask;
+    off_t pos;
+    int i;
+
+    if (mp_snmp_v3cache_open() != OK)
+        return 0;
+
+    mask = (1ULL << mp_snmp_v3cache_bits) - 1;
+    for (i = 0; i < MP_SNMP_V3CACHE_PROBE; i++) {
+        pos = sizeof(struct mp_snmp_v3cache_header) +
+            ((key + i) & mask) * sizeof(struct mp_snmp_v3cache_entry);
+        if (pread(mp_snmp_v3cache_fd, e, sizeof(*e), pos) != sizeof(*e))
+            return 0;
+        if (e->key != key)
+            continue;
+        if (e->check != mp_snmp_v3cache_check(e) ||
+                e->engine_len == 0 || e->engine_len > MP_SNMP_V3CACHE_ENGINE ||
+                e->kul_len > MP_SNMP_V3CACHE_KEY)
+            return 0;
+        if (off)
+            *off = pos;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void mp_snmp_v3cache_store(uint64_t key,
+        const struct mp_snmp_v3cache_entry *e) {
+    struct mp_snmp_v3cache_entry cur, new;
+    uint64_t mask;
+    off_t pos, free_pos = -1;
+    int i;
+
+    if (mp_snmp_v3cache_open() != OK)
+        return;
+
+    new = *e;
+    new.key = key;
+    new.check = mp_snmp_v3cache_check(&new);
+
+    mask = (1ULL << mp_snmp_v3cache_bits) - 1;
+
+    flock(mp_snmp_v3cache_fd, LOCK_EX);
+    for (i = 0; i < MP_SNMP_V3CACHE_PROBE; i++) {
+        pos = sizeof(struct mp_snmp_v3cache_header) +
+            ((key + i) & mask) * sizeof(struct mp_snmp_v3cache_entry);
+        if (pread(mp_snmp_v3cache_fd, &cur, sizeof(cur), pos) != sizeof(cur))
+            break;
+        if (cur.key == key) {
+            free_pos = pos;
+            break;
+        }
+        if (cur.key == 0 && free_pos < 0)
+            free_pos = pos;
+    }
+    /* Probe sequence full, evict the home slot. */
+    if (free_pos < 0)
+        free_pos = sizeof(struct mp_snmp_v3cache_header) +
+            (key & mask) * sizeof(struct mp_snmp_v3cache_entry);
+
+    if (pwrite(mp_snmp_v3cache_fd, &new, sizeof(new), free_pos) != sizeof(new)
+            && mp_verbose > 0)
+        printf("Can't write %s: %s\n", mp_snmp_v3cache_file,
+                strerror(errno));
+    flock(mp_snmp_v3cache_fd, LOCK_UN);
+}
+
+static int mp_snmp_v3cache_untrack(const netsnmp_session *ss) {
+    int i;
+
+    for (i = 0; i < mp_snmp_v3cache_sessions_num; i++) {
+        if (mp_snmp_v3cache_sessions[i] == ss) {
+            mp_snmp_v3cache_sessions[i] =
+                mp_snmp_v3cache_sessions[--mp_snmp_v3cache_sessions_num];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
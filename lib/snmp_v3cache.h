@@ -0,0 +1,94 @@
+/***
+ * Monitoring Plugin - snmp_v3cache.h
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#ifndef _SNMP_V3CACHE_H_
+#define _SNMP_V3CACHE_H_
+
+#include "mp_state.h"
+#include "snmp_utils.h"
+
+/** Default SNMPv3 key and engine cache file. */
+#define MP_SNMP_V3CACHE_FILE    MP_STATEDIR "/snmpv3.cache"
+/** Number of hash bits of a new cache. (16k slots, sparse file) */
+#define MP_SNMP_V3CACHE_BITS    14
+/** Max linear probe length of a lookup. */
+#define MP_SNMP_V3CACHE_PROBE   8
+
+/** Holds the path of the SNMPv3 cache file, NULL disables the cache. */
+extern const char *mp_snmp_v3cache_file;
+
+/**
+ * Fill a SNMPv3 session template from the cache.
+ * On a hit the localized key, engineID, boots and time are set so
+ * snmp_open skips generate_Ku and the discovery round trip. The
+ * caller must free securityEngineID, contextEngineID and
+ * securityAuthLocalKey after snmp_open.
+ *
+ * \param[in|out] session session template to fill
+ * \return 1 on a cache hit, 0 otherwise
+ */
+int mp_snmp_v3cache_load(netsnmp_session *session);
+
+/**
+ * Register a opened SNMPv3 session. Sessions opened from the cache are
+ * remembered for \ref mp_snmp_v3cache_recover, others are stored.
+ *
+ * \param[in] ss opened session
+ * \param[in] cached 1 if the template was filled from the cache
+ */
+void mp_snmp_v3cache_opened(netsnmp_session *ss, int cached);
+
+/**
+ * Check if a session was opened from the cache and not recovered yet.
+ *
+ * \param[in] ss session to check
+ * \return 1 if opened from the cache, 0 otherwise
+ */
+int mp_snmp_v3cache_cached(const netsnmp_session *ss);
+
+/**
+ * Redo the key generation and engine discovery of a session opened from
+ * the cache after a unknownEngineID, notInTimeWindow or authentication
+ * failure report.
+ *
+ * \param[in] ss failed session
+ * \return 1 if the request should be retried, 0 otherwise
+ */
+int mp_snmp_v3cache_recover(netsnmp_session *ss);
+
+/**
+ * Drop the cache entry of a session opened from the cache, so the next
+ * run does a full discovery.
+ *
+ * \param[in] ss failed session
+ */
+void mp_snmp_v3cache_invalidate(netsnmp_session *ss);
+
+/**
+ * Close the cache file.
+ */
+void mp_snmp_v3cache_close(void);
+
+#endif /* _SNMP_V3CACHE_H_ */
+
+/* vim: set ts=4 sw=4 et syn=c : */
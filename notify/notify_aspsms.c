@@ -123,8 +123,7 @@ int main (int argc, char **argv) {
 
     /* Init libcurl */
     curl = mp_curl_init();
-    answer.data = NULL;
-    answer.size = 0;
+    memset(&answer, 0, sizeof(struct mp_curl_data));
 
 
     /* Setup request */
@@ -157,7 +156,7 @@ int main (int argc, char **argv) {
         printf("Answer: '%s'\n", answer.data);
     }
 
-    if (code != 200) {
+    if (code != 200 || answer.overflow) {
         printf("XML-API request failed.\n");
         return 1;
     }
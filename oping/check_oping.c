@@ -32,6 +32,7 @@ const char *progusage = "-H host";
 
 /* MP Includes */
 #include "mp_common.h"
+#include "mp_repeat.h"
 /* Default Includes */
 #include <signal.h>
 #include <stdio.h>
@@ -53,19 +54,21 @@ thresholds *lost_thresholds = NULL;
 int packets = 5;
 int quick = 0;
 
+/** liboping state kept between repeated probes. */
+struct oping_probe {
+    pingobj_t   *oping;     /** < liboping object. */
+    uint32_t    dropped;    /** < Dropped count at end of last probe. */
+    uint32_t    num;        /** < Sequence at end of last probe. */
+};
+
 /* Function prototype */
+void oping_probe(void *data);
 
 int main (int argc, char **argv) {
     /* Local Vars */
     int         rv;
     pingobj_t   *oping;
-    pingobj_iter_t *iter;
-
-    uint32_t dropped=0, num=0;
-    int ttl=0;
-    double rt, rta=0;
-    char haddr[40];
-    size_t data_len, buf_len;
+    struct oping_probe probe;
 
     /* Set signal handling and alarm */
     if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
@@ -105,9 +108,28 @@ int main (int argc, char **argv) {
     rv = ping_host_add(oping, hostname);
     if (rv != 0)
         unknown("liboping setup Error: %s", ping_get_error(oping));
-        
 
-    for (; packets > 0; packets--) {
+    probe.oping = oping;
+    probe.dropped = 0;
+    probe.num = 0;
+
+    mp_repeat_run(oping_probe, &probe);
+}
+
+void oping_probe(void *data) {
+    struct oping_probe *probe = data;
+    pingobj_t   *oping = probe->oping;
+    pingobj_iter_t *iter;
+    int         rv;
+    int         count;
+
+    uint32_t dropped=0, num=0;
+    int ttl=0;
+    double rt, rta=0;
+    char haddr[40];
+    size_t data_len, buf_len;
+
+    for (count = packets; count > 0; count--) {
         rv = ping_send(oping);
         if (rv < 0)
             critical("Send Error: %s", ping_get_error(oping));
@@ -119,6 +141,8 @@ int main (int argc, char **argv) {
                     &dropped, &buf_len);
             if (rv != 0)
                 unknown("liboping ping_iterator_get_info dropped failed!");
+            // liboping counts since construct, make it per probe
+            dropped -= probe->dropped;
 
             buf_len = sizeof(rt);
             rv =  ping_iterator_get_info(iter, PING_INFO_LATENCY,
@@ -132,6 +156,7 @@ int main (int argc, char **argv) {
                 &num, &buf_len);
             if (rv != 0)
                 unknown("liboping ping_iterator_get_info sequence failed!");
+            num -= probe->num;
 
             data_len = 0;
             ping_iterator_get_info(iter, PING_INFO_DATA, NULL, &data_len);
@@ -157,7 +182,7 @@ int main (int argc, char **argv) {
             get_status((float)(rta/num), rta_thresholds) == STATE_OK &&
             get_status((dropped*100)/num, lost_thresholds) == STATE_OK) {
             break;
-        } else if (packets > 1){
+        } else if (count > 1){
             if (interval.tv_sec || interval.tv_nsec)
                 nanosleep(&interval, NULL);
             else
@@ -166,6 +191,9 @@ int main (int argc, char **argv) {
 
     }
 
+    probe->dropped += dropped;
+    probe->num += num;
+
     if (num == 0)
         critical("PING_INFO_SEQUENCE is 0");
 
@@ -179,9 +207,6 @@ int main (int argc, char **argv) {
     result2 = get_status((dropped*100)/num, lost_thresholds);
     result1 = result1 > result2 ? result1 : result2;
 
-    free_threshold(rta_thresholds);
-    free_threshold(lost_thresholds);
-
     switch(result1) {
         case STATE_OK:
             ok("Packet loss = %d%, RTA = %.2f ms",
@@ -212,6 +237,9 @@ int process_arguments (int argc, char **argv) {
         {"interval", required_argument, 0, 'i'},
         {"interface", required_argument, 0, 'I'},
         {"ttl", required_argument, 0, 'T'},
+        // --interval is taken by the packet interval
+        {"repeat", required_argument, NULL, (int)MP_LONGOPT_REPEAT},
+        {"repeat-interval", required_argument, NULL, (int)MP_LONGOPT_INTERVAL},
         MP_LONGOPTS_WC,
         MP_LONGOPTS_END
     };
@@ -338,6 +366,10 @@ void print_help (void) {
     printf(" -c, --critical=<rta>,<pl>%%\n");
     printf("      Return critical if check exceeds TRA or Packet loss limit\n");
     printf("            (Default to 100ms and 20%%)\n");
+    printf("     --repeat=COUNT\n");
+    printf("      Run the check COUNT times in-process and print a summary.\n");
+    printf("     --repeat-interval=DURATION\n");
+    printf("      Time between repeated checks. (Default to 1s)\n");
 }
 
 /* vim: set ts=4 sw=4 et syn=c : */
@@ -33,6 +33,7 @@ const char *progusage = "[--host <HOSTNAME>] [--port <PORT>]";
 /* MP Includes */
 #include "mp_common.h"
 #include "mp_utils.h"
+#include "mp_state.h"
 #include "redis_utils.h"
 /* Default Includes */
 #include <stdio.h>
@@ -56,6 +57,7 @@ int main (int argc, char **argv) {
     redisContext *c;
     redisReply *reply;
     char *redis_version = NULL;
+    char *target;
     long int used_memory = -1;              /** < Memory used now. */
     long int max_memory = -1;               /** < Memory allowed. */
     struct timeval start_time;
@@ -72,6 +74,11 @@ int main (int argc, char **argv) {
     /* Start plugin timeout */
     alarm(mp_timeout);
 
+    if (socket)
+        target = mp_strdup(socket);
+    else
+        mp_asprintf(&target, "%s:%d", hostname, port);
+
     // Connect to Server
     gettimeofday(&start_time, NULL);
     if (socket)
@@ -106,9 +113,13 @@ int main (int argc, char **argv) {
         } else if (strncmp(line, "total_connections_received:", 27) == 0) {
             mp_perfdata_int("connections", strtol(line+27, NULL, 10),
                     "c", NULL);
+            mp_perfdata_rate("connections_rate", target,
+                    strtoull(line+27, NULL, 10), MP_COUNTER64, "");
         } else if (strncmp(line, "total_commands_processed:", 25) == 0) {
             mp_perfdata_int("commands", strtol(line+25, NULL, 10),
                     "c", NULL);
+            mp_perfdata_rate("commands_rate", target,
+                    strtoull(line+25, NULL, 10), MP_COUNTER64, "");
         }
     }
     freeReplyObject(reply);
@@ -57,14 +57,68 @@ int         *sensor = NULL;
 int         sensors = 0;
 char        *degreeeUnit[] = { "F", "C" };
 
+/**
+ * Get a integer cell of a sensor row, 0 if the row or cell is missing.
+ */
+static long akcp_integer(const struct mp_snmp_table *table, oid column,
+        int row) {
+    long value = 0;
+
+    if (row >= 0)
+        mp_snmp_table_get_integer(table, column, row, &value);
+
+    return value;
+}
+
+/**
+ * Walk the needed columns of a sensorProbe table. The temperature and
+ * humidity tables share their column layout, only the temperature table
+ * has a unit column.
+ */
+static void akcp_walk(netsnmp_session *ss, const oid *entry,
+        const size_t entry_len, int temp, struct mp_snmp_table *table) {
+    oid columns[9];
+    size_t num = 0;
+
+    columns[num++] = MP_OID_sensorProbeTempDegree_COL;
+    columns[num++] = MP_OID_sensorProbeTempStatus_COL;
+    columns[num++] = MP_OID_sensorProbeTempOnline_COL;
+    if (sensor_name)
+        columns[num++] = MP_OID_sensorProbeTempDescription_COL;
+    if (mp_showperfdata) {
+        columns[num++] = MP_OID_sensorProbeTempHighWarning_COL;
+        columns[num++] = MP_OID_sensorProbeTempHighCritical_COL;
+        columns[num++] = MP_OID_sensorProbeTempLowWarning_COL;
+        columns[num++] = MP_OID_sensorProbeTempLowCritical_COL;
+    }
+    if (temp)
+        columns[num++] = MP_OID_sensorProbeTempDegreeType_COL;
+
+    if (mp_snmp_table_query_columns(ss, entry, entry_len, columns, num,
+                table) != STAT_SUCCESS) {
+        char *string;
+        snmp_error(ss, NULL, NULL, &string);
+        unknown("AKCP: Error fetching %s table: %s",
+                temp ? "temperature" : "humidity", string);
+    }
+
+    if (mp_verbose > 1)
+        printf("Fetched %d %s sensors\n", table->row,
+                temp ? "temperature" : "humidity");
+}
+
 int main (int argc, char **argv) {
     /* Local Vars */
     int             i;
     int             idx = 0;
+    int             row;
     int             state = STATE_OK;
     char            *output = NULL;
     char            *buf;
+    oid             index;
     netsnmp_session *ss;
+    struct mp_snmp_table temp_table = { 0 };
+    struct mp_snmp_table hum_table = { 0 };
 
     /* Set signal handling and alarm */
     if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
@@ -79,6 +133,14 @@ int main (int argc, char **argv) {
 
     ss = mp_snmp_init();
 
+    /* Fetch the sensor tables */
+    if (sensor_temp != 0)
+        akcp_walk(ss, MP_OID(MP_OID_sensorProbeTempEntry), 1, &temp_table);
+    if (sensor_hum != 0)
+        akcp_walk(ss, MP_OID(MP_OID_sensorProbeHumidityEntry), 0, &hum_table);
+
+    mp_snmp_deinit();
+
     /* Loop over sensor ports */
     for (i=0; i<(sensors?sensors:10); i++) {
         char *name = NULL;
@@ -88,52 +150,38 @@ int main (int argc, char **argv) {
 
         // Set index
         idx = sensor ? sensor[i]-1 : i;
+        index = idx;
 
-        /* Query Temp */
+        /* Check Temp */
         if (sensor_temp != 0) {
             long int temp;
-            long int temp_warn_high, temp_crit_high;
-            long int temp_warn_low, temp_crit_low;
             long int temp_unit;
 
-            mp_snmp_query_cmd snmpcmd[] = {
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,1,idx}, 15,
-                    ASN_OCTET_STR, (void *)&name, 0},
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,3,idx}, 15,
-                    ASN_INTEGER,   (void *)&temp, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,4,idx}, 15,
-                    ASN_INTEGER,   (void *)&sensor_state, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,5,idx}, 15,
-                    ASN_INTEGER,   (void *)&sensor_online, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,7,idx}, 15,
-                    ASN_INTEGER,   (void *)&temp_warn_high, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,8,idx}, 15,
-                    ASN_INTEGER,   (void *)&temp_crit_high, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,9,idx}, 15,
-                    ASN_INTEGER,   (void *)&temp_warn_low, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,10,idx}, 15,
-                    ASN_INTEGER,   (void *)&temp_crit_low, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,16,1,12,idx}, 15,
-                    ASN_INTEGER,   (void *)&temp_unit, sizeof(long int)},
-                {{0}, 0, 0, NULL},
-            };
+            row = mp_snmp_table_find(&temp_table, &index, 1);
 
             if(mp_verbose)
-                printf("Query Temp Sensor %d\n", idx);
+                printf("Check Temp Sensor %d\n", idx);
 
-            if(mp_snmp_query(ss, snmpcmd) != STAT_SUCCESS)
-                break;
+            sensor_state = akcp_integer(&temp_table,
+                    MP_OID_sensorProbeTempStatus_COL, row);
+            sensor_online = akcp_integer(&temp_table,
+                    MP_OID_sensorProbeTempOnline_COL, row);
 
             // Break on unavailable sensor in all sensor mode
             if (sensors == 0 && sensor_online == 0)
                 break;
 
+            temp = akcp_integer(&temp_table,
+                    MP_OID_sensorProbeTempDegree_COL, row);
+            temp_unit = akcp_integer(&temp_table,
+                    MP_OID_sensorProbeTempDegreeType_COL, row) == 1;
+
             // Get string of sensor name.
-            if (sensor_name == 0) {
-                if (name)
-                    free(name);
+            if (sensor_name == 0)
                 mp_asprintf(&name, "%d", i+1);
-            }
+            else if (row >= 0)
+                name = mp_snmp_table_get_string(&temp_table,
+                        MP_OID_sensorProbeTempDescription_COL, row);
 
             if (sensor_online == 1) { // Online
                 // Check state
@@ -167,10 +215,14 @@ int main (int argc, char **argv) {
                     threshold->critical = mp_malloc(sizeof(range));
                     memset(threshold->critical, 0, sizeof(range));
 
-                    threshold->critical->start = temp_crit_low;
-                    threshold->warning->start = temp_warn_low;
-                    threshold->warning->end = temp_warn_high;
-                    threshold->critical->end = temp_crit_high;
+                    threshold->critical->start = akcp_integer(&temp_table,
+                            MP_OID_sensorProbeTempLowCritical_COL, row);
+                    threshold->warning->start = akcp_integer(&temp_table,
+                            MP_OID_sensorProbeTempLowWarning_COL, row);
+                    threshold->warning->end = akcp_integer(&temp_table,
+                            MP_OID_sensorProbeTempHighWarning_COL, row);
+                    threshold->critical->end = akcp_integer(&temp_table,
+                            MP_OID_sensorProbeTempHighCritical_COL, row);
 
                     mp_asprintf(&buf, "temp_%s", name);
 
@@ -202,51 +254,36 @@ int main (int argc, char **argv) {
         }
         free(name);
 
-        /* Query Hum */
+        /* Check Hum */
         name = NULL;
         sensor_state = 0;
         sensor_online = 0;
         if (sensor_hum != 0) {
             long int    hum;
-            long int    hum_warn_high, hum_crit_high;
-            long int hum_warn_low, hum_crit_low;
-
-            mp_snmp_query_cmd snmpcmd[] = {
-                {{1,3,6,1,4,1,3854,1,2,2,1,17,1,1,idx}, 15,
-                    ASN_OCTET_STR, (void *)&name},
-                {{1,3,6,1,4,1,3854,1,2,2,1,17,1,3,idx}, 15,
-                    ASN_INTEGER,   (void *)&hum, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,17,1,4,idx}, 15,
-                    ASN_INTEGER,   (void *)&sensor_state, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,17,1,5,idx}, 15,
-                    ASN_INTEGER,   (void *)&sensor_online, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,17,1,7,idx}, 15,
-                    ASN_INTEGER,   (void *)&hum_warn_high, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,17,1,8,idx}, 15,
-                    ASN_INTEGER,   (void *)&hum_crit_high, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,17,1,9,idx}, 15,
-                    ASN_INTEGER,   (void *)&hum_warn_low, sizeof(long int)},
-                {{1,3,6,1,4,1,3854,1,2,2,1,17,1,10,idx}, 15,
-                    ASN_INTEGER,   (void *)&hum_crit_low, sizeof(long int)},
-                {{0}, 0, 0, NULL},
-            };
+
+            row = mp_snmp_table_find(&hum_table, &index, 1);
 
             if(mp_verbose)
-                printf("Query Hum Sensor %d\n", idx);
+                printf("Check Hum Sensor %d\n", idx);
 
-            if(mp_snmp_query(ss, snmpcmd) != STAT_SUCCESS)
-                break;
+            sensor_state = akcp_integer(&hum_table,
+                    MP_OID_sensorProbeHumidityStatus_COL, row);
+            sensor_online = akcp_integer(&hum_table,
+                    MP_OID_sensorProbeHumidityOnline_COL, row);
 
             // Break on unavailable sensor in all sensor mode
             if (sensors == 0 && sensor_online == 0)
                 break;
 
+            hum = akcp_integer(&hum_table,
+                    MP_OID_sensorProbeHumidityPercent_COL, row);
+
             // Get string of sensor name.
-            if (sensor_name == 0) {
-                if (name)
-                    free(name);
+            if (sensor_name == 0)
                 mp_asprintf(&name, "%d", i+1);
-            }
+            else if (row >= 0)
+                name = mp_snmp_table_get_string(&hum_table,
+                        MP_OID_sensorProbeHumidityDescription_COL, row);
 
             if (sensor_online == 1) { // Online
                 // Check state
@@ -279,10 +316,14 @@ int main (int argc, char **argv) {
                     threshold->critical = mp_malloc(sizeof(range));
                     memset(threshold->critical, 0, sizeof(range));
 
-                    threshold->critical->start = hum_crit_low;
-                    threshold->warning->start = hum_warn_low;
-                    threshold->warning->end = hum_warn_high;
-                    threshold->critical->end = hum_crit_high;
+                    threshold->critical->start = akcp_integer(&hum_table,
+                            MP_OID_sensorProbeHumidityLowCritical_COL, row);
+                    threshold->warning->start = akcp_integer(&hum_table,
+                            MP_OID_sensorProbeHumidityLowWarning_COL, row);
+                    threshold->warning->end = akcp_integer(&hum_table,
+                            MP_OID_sensorProbeHumidityHighWarning_COL, row);
+                    threshold->critical->end = akcp_integer(&hum_table,
+                            MP_OID_sensorProbeHumidityHighCritical_COL, row);
 
                     mp_asprintf(&buf, "hum_%s", name);
 
@@ -325,7 +366,8 @@ int main (int argc, char **argv) {
         sensor_found += found;
     }
 
-    mp_snmp_deinit();
+    mp_snmp_table_free(&temp_table);
+    mp_snmp_table_free(&hum_table);
 
     if (sensor_found == 0)
         unknown("No Sensors found.");
@@ -33,10 +33,12 @@ const char *progusage = "-H <HOST> [--on <PORTS>] [--off <PORTS>]";
 /* MP Includes */
 #include "mp_common.h"
 #include "snmp_utils.h"
+#include "snmp_async.h"
 /* Default Includes */
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 /* Library Includes */
 #include <net-snmp/net-snmp-config.h>
@@ -48,201 +50,216 @@ const char  *stateOn = NULL;
 const char  *stateOff = NULL;
 int         port = 161;
 
-int main (int argc, char **argv) {
-    /* Local Vars */
-    char        *output = NULL;
-    char        *pdu_name = NULL;
-    int         status = STATE_OK;
-    long        pdu_psu1 = -1;
-    long        pdu_psu2 = -1;
-    long int    outlet_state;
-    char        *outlet_name;
-    int         i;
-    int         rc = 0;
-    mp_snmp_subtree         table_state;
-    netsnmp_session         *ss;
+/**
+ * Find a outlet row by its number (the table index) or its name.
+ */
+static int find_outlet(const struct mp_snmp_table *table, const char *outlet) {
+    char *name;
+    oid idx;
+    int i;
+
+    idx = strtol(outlet, NULL, 10);
+    if (idx > 0)
+        return mp_snmp_table_find(table, &idx, 1);
+
+    for (i = 0; i < table->row; i++) {
+        name = mp_snmp_table_get_string(table,
+            MP_OID_rPDUOutletStatusOutletName_COL, i);
+        if (name && strcmp(outlet, name) == 0) {
+            free(name);
+            return i;
+        }
+        free(name);
+    }
 
-    /* Set signal handling and alarm */
-    if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
-        critical("Setup SIGALRM trap failed!");
+    return -1;
+}
 
-    /* Process check arguments */
-    if (process_arguments(argc, argv) != OK)
-        unknown("Parsing arguments failed!");
+/**
+ * Check a comma separated list of outlets for the wanted state.
+ */
+static void check_outlets(const struct mp_snmp_table *table,
+        const char *outlets, long want, char **output, int *status) {
+    char *c, *s, *p;
+    char *outlet_name;
+    long outlet_state;
+    int i;
+
+    p = s = mp_strdup(outlets);
+    while((c = strsep(&s, ","))) {
+        i = find_outlet(table, c);
+
+        if (i < 0 || !mp_snmp_table_get_integer(table,
+                MP_OID_rPDUOutletStatusOutletState_COL, i, &outlet_state)) {
+            mp_strcat_space(output, c);
+            mp_strcat_space(output, " not found!");
+            *status = *status == STATE_OK ? STATE_UNKNOWN : *status;
+            continue;
+        }
 
-    /* Start plugin timeout */
-    alarm(mp_timeout);
+        if (outlet_state != want) {
+            outlet_name = mp_snmp_table_get_string(table,
+                MP_OID_rPDUOutletStatusOutletName_COL, i);
 
-    ss = mp_snmp_init();
+            mp_strcat_space(output, outlet_name ? outlet_name : c);
+            mp_strcat_space(output, want == 1 ? " is off!" : " is on!");
+            *status = STATE_CRITICAL;
+            free(outlet_name);
+        }
+    }
+    free(p);
+}
 
+/**
+ * PDU values, one per polled agent.
+ */
+struct pdu_s {
+    long                psu1;
+    long                psu2;
+    char                *name;
+    mp_snmp_query_cmd   snmpcmd[4];
+    mp_snmp_subtree     subtree;
+    struct mp_snmp_table table;
+};
+
+static void pdu_init(struct pdu_s *pdu) {
     /* OIDs to query */
     mp_snmp_query_cmd snmpcmd[] = {
         {{1,3,6,1,4,1,318,1,1,12,4,1,1,0}, 14,
-            ASN_INTEGER, (void *)&pdu_psu1, sizeof(long int)},
+            ASN_INTEGER, (void *)&pdu->psu1, sizeof(long int)},
         {{1,3,6,1,4,1,318,1,1,12,4,1,2,0}, 14,
-            ASN_INTEGER, (void *)&pdu_psu2, sizeof(long int)},
+            ASN_INTEGER, (void *)&pdu->psu2, sizeof(long int)},
         {{1,3,6,1,2,1,1,5,0}, 9,
-            ASN_OCTET_STR, (void *)&pdu_name, 0},
+            ASN_OCTET_STR, (void *)&pdu->name, 0},
         {{0}, 0, 0, 0},
     };
 
-    rc = mp_snmp_query(ss, snmpcmd);
-    if (rc != STAT_SUCCESS) {
-        char *string;
-        snmp_error(ss, NULL, NULL, &string);
-        unknown("APC PDU: Error fetching values: %s", string);
-    }
-
-    rc = mp_snmp_subtree_query(ss, MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1),
-        &table_state);
-    if (rc != STAT_SUCCESS) {
-        char *string;
-        snmp_error(ss, NULL, NULL, &string);
-        unknown("APC PDU: Error fetching table: %s", string);
-    }
+    memset(pdu, 0, sizeof(struct pdu_s));
+    pdu->psu1 = -1;
+    pdu->psu2 = -1;
+    memcpy(pdu->snmpcmd, snmpcmd, sizeof(snmpcmd));
+}
 
-    mp_snmp_deinit();
+static void pdu_eval(struct pdu_s *pdu) {
+    char        *output = NULL;
+    int         status = STATE_OK;
+    long int    outlet_state;
+    char        *outlet_name;
+    int         i;
 
     // Check for PSU Failure
-    if (pdu_psu1 != 1) {
+    if (pdu->psu1 != 1) {
         status = STATE_CRITICAL;
         output = mp_strdup("Power Supply 1 Failed!");
-    } else if (pdu_psu2 != 1) {
+    } else if (pdu->psu2 != 1) {
         status = STATE_CRITICAL;
         output = mp_strdup("Power Supply 2 Failed!");
     }
 
-    outlet_name = mp_malloc(64);
-
     if (stateOn == NULL && stateOff == NULL) {
         // Check all outlets for on.
-        long int outlet_state;
-        for (i = 0; i<table_state.size; i++) {
-            rc = mp_snmp_subtree_get_value(&table_state,
-                MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1,1,4), i,
-                ASN_INTEGER, (void *)&outlet_state, sizeof(long int));
-            
-            if (rc != 1)
-                break;
+        for (i = 0; i < pdu->table.row; i++) {
+            if (!mp_snmp_table_get_integer(&pdu->table,
+                    MP_OID_rPDUOutletStatusOutletState_COL, i, &outlet_state))
+                continue;
 
             if (outlet_state != 1) {
-                mp_snmp_subtree_get_value(&table_state,
-                    MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1,1,2), i,
-                    ASN_OCTET_STR, (void *)&outlet_name, 64);
+                outlet_name = mp_snmp_table_get_string(&pdu->table,
+                    MP_OID_rPDUOutletStatusOutletName_COL, i);
 
-                mp_strcat_space(&output, outlet_name);
+                mp_strcat_space(&output, outlet_name ? outlet_name : "?");
                 mp_strcat_space(&output, " is off!");
                 status = STATE_CRITICAL;
+                free(outlet_name);
             }
         }
     } else {
-        if (stateOn != NULL) {
-            char *c, *s, *p;
-            p = s = mp_strdup(stateOn);
-            while((c = strsep(&s, ","))) {
-                i = strtol(c, NULL, 10);
-                if (i == 0) {
-                    for (i = 0; i<table_state.size; i++) {
-                        rc = mp_snmp_subtree_get_value(&table_state,
-                            MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1,1,2), i,
-                            ASN_OCTET_STR, (void *)&outlet_name, 64);
-
-                        if (rc == 0 || strcmp(c, outlet_name) == 0)
-                            break;
-                    }
-                    if (rc == 0) {
-                        mp_strcat_space(&output, c);
-                        mp_strcat_space(&output, " not found!");
-                        status = status == STATE_OK ? STATE_UNKNOWN : status;
-                        continue;
-                    }
-                } else {
-                    i--;
-                }
-                    
-                rc = mp_snmp_subtree_get_value(&table_state,
-                    MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1,1,4), i,
-                    ASN_INTEGER, (void *)&outlet_state, sizeof(long int));
-
-                if (rc == 0) {
-                    mp_strcat_space(&output, c);
-                    mp_strcat_space(&output, " not found!");
-                    status = status == STATE_OK ? STATE_UNKNOWN : status;
-                    continue;
-                }
-
-                if (outlet_state != 1) {
-                    mp_snmp_subtree_get_value(&table_state,
-                        MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1,1,2), i,
-                        ASN_OCTET_STR, (void *)&outlet_name, 64);
-
-                    mp_strcat_space(&output, outlet_name);
-                    mp_strcat_space(&output, " is off!");
-                    status = STATE_CRITICAL;
-                }
-            }
-            free( p );
-        }
-        if (stateOff != NULL) {
-            char *c, *s, *p;
-            p = s = mp_strdup(stateOff);
-            while((c = strsep(&s, ","))) {
-                i = strtol(c, NULL, 10);
-                if (i == 0) {
-                    for (i = 0; i<table_state.size; i++) {
-                        rc = mp_snmp_subtree_get_value(&table_state,
-                            MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1,1,2), i,
-                            ASN_OCTET_STR, (void *)&outlet_name, 64);
-
-                        if (rc == 0 || strcmp(c, outlet_name) == 0)
-                            break;
-                    }
-                    if (rc == 0) {
-                        mp_strcat_space(&output, c);
-                        mp_strcat_space(&output, " not found!");
-                        status = status == STATE_OK ? STATE_UNKNOWN : status;
-                        continue;
-                    }
-                } else {
-                    i--;
-                }
-
-                rc = mp_snmp_subtree_get_value(&table_state,
-                    MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1,1,4), i,
-                    ASN_INTEGER, (void *)&outlet_state, sizeof(long int));
-
-                if (rc == 0) {
-                    mp_strcat_space(&output, c);
-                    mp_strcat_space(&output, " not found!");
-                    status = status == STATE_OK ? STATE_UNKNOWN : status;
-                    continue;
-                }
-
-                if (outlet_state != 2) {
-                    mp_snmp_subtree_get_value(&table_state,
-                        MP_OID(1,3,6,1,4,1,318,1,1,12,3,5,1,1,2), i,
-                        ASN_OCTET_STR, (void *)&outlet_name, 64);
-
-                    mp_strcat_space(&output, outlet_name);
-                    mp_strcat_space(&output, " is on!");
-                    status = STATE_CRITICAL;
-                }
-            }
-            free( p );
-        }
+        if (stateOn != NULL)
+            check_outlets(&pdu->table, stateOn, 1, &output, &status);
+        if (stateOff != NULL)
+            check_outlets(&pdu->table, stateOff, 2, &output, &status);
     }
 
-    mp_snmp_subtree_free(&table_state);
-    free(outlet_name);
+    mp_snmp_table_free(&pdu->table);
 
     /* Output and return */
     if (status == STATE_OK)
-        ok("APC PDU %s", pdu_name);
+        ok("APC PDU %s", pdu->name);
     if (status == STATE_WARNING)
-        warning("APC PDU %s [%s]", pdu_name, output);
+        warning("APC PDU %s [%s]", pdu->name, output);
     if (status == STATE_UNKNOWN)
-        unknown("APC PDU %s [%s]", pdu_name, output);
-    critical("APC PDU %s [%s]", pdu_name, output);
+        unknown("APC PDU %s [%s]", pdu->name, output);
+    critical("APC PDU %s [%s]", pdu->name, output);
+}
+
+static void pdu_eval_agent(mp_snmp_agent *agent) {
+    struct pdu_s *pdu = (struct pdu_s *) agent->data;
+
+    mp_snmp_table_build(&pdu->subtree,
+        MP_OID(MP_OID_rPDUOutletStatusEntry), &pdu->table);
+    pdu_eval(pdu);
+}
+
+int main (int argc, char **argv) {
+    /* Local Vars */
+    struct pdu_s    pdu;
+    struct pdu_s    *multi;
+    mp_snmp_agent   **agents;
+    int             i;
+    int             rc = 0;
+    netsnmp_session *ss;
+
+    /* Set signal handling and alarm */
+    if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
+        critical("Setup SIGALRM trap failed!");
+
+    /* Process check arguments */
+    if (process_arguments(argc, argv) != OK)
+        unknown("Parsing arguments failed!");
+
+    /* Start plugin timeout */
+    alarm(mp_timeout);
+
+    if (mp_snmp_hosts_num > 0) {
+        multi = mp_calloc(mp_snmp_hosts_num, sizeof(struct pdu_s));
+        agents = mp_calloc(mp_snmp_hosts_num, sizeof(mp_snmp_agent *));
+
+        for (i = 0; i < mp_snmp_hosts_num; i++) {
+            pdu_init(&multi[i]);
+            agents[i] = mp_snmp_async_agent(mp_snmp_hosts[i], port, &multi[i]);
+            mp_snmp_async_query(agents[i], multi[i].snmpcmd);
+            mp_snmp_async_columns(agents[i],
+                MP_OID(MP_OID_rPDUOutletStatusEntry),
+                MP_OID(MP_OID_rPDUOutletStatusOutletName_COL,
+                       MP_OID_rPDUOutletStatusOutletState_COL),
+                &multi[i].subtree);
+        }
+
+        if (mp_snmp_async_run() != OK)
+            unknown("SNMP event loop failed.");
+        alarm(0);
+
+        mp_snmp_async_exit(agents, mp_snmp_hosts_num, pdu_eval_agent);
+    }
+
+    pdu_init(&pdu);
+
+    ss = mp_snmp_init();
+
+    mp_snmp_query(ss, pdu.snmpcmd);
+
+    rc = mp_snmp_table_query_columns(ss, MP_OID(MP_OID_rPDUOutletStatusEntry),
+        MP_OID(MP_OID_rPDUOutletStatusOutletName_COL,
+               MP_OID_rPDUOutletStatusOutletState_COL), &pdu.table);
+    if (rc != STAT_SUCCESS) {
+        char *string;
+        snmp_error(ss, NULL, NULL, &string);
+        unknown("APC PDU: Error fetching table: %s", string);
+    }
+
+    mp_snmp_deinit();
+
+    pdu_eval(&pdu);
 }
 
 int process_arguments (int argc, char **argv) {
@@ -253,6 +270,7 @@ int process_arguments (int argc, char **argv) {
             MP_LONGOPTS_DEFAULT,
             MP_LONGOPTS_HOST,
             MP_LONGOPTS_PORT,
+            MP_LONGOPTS_SNMP_HOSTS,
             {"on", required_argument, NULL, (int)'o'},
             {"off", required_argument, NULL, (int)'O'},
             SNMP_LONGOPTS,
@@ -282,6 +300,9 @@ int process_arguments (int argc, char **argv) {
             case 'P':
                 getopt_port(optarg, &port);
                 break;
+            case MP_LONGOPT_HOSTS:
+                getopt_snmp_hosts(optarg);
+                break;
             case 'o':
                 stateOn = optarg;
                 break;
@@ -318,6 +339,7 @@ void print_help (void) {
     printf("      Ports which should be Off.\n");
 
     print_help_snmp();
+    print_help_snmp_hosts();
 }
 
 /* vim: set ts=4 sw=4 et syn=c : */
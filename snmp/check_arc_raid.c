@@ -51,12 +51,11 @@ int         port = 161;
 int main (int argc, char **argv) {
     /* Local Vars */
     int         i;
-    int         rc = 0;
     char        *output = NULL;
     char        *raid_state = NULL;
     char        *raid_name = NULL;
     int         status = STATE_OK;
-    mp_snmp_subtree         table_state;
+    struct mp_snmp_table    table_state;
     netsnmp_session         *ss;
 
     /* Set signal handling and alarm */
@@ -74,7 +73,8 @@ int main (int argc, char **argv) {
     ss = mp_snmp_init();
 
     /* OIDs to query */
-    status = mp_snmp_subtree_query(ss, MP_OID(1,3,6,1,4,1,18928,1,2,4,1),
+    status = mp_snmp_table_query_columns(ss, MP_OID(MP_OID_raidSetEntry),
+        MP_OID(MP_OID_raidSetName_COL, MP_OID_raidSetState_COL),
         &table_state);
     if (status != STAT_SUCCESS) {
         char *string;
@@ -86,26 +86,19 @@ int main (int argc, char **argv) {
 
     status = STATE_OK;
 
-    raid_state = mp_malloc(24);
-    raid_name = mp_malloc(64);
+    for (i = 0; i < table_state.row; i++) {
+        raid_state = mp_snmp_table_get_string(&table_state,
+            MP_OID_raidSetState_COL, i);
 
-    for (i = 0; i<table_state.size; i++) {
-        rc = mp_snmp_subtree_get_value(&table_state,
-            MP_OID(1,3,6,1,4,1,18928,1,2,4,1,1,4), i,
-            ASN_OCTET_STR, (void *)&raid_state, 24);
-
-        if (rc == 0)
-            break;
-
-        if ( (strcmp(raid_state, "Normal") == 0) || (strcmp(raid_state, "Checking") == 0) ){
+        if ( raid_state == NULL || (strcmp(raid_state, "Normal") == 0) || (strcmp(raid_state, "Checking") == 0) ){
+            free(raid_state);
             continue;
         }
 
-        rc = mp_snmp_subtree_get_value(&table_state,
-            MP_OID(1,3,6,1,4,1,18928,1,2,4,1,1,2), i,
-            ASN_OCTET_STR, (void *)&raid_name, 64);
+        raid_name = mp_snmp_table_get_string(&table_state,
+            MP_OID_raidSetName_COL, i);
 
-        mp_strcat_comma(&output, raid_name);
+        mp_strcat_comma(&output, raid_name ? raid_name : "?");
         mp_strcat_space(&output, "is");
         mp_strcat_space(&output, raid_state);
 
@@ -113,10 +106,11 @@ int main (int argc, char **argv) {
             status = STATE_CRITICAL;
         else
             status = STATE_WARNING;
+
+        free(raid_state);
+        free(raid_name);
     }
-    mp_snmp_subtree_free(&table_state);
-    free(raid_state);
-    free(raid_name);
+    mp_snmp_table_free(&table_state);
 
     if (i == 0)
         unknown("ARC: No raid set found.");
@@ -28,37 +28,357 @@ const char *progdesc  = "Check interface status by SNMP IF-MIB.";
 const char *progvers  = "0.1";
 const char *progcopy  = "2010";
 const char *progauth  = "Marius Rieder <marius.rieder@durchmesser.ch>";
-const char *progusage = "-H <HOST> -I <ifIndex>";
+const char *progusage = "-H <HOST> [-I <ifIndex>[,<ifIndex>]] [-n <REGEX>] [--alias <REGEX>]";
 
 /* MP Includes */
 #include "mp_common.h"
+#include "mp_state.h"
 #include "snmp_utils.h"
+#include "snmp_async.h"
 /* Default Includes */
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <regex.h>
 /* Library Includes */
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 
+#define LONGOPT_ALIAS MP_LONGOPT_PRIV0
+#define LONGOPT_ALL   MP_LONGOPT_PRIV1
+
 /* Global Vars */
 const char  *hostname = NULL;
 int         port = 161;
 int         ifIndex = 0;
+int         *ifIndexes = NULL;
+int         ifIndexes_num = 0;
+regex_t     *name_re = NULL;
+regex_t     *alias_re = NULL;
+int         walk = 0;
 int         should = 1;
+thresholds  *usage_thresholds = NULL;
+
+/**
+ * Interface values, one per polled agent.
+ */
+struct iface_s {
+    const char  *host;
+    long int    ifOperStatus;
+    char        *ifDescr;
+    long int    ifSpeed;
+    long int    ifInOctets;
+    long int    ifInErrors;
+    long int    ifOutOctets;
+    long int    ifOutErrors;
+    uint64_t    ifHCInOctets;
+    uint64_t    ifHCOutOctets;
+    mp_snmp_query_cmd snmpcmd[10];
+};
+
+static void iface_init(struct iface_s *iface, const char *host) {
+    /* OIDs to query */
+    mp_snmp_query_cmd snmpcmd[] = {
+        {{MP_OID_ifDescr, ifIndex}, MP_OID_ifDescr_LEN + 1,
+            ASN_OCTET_STR, (void *)&iface->ifDescr, 0},
+        {{MP_OID_ifSpeed, ifIndex}, MP_OID_ifSpeed_LEN + 1,
+            ASN_GAUGE, (void *)&iface->ifSpeed, sizeof(long int)},
+        {{MP_OID_ifOperStatus, ifIndex}, MP_OID_ifOperStatus_LEN + 1,
+            ASN_INTEGER, (void *)&iface->ifOperStatus, sizeof(long int)},
+        {{MP_OID_ifInOctets, ifIndex}, MP_OID_ifInOctets_LEN + 1,
+            ASN_COUNTER, (void *)&iface->ifInOctets, sizeof(long int)},
+        {{MP_OID_ifInErrors, ifIndex}, MP_OID_ifInErrors_LEN + 1,
+            ASN_COUNTER, (void *)&iface->ifInErrors, sizeof(long int)},
+        {{MP_OID_ifOutOctets, ifIndex}, MP_OID_ifOutOctets_LEN + 1,
+            ASN_COUNTER, (void *)&iface->ifOutOctets, sizeof(long int)},
+        {{MP_OID_ifOutErrors, ifIndex}, MP_OID_ifOutErrors_LEN + 1,
+            ASN_COUNTER, (void *)&iface->ifOutErrors, sizeof(long int)},
+        {{MP_OID_ifHCInOctets, ifIndex}, MP_OID_ifHCInOctets_LEN + 1,
+            ASN_COUNTER64, (void *)&iface->ifHCInOctets, sizeof(uint64_t)},
+        {{MP_OID_ifHCOutOctets, ifIndex}, MP_OID_ifHCOutOctets_LEN + 1,
+            ASN_COUNTER64, (void *)&iface->ifHCOutOctets, sizeof(uint64_t)},
+        {{0}, 0, 0, 0, 0},
+    };
+
+    memset(iface, 0, sizeof(struct iface_s));
+    iface->host = host;
+    memcpy(iface->snmpcmd, snmpcmd, sizeof(snmpcmd));
+
+    /* SNMPv1 has no Counter64 and fails the whole GET on a unknown OID. */
+    if (mp_snmp_version == SNMP_VERSION_1)
+        memset(&iface->snmpcmd[7], 0, sizeof(mp_snmp_query_cmd));
+}
+
+/**
+ * Add the rate perfdata of a octet counter. Samples are stored per
+ * counter, so switching between the 32 and 64-bit one starts over.
+ */
+static void iface_rate(const char *target, const char *label,
+        const char *counter, uint64_t value, int width) {
+    double rate;
+
+    if (mp_state_rate(target, counter, value, width, &rate) == OK)
+        mp_perfdata_float(label, (float)rate, "B", NULL);
+}
+
+static void iface_eval(struct iface_s *iface) {
+    char        *target;
+
+    if (iface->ifDescr == NULL)
+        unknown("Interface with index %d not found.", ifIndex);
+
+    mp_perfdata_int("ifInOctets", iface->ifInOctets, "c", NULL);
+    mp_perfdata_int("ifInErrors", iface->ifInErrors, "c", NULL);
+    mp_perfdata_int("ifOutOctets", iface->ifOutOctets, "c", NULL);
+    mp_perfdata_int("ifOutErrors", iface->ifOutErrors, "c", NULL);
+    mp_perfdata_int("ifSpeed", iface->ifSpeed, "", NULL);
+
+    mp_asprintf(&target, "%s:%d", iface->host, ifIndex);
+    /* Prefer the 64-bit counters, agents without them leave them at 0. */
+    if (iface->ifHCInOctets || iface->ifHCOutOctets) {
+        iface_rate(target, "ifInOctets_rate", "ifHCInOctets",
+                iface->ifHCInOctets, MP_COUNTER64);
+        iface_rate(target, "ifOutOctets_rate", "ifHCOutOctets",
+                iface->ifHCOutOctets, MP_COUNTER64);
+    } else {
+        iface_rate(target, "ifInOctets_rate", "ifInOctets",
+                (uint32_t)iface->ifInOctets, MP_COUNTER32);
+        iface_rate(target, "ifOutOctets_rate", "ifOutOctets",
+                (uint32_t)iface->ifOutOctets, MP_COUNTER32);
+    }
+    free(target);
+
+    if (iface->ifOperStatus == should) {
+        ok("%s is %s", iface->ifDescr,
+           ifOperStatusText[(int)iface->ifOperStatus]);
+    } else {
+        critical("%s is %s", iface->ifDescr,
+                 ifOperStatusText[(int)iface->ifOperStatus]);
+    }
+}
+
+static void iface_eval_agent(mp_snmp_agent *agent) {
+    iface_eval((struct iface_s *) agent->data);
+}
+
+/**
+ * Check if interface row of the walked tables is selected by the index
+ * list and the name and alias regex.
+ */
+static int iface_selected(long idx, const char *name, const char *alias) {
+    int i;
+
+    if (ifIndexes_num > 0) {
+        for (i = 0; i < ifIndexes_num; i++) {
+            if (ifIndexes[i] == idx)
+                break;
+        }
+        if (i == ifIndexes_num)
+            return 0;
+    }
+
+    if (name_re && regexec(name_re, name, 0, NULL, 0) != 0)
+        return 0;
+    if (alias_re && (!alias || regexec(alias_re, alias, 0, NULL, 0) != 0))
+        return 0;
+
+    return 1;
+}
+
+/**
+ * Per second rate of a counter of a interface in bit/s.
+ */
+static int iface_bps(long idx, const char *label, uint64_t value,
+        int width, double *bps) {
+    char *target;
+    double rate;
+    int rc;
+
+    mp_asprintf(&target, "%s:%ld", hostname, idx);
+    rc = mp_state_rate(target, label, value, width, &rate);
+    free(target);
+
+    if (rc != OK)
+        return 0;
+
+    *bps = rate * 8;
+    return 1;
+}
+
+/**
+ * Walk ifTable and ifXTable once and check all selected interfaces.
+ */
+static void iface_walk(netsnmp_session *ss) {
+    struct mp_snmp_table    iftable;
+    struct mp_snmp_table    xtable;
+    const oid   *idx;
+    size_t      idx_len;
+    char        *output = NULL;
+    char        *name, *alias, *label;
+    char        buf[64];
+    long        oper_status, speed, high_speed;
+    uint64_t    in_octets, out_octets;
+    double      in_bps, out_bps, in_util, out_util;
+    int         width, have_rate;
+    int         i, x;
+    int         count = 0, bad = 0;
+    int         state, usage_state, status = STATE_OK;
+
+    if (mp_snmp_table_query_columns(ss, MP_OID(MP_OID_ifEntry),
+            MP_OID(MP_OID_ifDescr_COL, MP_OID_ifSpeed_COL,
+                   MP_OID_ifOperStatus_COL, MP_OID_ifInOctets_COL,
+                   MP_OID_ifOutOctets_COL), &iftable) != STAT_SUCCESS) {
+        char *string;
+        snmp_error(ss, NULL, NULL, &string);
+        unknown("Error fetching ifTable: %s", string);
+    }
+
+    /* SNMPv1 agents have no Counter64, the walk just stays empty. */
+    if (mp_snmp_table_query_columns(ss, MP_OID(MP_OID_ifXEntry),
+            MP_OID(MP_OID_ifName_COL, MP_OID_ifHCInOctets_COL,
+                   MP_OID_ifHCOutOctets_COL, MP_OID_ifHighSpeed_COL,
+                   MP_OID_ifAlias_COL), &xtable) != STAT_SUCCESS) {
+        memset(&xtable, 0, sizeof(xtable));
+    }
+
+    mp_snmp_deinit();
+
+    for (i = 0; i < iftable.row; i++) {
+        idx = mp_snmp_table_index(&iftable, i, &idx_len);
+        if (!idx || idx_len != 1)
+            continue;
+        x = mp_snmp_table_find(&xtable, idx, idx_len);
+
+        name = x < 0 ? NULL :
+            mp_snmp_table_get_string(&xtable, MP_OID_ifName_COL, x);
+        if (!name || !*name) {
+            free(name);
+            name = mp_snmp_table_get_string(&iftable, MP_OID_ifDescr_COL, i);
+        }
+        if (!name)
+            mp_asprintf(&name, "%ld", (long)idx[0]);
+        alias = x < 0 ? NULL :
+            mp_snmp_table_get_string(&xtable, MP_OID_ifAlias_COL, x);
+
+        if (!iface_selected(idx[0], name, alias)) {
+            free(name);
+            free(alias);
+            continue;
+        }
+        count++;
+        state = STATE_OK;
+
+        if (!mp_snmp_table_get_integer(&iftable, MP_OID_ifOperStatus_COL, i,
+                &oper_status) || oper_status < 1 || oper_status > 7)
+            oper_status = 4;
+        if (oper_status != should) {
+            state = STATE_CRITICAL;
+            mp_snprintf(buf, sizeof(buf), "%s is %s", name,
+                    ifOperStatusText[oper_status]);
+            mp_strcat_comma(&output, buf);
+        }
+
+        /* Prefer the 64-bit counters and speed of the ifXTable. */
+        width = MP_COUNTER64;
+        if (x < 0 ||
+                !mp_snmp_table_get_counter64(&xtable, MP_OID_ifHCInOctets_COL,
+                    x, &in_octets) ||
+                !mp_snmp_table_get_counter64(&xtable, MP_OID_ifHCOutOctets_COL,
+                    x, &out_octets)) {
+            width = MP_COUNTER32;
+            if (!mp_snmp_table_get_counter64(&iftable, MP_OID_ifInOctets_COL,
+                        i, &in_octets) ||
+                    !mp_snmp_table_get_counter64(&iftable,
+                        MP_OID_ifOutOctets_COL, i, &out_octets))
+                width = 0;
+        }
+
+        speed = 0;
+        if (x >= 0 && mp_snmp_table_get_integer(&xtable,
+                    MP_OID_ifHighSpeed_COL, x, &high_speed) && high_speed > 0)
+            speed = high_speed * 1000000L;
+        else
+            mp_snmp_table_get_integer(&iftable, MP_OID_ifSpeed_COL, i, &speed);
+
+        /* Store both samples, even if the first has no previous one. */
+        have_rate = 0;
+        if (width) {
+            have_rate = iface_bps(idx[0], width == MP_COUNTER64 ?
+                    "ifHCInOctets" : "ifInOctets", in_octets, width, &in_bps);
+            if (!iface_bps(idx[0], width == MP_COUNTER64 ?
+                    "ifHCOutOctets" : "ifOutOctets", out_octets, width,
+                    &out_bps))
+                have_rate = 0;
+        }
+
+        if (have_rate) {
+
+            mp_asprintf(&label, "%s_in_bps", name);
+            mp_perfdata_float2(label, (float)in_bps, "", NULL,
+                    1, 0, speed > 0, (float)speed);
+            free(label);
+            mp_asprintf(&label, "%s_out_bps", name);
+            mp_perfdata_float2(label, (float)out_bps, "", NULL,
+                    1, 0, speed > 0, (float)speed);
+            free(label);
+
+            if (speed > 0) {
+                in_util = in_bps * 100 / speed;
+                out_util = out_bps * 100 / speed;
+
+                mp_asprintf(&label, "%s_in_usage", name);
+                mp_perfdata_float2(label, (float)in_util, "%",
+                        usage_thresholds, 1, 0, 1, 100);
+                free(label);
+                mp_asprintf(&label, "%s_out_usage", name);
+                mp_perfdata_float2(label, (float)out_util, "%",
+                        usage_thresholds, 1, 0, 1, 100);
+                free(label);
+
+                usage_state = get_status(
+                        in_util > out_util ? in_util : out_util,
+                        usage_thresholds);
+                if (usage_state != STATE_OK) {
+                    mp_snprintf(buf, sizeof(buf), "%s at %.1f%%/%.1f%%",
+                            name, in_util, out_util);
+                    mp_strcat_comma(&output, buf);
+                    if (usage_state > state)
+                        state = usage_state;
+                }
+            }
+        }
+
+        if (state != STATE_OK)
+            bad++;
+        if (state > status)
+            status = state;
+
+        free(name);
+        free(alias);
+    }
+
+    mp_snmp_table_free(&iftable);
+    mp_snmp_table_free(&xtable);
+
+    if (count == 0)
+        unknown("No interface selected.");
+
+    if (status == STATE_OK)
+        ok("%d interfaces OK", count);
+    if (status == STATE_WARNING)
+        warning("%d of %d interfaces: %s", bad, count, output);
+    critical("%d of %d interfaces: %s", bad, count, output);
+}
 
 int main (int argc, char **argv) {
     /* Local Vars */
-    long int    ifOperStatus = 0;
-    char        *ifDescr = NULL;
-    long int    ifSpeed = 0;
-    long int    ifInOctets = 0;
-    long int    ifInErrors = 0;
-    long int    ifOutOctets = 0;
-    long int    ifOutErrors = 0;
-    netsnmp_session         *ss;
+    struct iface_s  iface;
+    struct iface_s  *multi;
+    mp_snmp_agent   **agents;
+    int             i;
+    netsnmp_session *ss;
 
     /* Set signal handling and alarm */
     if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
@@ -71,45 +391,35 @@ int main (int argc, char **argv) {
     /* Start plugin timeout */
     alarm(mp_timeout);
 
-    ss = mp_snmp_init();
-
-    /* OIDs to query */
-    mp_snmp_query_cmd snmpcmd[] = {
-        {{1,3,6,1,2,1,2,2,1,2,ifIndex}, 11,
-            ASN_OCTET_STR, (void *)&ifDescr, 0},
-        {{1,3,6,1,2,1,2,2,1,5,ifIndex}, 11,
-            ASN_GAUGE, (void *)&ifSpeed, sizeof(long int)},
-        {{1,3,6,1,2,1,2,2,1,8,ifIndex}, 11,
-            ASN_INTEGER, (void *)&ifOperStatus, sizeof(long int)},
-        {{1,3,6,1,2,1,2,2,1,10,ifIndex}, 11,
-            ASN_COUNTER, (void *)&ifInOctets, sizeof(long int)},
-        {{1,3,6,1,2,1,2,2,1,14,ifIndex}, 11,
-            ASN_COUNTER, (void *)&ifInErrors, sizeof(long int)},
-        {{1,3,6,1,2,1,2,2,1,16,ifIndex}, 11,
-            ASN_COUNTER, (void *)&ifOutOctets, sizeof(long int)},
-        {{1,3,6,1,2,1,2,2,1,20,ifIndex}, 11,
-            ASN_COUNTER, (void *)&ifOutErrors, sizeof(long int)},
-        {{0}, 0, 0, 0, 0},
-    };
-    
-    mp_snmp_query(ss, snmpcmd);
+    if (walk) {
+        ss = mp_snmp_init();
+        iface_walk(ss);
+    }
 
-    mp_snmp_deinit();
+    if (mp_snmp_hosts_num > 0) {
+        multi = mp_calloc(mp_snmp_hosts_num, sizeof(struct iface_s));
+        agents = mp_calloc(mp_snmp_hosts_num, sizeof(mp_snmp_agent *));
 
-    if (ifDescr == NULL)
-        unknown("Interface with index %d not found.", ifIndex);
+        for (i = 0; i < mp_snmp_hosts_num; i++) {
+            iface_init(&multi[i], mp_snmp_hosts[i]);
+            agents[i] = mp_snmp_async_agent(mp_snmp_hosts[i], port, &multi[i]);
+            mp_snmp_async_query(agents[i], multi[i].snmpcmd);
+        }
 
-    mp_perfdata_int("ifInOctets", ifInOctets, "c", NULL);
-    mp_perfdata_int("ifInErrors", ifInErrors, "c", NULL);
-    mp_perfdata_int("ifOutOctets", ifOutOctets, "c", NULL);
-    mp_perfdata_int("ifOutErrors", ifOutErrors, "c", NULL);
-    mp_perfdata_int("ifSpeed", ifSpeed, "", NULL);
+        if (mp_snmp_async_run() != OK)
+            unknown("SNMP event loop failed.");
+        alarm(0);
 
-    if (ifOperStatus == should) {
-        ok("%s is %s", ifDescr,  ifOperStatusText[(int)ifOperStatus]);
-    } else {
-        critical("%s is %s", ifDescr,  ifOperStatusText[(int)ifOperStatus]);
+        mp_snmp_async_exit(agents, mp_snmp_hosts_num, iface_eval_agent);
     }
+
+    iface_init(&iface, hostname);
+
+    ss = mp_snmp_init();
+    mp_snmp_query(ss, iface.snmpcmd);
+    mp_snmp_deinit();
+
+    iface_eval(&iface);
 }
 
 int process_arguments (int argc, char **argv) {
@@ -120,9 +430,14 @@ int process_arguments (int argc, char **argv) {
             MP_LONGOPTS_DEFAULT,
             MP_LONGOPTS_HOST,
             MP_LONGOPTS_PORT,
+            MP_LONGOPTS_SNMP_HOSTS,
             {"interface", required_argument, NULL, (int)'I'},
             {"down",      no_argument,       NULL, (int)'d'},
             {"should",    required_argument, NULL, (int)'s'},
+            {"name",      required_argument, NULL, (int)'n'},
+            {"alias",     required_argument, NULL, (int)LONGOPT_ALIAS},
+            {"all",       no_argument,       NULL, (int)LONGOPT_ALL},
+            MP_LONGOPTS_WC,
             SNMP_LONGOPTS,
             MP_LONGOPTS_END
     };
@@ -134,7 +449,7 @@ int process_arguments (int argc, char **argv) {
 
 
     while (1) {
-        c = mp_getopt(&argc, &argv, MP_OPTSTR_DEFAULT"H:P:I:ds:"SNMP_OPTSTR, longopts, &option);
+        c = mp_getopt(&argc, &argv, MP_OPTSTR_DEFAULT"H:P:I:ds:n:w:c:"SNMP_OPTSTR, longopts, &option);
 
         if (c == -1 || c == EOF)
             break;
@@ -150,9 +465,32 @@ int process_arguments (int argc, char **argv) {
             case 'P':
                 getopt_port(optarg, &port);
                 break;
+            case MP_LONGOPT_HOSTS:
+                getopt_snmp_hosts(optarg);
+                break;
             /* Plugin opt */
             case 'I':
-                ifIndex = (int) strtol(optarg, NULL, 10);
+                mp_array_push_int(&ifIndexes, optarg, &ifIndexes_num);
+                break;
+            case 'n':
+                name_re = mp_malloc(sizeof(regex_t));
+                if (regcomp(name_re, optarg, REG_EXTENDED | REG_NOSUB) != 0)
+                    usage("Invalid name regex '%s'.", optarg);
+                walk = 1;
+                break;
+            case LONGOPT_ALIAS:
+                alias_re = mp_malloc(sizeof(regex_t));
+                if (regcomp(alias_re, optarg, REG_EXTENDED | REG_NOSUB) != 0)
+                    usage("Invalid alias regex '%s'.", optarg);
+                walk = 1;
+                break;
+            case LONGOPT_ALL:
+                walk = 1;
+                break;
+            case 'w':
+            case 'c':
+                getopt_wc(c, optarg, &usage_thresholds);
+                walk = 1;
                 break;
             case 'd':
                 should= 2;
@@ -169,6 +507,14 @@ int process_arguments (int argc, char **argv) {
     if (should > 7)
         usage("should is one of up, down, testing, inknown, dormant, notPresent, lowerLayerDown");
 
+    if (ifIndexes_num > 1)
+        walk = 1;
+    else if (ifIndexes_num == 1)
+        ifIndex = ifIndexes[0];
+
+    if (walk && mp_snmp_hosts_num > 0)
+        usage("--hosts checks a single interface, not a selection.");
+
     return(OK);
 }
 
@@ -187,14 +533,24 @@ void print_help (void) {
 
     print_help_default();
 
-    printf(" -I, --interface=[INDEX]\n");
-    printf("      Index of Interface to check.\n");
+    printf(" -I, --interface=INDEX[,INDEX]\n");
+    printf("      Index of Interface to check. Several indexes walk the tables.\n");
+    printf(" -n, --name=REGEX\n");
+    printf("      Check all interfaces with a ifName (or ifDescr) matching REGEX.\n");
+    printf("     --alias=REGEX\n");
+    printf("      Check all interfaces with a ifAlias matching REGEX.\n");
+    printf("     --all\n");
+    printf("      Check all interfaces.\n");
     printf(" -d, --down\n");
     printf("      Check for interface being down.\n");
     printf(" -s --should=[STATE]\n");
     printf("      Check for interface being in STATE.\n");
+    print_help_warn("usage", "none");
+    print_help_crit("usage", "none");
+    printf("      Usage is the in or out bit rate in percent of the speed.\n");
 
     print_help_snmp();
+    print_help_snmp_hosts();
 }
 
 /* vim: set ts=4 sw=4 et syn=c : */
@@ -55,11 +55,12 @@ int main (int argc, char **argv) {
     /* Local Vars */
     int         i, j;
     int         rc;
-    char        *vrrp_name;
+    int         rows;
+    char        *vrrp_name = NULL;
     long int    vrrp_id;
     long int    vrrp_state = -1;
     long int    vrrp_state_initial = -1;
-    mp_snmp_subtree         table_state;
+    struct mp_snmp_table    table_state;
     netsnmp_session         *ss;
 
     /* Set signal handling and alarm */
@@ -77,8 +78,11 @@ int main (int argc, char **argv) {
     ss = mp_snmp_init();
 
     /* OIDs to query */
-    rc = mp_snmp_subtree_query(ss, MP_OID(1,3,6,1,4,1,9586,100,5,2,3,1),
-        &table_state);
+    rc = mp_snmp_table_query_columns(ss, MP_OID(MP_OID_vrrpInstanceEntry),
+        MP_OID(MP_OID_vrrpInstanceName_COL,
+               MP_OID_vrrpInstanceVirtualRouterId_COL,
+               MP_OID_vrrpInstanceState_COL,
+               MP_OID_vrrpInstanceInitialState_COL), &table_state);
     if (rc != STAT_SUCCESS) {
         char *string;
         snmp_error(ss, NULL, NULL, &string);
@@ -87,16 +91,15 @@ int main (int argc, char **argv) {
 
     mp_snmp_deinit();
 
-    vrrp_name = mp_malloc(25);
+    for (i = 0; i < table_state.row; i++) {
+        free(vrrp_name);
+        vrrp_name = mp_snmp_table_get_string(&table_state,
+            MP_OID_vrrpInstanceName_COL, i);
 
-    for (i = 0; i<table_state.size; i++) {
-        rc = mp_snmp_subtree_get_value(&table_state,
-            MP_OID(1,3,6,1,4,1,9586,100,5,2,3,1,2), i,
-            ASN_OCTET_STR, (void *)&vrrp_name, 24);
-
-        /* No more vrrpInstances */
-        if (rc == 0)
-            break;
+        if (vrrp_name == NULL) {
+            set_warning("Fetching vrrp_name for instance %d failed", i);
+            continue;
+        }
 
         /* Check if instance should be checked */
         if (instances > 0) {
@@ -113,25 +116,22 @@ int main (int argc, char **argv) {
         }
 
         /* Check State */
-        rc = mp_snmp_subtree_get_value(&table_state,
-                MP_OID(1,3,6,1,4,1,9586,100,5,2,3,1,3), i,
-                ASN_GAUGE, (void *)&vrrp_id, sizeof(long int));
+        rc = mp_snmp_table_get_integer(&table_state,
+                MP_OID_vrrpInstanceVirtualRouterId_COL, i, &vrrp_id);
         if (rc == 0) {
             set_warning("Fetching vrrp_if for instance %d failed", i);
             continue;
         }
 
-        rc = mp_snmp_subtree_get_value(&table_state,
-                MP_OID(1,3,6,1,4,1,9586,100,5,2,3,1,4), i,
-                ASN_INTEGER, (void *)&vrrp_state, sizeof(long int));
+        rc = mp_snmp_table_get_integer(&table_state,
+                MP_OID_vrrpInstanceState_COL, i, &vrrp_state);
         if (rc == 0) {
             set_warning("Fetching vrrp_state for instance %d failed", i);
             continue;
         }
 
-        rc = mp_snmp_subtree_get_value(&table_state,
-                MP_OID(1,3,6,1,4,1,9586,100,5,2,3,1,5), i,
-                ASN_INTEGER, (void *)&vrrp_state_initial, sizeof(long int));
+        rc = mp_snmp_table_get_integer(&table_state,
+                MP_OID_vrrpInstanceInitialState_COL, i, &vrrp_state_initial);
         if (rc == 0) {
             set_warning("Fetching vrrp_state_initial for instance %d failed", i);
             continue;
@@ -148,7 +148,9 @@ int main (int argc, char **argv) {
         }
 
     }
-    mp_snmp_subtree_free(&table_state);
+    free(vrrp_name);
+    rows = table_state.row;
+    mp_snmp_table_free(&table_state);
 
     /* Check for unmatched instances */
     if (instances > 0) {
@@ -160,7 +162,7 @@ int main (int argc, char **argv) {
     }
 
     /* Output and return */
-    if (i == 0)
+    if (rows == 0)
         unknown("Keepalived VRRP: No Instances found.");
     mp_exit("Keepalived VRRP");
 }
@@ -63,7 +63,7 @@ int main (int argc, char **argv) {
     long int    disk_state;
     char        *disk_name;
     int         status = STATE_OK;
-    mp_snmp_subtree         table_state;
+    struct mp_snmp_table    table_state;
     netsnmp_session         *ss;
 
     /* Set signal handling and alarm */
@@ -81,8 +81,8 @@ int main (int argc, char **argv) {
     ss = mp_snmp_init();
 
     /* OIDs to query */
-    status = mp_snmp_subtree_query(ss, MP_OID(1,3,6,1,4,1,24681,1,2,11),
-        &table_state);
+    status = mp_snmp_table_query_columns(ss, MP_OID(MP_OID_hdEntry),
+        MP_OID(MP_OID_hdDescr_COL, MP_OID_hdStatus_COL), &table_state);
     if (status != STAT_SUCCESS) {
         char *string;
         snmp_error(ss, NULL, NULL, &string);
@@ -93,24 +93,18 @@ int main (int argc, char **argv) {
 
     status = STATE_OK;
 
-    disk_name = mp_malloc(64);
+    for (i = 0; i < table_state.row; i++) {
+        rc = mp_snmp_table_get_integer(&table_state,
+            MP_OID_hdStatus_COL, i, &disk_state);
 
-    for (i = 0; i<table_state.size; i++) {
-        rc = mp_snmp_subtree_get_value(&table_state,
-            MP_OID(1,3,6,1,4,1,24681,1,2,11,1,4), i,
-            ASN_INTEGER, (void *)&disk_state, sizeof(long int));
-
-        if (rc == 0)
-            break;
-
-        if (disk_state == HDD_Ready)
+        if (rc == 0 || disk_state == HDD_Ready)
             continue;
 
-        mp_snmp_subtree_get_value(&table_state,
-            MP_OID(1,3,6,1,4,1,24681,1,2,11,1,2), i,
-            ASN_OCTET_STR, (void *)&disk_name, 64);
+        disk_name = mp_snmp_table_get_string(&table_state,
+            MP_OID_hdDescr_COL, i);
 
-        mp_strcat_comma(&output, disk_name);
+        mp_strcat_comma(&output, disk_name ? disk_name : "?");
+        free(disk_name);
 
         switch (disk_state) {
             case HDD_NoDisk:
@@ -130,8 +124,7 @@ int main (int argc, char **argv) {
 
         status = STATE_CRITICAL;
     }
-    mp_snmp_subtree_free(&table_state);
-    free(disk_name);
+    mp_snmp_table_free(&table_state);
 
     if (i == 0)
         unknown("QNAP: No Disks found.");
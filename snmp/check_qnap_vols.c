@@ -50,12 +50,11 @@ int         port = 161;
 int main (int argc, char **argv) {
     /* Local Vars */
     int         i;
-    int         rc;
     char        *output = NULL;
     char        *vol_state;
     char        *vol_name;
     int         status = STATE_OK;
-    mp_snmp_subtree         table_state;
+    struct mp_snmp_table    table_state;
     netsnmp_session         *ss;
 
     /* Set signal handling and alarm */
@@ -73,7 +72,8 @@ int main (int argc, char **argv) {
     ss = mp_snmp_init();
 
     /* OIDs to query */
-    status = mp_snmp_subtree_query(ss, MP_OID(1,3,6,1,4,1,24681,1,2,17),
+    status = mp_snmp_table_query_columns(ss, MP_OID(MP_OID_sysVolumeEntry),
+        MP_OID(MP_OID_sysVolumeDescr_COL, MP_OID_sysVolumeStatus_COL),
         &table_state);
     if (status != STAT_SUCCESS) {
         char *string;
@@ -85,28 +85,20 @@ int main (int argc, char **argv) {
 
     status = STATE_OK;
 
-    vol_state = mp_malloc(24);
-    vol_name = mp_malloc(64);
-
-    for (i = 0; i<table_state.size; i++) {
-        rc = mp_snmp_subtree_get_value(&table_state,
-            MP_OID(1,3,6,1,4,1,24681,1,2,17,1,6), i,
-            ASN_OCTET_STR, (void *)&vol_state, 24);
-
-        /* No mor volumes */
-        if (rc == 0)
-            break;
+    for (i = 0; i < table_state.row; i++) {
+        vol_state = mp_snmp_table_get_string(&table_state,
+            MP_OID_sysVolumeStatus_COL, i);
 
         /* Skip Ready volumes */
-        if (strcmp(vol_state, "Ready") == 0)
+        if (vol_state == NULL || strcmp(vol_state, "Ready") == 0) {
+            free(vol_state);
             continue;
-        
-        mp_snmp_subtree_get_value(&table_state,
-            MP_OID(1,3,6,1,4,1,24681,1,2,17,1,2), i,
-            ASN_OCTET_STR, (void *)&vol_name, 64);
+        }
 
+        vol_name = mp_snmp_table_get_string(&table_state,
+            MP_OID_sysVolumeDescr_COL, i);
 
-        mp_strcat_comma(&output, vol_name);
+        mp_strcat_comma(&output, vol_name ? vol_name : "?");
         mp_strcat_space(&output, "is");
         mp_strcat_space(&output, vol_state);
 
@@ -115,10 +107,11 @@ int main (int argc, char **argv) {
             status = STATE_CRITICAL;
         else
             status = STATE_WARNING;
+
+        free(vol_state);
+        free(vol_name);
     }
-    mp_snmp_subtree_free(&table_state);
-    free(vol_state);
-    free(vol_name);
+    mp_snmp_table_free(&table_state);
 
     /* Output and return */
     if (i == 0)
@@ -33,6 +33,7 @@ const char *progusage = "-H <HOST>";
 /* MP Includes */
 #include "mp_common.h"
 #include "snmp_utils.h"
+#include "snmp_async.h"
 /* Default Includes */
 #include <errno.h>
 #include <signal.h>
@@ -87,106 +88,109 @@ inline static const char* output_source_to_string(int source) {
 }
 
 
-int main (int argc, char **argv) {
-    /* Local Vars */
-    int             state = STATE_OK;
-    char            *ups_ident              = NULL;
-    long            ups_battery_status      = LONG_MIN;
-    long            ups_seconds_on_battery  = LONG_MIN;
-    long            ups_remaining_runtime   = LONG_MIN;
-    long            ups_remaining_charge    = LONG_MIN;
-    long            ups_battery_voltage     = LONG_MIN;
-    long            ups_battery_current     = LONG_MIN;
-    long            ups_battery_temperature = LONG_MIN;
-    long            ups_input_line_bads     = LONG_MIN;
-    long            ups_input_lines         = LONG_MIN;
-    long            ups_output_source       = LONG_MIN;
-    long            ups_output_frequency    = LONG_MIN;
-    long            ups_output_lines        = LONG_MIN;
-    long            ups_alarms_present      = LONG_MIN;
-    char            *output = NULL;
-    char            buf[64];
-    netsnmp_session *snmp_session;
-
+/**
+ * UPS values, one per polled agent.
+ */
+struct ups_s {
+    char            *ident;
+    long            battery_status;
+    long            seconds_on_battery;
+    long            remaining_runtime;
+    long            remaining_charge;
+    long            battery_voltage;
+    long            battery_current;
+    long            battery_temperature;
+    long            input_line_bads;
+    long            input_lines;
+    long            output_source;
+    long            output_frequency;
+    long            output_lines;
+    long            alarms_present;
+    mp_snmp_query_cmd snmpcmd[15];
+};
+
+static void ups_init(struct ups_s *ups) {
     mp_snmp_query_cmd snmpcmd[] = {
         {{1,3,6,1,2,1,33,1,1,5,0}, 11, ASN_OCTET_STR,
-         (void *)&ups_ident, 0},
+         (void *)&ups->ident, 0},
         {{1,3,6,1,2,1,33,1,2,1,0}, 11, ASN_INTEGER,
-         (void *)&ups_battery_status, sizeof(long int)},
+         (void *)&ups->battery_status, sizeof(long int)},
         {{1,3,6,1,2,1,33,1,2,2,0}, 11, ASN_INTEGER,
-         (void *)&ups_seconds_on_battery, sizeof(long int)},
+         (void *)&ups->seconds_on_battery, sizeof(long int)},
         {{1,3,6,1,2,1,33,1,2,3,0}, 11, ASN_INTEGER,
-         (void *)&ups_remaining_runtime, sizeof(long int)},
+         (void *)&ups->remaining_runtime, sizeof(long int)},
         {{1,3,6,1,2,1,33,1,2,4,0}, 11, ASN_INTEGER,
-         (void *)&ups_remaining_charge, sizeof(long int)},
+         (void *)&ups->remaining_charge, sizeof(long int)},
         {{1,3,6,1,2,1,33,1,2,5,0}, 11, ASN_INTEGER,
-         (void *)&ups_battery_voltage, sizeof(long int)},     /* 0.1 volts DC */
+         (void *)&ups->battery_voltage, sizeof(long int)},     /* 0.1 volts DC */
         {{1,3,6,1,2,1,33,1,2,6,0}, 11, ASN_INTEGER,
-         (void *)&ups_battery_current, sizeof(long int)},     /* 0.1 amps DC */
+         (void *)&ups->battery_current, sizeof(long int)},     /* 0.1 amps DC */
         {{1,3,6,1,2,1,33,1,2,7,0}, 11, ASN_INTEGER,
-         (void *)&ups_battery_temperature, sizeof(long int)}, /* deg C */
+         (void *)&ups->battery_temperature, sizeof(long int)}, /* deg C */
         {{1,3,6,1,2,1,33,1,3,1,0}, 11, ASN_COUNTER,
-         (void *)&ups_input_line_bads, sizeof(long int)},
+         (void *)&ups->input_line_bads, sizeof(long int)},
         {{1,3,6,1,2,1,33,1,3,2,0}, 11, ASN_INTEGER,
-         (void *)&ups_input_lines, sizeof(long int)},
+         (void *)&ups->input_lines, sizeof(long int)},
         {{1,3,6,1,2,1,33,1,4,1,0}, 11, ASN_INTEGER,
-         (void *)&ups_output_source, sizeof(long int)},
+         (void *)&ups->output_source, sizeof(long int)},
         {{1,3,6,1,2,1,33,1,4,2,0}, 11, ASN_INTEGER,
-         (void *)&ups_output_frequency, sizeof(long int)}, /* 0.1 RMS */
+         (void *)&ups->output_frequency, sizeof(long int)}, /* 0.1 RMS */
         {{1,3,6,1,2,1,33,1,4,3,0}, 11, ASN_INTEGER,
-         (void *)&ups_output_lines, sizeof(long int)},
+         (void *)&ups->output_lines, sizeof(long int)},
         {{1,3,6,1,2,1,33,1,6,1,0}, 11, ASN_GAUGE,
-         (void *)&ups_alarms_present, sizeof(long int)},
+         (void *)&ups->alarms_present, sizeof(long int)},
         {{0}, 0, 0, NULL},
     };
 
-    /* set threshold defaults */
-    mp_threshold_set_warning(&threshold_charge, DEFAULT_CHARGE_WARNING, NOEXT);
-    mp_threshold_set_critical(&threshold_charge, DEFAULT_CHARGE_CRITICAL, NOEXT);
-    mp_threshold_set_warning(&threshold_runtime, DEFAULT_RUNTIME_WARNING, NOEXT);
-    mp_threshold_set_critical(&threshold_runtime, DEFAULT_RUNTIME_CRITICAL, NOEXT);
-
-    /* Set signal handling and alarm */
-    if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
-        critical("Setup SIGALRM trap failed!");
-
-    /* Process check arguments */
-    if (process_arguments(argc, argv) != OK)
-        unknown("Parsing arguments failed!");
-
-    /* Start plugin timeout */
-    alarm(mp_timeout);
+    ups->ident = NULL;
+    ups->battery_status = LONG_MIN;
+    ups->seconds_on_battery = LONG_MIN;
+    ups->remaining_runtime = LONG_MIN;
+    ups->remaining_charge = LONG_MIN;
+    ups->battery_voltage = LONG_MIN;
+    ups->battery_current = LONG_MIN;
+    ups->battery_temperature = LONG_MIN;
+    ups->input_line_bads = LONG_MIN;
+    ups->input_lines = LONG_MIN;
+    ups->output_source = LONG_MIN;
+    ups->output_frequency = LONG_MIN;
+    ups->output_lines = LONG_MIN;
+    ups->alarms_present = LONG_MIN;
+
+    memcpy(ups->snmpcmd, snmpcmd, sizeof(snmpcmd));
+}
 
-    snmp_session = mp_snmp_init();
-    mp_snmp_query(snmp_session, snmpcmd);
-    mp_snmp_deinit();
+static void ups_eval(struct ups_s *ups) {
+    int             state = STATE_OK;
+    char            *output = NULL;
+    char            buf[64];
 
     if (mp_verbose > 1) {
-        printf("battery status: %ld\n", ups_battery_status);
-        printf("output source: %ld\n", ups_output_source);
-        printf("alarms present: %ld\n", ups_alarms_present);
-        printf("input lines: %ld\n", ups_input_lines);
-        printf("output lines: %ld\n", ups_output_lines);
-        printf("input line bads: %ld\n", ups_input_line_bads);
+        printf("battery status: %ld\n", ups->battery_status);
+        printf("output source: %ld\n", ups->output_source);
+        printf("alarms present: %ld\n", ups->alarms_present);
+        printf("input lines: %ld\n", ups->input_lines);
+        printf("output lines: %ld\n", ups->output_lines);
+        printf("input line bads: %ld\n", ups->input_line_bads);
     }
 
-    if (ups_ident) {
-        if (*ups_ident != '\0') {
-            mp_snprintf((char *)&buf, sizeof(buf), "[%s] ", ups_ident);
+    if (ups->ident) {
+        if (*ups->ident != '\0') {
+            mp_snprintf((char *)&buf, sizeof(buf), "[%s] ", ups->ident);
             mp_strcat(&output, buf);
         }
-        free(ups_ident);
+        free(ups->ident);
     }
 
     /* always warning, if on battery */
-    if ((ups_seconds_on_battery > 0) ||
-        (ups_output_source == OUTPUT_BATTERY)) {
+    if ((ups->seconds_on_battery > 0) ||
+        (ups->output_source == OUTPUT_BATTERY)) {
         state = STATE_WARNING;
-        if (ups_seconds_on_battery > 0) {
+        if (ups->seconds_on_battery > 0) {
             mp_snprintf((char *) &buf, sizeof(buf),
                         "ON BATTERY (since %d sec%s), ",
-                        ups_seconds_on_battery,
-                        ((ups_seconds_on_battery != 1) ? "s" : ""));
+                        ups->seconds_on_battery,
+                        ((ups->seconds_on_battery != 1) ? "s" : ""));
             mp_strcat(&output, buf);
         } else {
             mp_strcat(&output, "ON BATTERY, ");
@@ -194,19 +198,19 @@ int main (int argc, char **argv) {
     }
 
     /* check alarms */
-    if ((ups_alarms_present != LONG_MIN) && (ups_alarms_present > 0)) {
+    if ((ups->alarms_present != LONG_MIN) && (ups->alarms_present > 0)) {
         if (state != STATE_CRITICAL)
             state = STATE_WARNING;
 
-        if (ups_alarms_present == 1)
+        if (ups->alarms_present == 1)
             mp_strcat(&output, "UPS REPORTS AN ALARM, ");
         else
             mp_strcat(&output, "UPS REPORTS MULTIPLE ALARMS, ");
     }
 
     /* check remaining runtime threshold */
-    if (ups_remaining_runtime > LONG_MIN) {
-        switch (get_status(ups_remaining_runtime, threshold_runtime)) {
+    if (ups->remaining_runtime > LONG_MIN) {
+        switch (get_status(ups->remaining_runtime, threshold_runtime)) {
         case STATE_CRITICAL:
             state = STATE_CRITICAL;
             mp_strcat(&output, "RUNTIME CRITICAL, ");
@@ -220,8 +224,8 @@ int main (int argc, char **argv) {
     }
 
     /* check remaining charge threshold */
-    if (ups_remaining_charge > LONG_MIN) {
-        switch (get_status(ups_remaining_charge, threshold_charge)) {
+    if (ups->remaining_charge > LONG_MIN) {
+        switch (get_status(ups->remaining_charge, threshold_charge)) {
         case STATE_CRITICAL:
             state = STATE_CRITICAL;
             mp_strcat(&output, "CHARGE CRITICAL, ");
@@ -235,7 +239,7 @@ int main (int argc, char **argv) {
     }
 
     /* check battery status */
-    switch (ups_battery_status) {
+    switch (ups->battery_status) {
     case BATTERY_NORMAL:
         break;
     case BATTERY_LOW:
@@ -253,7 +257,7 @@ int main (int argc, char **argv) {
     } /* switch */
 
     /* check output source */
-    switch (ups_output_source) {
+    switch (ups->output_source) {
     case OUTPUT_NORMAL:
         /* DO NOTHING */
         break;
@@ -283,63 +287,63 @@ int main (int argc, char **argv) {
      * status line
      */
     mp_snprintf((char *) &buf, sizeof(buf), "battery: %s",
-                battery_status_to_string(ups_battery_status));
+                battery_status_to_string(ups->battery_status));
     mp_strcat(&output, buf);
 
-    if ((ups_remaining_runtime > LONG_MIN) &&
-        (ups_remaining_charge > LONG_MIN)) {
+    if ((ups->remaining_runtime > LONG_MIN) &&
+        (ups->remaining_charge > LONG_MIN)) {
         mp_snprintf((char *) &buf, sizeof(buf),
                     "remaining: %ld min%s [%d%%]",
-                    ups_remaining_runtime,
-                    ((ups_remaining_runtime != 1) ? "s" : ""),
-                    (int) ups_remaining_charge);
+                    ups->remaining_runtime,
+                    ((ups->remaining_runtime != 1) ? "s" : ""),
+                    (int) ups->remaining_charge);
         mp_strcat_comma(&output, buf);
-    } else if (ups_remaining_runtime > LONG_MIN) {
+    } else if (ups->remaining_runtime > LONG_MIN) {
         mp_snprintf((char *) &buf, sizeof(buf),
                     "remaining: %ld min%s",
-                    ups_remaining_runtime,
-                    ((ups_remaining_runtime != 1) ? "s" : ""));
+                    ups->remaining_runtime,
+                    ((ups->remaining_runtime != 1) ? "s" : ""));
         mp_strcat_comma(&output, buf);
-    } else if (ups_remaining_charge > LONG_MIN) {
+    } else if (ups->remaining_charge > LONG_MIN) {
         mp_snprintf((char *) &buf, sizeof(buf),
                     "remaining: %d%%",
-                    (int) ups_remaining_charge);
+                    (int) ups->remaining_charge);
         mp_strcat_comma(&output, buf);
     }
 
     mp_snprintf((char *) &buf, sizeof(buf), "source: %s",
-                output_source_to_string(ups_output_source));
+                output_source_to_string(ups->output_source));
     mp_strcat_comma(&output, buf);
 
     if (extended_status) {
-        if (ups_battery_voltage > LONG_MIN) {
+        if (ups->battery_voltage > LONG_MIN) {
             mp_snprintf((char *) &buf, sizeof(buf),
                         "voltage: %1.0f V",
-                        (ups_battery_voltage * 0.1f));
+                        (ups->battery_voltage * 0.1f));
             mp_strcat_comma(&output, buf);
         }
-        if (ups_battery_current > LONG_MIN) {
+        if (ups->battery_current > LONG_MIN) {
             mp_snprintf((char *) &buf, sizeof(buf),
                         "current: %1.1f A",
-                        (ups_battery_current * 0.1f));
+                        (ups->battery_current * 0.1f));
             mp_strcat_comma(&output, buf);
         }
-        if (ups_battery_temperature > LONG_MIN) {
+        if (ups->battery_temperature > LONG_MIN) {
             mp_snprintf((char *) &buf, sizeof(buf),
                         "temperature: %ld C",
-                        ups_battery_temperature);
+                        ups->battery_temperature);
             mp_strcat_comma(&output, buf);
         }
-        if (ups_output_frequency > LONG_MIN) {
+        if (ups->output_frequency > LONG_MIN) {
             mp_snprintf((char *) &buf, sizeof(buf),
                         "output frequency: %3.1f Hz",
-                        (ups_output_frequency * 0.1f));
+                        (ups->output_frequency * 0.1f));
             mp_strcat_comma(&output, buf);
         }
-        if (ups_input_line_bads > LONG_MIN) {
+        if (ups->input_line_bads > LONG_MIN) {
             mp_snprintf((char *) &buf, sizeof(buf),
                         "input line bads: %ld",
-                        ups_input_line_bads);
+                        ups->input_line_bads);
             mp_strcat_comma(&output, buf);
         }
     }
@@ -348,39 +352,39 @@ int main (int argc, char **argv) {
      * performance data
      */
     if (mp_showperfdata) {
-        if (ups_remaining_charge > LONG_MIN) {
+        if (ups->remaining_charge > LONG_MIN) {
             mp_perfdata_int("remaining_charge",
-                            ups_remaining_charge,
+                            ups->remaining_charge,
                             "%", threshold_charge);
         }
-        if (ups_remaining_runtime > LONG_MIN) {
+        if (ups->remaining_runtime > LONG_MIN) {
             mp_perfdata_int("remaining_runtime",
-                            ups_remaining_charge,
+                            ups->remaining_charge,
                             "minutes", threshold_runtime);
         }
-        if (ups_battery_voltage > LONG_MIN) {
+        if (ups->battery_voltage > LONG_MIN) {
             mp_perfdata_float("battery_voltage",
-                              ups_battery_voltage * 0.1f,
+                              ups->battery_voltage * 0.1f,
                               "V", NULL);
         }
-        if (ups_battery_current > LONG_MIN) {
+        if (ups->battery_current > LONG_MIN) {
             mp_perfdata_float("battery_current",
-                              ups_battery_current * 0.1f,
+                              ups->battery_current * 0.1f,
                               "A", NULL);
         }
-        if (ups_battery_temperature > LONG_MIN) {
+        if (ups->battery_temperature > LONG_MIN) {
             mp_perfdata_int("battery_temperature",
-                            ups_battery_temperature,
+                            ups->battery_temperature,
                             "C", NULL);
         }
-        if (ups_output_frequency > LONG_MIN) {
+        if (ups->output_frequency > LONG_MIN) {
             mp_perfdata_float("output_frequency",
-                              ups_output_frequency * 0.1f,
+                              ups->output_frequency * 0.1f,
                               "Hz", NULL);
         }
-        if (ups_input_line_bads > LONG_MIN) {
+        if (ups->input_line_bads > LONG_MIN) {
             mp_perfdata_int("input_line_bads",
-                            ups_input_line_bads,
+                            ups->input_line_bads,
                             "", NULL);
         }
     }
@@ -401,6 +405,61 @@ int main (int argc, char **argv) {
     }
 }
 
+static void ups_eval_agent(mp_snmp_agent *agent) {
+    ups_eval((struct ups_s *) agent->data);
+}
+
+int main (int argc, char **argv) {
+    /* Local Vars */
+    struct ups_s    ups;
+    struct ups_s    *multi;
+    mp_snmp_agent   **agents;
+    netsnmp_session *snmp_session;
+    int             i;
+
+    /* set threshold defaults */
+    mp_threshold_set_warning(&threshold_charge, DEFAULT_CHARGE_WARNING, NOEXT);
+    mp_threshold_set_critical(&threshold_charge, DEFAULT_CHARGE_CRITICAL, NOEXT);
+    mp_threshold_set_warning(&threshold_runtime, DEFAULT_RUNTIME_WARNING, NOEXT);
+    mp_threshold_set_critical(&threshold_runtime, DEFAULT_RUNTIME_CRITICAL, NOEXT);
+
+    /* Set signal handling and alarm */
+    if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR)
+        critical("Setup SIGALRM trap failed!");
+
+    /* Process check arguments */
+    if (process_arguments(argc, argv) != OK)
+        unknown("Parsing arguments failed!");
+
+    /* Start plugin timeout */
+    alarm(mp_timeout);
+
+    if (mp_snmp_hosts_num > 0) {
+        multi = mp_calloc(mp_snmp_hosts_num, sizeof(struct ups_s));
+        agents = mp_calloc(mp_snmp_hosts_num, sizeof(mp_snmp_agent *));
+
+        for (i = 0; i < mp_snmp_hosts_num; i++) {
+            ups_init(&multi[i]);
+            agents[i] = mp_snmp_async_agent(mp_snmp_hosts[i], port, &multi[i]);
+            mp_snmp_async_query(agents[i], multi[i].snmpcmd);
+        }
+
+        if (mp_snmp_async_run() != OK)
+            unknown("SNMP event loop failed.");
+        alarm(0);
+
+        mp_snmp_async_exit(agents, mp_snmp_hosts_num, ups_eval_agent);
+    }
+
+    ups_init(&ups);
+
+    snmp_session = mp_snmp_init();
+    mp_snmp_query(snmp_session, ups.snmpcmd);
+    mp_snmp_deinit();
+
+    ups_eval(&ups);
+}
+
 int process_arguments (int argc, char **argv) {
     int c;
     int option = 0;
@@ -409,6 +468,7 @@ int process_arguments (int argc, char **argv) {
             MP_LONGOPTS_DEFAULT,
             MP_LONGOPTS_HOST,
             MP_LONGOPTS_PORT,
+            MP_LONGOPTS_SNMP_HOSTS,
             {"extended-status", no_argument, NULL, (int) 'e'},
             SNMP_LONGOPTS,
             MP_LONGOPTS_END
@@ -439,6 +499,9 @@ int process_arguments (int argc, char **argv) {
             case 'P':
                 getopt_port(optarg, &port);
                 break;
+            case MP_LONGOPT_HOSTS:
+                getopt_snmp_hosts(optarg);
+                break;
             /* Plugin opt */
             case 'e':
                 extended_status = 1;
@@ -523,6 +586,7 @@ void print_help (void) {
     printf("      Print extended status.\n");
 
     print_help_snmp();
+    print_help_snmp_hosts();
 }
 
 /* vim: set ts=4 sw=4 et syn=c : */
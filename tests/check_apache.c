@@ -0,0 +1,178 @@
+/***
+ * Monitoring Plugin Tests - check_apache.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "apache_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+const char *progname  = "TEST";
+const char *progvers  = "TEST";
+const char *progcopy  = "TEST";
+const char *progauth  = "TEST";
+const char *progusage = "TEST";
+
+/* ?auto answer of an event MPM, values by key index */
+static const char *apache_auto_values[APACHE_KEYS] = {
+    "Apache/2.4.57 (Debian)", "event", "86400", "123456",
+    "7890", "4321", ".0123", "1.42889",
+    "93.4815", "65.4321", ".035", "3",
+    "72", "0", "3", "0",
+    "5", "1", "2",
+    "0", "0.12", "0.34", "0.56",
+};
+
+/* Scoreboard of 27 slots, the last three only hit the tail loop */
+static const char *apache_auto_sb = "_W_K_..R.SDCLGI_W_KKK....._";
+static const long apache_auto_slots[APACHE_SCOREBOARD_STATES] = {
+    8, 1, 1, 2, 4, 1, 1, 1, 1, 1, 6,
+};
+
+static void apache_auto_parse(struct apache_auto_s *status) {
+    char line[128];
+    int k;
+
+    memset(status, 0, sizeof(struct apache_auto_s));
+
+    apache_auto_line(status, "localhost", 9);
+    for (k = 0; k < APACHE_SCOREBOARD; k++) {
+        mp_snprintf(line, sizeof(line), "%s: %s", apache_keys[k],
+                apache_auto_values[k]);
+        apache_auto_line(status, line, strlen(line));
+    }
+    apache_auto_line(status, "TLSSessionCacheStatus", 21);
+    apache_auto_line(status, "CacheType: SHMCB", 16);
+    mp_snprintf(line, sizeof(line), "Scoreboard: %s", apache_auto_sb);
+    apache_auto_line(status, line, strlen(line));
+}
+
+START_TEST (test_apache_key) {
+    int k;
+
+    apache_keys_init();
+
+    for (k = 0; k < APACHE_KEYS; k++)
+        fail_unless(apache_key(apache_keys[k], strlen(apache_keys[k])) == k,
+                "Key '%s' not found.", apache_keys[k]);
+
+    /* Prefixes and unknown keys do not match */
+    fail_unless(apache_key("Load", 4) == -1, "Prefix matched.");
+    fail_unless(apache_key("Load15s", 7) == -1, "Longer key matched.");
+    fail_unless(apache_key("CacheType", 9) == -1, "Unknown key matched.");
+    fail_unless(apache_key("Total Accesses", 5) == -1, "Prefix matched.");
+}
+END_TEST
+
+START_TEST (test_apache_auto_line) {
+    struct apache_auto_s status;
+    int k;
+
+    apache_keys_init();
+    apache_auto_parse(&status);
+
+    for (k = 0; k < APACHE_SCOREBOARD; k++) {
+        fail_unless(status.value[k] != NULL, "Key '%s' not parsed.",
+                apache_keys[k]);
+        fail_unless(strcmp(status.value[k], apache_auto_values[k]) == 0,
+                "Key '%s' is '%s'.", apache_keys[k], status.value[k]);
+    }
+    fail_unless(status.value[APACHE_SCOREBOARD] == NULL,
+            "Scoreboard stored as value.");
+
+    fail_unless(status.scoreboard == 1, "Scoreboard not parsed.");
+    for (k = 0; k < APACHE_SCOREBOARD_STATES; k++)
+        fail_unless(status.slots[k] == apache_auto_slots[k],
+                "Slot '%c' counted %ld, not %ld.", apache_scoreboard[k].key,
+                status.slots[k], apache_auto_slots[k]);
+
+    apache_auto_free(&status);
+}
+END_TEST
+
+START_TEST (test_apache_auto_scoreboard) {
+    struct apache_auto_s status;
+    char *sb;
+    size_t len, i;
+    int k;
+
+    memset(&status, 0, sizeof(struct apache_auto_s));
+
+    /* Every length around the four bank unroll */
+    for (len = 0; len <= 9; len++) {
+        sb = mp_malloc(len + 1);
+        memset(sb, 'W', len);
+        sb[len] = '\0';
+        if (len > 0)
+            sb[len - 1] = '.';
+
+        apache_auto_scoreboard(&status, sb, len);
+        fail_unless(status.slots[0] == (len > 0),
+                "Open counted %ld at length %zu.", status.slots[0], len);
+        fail_unless(status.slots[3] == (long)(len > 0 ? len - 1 : 0),
+                "Write counted %ld at length %zu.", status.slots[3], len);
+        for (k = 0; k < APACHE_SCOREBOARD_STATES; k++)
+            if (k != 0 && k != 3)
+                fail_unless(status.slots[k] == 0,
+                        "Slot '%c' counted at length %zu.",
+                        apache_scoreboard[k].key, len);
+        free(sb);
+    }
+
+    /* Large event MPM scoreboard */
+    len = 4 * 4096 + 3;
+    sb = mp_malloc(len);
+    for (i = 0; i < len; i++)
+        sb[i] = apache_scoreboard[i % APACHE_SCOREBOARD_STATES].key;
+    apache_auto_scoreboard(&status, sb, len);
+    for (k = 0; k < APACHE_SCOREBOARD_STATES; k++)
+        fail_unless(status.slots[k] == (long)(len / APACHE_SCOREBOARD_STATES
+                    + (k < len % APACHE_SCOREBOARD_STATES)),
+                "Slot '%c' counted %ld.", apache_scoreboard[k].key,
+                status.slots[k]);
+    free(sb);
+}
+END_TEST
+
+int main (void) {
+
+  int number_failed;
+  SRunner *sr;
+
+  Suite *s = suite_create ("Apache");
+
+  TCase *tc = tcase_create ("Auto");
+  tcase_add_test(tc, test_apache_key);
+  tcase_add_test(tc, test_apache_auto_line);
+  tcase_add_test(tc, test_apache_auto_scoreboard);
+  suite_add_tcase (s, tc);
+
+  sr = srunner_create(s);
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
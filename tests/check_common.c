@@ -22,7 +22,10 @@
  */
 
 #include "mp_common.h"
+#include "mp_repeat.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <check.h>
@@ -177,6 +180,80 @@ START_TEST (test_set_critical_warning) {
 }
 END_TEST
 
+void repeat_probe(void *data) {
+    int *run = data;
+
+    mp_perfdata_int("PERF", (long int)*run, "", NULL);
+    switch ((*run)++) {
+        case 1:
+            set_warning("TEST");
+            mp_exit("TEST");
+        default:
+            ok("TEST OK");
+    }
+}
+
+START_TEST (test_repeat_once) {
+    int run = 1;
+    mp_repeat_run(repeat_probe, &run);
+}
+END_TEST
+
+START_TEST (test_repeat_worst) {
+    int run = 0;
+    mp_repeat = 3;
+    mp_interval = 0;
+    mp_showperfdata = 1;
+    mp_repeat_run(repeat_probe, &run);
+}
+END_TEST
+
+static void multi_eval(void *data, int i) {
+    mp_perfdata_int("PERF", (long int)i, "", NULL);
+    switch (i) {
+        case 1:
+            critical("TEST %d", i);
+        case 2:
+            set_warning("TEST");
+            mp_exit("TEST %d", i);
+        default:
+            ok("TEST %d", i);
+    }
+}
+
+static FILE *multi_out;
+
+/* Exit handler checking the output, a mismatch changes the exit code */
+static void multi_check(void) {
+    char buf[512];
+    size_t len;
+
+    fflush(stdout);
+    rewind(multi_out);
+    len = fread(buf, 1, sizeof(buf) - 1, multi_out);
+    buf[len] = '\0';
+
+    if (strcmp(buf, "CRITICAL - worst of 3 hosts, 1 OK, 1 WARNING, 1 CRITICAL, 0 UNKNOWN\n"
+                "a: OK - TEST 0\n"
+                "b: CRITICAL - TEST 1\n"
+                "c d: WARNING - TEST 2 TEST"
+                " | ALL=1; a_PERF=0; b_PERF=1; 'c d_PERF'=2;\n") != 0)
+        _exit(99);
+}
+
+START_TEST (test_multi_exit) {
+    const char *hosts[] = { "a", "b", "c d" };
+
+    multi_out = tmpfile();
+    dup2(fileno(multi_out), 1);
+    atexit(multi_check);
+
+    mp_showperfdata = 1;
+    mp_perfdata_int("ALL", 1L, "", NULL);
+    mp_multi_exit(hosts, 3, multi_eval, NULL);
+}
+END_TEST
+
 START_TEST (test_print_revision) {
     print_revision();
 }
@@ -215,6 +292,13 @@ Suite* make_lib_common_suite(void) {
     tcase_add_exit_test(tc_set, test_set_critical_warning, 2);
     suite_add_tcase (s, tc_set);
 
+    TCase *tc_repeat = tcase_create("Repeat");
+    tcase_add_checked_fixture (tc_repeat, exit_setup, exit_teardown);
+    tcase_add_exit_test(tc_repeat, test_repeat_once, 1);
+    tcase_add_exit_test(tc_repeat, test_repeat_worst, 1);
+    tcase_add_exit_test(tc_repeat, test_multi_exit, 2);
+    suite_add_tcase (s, tc_repeat);
+
     TCase *tc_print = tcase_create("Print");
     tcase_add_test(tc_print, test_print_revision);
     tcase_add_test(tc_print, test_print_copyright);
@@ -0,0 +1,212 @@
+/***
+ * Monitoring Plugin Tests - check_curl.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "curl_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+const char *progname  = "TEST";
+const char *progvers  = "TEST";
+const char *progcopy  = "TEST";
+const char *progauth  = "TEST";
+const char *progusage = "TEST";
+
+START_TEST (test_curl_recv_data) {
+    struct mp_curl_data data;
+    char chunk[1000];
+    size_t i;
+
+    memset(&data, 0, sizeof(struct mp_curl_data));
+    memset(chunk, 'x', sizeof(chunk));
+
+    /* Grows geometrically from one chunk and stays terminated */
+    for (i = 1; i <= 10; i++) {
+        chunk[0] = '0' + i % 10;
+        fail_unless(mp_curl_recv_data(chunk, 1, sizeof(chunk), &data) == sizeof(chunk),
+                "Chunk %zu not consumed.", i);
+        fail_unless(data.size == i * sizeof(chunk),
+                "Wrong size %zu after chunk %zu.", data.size, i);
+        fail_unless(data.alloc > data.size && data.alloc % MP_CURL_CHUNK == 0
+                && (data.alloc / MP_CURL_CHUNK & (data.alloc / MP_CURL_CHUNK - 1)) == 0,
+                "Wrong alloc %zu after chunk %zu.", data.alloc, i);
+        fail_unless(data.data[data.size] == '\0', "Data not terminated.");
+    }
+    fail_unless(data.alloc == 4 * MP_CURL_CHUNK, "Wrong alloc %zu.", data.alloc);
+    for (i = 1; i <= 10; i++)
+        fail_unless(data.data[(i - 1) * sizeof(chunk)] == '0' + i % 10,
+                "Chunk %zu at the wrong offset.", i);
+    fail_unless(data.overflow == 0, "Overflow without max.");
+
+    free(data.data);
+}
+END_TEST
+
+START_TEST (test_curl_recv_data_max) {
+    struct mp_curl_data data;
+
+    memset(&data, 0, sizeof(struct mp_curl_data));
+    data.max = 8;
+
+    /* Up to max is kept, more aborts the transfer */
+    fail_unless(mp_curl_recv_data("1234", 1, 4, &data) == 4, "Data not consumed.");
+    fail_unless(mp_curl_recv_data("5678", 2, 2, &data) == 4, "Data up to max not consumed.");
+    fail_unless(mp_curl_recv_data("9", 1, 1, &data) == 0, "Data over max consumed.");
+    fail_unless(data.overflow == 1, "Overflow not set.");
+    fail_unless(mp_curl_recv_data("", 1, 0, &data) == 0, "Data after overflow consumed.");
+    fail_unless(data.size == 8 && strcmp(data.data, "12345678") == 0,
+            "Wrong data '%s'.", data.data);
+
+    free(data.data);
+
+    /* Without max the body limit applies */
+    memset(&data, 0, sizeof(struct mp_curl_data));
+    mp_curl_maxbody = 4;
+    fail_unless(mp_curl_recv_data("12345", 1, 5, &data) == 0,
+            "Data over body limit consumed.");
+    fail_unless(data.overflow == 1 && data.data == NULL, "Overflow not set.");
+    mp_curl_maxbody = MP_CURL_MAXBODY;
+}
+END_TEST
+
+static void curl_line(char *line, size_t len, void *userdata) {
+    char *lines = (char *)userdata;
+
+    fail_unless(strlen(line) == len, "Wrong length %zu of '%s'.", len, line);
+    strcat(lines, line);
+    strcat(lines, "|");
+}
+
+static const char *curl_lines_doc = "Total: 1\r\nScoreboard: _W\n\nlast";
+
+START_TEST (test_curl_recv_lines) {
+    struct mp_curl_lines lines;
+    size_t len = strlen(curl_lines_doc);
+    size_t split;
+    char out[64];
+
+    /* Split the document at every offset */
+    for (split = 0; split <= len; split++) {
+        memset(&lines, 0, sizeof(struct mp_curl_lines));
+        out[0] = '\0';
+        lines.line = curl_line;
+        lines.userdata = out;
+
+        fail_unless(mp_curl_recv_lines((void *)curl_lines_doc, 1, split, &lines) == split,
+                "Data not consumed with split at %zu.", split);
+        fail_unless(mp_curl_recv_lines((void *)(curl_lines_doc + split), 1,
+                len - split, &lines) == len - split,
+                "Data not consumed with split at %zu.", split);
+        mp_curl_lines_finish(&lines);
+
+        fail_unless(strcmp(out, "Total: 1|Scoreboard: _W||last|") == 0,
+                "Wrong lines with split at %zu: %s", split, out);
+        fail_unless(lines.buf.data == NULL, "Line buffer not freed.");
+    }
+}
+END_TEST
+
+START_TEST (test_curl_recv_lines_max) {
+    struct mp_curl_lines lines;
+    char out[64];
+
+    memset(&lines, 0, sizeof(struct mp_curl_lines));
+    out[0] = '\0';
+    lines.line = curl_line;
+    lines.userdata = out;
+    lines.buf.max = 4;
+
+    /* The limit is per line, a longer line aborts the transfer */
+    fail_unless(mp_curl_recv_lines("abcd\nefgh\n", 1, 10, &lines) == 10,
+            "Short lines not consumed.");
+    fail_unless(mp_curl_recv_lines("ijklm\n", 1, 6, &lines) == 0,
+            "Long line consumed.");
+    fail_unless(lines.buf.overflow == 1, "Overflow not set.");
+    fail_unless(strcmp(out, "abcd|efgh|") == 0, "Wrong lines: %s", out);
+
+    mp_curl_lines_finish(&lines);
+}
+END_TEST
+
+static size_t curl_header(char *line, struct mp_curl_header *headers) {
+    return mp_curl_recv_header(line, 1, strlen(line), headers);
+}
+
+START_TEST (test_curl_recv_header) {
+    char *etag = NULL;
+    char *modified = NULL;
+    struct mp_curl_header headers[] = {
+        {"ETag", &etag}, {"Last-Modified", &modified}, {NULL, NULL}
+    };
+
+    /* First value of a response wins */
+    fail_unless(curl_header("HTTP/1.1 200 OK\r\n", headers) == 17,
+            "Status line not consumed.");
+    fail_unless(curl_header("etag: \"a\"\r\n", headers) == 11,
+            "Header not consumed.");
+    curl_header("ETag: \"b\"\r\n", headers);
+    curl_header("ETagged: x\r\n", headers);
+    fail_unless(etag && strcmp(etag, "\"a\"") == 0, "Wrong ETag '%s'.", etag);
+    fail_unless(modified == NULL, "Missing header set.");
+
+    /* A followed response replaces the redirect headers */
+    curl_header("HTTP/1.1 302 Found\r\n", headers);
+    fail_unless(etag == NULL, "ETag of the redirect kept.");
+    curl_header("HTTP/2 200\r\n", headers);
+    curl_header("Last-Modified: Mon, 19 Oct 2026 10:00:00 GMT\r\n", headers);
+    curl_header("ETag: \"c\"\r\n", headers);
+    curl_header("\r\n", headers);
+    fail_unless(etag && strcmp(etag, "\"c\"") == 0, "Wrong ETag '%s'.", etag);
+    fail_unless(modified && strcmp(modified, "Mon, 19 Oct 2026 10:00:00 GMT") == 0,
+            "Wrong Last-Modified '%s'.", modified);
+
+    free(etag);
+    free(modified);
+}
+END_TEST
+
+int main (void) {
+
+  int number_failed;
+  SRunner *sr;
+
+  Suite *s = suite_create ("Curl");
+
+  TCase *tc = tcase_create ("Recv");
+  tcase_add_test(tc, test_curl_recv_data);
+  tcase_add_test(tc, test_curl_recv_data_max);
+  tcase_add_test(tc, test_curl_recv_lines);
+  tcase_add_exit_test(tc, test_curl_recv_lines_max, STATE_CRITICAL);
+  tcase_add_test(tc, test_curl_recv_header);
+  suite_add_tcase (s, tc);
+
+  sr = srunner_create(s);
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,129 @@
+/***
+ * Monitoring Plugin Tests - check_expat.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "expat_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+const char *progname  = "TEST";
+const char *progvers  = "TEST";
+const char *progcopy  = "TEST";
+const char *progauth  = "TEST";
+const char *progusage = "TEST";
+
+static const char *expat_doc =
+    "<?xml version=\"1.0\"?><D:multistatus xmlns:D=\"DAV:\">"
+    "<D:response><D:href>/a</D:href></D:response>"
+    "<D:response><D:href>/b</D:href></D:response></D:multistatus>";
+
+static void expat_start(void *userData, const char *name, const char **atts) {
+    if (strcmp(name, "DAV:response") == 0)
+        (*(int *)userData)++;
+}
+
+static void expat_init(struct mp_expat_stream *stream, int *count, size_t max) {
+    memset(stream, 0, sizeof(struct mp_expat_stream));
+    stream->max = max;
+    stream->parser = XML_ParserCreateNS(NULL, 0);
+    *count = 0;
+    XML_SetUserData(stream->parser, count);
+    XML_SetStartElementHandler(stream->parser, expat_start);
+}
+
+START_TEST (test_expat_recv) {
+    struct mp_expat_stream stream;
+    size_t len = strlen(expat_doc);
+    size_t split;
+    int count;
+
+    /* Split the document at every offset */
+    for (split = 0; split <= len; split++) {
+        expat_init(&stream, &count, len);
+        fail_unless(mp_expat_recv((void *)expat_doc, 1, split, &stream) == split,
+                "Data not consumed with split at %zu.", split);
+        fail_unless(mp_expat_recv((void *)(expat_doc + split), 1, len - split,
+                &stream) == len - split,
+                "Data not consumed with split at %zu.", split);
+        mp_expat_finish(&stream);
+        XML_ParserFree(stream.parser);
+
+        fail_unless(count == 2, "Wrong count %d with split at %zu.", count, split);
+        fail_unless(stream.failed == 0 && stream.overflow == 0,
+                "Parse failed with split at %zu.", split);
+    }
+}
+END_TEST
+
+START_TEST (test_expat_recv_invalid) {
+    struct mp_expat_stream stream;
+    int count;
+
+    /* Data after a parse error is ignored, not a transfer error */
+    expat_init(&stream, &count, 0);
+    fail_unless(mp_expat_recv("<a></b>", 1, 7, &stream) == 7, "Data not consumed.");
+    fail_unless(stream.failed == 1, "Parse error not set.");
+    fail_unless(mp_expat_recv("<c/>", 1, 4, &stream) == 4,
+            "Data after parse error not consumed.");
+    XML_ParserFree(stream.parser);
+}
+END_TEST
+
+START_TEST (test_expat_recv_max) {
+    struct mp_expat_stream stream;
+    int count;
+
+    /* More than max aborts the transfer and is critical on finish */
+    expat_init(&stream, &count, 10);
+    fail_unless(mp_expat_recv((void *)expat_doc, 1, 10, &stream) == 10,
+            "Data up to max not consumed.");
+    fail_unless(mp_expat_recv((void *)(expat_doc + 10), 1, 1, &stream) == 0,
+            "Data over max consumed.");
+    fail_unless(stream.overflow == 1, "Overflow not set.");
+    mp_expat_finish(&stream);
+}
+END_TEST
+
+int main (void) {
+
+  int number_failed;
+  SRunner *sr;
+
+  Suite *s = suite_create ("Expat");
+
+  TCase *tc = tcase_create ("Recv");
+  tcase_add_test(tc, test_expat_recv);
+  tcase_add_test(tc, test_expat_recv_invalid);
+  tcase_add_exit_test(tc, test_expat_recv_max, STATE_CRITICAL);
+  suite_add_tcase (s, tc);
+
+  sr = srunner_create(s);
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,289 @@
+/***
+ * Monitoring Plugin Tests - check_json.c
+ **
+ *
+ * Copyright (C) 2014 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "mp_common.h"
+#include "json_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+const char *progname  = "TEST";
+const char *progvers  = "TEST";
+const char *progcopy  = "TEST";
+const char *progauth  = "TEST";
+const char *progusage = "TEST";
+
+static const char *json_doc =
+    "{\"rabbitmq_version\": \"3.8.2\", \"skip\": {\"queue_totals\": 1,"
+    " \"list\": [1, 2, {\"a\": \"b\\\"\"}]},\n"
+    " \"queue_totals\": {\"messages\": 42, \"messages_ready\": -3},"
+    " \"message_stats\": {\"publish_details\": {\"rate\": 1.5e1}},"
+    " \"queues\": [{\"name\": \"q\\u00e4\\ud83d\\ude00\"}, {\"name\": \"b\\n\"}],"
+    " \"accepted conn\": 12, \"flag\": true, \"none\": null, \"empty\": {}}";
+
+static void json_paths(struct mp_json_path *paths) {
+    const char *names[] = { "rabbitmq_version", "queue_totals.messages",
+        "queue_totals.messages_ready", "message_stats.publish_details.rate",
+        "queues.0.name", "queues.1.name", "accepted conn", "flag", "none",
+        "missing", "skip.list.2.a" };
+    int i;
+
+    memset(paths, 0, sizeof(struct mp_json_path) * 11);
+    for (i = 0; i < 11; i++)
+        paths[i].path = names[i];
+}
+
+static void json_check_paths(struct mp_json_path *paths) {
+    fail_unless(strcmp(paths[0].value, "3.8.2") == 0
+            && paths[0].type == json_type_string,
+            "Wrong version: %s", paths[0].value);
+    fail_unless(mp_json_path_int(&paths[1], -1) == 42,
+            "Wrong messages: %s", paths[1].value);
+    fail_unless(mp_json_path_int(&paths[2], 0) == -3,
+            "Wrong messages_ready: %s", paths[2].value);
+    fail_unless(mp_json_path_double(&paths[3], 0) == 15.0
+            && paths[3].type == json_type_double,
+            "Wrong rate: %s", paths[3].value);
+    fail_unless(strcmp(paths[4].value, "q\xc3\xa4\xf0\x9f\x98\x80") == 0,
+            "Wrong unicode name: %s", paths[4].value);
+    fail_unless(strcmp(paths[5].value, "b\n") == 0,
+            "Wrong escaped name: %s", paths[5].value);
+    fail_unless(mp_json_path_int(&paths[6], 0) == 12,
+            "Wrong accepted conn: %s", paths[6].value);
+    fail_unless(paths[7].type == json_type_boolean
+            && strcmp(paths[7].value, "true") == 0,
+            "Wrong flag: %s", paths[7].value);
+    fail_unless(paths[8].type == json_type_null && paths[8].value != NULL,
+            "Null not found.");
+    fail_unless(paths[9].value == NULL && mp_json_path_int(&paths[9], -1) == -1,
+            "Missing path found.");
+    fail_unless(strcmp(paths[10].value, "b\"") == 0,
+            "Wrong array member: %s", paths[10].value);
+}
+
+START_TEST (test_json_scan_string) {
+    struct mp_json_path paths[11];
+
+    json_paths(paths);
+    fail_unless(mp_json_scan_string(json_doc, paths, 11) == 10,
+            "Wrong number of paths found.");
+    json_check_paths(paths);
+    mp_json_paths_free(paths, 11);
+}
+END_TEST
+
+START_TEST (test_json_scan_chunks) {
+    struct mp_json_path paths[11];
+    struct mp_json_scan scan;
+    size_t len = strlen(json_doc);
+    size_t split;
+
+    /* Split the document at every offset */
+    json_paths(paths);
+    for (split = 0; split <= len; split++) {
+        mp_json_scan_init(&scan, paths, 11, 0);
+        mp_json_scan_recv((void *)json_doc, 1, split, &scan);
+        mp_json_scan_recv((void *)(json_doc + split), 1, len - split, &scan);
+        fail_unless(mp_json_scan_finish(&scan) == 10,
+                "Wrong number of paths found with split at %zu.", split);
+        json_check_paths(paths);
+    }
+    mp_json_paths_free(paths, 11);
+}
+END_TEST
+
+START_TEST (test_json_paths_object) {
+    struct mp_json_path paths[11];
+    struct json_object *obj;
+    char *summary;
+
+    /* A summary of the paths scans to the same values */
+    json_paths(paths);
+    mp_json_scan_string(json_doc, paths, 11);
+    obj = mp_json_paths_object(paths, 11);
+    summary = mp_strdup(json_object_to_json_string(obj));
+    json_object_put(obj);
+
+    fail_unless(mp_json_scan_string(summary, paths, 11) == 10,
+            "Wrong number of paths found in '%s'.", summary);
+    json_check_paths(paths);
+    mp_json_paths_free(paths, 11);
+    free(summary);
+}
+END_TEST
+
+START_TEST (test_json_scan_top_level) {
+    struct mp_json_path paths[1] = {{ "a", json_type_null, NULL }};
+
+    fail_unless(mp_json_scan_string(" [1, {\"a\": 2}] ", paths, 1) == 0,
+            "Path found in array.");
+    fail_unless(mp_json_scan_string("17", paths, 1) == 0,
+            "Path found in scalar.");
+}
+END_TEST
+
+static const char *json_list =
+    "{\"items\": [{\"name\": \"a\", \"stats\": {\"n\": 1}, \"skip\": [2]},"
+    " {\"name\": \"b\"}, 3, {\"stats\": {\"n\": 4}}], \"page_count\": 2}";
+
+static void json_list_item(struct mp_json_scan *scan, void *userdata) {
+    char *items = (char *)userdata;
+    char item[32];
+
+    mp_snprintf(item, sizeof(item), "%s:%lld,",
+            scan->paths[0].value ? scan->paths[0].value : "-",
+            mp_json_path_int(&scan->paths[1], -1));
+    strcat(items, item);
+}
+
+START_TEST (test_json_scan_each) {
+    struct mp_json_path paths[3] = {
+        { "items.*.name", json_type_null, NULL },
+        { "items.*.stats.n", json_type_null, NULL },
+        { "page_count", json_type_null, NULL }};
+    struct mp_json_scan scan;
+    size_t len = strlen(json_list);
+    size_t split;
+    char items[128];
+
+    /* Every element is passed once with only its own values */
+    for (split = 0; split <= len; split++) {
+        items[0] = '\0';
+        mp_json_scan_init(&scan, paths, 3, 0);
+        mp_json_scan_each(&scan, "items.*", json_list_item, items);
+        mp_json_scan_recv((void *)json_list, 1, split, &scan);
+        mp_json_scan_recv((void *)(json_list + split), 1, len - split, &scan);
+        fail_unless(mp_json_scan_finish(&scan) == 1,
+                "Wrong number of paths found with split at %zu.", split);
+        fail_unless(strcmp(items, "a:1,b:-1,-:-1,-:4,") == 0,
+                "Wrong items with split at %zu: %s", split, items);
+        fail_unless(mp_json_path_int(&paths[2], 0) == 2,
+                "Wrong page_count: %s", paths[2].value);
+    }
+    mp_json_paths_free(paths, 3);
+}
+END_TEST
+
+START_TEST (test_json_recv) {
+    struct mp_json_stream stream;
+    struct json_object *obj;
+    struct json_object *value;
+    size_t len = strlen(json_list);
+    size_t split;
+
+    /* Split the document at every offset */
+    for (split = 0; split <= len; split++) {
+        mp_json_stream_init(&stream, len);
+        fail_unless(mp_json_recv((void *)json_list, 1, split, &stream) == split,
+                "Data not consumed with split at %zu.", split);
+        fail_unless(mp_json_recv((void *)(json_list + split), 1, len - split,
+                &stream) == len - split,
+                "Data not consumed with split at %zu.", split);
+        obj = mp_json_stream_finish(&stream);
+
+        fail_unless(mp_json_object_object_get(obj, "page_count", &value)
+                && json_object_get_int(value) == 2,
+                "Wrong page_count with split at %zu.", split);
+        json_object_put(obj);
+    }
+}
+END_TEST
+
+START_TEST (test_json_recv_max) {
+    struct mp_json_stream stream;
+
+    /* More than max aborts the transfer and is critical on finish */
+    mp_json_stream_init(&stream, 10);
+    fail_unless(mp_json_recv((void *)json_list, 1, 10, &stream) == 10,
+            "Data up to max not consumed.");
+    fail_unless(mp_json_recv((void *)(json_list + 10), 1, 1, &stream) == 0,
+            "Data over max consumed.");
+    fail_unless(stream.overflow == 1, "Overflow not set.");
+    mp_json_stream_finish(&stream);
+}
+END_TEST
+
+START_TEST (test_json_scan_recv_max) {
+    struct mp_json_path paths[1] = {{ "page_count", json_type_null, NULL }};
+    struct mp_json_scan scan;
+
+    mp_json_scan_init(&scan, paths, 1, 10);
+    fail_unless(mp_json_scan_recv((void *)json_list, 1, 10, &scan) == 10,
+            "Data up to max not consumed.");
+    fail_unless(mp_json_scan_recv((void *)(json_list + 10), 1, 1, &scan) == 0,
+            "Data over max consumed.");
+    fail_unless(scan.overflow == 1, "Overflow not set.");
+    mp_json_scan_finish(&scan);
+}
+END_TEST
+
+static const char *json_invalid[] = {
+    "{\"a\": 1",
+    "{\"a\" 1}",
+    "{\"a\": 1,}",
+    "{\"a\": [1, 2}",
+    "{\"a\": tru}",
+    "{\"a\": \"\\x\"}",
+    "{\"a\": \"b\nc\"}",
+    "",
+};
+
+START_TEST (test_json_scan_invalid) {
+    struct mp_json_path paths[1] = {{ "a", json_type_null, NULL }};
+
+    mp_json_scan_string(json_invalid[_i], paths, 1);
+}
+END_TEST
+
+int main (void) {
+
+  int number_failed;
+  SRunner *sr;
+
+  Suite *s = suite_create ("JSON");
+
+  TCase *tc = tcase_create ("Scan");
+  tcase_add_test(tc, test_json_scan_string);
+  tcase_add_test(tc, test_json_scan_chunks);
+  tcase_add_test(tc, test_json_paths_object);
+  tcase_add_test(tc, test_json_scan_top_level);
+  tcase_add_test(tc, test_json_scan_each);
+  tcase_add_loop_exit_test(tc, test_json_scan_invalid, STATE_CRITICAL, 0,
+          sizeof(json_invalid) / sizeof(json_invalid[0]));
+  suite_add_tcase (s, tc);
+
+  tc = tcase_create ("Recv");
+  tcase_add_test(tc, test_json_recv);
+  tcase_add_exit_test(tc, test_json_recv_max, STATE_CRITICAL);
+  tcase_add_exit_test(tc, test_json_scan_recv_max, STATE_CRITICAL);
+  suite_add_tcase (s, tc);
+
+  sr = srunner_create(s);
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -0,0 +1,195 @@
+/***
+ * Monitoring Plugin Tests - check_procfile.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "main.h"
+#include "mp_procfile.h"
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void procfile_setup(void);
+void procfile_teardown(void);
+
+static char procfile_file[] = "/tmp/mp_procfile_test_XXXXXX";
+
+static void procfile_write(const char *content) {
+    FILE *fp;
+
+    fp = fopen(procfile_file, "w");
+    fputs(content, fp);
+    fclose(fp);
+}
+
+void procfile_setup(void) {
+    int fd;
+
+    strcpy(procfile_file, "/tmp/mp_procfile_test_XXXXXX");
+    fd = mkstemp(procfile_file);
+    close(fd);
+}
+
+void procfile_teardown(void) {
+    unlink(procfile_file);
+}
+
+START_TEST (test_procfile_lines) {
+    mp_procfile *pf;
+    mp_slice line;
+
+    procfile_write("first\n\nthird");
+
+    pf = mp_procfile_open(procfile_file);
+    fail_unless (pf != NULL, "mp_procfile_open failed.");
+    fail_unless (mp_procfile_read(pf) == OK, "mp_procfile_read failed.");
+
+    fail_unless (mp_procfile_line(pf, &line) == 1, "First line missing.");
+    fail_unless (mp_slice_eq(&line, "first"), "Wrong first line.");
+    fail_unless (mp_procfile_line(pf, &line) == 1, "Empty line missing.");
+    fail_unless (line.len == 0, "Empty line not empty.");
+    fail_unless (mp_procfile_line(pf, &line) == 1, "Last line missing.");
+    fail_unless (mp_slice_eq(&line, "third"), "Wrong last line.");
+    fail_unless (mp_procfile_line(pf, &line) == 0, "Line after end.");
+
+    mp_procfile_close(pf);
+}
+END_TEST
+
+START_TEST (test_procfile_reread) {
+    mp_procfile *pf;
+    mp_slice line;
+    char *big;
+    int i;
+
+    procfile_write("one\n");
+
+    pf = mp_procfile_open(procfile_file);
+    fail_unless (mp_procfile_read(pf) == OK, "mp_procfile_read failed.");
+    fail_unless (mp_procfile_line(pf, &line) && mp_slice_eq(&line, "one"),
+            "Wrong line.");
+
+    /* Grow beyond the initial buffer and re-read the same fd */
+    big = mp_malloc(MP_PROCFILE_BUFSIZE * 5 + 1);
+    for (i = 0; i < MP_PROCFILE_BUFSIZE * 5; i++)
+        big[i] = (i % 64 == 63) ? '\n' : 'x';
+    big[i] = '\0';
+    procfile_write(big);
+
+    fail_unless (mp_procfile_read(pf) == OK, "mp_procfile_read failed.");
+    fail_unless (pf->len == MP_PROCFILE_BUFSIZE * 5, "Short read: %zu", pf->len);
+    fail_unless (mp_procfile_count_lines(pf) == MP_PROCFILE_BUFSIZE * 5 / 64,
+            "Wrong line count.");
+    fail_unless (memcmp(pf->buf, big, pf->len) == 0, "Wrong content.");
+
+    free(big);
+    mp_procfile_close(pf);
+}
+END_TEST
+
+START_TEST (test_procfile_missing) {
+    fail_unless (mp_procfile_open("/nonexistent/file") == NULL,
+            "Missing file opened.");
+}
+END_TEST
+
+START_TEST (test_slice_field) {
+    mp_slice s, f;
+
+    s.ptr = "  0: 0100007F:0277 00000000:0000 0A  ";
+    s.len = strlen(s.ptr);
+
+    fail_unless (mp_slice_field(&s, &f) && mp_slice_eq(&f, "0:"),
+            "Wrong field 1.");
+    fail_unless (mp_slice_field(&s, &f) && mp_slice_eq(&f, "0100007F:0277"),
+            "Wrong field 2.");
+    fail_unless (mp_slice_token(&f, ':', &s) == 1, "Separator not found.");
+    fail_unless (mp_slice_hex(&f) == 0x277, "Wrong hex value.");
+    fail_unless (mp_slice_hex(&s) == 0x100007F, "Wrong hex value.");
+}
+END_TEST
+
+START_TEST (test_slice_token) {
+    mp_slice s, t;
+
+    s.ptr = "MemTotal:        8048552 kB";
+    s.len = strlen(s.ptr);
+
+    fail_unless (mp_slice_token(&s, ':', &t) == 1, "Separator not found.");
+    fail_unless (mp_slice_eq(&t, "MemTotal"), "Wrong key.");
+    fail_unless (!mp_slice_eq(&t, "MemTotalX"), "Prefix matched.");
+    fail_unless (!mp_slice_eq(&t, "Mem"), "Shorter matched.");
+    fail_unless (mp_slice_ull(&s, NULL) == 8048552ULL, "Wrong value.");
+
+    mp_slice_trim(&s);
+    fail_unless (mp_slice_eq(&s, "8048552 kB"), "Wrong trim.");
+
+    fail_unless (mp_slice_token(&s, ':', &t) == 0, "Separator found.");
+    fail_unless (s.len == 0, "Slice not consumed.");
+}
+END_TEST
+
+START_TEST (test_slice_number) {
+    mp_slice s;
+    char *str;
+    size_t end;
+
+    s.ptr = "18446744073709551615 rest";
+    s.len = strlen(s.ptr);
+    fail_unless (mp_slice_ull(&s, &end) == 18446744073709551615ULL,
+            "Wrong max value.");
+    fail_unless (end == 20, "Wrong end %zu", end);
+
+    s.ptr = "DeadBeefG";
+    s.len = strlen(s.ptr);
+    fail_unless (mp_slice_hex(&s) == 0xdeadbeefULL, "Wrong hex value.");
+
+    s.len = 4;
+    str = mp_slice_strdup(&s);
+    fail_unless (strcmp(str, "Dead") == 0, "Wrong strdup '%s'.", str);
+    free(str);
+}
+END_TEST
+
+Suite* make_lib_procfile_suite(void) {
+
+    Suite *s = suite_create ("Procfile");
+
+    TCase *tc_file = tcase_create("File");
+    tcase_add_checked_fixture(tc_file, procfile_setup, procfile_teardown);
+    tcase_add_test(tc_file, test_procfile_lines);
+    tcase_add_test(tc_file, test_procfile_reread);
+    tcase_add_test(tc_file, test_procfile_missing);
+    suite_add_tcase(s, tc_file);
+
+    TCase *tc_slice = tcase_create("Slice");
+    tcase_add_test(tc_slice, test_slice_field);
+    tcase_add_test(tc_slice, test_slice_token);
+    tcase_add_test(tc_slice, test_slice_number);
+    suite_add_tcase(s, tc_slice);
+
+    return s;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
@@ -23,12 +23,15 @@
 
 #include "mp_common.h"
 #include "snmp_utils.h"
+#include "snmp_replay.h"
+#include "snmp_stats.h"
 
 #include <stdlib.h>
 #include <locale.h>
 #include <check.h>
 #include <sys/types.h>
 #include <signal.h>
+#include <unistd.h>
 
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
@@ -49,14 +52,21 @@ void snmp_replay_teardown(void);
 void snmp_replay_setup_v1(void) {
     mp_snmp_community = "unittest";
     mp_snmp_version = SNMP_VERSION_1;
+    setenv(MP_SNMP_REPLAY_ENV, abs_srcdir "/testdata/snmp/unittest.walk", 1);
 }
 
 void snmp_replay_setup_v2(void) {
     mp_snmp_community = "unittest";
     mp_snmp_version = SNMP_VERSION_2c;
+    setenv(MP_SNMP_REPLAY_ENV, abs_srcdir "/testdata/snmp/unittest.walk", 1);
 }
 
 void snmp_replay_teardown(void) {
+    unsetenv(MP_SNMP_REPLAY_ENV);
+    unsetenv(MP_SNMP_REPLAY_LOSS_ENV);
+    unsetenv(MP_SNMP_REPLAY_MAXSIZE_ENV);
+    unsetenv(MP_SNMP_RECORD_ENV);
+    unsetenv(MP_SNMP_REPLAY_LATENCY_ENV);
 }
 
 START_TEST (test_snmp_query_cmd) {
@@ -281,6 +291,410 @@ START_TEST (test_snmp_query_gauge) {
 }
 END_TEST
 
+START_TEST (test_snmp_table_query_columns) {
+    netsnmp_session *ss;
+    struct mp_snmp_table table;
+    oid idx;
+    long value;
+    char *s;
+    int rc;
+
+    ss = mp_snmp_init();
+    rc = mp_snmp_table_query_columns(ss, MP_OID(1,3,6,1,4,1,31865,9999,42),
+            MP_OID(4,2), &table);
+    mp_snmp_deinit();
+
+    fail_unless(rc == STAT_SUCCESS, "Column walk failed");
+    fail_unless(table.row == 5 && table.col == 2,
+            "Table size wrong: %d rows, %d cols", table.row, table.col);
+
+    idx = 2;
+    fail_unless(mp_snmp_table_get_integer(&table, 2,
+            mp_snmp_table_find(&table, &idx, 1), &value) == 1 && value == -2,
+            "DURCHMESSER-MIB::durchmesserExperimental.42.2.2 is not -2");
+
+    idx = 4;
+    s = mp_snmp_table_get_string(&table, 4,
+            mp_snmp_table_find(&table, &idx, 1));
+    fail_unless(s && strcmp(s, "String4") == 0,
+            "DURCHMESSER-MIB::durchmesserExperimental.42.4.4 is not String4");
+    free(s);
+
+    idx = 3;
+    fail_unless(mp_snmp_table_get_string(&table, 4,
+            mp_snmp_table_find(&table, &idx, 1)) == NULL,
+            "DURCHMESSER-MIB::durchmesserExperimental.42.4.3 exists");
+
+    fail_unless(mp_snmp_table_get(&table, 65, 0) == NULL,
+            "Fetched column not asked for");
+
+    mp_snmp_table_free(&table);
+}
+END_TEST
+
+START_TEST (test_snmp_parse_oid) {
+    oid name[MAX_OID_LEN];
+    size_t len;
+    oid sysName0[] = {MP_OID_sysName, 0};
+
+    len = MAX_OID_LEN;
+    fail_unless(mp_snmp_parse_oid(".1.3.6.1.2.1.1.5.0", name, &len) == 1,
+            "Parse .1.3.6.1.2.1.1.5.0 failed");
+    fail_unless(len == MP_OID_sysName_LEN + 1 &&
+            snmp_oid_compare(name, len, sysName0, len) == 0,
+            "Parse .1.3.6.1.2.1.1.5.0 wrong");
+
+    len = MAX_OID_LEN;
+    fail_unless(mp_snmp_parse_oid("1.3.6.1.2.1.1.5.0", name, &len) == 1 &&
+            len == 9, "Parse without leading dot failed");
+
+    len = MAX_OID_LEN;
+    fail_unless(mp_snmp_parse_oid("1.3.6.1.4294967295", name, &len) == 1 &&
+            name[4] == 4294967295UL, "Parse max sub-identifier failed");
+
+    len = MAX_OID_LEN;
+    fail_unless(mp_snmp_parse_oid("1.3.6.1.4294967296", name, &len) == 0,
+            "Parsed too large sub-identifier");
+    fail_unless(mp_snmp_parse_oid("1..3", name, &len) == 0,
+            "Parsed empty sub-identifier");
+    fail_unless(mp_snmp_parse_oid("1.3.", name, &len) == 0,
+            "Parsed trailing dot");
+    fail_unless(mp_snmp_parse_oid("", name, &len) == 0,
+            "Parsed empty OID");
+    fail_unless(mp_snmp_parse_oid("SNMPv2-MIB::sysName.0", name, &len) == 0,
+            "Parsed symbolic OID");
+
+    len = 3;
+    fail_unless(mp_snmp_parse_oid("1.3.6.1", name, &len) == 0,
+            "Parsed OID longer than buffer");
+}
+END_TEST
+
+/** Append a synthetic walk result entry.index = value to subtree. */
+static void table_add(mp_snmp_subtree *subtree, oid column, oid i1, oid i2,
+                      u_char type, const void *value, size_t len) {
+    oid name[] = {1,3,6,1,4,1,31865,9999,42,7,1, column, i1, i2};
+    netsnmp_variable_list var;
+
+    memset(&var, 0, sizeof(var));
+    snmp_set_var_objid(&var, name, i2 ? 14 : 13);
+    snmp_set_var_typed_value(&var, type, value, len);
+
+    mp_snmp_subtree_add(subtree, &var);
+}
+
+START_TEST (test_snmp_subtree_arena) {
+    mp_snmp_subtree subtree;
+    oid column[] = {1,3,6,1,4,1,31865,9999,42,7,1,4};
+    char *name = NULL;
+    long value;
+    size_t i;
+
+    memset(&subtree, 0, sizeof(subtree));
+
+    /* Grow records and arena several times */
+    for (value = 0; value < 1000; value++)
+        table_add(&subtree, 4, value + 1, 0, ASN_INTEGER,
+                  &value, sizeof(value));
+    table_add(&subtree, 2, 1, 0, ASN_OCTET_STR, "one", 3);
+
+    fail_unless(subtree.size == 1001, "Subtree size %zu", subtree.size);
+    fail_unless(subtree.alloc >= subtree.size &&
+            subtree.arena_alloc >= subtree.arena_len,
+            "Subtree storage overrun");
+    for (i = 0; i < subtree.size; i++)
+        fail_unless(subtree.vars[i].name_off % sizeof(oid) == 0 &&
+                subtree.vars[i].val_off % sizeof(oid) == 0,
+                "Unaligned varbind %zu", i);
+
+    fail_unless(mp_snmp_subtree_get_value(&subtree, column, 12, 777,
+            ASN_INTEGER, (void *)&value, sizeof(value)) == 1 && value == 777,
+            "Get value 777 failed");
+    column[11] = 2;
+    fail_unless(mp_snmp_subtree_get_value(&subtree, column, 12, 0,
+            ASN_OCTET_STR, (void *)&name, 0) == 1 && strcmp(name, "one") == 0,
+            "Get string failed");
+    free(name);
+
+    mp_snmp_subtree_free(&subtree);
+    fail_unless(subtree.size == 0 && subtree.vars == NULL &&
+            subtree.arena == NULL, "Subtree not reset by free");
+}
+END_TEST
+
+START_TEST (test_snmp_table) {
+    mp_snmp_subtree subtree;
+    struct mp_snmp_table table;
+    oid entry[] = {1,3,6,1,4,1,31865,9999,42,7,1};
+    oid idx[] = {12, 0};
+    const oid *index;
+    size_t index_len;
+    long state;
+    char *name;
+
+    memset(&subtree, 0, sizeof(subtree));
+
+    /* Walk order is column-major, row 7 has no state */
+    state = 1;
+    table_add(&subtree, 4, 3, 0, ASN_INTEGER, &state, sizeof(state));
+    state = 2;
+    table_add(&subtree, 4, 12, 0, ASN_INTEGER, &state, sizeof(state));
+    table_add(&subtree, 2, 3, 0, ASN_OCTET_STR, "three", 5);
+    table_add(&subtree, 2, 7, 0, ASN_OCTET_STR, "seven", 5);
+    table_add(&subtree, 2, 12, 0, ASN_OCTET_STR, "twelve", 6);
+    table_add(&subtree, 9, 12, 5, ASN_OCTET_STR, "sub", 3);
+
+    fail_unless(mp_snmp_table_build(&subtree, entry, 11, &table) == OK,
+            "Table build failed");
+    fail_unless(subtree.size == 0 && subtree.vars == NULL,
+            "Table did not take over the subtree");
+    fail_unless(table.row == 4 && table.col == 3,
+            "Table size wrong: %d rows, %d cols", table.row, table.col);
+
+    fail_unless(mp_snmp_table_find(&table, idx, 1) == 1,
+            "Find row 12 failed");
+    fail_unless(mp_snmp_table_find(&table, idx, 2) == -1,
+            "Found row 12.0");
+    idx[1] = 5;
+    fail_unless(mp_snmp_table_find(&table, idx, 2) == 3,
+            "Find row 12.5 failed");
+    idx[0] = 7;
+    fail_unless(mp_snmp_table_find(&table, idx, 1) == 2,
+            "Find row 7 failed");
+
+    index = mp_snmp_table_index(&table, 2, &index_len);
+    fail_unless(index_len == 1 && index[0] == 7, "Index of row 2 wrong");
+
+    fail_unless(mp_snmp_table_get_integer(&table, 4, 1, &state) == 1 &&
+            state == 2, "Get state of row 12 failed");
+    fail_unless(mp_snmp_table_get_integer(&table, 4, 2, &state) == 0,
+            "Got state of row 7");
+    fail_unless(mp_snmp_table_get_integer(&table, 2, 0, &state) == 0,
+            "Got string as integer");
+    fail_unless(mp_snmp_table_get(&table, 5, 0) == NULL,
+            "Got unknown column");
+    fail_unless(mp_snmp_table_get(&table, 4, 4) == NULL,
+            "Got row out of range");
+
+    name = mp_snmp_table_get_string(&table, 2, 2);
+    fail_unless(name && strcmp(name, "seven") == 0,
+            "Get name of row 7 failed");
+    free(name);
+    fail_unless(mp_snmp_table_get_string(&table, 4, 0) == NULL,
+            "Got integer as string");
+
+    mp_snmp_table_free(&table);
+    fail_unless(table.row == 0 && mp_snmp_table_find(&table, idx, 1) == -1,
+            "Table not reset by free");
+}
+END_TEST
+
+START_TEST (test_snmp_replay_types) {
+    netsnmp_session *ss;
+    uint64_t c64 = 0;
+    char *mac = NULL;
+    mp_snmp_query_cmd snmpcmd[] = {
+        {{1,3,6,1,4,1,31865,9999,42,70,1}, 11,
+            ASN_COUNTER64, (void *)&c64, sizeof(uint64_t)},
+        {{1,3,6,1,4,1,31865,9999,42,70,2}, 11,
+            ASN_OCTET_STR, (void *)&mac, 0},
+        {{0}, 0, 0, NULL},
+    };
+
+    ss = mp_snmp_init();
+    mp_snmp_query(ss, snmpcmd);
+    mp_snmp_deinit();
+
+    fail_unless(c64 == 18446744073709551615ULL,
+            "DURCHMESSER-MIB::durchmesserExperimental.42.70.1 is not 2^64-1");
+    fail_unless(mac && memcmp(mac, "\x00\x1a\x2b\x3c\x4d\x5e", 6) == 0,
+            "DURCHMESSER-MIB::durchmesserExperimental.42.70.2 is wrong");
+    free(mac);
+}
+END_TEST
+
+START_TEST (test_snmp_replay_toobig) {
+    netsnmp_session *ss;
+    struct mp_snmp_table table;
+    char *s1 = NULL;
+    char *s5 = NULL;
+    int rc;
+    mp_snmp_query_cmd snmpcmd[] = {
+        {{1,3,6,1,4,1,31865,9999,42,4,1}, 11, ASN_OCTET_STR, (void *)&s1, 0},
+        {{1,3,6,1,4,1,31865,9999,42,4,5}, 11, ASN_OCTET_STR, (void *)&s5, 0},
+        {{0}, 0, 0, NULL},
+    };
+
+    /* A answer of one varbind fits, the packed GET is split */
+    setenv(MP_SNMP_REPLAY_MAXSIZE_ENV, "80", 1);
+
+    ss = mp_snmp_init();
+    rc = mp_snmp_query(ss, snmpcmd);
+    fail_unless(rc == STAT_SUCCESS && s1 && s5 &&
+            strcmp(s1, "String1") == 0 && strcmp(s5, "String5") == 0,
+            "Split tooBig GET failed");
+    free(s1);
+    free(s5);
+    s1 = s5 = NULL;
+    mp_snmp_deinit();
+
+    /* Not even a single varbind fits */
+    setenv(MP_SNMP_REPLAY_MAXSIZE_ENV, "60", 1);
+
+    ss = mp_snmp_init();
+    rc = mp_snmp_query(ss, snmpcmd);
+    fail_unless(rc == STAT_SUCCESS && s1 == NULL && s5 == NULL,
+            "Got values of a tooBig GET");
+    mp_snmp_deinit();
+
+    setenv(MP_SNMP_REPLAY_MAXSIZE_ENV, "80", 1);
+
+    ss = mp_snmp_init();
+
+    /* GETBULK answers are truncated, the walk still completes */
+    rc = mp_snmp_table_query_columns(ss, MP_OID(1,3,6,1,4,1,31865,9999,42),
+            MP_OID(4,2), &table);
+    mp_snmp_deinit();
+
+    fail_unless(rc == STAT_SUCCESS && table.row == 5 && table.col == 2,
+            "Truncated column walk failed: %d rows", table.row);
+    mp_snmp_table_free(&table);
+
+    unsetenv(MP_SNMP_REPLAY_MAXSIZE_ENV);
+}
+END_TEST
+
+START_TEST (test_snmp_replay_loss) {
+    netsnmp_session *ss;
+    long sysUpTime = -1;
+    mp_snmp_query_cmd snmpcmd[] = {
+        {{1,3,6,1,2,1,1,3,0}, 9,
+            ASN_TIMETICKS, (void *)&sysUpTime, sizeof(long int)},
+        {{0}, 0, 0, NULL},
+    };
+
+    setenv(MP_SNMP_REPLAY_LOSS_ENV, "100", 1);
+
+    ss = mp_snmp_init();
+    ss->timeout = 1000;
+    ss->retries = 1;
+    fail_unless(mp_snmp_query(ss, snmpcmd) != STAT_SUCCESS,
+            "Query with all requests lost succeeded");
+    fail_unless(sysUpTime == -1, "Got value of a lost request");
+    mp_snmp_deinit();
+
+    unsetenv(MP_SNMP_REPLAY_LOSS_ENV);
+}
+END_TEST
+
+START_TEST (test_snmp_record) {
+    netsnmp_session *ss;
+    mp_snmp_subtree live, replay;
+    char fixture[] = "/tmp/check_snmp_record.XXXXXX";
+    size_t i;
+    int fd;
+
+    fd = mkstemp(fixture);
+    fail_unless(fd >= 0, "mkstemp failed");
+    close(fd);
+
+    /* Record a walk answered from the unittest fixture */
+    setenv(MP_SNMP_RECORD_ENV, fixture, 1);
+    ss = mp_snmp_init();
+    mp_snmp_subtree_query(ss, MP_OID(1,3,6,1,4,1,31865,9999,42), &live);
+    mp_snmp_deinit();
+    unsetenv(MP_SNMP_RECORD_ENV);
+
+    /* And replay the recording */
+    setenv(MP_SNMP_REPLAY_ENV, fixture, 1);
+    ss = mp_snmp_init();
+    mp_snmp_subtree_query(ss, MP_OID(1,3,6,1,4,1,31865,9999,42), &replay);
+    mp_snmp_deinit();
+    unlink(fixture);
+
+    fail_unless(live.size == 20 && replay.size == live.size,
+            "Recorded walk differs: %zu ~ %zu", live.size, replay.size);
+    for (i = 0; i < live.size; i++) {
+        fail_unless(live.vars[i].type == replay.vars[i].type &&
+                live.vars[i].val_len == replay.vars[i].val_len &&
+                memcmp(mp_snmp_varbind_value(&live, &live.vars[i]),
+                    mp_snmp_varbind_value(&replay, &replay.vars[i]),
+                    live.vars[i].val_len) == 0,
+                "Recorded varbind %zu differs", i);
+    }
+
+    mp_snmp_subtree_free(&live);
+    mp_snmp_subtree_free(&replay);
+}
+END_TEST
+
+START_TEST (test_snmp_stats_bucket) {
+    uint64_t usec;
+    int bucket;
+
+    for (usec = 0; usec < 100000000; usec = usec * 9 / 8 + 1) {
+        bucket = mp_snmp_stats_bucket(usec);
+        fail_unless(usec <= mp_snmp_stats_bucket_le(bucket),
+                "%llu above bucket %d", (unsigned long long) usec, bucket);
+        fail_unless(bucket == 0 ||
+                usec > mp_snmp_stats_bucket_le(bucket - 1),
+                "%llu below bucket %d", (unsigned long long) usec, bucket);
+    }
+}
+END_TEST
+
+START_TEST (test_snmp_stats) {
+    netsnmp_session *ss;
+    mp_snmp_subtree subtree;
+    char *s1 = NULL;
+    char *s5 = NULL;
+    mp_snmp_query_cmd snmpcmd[] = {
+        {{1,3,6,1,4,1,31865,9999,42,4,1}, 11, ASN_OCTET_STR, (void *)&s1, 0},
+        {{1,3,6,1,4,1,31865,9999,42,4,5}, 11, ASN_OCTET_STR, (void *)&s5, 0},
+        {{0}, 0, 0, NULL},
+    };
+
+    setenv(MP_SNMP_REPLAY_LATENCY_ENV, "20", 1);
+    setenv(MP_SNMP_REPLAY_MAXSIZE_ENV, "80", 1);
+    mp_snmp_stats_enabled = 1;
+    mp_showperfdata = 1;
+
+    ss = mp_snmp_init();
+    mp_snmp_query(ss, snmpcmd);
+    mp_snmp_subtree_query(ss, MP_OID(1,3,6,1,4,1,31865,9999,42), &subtree);
+
+    /* The GET is split once, the walk needs more than one request */
+    fail_unless(mp_snmp_stats.toobig >= 1, "No tooBig counted");
+    fail_unless(mp_snmp_stats.pdus >= 5, "Only %llu PDUs counted",
+            (unsigned long long) mp_snmp_stats.pdus);
+    fail_unless(mp_snmp_stats.timeouts == 0 && mp_snmp_stats.retries == 0,
+            "Retries counted without loss");
+    fail_unless(mp_snmp_stats.bytes_in > 0 && mp_snmp_stats.bytes_out > 0,
+            "No bytes counted");
+    fail_unless(mp_snmp_stats.rtt_max >= 20000 &&
+            mp_snmp_stats_percentile(0.5) >= 16000 &&
+            mp_snmp_stats_percentile(0.95) <= mp_snmp_stats.rtt_max,
+            "RTT of a 20ms agent is off: p50 %llu max %llu",
+            (unsigned long long) mp_snmp_stats_percentile(0.5),
+            (unsigned long long) mp_snmp_stats.rtt_max);
+
+    mp_snmp_deinit();
+    fail_unless(mp_perfdata && strstr(mp_perfdata, "snmp_pdus=") &&
+            strstr(mp_perfdata, "snmp_rtt_p95=") &&
+            strstr(mp_perfdata, "snmp_retries=0c"),
+            "SNMP stats perfdata missing: %s", mp_perfdata);
+    fail_unless(mp_snmp_stats.pdus == 0, "Stats not reset");
+
+    mp_snmp_stats_enabled = 0;
+    mp_showperfdata = 0;
+    free(mp_perfdata);
+    mp_perfdata = NULL;
+    mp_snmp_subtree_free(&subtree);
+    free(s1);
+    free(s5);
+}
+END_TEST
+
 int main (void) {
 
   int number_failed;
@@ -288,6 +702,13 @@ int main (void) {
 
   Suite *s = suite_create ("SNMP");
 
+  TCase *tc_oid = tcase_create ("OID");
+  tcase_add_test(tc_oid, test_snmp_parse_oid);
+  tcase_add_test(tc_oid, test_snmp_subtree_arena);
+  tcase_add_test(tc_oid, test_snmp_table);
+  tcase_add_test(tc_oid, test_snmp_stats_bucket);
+  suite_add_tcase(s, tc_oid);
+
   TCase *tc = tcase_create ("SNMPv1");
   tcase_add_unchecked_fixture(tc, snmp_replay_setup_v1, snmp_replay_teardown);
   tcase_add_test(tc, test_snmp_query_cmd);
@@ -296,6 +717,7 @@ int main (void) {
   tcase_add_test(tc, test_snmp_query_string_pre);
   tcase_add_test(tc, test_snmp_query_counter);
   tcase_add_test(tc, test_snmp_query_gauge);
+  tcase_add_test(tc, test_snmp_table_query_columns);
   suite_add_tcase(s, tc);
 
   tc = tcase_create ("SNMPv2");
@@ -306,6 +728,16 @@ int main (void) {
   tcase_add_test(tc, test_snmp_query_string_pre);
   tcase_add_test(tc, test_snmp_query_counter);
   tcase_add_test(tc, test_snmp_query_gauge);
+  tcase_add_test(tc, test_snmp_table_query_columns);
+  suite_add_tcase(s, tc);
+
+  tc = tcase_create ("Replay");
+  tcase_add_unchecked_fixture(tc, snmp_replay_setup_v2, snmp_replay_teardown);
+  tcase_add_test(tc, test_snmp_replay_types);
+  tcase_add_test(tc, test_snmp_replay_toobig);
+  tcase_add_test(tc, test_snmp_replay_loss);
+  tcase_add_test(tc, test_snmp_record);
+  tcase_add_test(tc, test_snmp_stats);
   suite_add_tcase(s, tc);
 
   sr = srunner_create(s);
@@ -0,0 +1,227 @@
+/***
+ * Monitoring Plugin Tests - check_state.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "main.h"
+#include "mp_state.h"
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+void state_setup(void);
+void state_teardown(void);
+
+static char state_file[] = "/tmp/mp_state_test_XXXXXX";
+
+void state_setup(void) {
+    int fd;
+
+    strcpy(state_file, "/tmp/mp_state_test_XXXXXX");
+    fd = mkstemp(state_file);
+    close(fd);
+    mp_state_file = state_file;
+    mp_perfdata = NULL;
+}
+
+void state_teardown(void) {
+    mp_state_close();
+    unlink(state_file);
+    if (mp_perfdata)
+        free(mp_perfdata);
+    mp_perfdata = NULL;
+}
+
+static double state_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+START_TEST (test_state_set_get) {
+    uint64_t value = 0;
+    double time = 0;
+
+    fail_unless (mp_state_get("host", "label", &value, &time) == ERROR,
+            "Unset label found.");
+    fail_unless (mp_state_set("host", "label", 42, 1000) == OK,
+            "mp_state_set failed.");
+    fail_unless (mp_state_set("other", "label", 23, 2000) == OK,
+            "mp_state_set failed.");
+    fail_unless (mp_state_get("host", "label", &value, &time) == OK,
+            "mp_state_get failed.");
+    fail_unless (value == 42 && time == 1000,
+            "Wrong sample: %llu at %f", (unsigned long long)value, time);
+    fail_unless (mp_state_get("other", "label", &value, &time) == OK,
+            "mp_state_get failed.");
+    fail_unless (value == 23 && time == 2000,
+            "Wrong sample: %llu at %f", (unsigned long long)value, time);
+}
+END_TEST
+
+START_TEST (test_state_reopen) {
+    uint64_t value = 0;
+    double time = 0;
+
+    mp_state_set(NULL, "label", 4242, 1000);
+    mp_state_close();
+
+    fail_unless (mp_state_get(NULL, "label", &value, &time) == OK,
+            "mp_state_get after reopen failed.");
+    fail_unless (value == 4242,
+            "Wrong value: %llu", (unsigned long long)value);
+}
+END_TEST
+
+START_TEST (test_state_delta) {
+    uint64_t delta = 0;
+    double interval = 0;
+
+    fail_unless (mp_state_delta(NULL, "c", 100, MP_COUNTER64,
+                &delta, &interval) == ERROR,
+            "First sample returned a delta.");
+    mp_state_set(NULL, "c", 100, state_now() - 10);
+    fail_unless (mp_state_delta(NULL, "c", 150, MP_COUNTER64,
+                &delta, &interval) == OK,
+            "mp_state_delta failed.");
+    fail_unless (delta == 50, "Wrong delta: %llu", (unsigned long long)delta);
+    fail_unless (interval > 9.9 && interval < 11,
+            "Wrong interval: %f", interval);
+}
+END_TEST
+
+START_TEST (test_state_wrap32) {
+    uint64_t delta = 0;
+    double interval = 0;
+
+    mp_state_set(NULL, "c", 4294967200ULL, state_now() - 1);
+    fail_unless (mp_state_delta(NULL, "c", 100, MP_COUNTER32,
+                &delta, &interval) == OK,
+            "32-bit wrap not detected.");
+    fail_unless (delta == 196, "Wrong delta: %llu", (unsigned long long)delta);
+}
+END_TEST
+
+START_TEST (test_state_wrap64) {
+    uint64_t delta = 0;
+    double interval = 0;
+
+    mp_state_set(NULL, "c", 18446744073709551600ULL, state_now() - 1);
+    fail_unless (mp_state_delta(NULL, "c", 100, MP_COUNTER64,
+                &delta, &interval) == OK,
+            "64-bit wrap not detected.");
+    fail_unless (delta == 116, "Wrong delta: %llu", (unsigned long long)delta);
+}
+END_TEST
+
+START_TEST (test_state_reset) {
+    uint64_t delta = 0;
+    uint64_t value = 0;
+    double interval = 0;
+    double time = 0;
+
+    mp_state_set(NULL, "c", 1000000, state_now() - 1);
+    fail_unless (mp_state_delta(NULL, "c", 10, MP_COUNTER32,
+                &delta, &interval) == ERROR,
+            "Counter reset not detected.");
+    fail_unless (mp_state_get(NULL, "c", &value, &time) == OK && value == 10,
+            "Sample after reset not stored.");
+}
+END_TEST
+
+START_TEST (test_state_rate) {
+    double rate = 0;
+
+    mp_state_set("host", "c", 1000, state_now() - 10);
+    fail_unless (mp_state_rate("host", "c", 2000, MP_COUNTER64, &rate) == OK,
+            "mp_state_rate failed.");
+    fail_unless (rate > 95 && rate < 101, "Wrong rate: %f", rate);
+}
+END_TEST
+
+START_TEST (test_perfdata_rate) {
+    mp_showperfdata = 1;
+
+    mp_perfdata_rate("rate", "host", 1000, MP_COUNTER64, "");
+    fail_unless (mp_perfdata == NULL,
+            "Perfdata for first sample: '%s'", mp_perfdata);
+
+    mp_state_set("host", "rate", 0, state_now() - 10);
+    mp_perfdata_rate("rate", "host", 1000, MP_COUNTER64, "");
+    fail_unless (strncmp(mp_perfdata, "rate=", 5) == 0,
+            "Wrong perfdata: '%s'", mp_perfdata);
+}
+END_TEST
+
+START_TEST (test_state_mkdir) {
+    char dir[] = "/tmp/mp_state_test_XXXXXX";
+    char *file;
+    char *sub;
+
+    fail_unless (mkdtemp(dir) != NULL, "mkdtemp failed.");
+    mp_asprintf(&sub, "%s/a", dir);
+    mp_asprintf(&file, "%s/b/state.db", sub);
+    mp_state_file = file;
+
+    fail_unless (mp_state_set("host", "label", 42, 1000) == OK,
+            "State in missing directories not created.");
+
+    mp_state_close();
+    mp_state_file = state_file;
+    unlink(file);
+    *strrchr(file, '/') = '\0';
+    rmdir(file);
+    rmdir(sub);
+    rmdir(dir);
+    free(file);
+    free(sub);
+}
+END_TEST
+
+Suite* make_lib_state_suite(void) {
+
+    Suite *s = suite_create ("State");
+
+    TCase *tc_store = tcase_create("Store");
+    tcase_add_checked_fixture(tc_store, state_setup, state_teardown);
+    tcase_add_test(tc_store, test_state_set_get);
+    tcase_add_test(tc_store, test_state_reopen);
+    tcase_add_test(tc_store, test_state_mkdir);
+    suite_add_tcase(s, tc_store);
+
+    TCase *tc_counter = tcase_create("Counter");
+    tcase_add_checked_fixture(tc_counter, state_setup, state_teardown);
+    tcase_add_test(tc_counter, test_state_delta);
+    tcase_add_test(tc_counter, test_state_wrap32);
+    tcase_add_test(tc_counter, test_state_wrap64);
+    tcase_add_test(tc_counter, test_state_reset);
+    tcase_add_test(tc_counter, test_state_rate);
+    tcase_add_test(tc_counter, test_perfdata_rate);
+    suite_add_tcase(s, tc_counter);
+
+    return s;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
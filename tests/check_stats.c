@@ -0,0 +1,149 @@
+/***
+ * Monitoring Plugin Tests - check_stats.c
+ **
+ *
+ * Copyright (C) 2012 Marius Rieder <marius.rieder@durchmesser.ch>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * $Id$
+ */
+
+#include "main.h"
+#include "mp_stats.h"
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void stats_setup(void);
+void stats_teardown(void);
+
+static char stats_file[] = "/tmp/mp_stats_test_XXXXXX";
+
+void stats_setup(void) {
+    int fd;
+
+    strcpy(stats_file, "/tmp/mp_stats_test_XXXXXX");
+    fd = mkstemp(stats_file);
+    close(fd);
+    mp_stats_file = stats_file;
+    mp_stats_timeout = 0;
+}
+
+void stats_teardown(void) {
+    mp_stats_close();
+    unlink(stats_file);
+}
+
+static struct mp_stats_entry *stats_find(const char *name) {
+    struct mp_stats_entry *slots;
+    int num = 0;
+    int i;
+
+    slots = mp_stats_entries(&num);
+    for (i = 0; slots && i < num; i++) {
+        if (slots[i].ready && strcmp(slots[i].name, name) == 0)
+            return &slots[i];
+    }
+    return NULL;
+}
+
+START_TEST (test_stats_missing) {
+    unlink(stats_file);
+    fail_unless (mp_stats_open(0) == ERROR,
+            "Missing stats file opened.");
+    mp_stats_record(STATE_OK);
+    fail_unless (access(stats_file, F_OK) != 0,
+            "Stats file created by record.");
+}
+END_TEST
+
+START_TEST (test_stats_record) {
+    struct mp_stats_entry *e;
+    int i;
+    uint64_t sum = 0;
+
+    fail_unless (mp_stats_open(1) == OK, "mp_stats_open failed.");
+    mp_stats_record(STATE_OK);
+    mp_stats_record(STATE_OK);
+    mp_stats_timeout = 1;
+    mp_stats_record(STATE_CRITICAL);
+    mp_stats_record(42);
+
+    e = stats_find(progname);
+    fail_unless (e != NULL, "Entry for %s not found.", progname);
+    fail_unless (e->runs == 4, "Wrong runs: %llu",
+            (unsigned long long)e->runs);
+    fail_unless (e->state[STATE_OK] == 2 && e->state[STATE_CRITICAL] == 1 &&
+            e->state[STATE_UNKNOWN] == 1, "Wrong state counts.");
+    fail_unless (e->timeouts == 2, "Wrong timeouts: %llu",
+            (unsigned long long)e->timeouts);
+    fail_unless (e->maxrss > 0, "No maxrss recorded.");
+    for (i = 0; i < MP_STATS_BUCKETS; i++)
+        sum += e->wall[i];
+    fail_unless (sum == 4, "Wrong histogram count: %llu",
+            (unsigned long long)sum);
+}
+END_TEST
+
+START_TEST (test_stats_reopen) {
+    struct mp_stats_entry *e;
+
+    fail_unless (mp_stats_open(1) == OK, "mp_stats_open failed.");
+    mp_stats_close();
+    mp_stats_record(STATE_WARNING);
+
+    fail_unless (mp_stats_open(0) == OK, "mp_stats_open failed.");
+    e = stats_find(progname);
+    fail_unless (e != NULL && e->state[STATE_WARNING] == 1,
+            "Record without open map lost.");
+}
+END_TEST
+
+START_TEST (test_stats_bucket) {
+    fail_unless (mp_stats_bucket(0) == 0, "Bucket of 0us.");
+    fail_unless (mp_stats_bucket(1000) == 0, "Bucket of 1ms.");
+    fail_unless (mp_stats_bucket(1001) == 1, "Bucket of 1.001ms.");
+    fail_unless (mp_stats_bucket(300000) == 9, "Bucket of 300ms.");
+    fail_unless (mp_stats_bucket(UINT64_MAX) == MP_STATS_BUCKETS - 1,
+            "Bucket of max.");
+    fail_unless (mp_stats_bucket_le(9) == 0.512, "Upper bound of 9.");
+    fail_unless (mp_stats_bucket_le(MP_STATS_BUCKETS - 1) < 0,
+            "Upper bound of last.");
+}
+END_TEST
+
+Suite* make_lib_stats_suite(void) {
+
+    Suite *s = suite_create ("Stats");
+
+    TCase *tc_file = tcase_create("File");
+    tcase_add_checked_fixture(tc_file, stats_setup, stats_teardown);
+    tcase_add_test(tc_file, test_stats_missing);
+    tcase_add_test(tc_file, test_stats_record);
+    tcase_add_test(tc_file, test_stats_reopen);
+    suite_add_tcase(s, tc_file);
+
+    TCase *tc_bucket = tcase_create("Bucket");
+    tcase_add_test(tc_bucket, test_stats_bucket);
+    suite_add_tcase(s, tc_bucket);
+
+    return s;
+}
+
+/* vim: set ts=4 sw=4 et syn=c : */
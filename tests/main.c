@@ -42,6 +42,9 @@ int main (void) {
   srunner_add_suite(sr, make_lib_eopt_suite() );
   srunner_add_suite(sr, make_lib_utils_suite() );
   srunner_add_suite(sr, make_lib_perfdata_suite() );
+  srunner_add_suite(sr, make_lib_state_suite() );
+  srunner_add_suite(sr, make_lib_procfile_suite() );
+  srunner_add_suite(sr, make_lib_stats_suite() );
   srunner_run_all(sr, CK_NORMAL);
   number_failed = srunner_ntests_failed(sr);
   srunner_free(sr);
@@ -45,4 +45,13 @@ Suite *make_lib_utils_suite(void);
 /* Lib PERFDATA Suite */
 Suite *make_lib_perfdata_suite(void);
 
+/* Lib STATE Suite */
+Suite *make_lib_state_suite(void);
+
+/* Lib PROCFILE Suite */
+Suite *make_lib_procfile_suite(void);
+
+/* Lib STATS Suite */
+Suite *make_lib_stats_suite(void);
+
 #endif /* _TESTS_MAIN_H */
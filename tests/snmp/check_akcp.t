@@ -3,13 +3,19 @@
 . ./setup.sh
 
 test_expect_success HAVE_NET_SNMP 'check_akcp' "
-    test_expect_code 0 $WRAPPER $BASE/snmp/check_akcp -H test.mp.durchmesser.ch -P 1661\
-        -C akcp
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/akcp.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_akcp -H test.mp.durchmesser.ch
 "
 
 test_expect_success HAVE_NET_SNMP 'check_akcp w/ one sensor only' "
-    test_expect_code 0 $WRAPPER $BASE/snmp/check_akcp -H test.mp.durchmesser.ch -P 1661\
-        -C akcp_s1_offline
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/akcp_s1_offline.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_akcp -H test.mp.durchmesser.ch
+"
+
+test_expect_success HAVE_NET_SNMP 'check_akcp w/ lossy slow agent' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/akcp.walk &&
+    export MP_SNMP_REPLAY_LATENCY=20 MP_SNMP_REPLAY_LOSS=20 &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_akcp -H test.mp.durchmesser.ch -T 1 -R 5
 "
 
 test_done
@@ -3,18 +3,28 @@
 . ./setup.sh
 
 test_expect_success HAVE_NET_SNMP 'check_apc_pdu' "
-    test_expect_code 0 $BASE/snmp/check_apc_pdu -H test.mp.durchmesser.ch -P 1661\
-        -C apc_pdu
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/apc_pdu.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_apc_pdu -H test.mp.durchmesser.ch
 "
 
-test_expect_success HAVE_NET_SNMP 'check_akcp w/ unknown sensor' "
-    test_expect_code 3 $BASE/snmp/check_apc_pdu -H test.mp.durchmesser.ch -P 1661\
-        -C apc_pdu --on 9
+test_expect_success HAVE_NET_SNMP 'check_apc_pdu w/ unknown outlet' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/apc_pdu.walk &&
+    test_expect_code 3 $WRAPPER $BASE/snmp/check_apc_pdu -H test.mp.durchmesser.ch --on 9
 "
 
-test_expect_success HAVE_NET_SNMP 'check_akcp w/ sensor in wrong state' "
-    test_expect_code 2 $BASE/snmp/check_apc_pdu -H test.mp.durchmesser.ch -P 1661\
-        -C apc_pdu --off 1
+test_expect_success HAVE_NET_SNMP 'check_apc_pdu w/ outlet in wrong state' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/apc_pdu.walk &&
+    test_expect_code 2 $WRAPPER $BASE/snmp/check_apc_pdu -H test.mp.durchmesser.ch --off 1
+"
+
+test_expect_success HAVE_NET_SNMP 'check_apc_pdu w/ dead agent' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/apc_pdu.walk MP_SNMP_REPLAY_LOSS=100 &&
+    test_expect_code 2 $WRAPPER $BASE/snmp/check_apc_pdu -H test.mp.durchmesser.ch -T 1 -R 1
+"
+
+test_expect_success HAVE_NET_SNMP 'check_apc_pdu w/ hosts' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/apc_pdu.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_apc_pdu --hosts pdu1,pdu2
 "
 
 test_done
@@ -0,0 +1,25 @@
+#!/bin/sh
+
+. ./setup.sh
+
+test_expect_success HAVE_NET_SNMP 'check_interface' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/interface.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_interface -H test.mp.durchmesser.ch -I 1
+"
+
+test_expect_success HAVE_NET_SNMP 'check_interface w/ SNMPv1' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/interface.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_interface -H test.mp.durchmesser.ch -I 1 -S 1
+"
+
+test_expect_success HAVE_NET_SNMP 'check_interface w/o 64-bit counters' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/interface.walk &&
+    test_expect_code 2 $WRAPPER $BASE/snmp/check_interface -H test.mp.durchmesser.ch -I 2
+"
+
+test_expect_success HAVE_NET_SNMP 'check_interface w/ unknown index' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/interface.walk &&
+    test_expect_code 3 $WRAPPER $BASE/snmp/check_interface -H test.mp.durchmesser.ch -I 3
+"
+
+test_done
@@ -3,43 +3,43 @@
 . ./setup.sh
 
 test_expect_success HAVE_NET_SNMP 'check_check_keepalived_vrrp' "
-    test_expect_code 0 $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch -P 1661 \
-        -C keepalived_vrrp_master
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/keepalived_vrrp_master.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch
 "
 
 test_expect_success HAVE_NET_SNMP 'check_check_keepalived_vrrp w/ master instance' "
-    test_expect_code 0 $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch -P 1661 \
-        -C keepalived_vrrp_master --instance staginglb
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/keepalived_vrrp_master.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch --instance staginglb
 "
 
 test_expect_success HAVE_NET_SNMP 'check_check_keepalived_vrrp w/ slave instance' "
-    test_expect_code 0 $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch -P 1661 \
-        -C keepalived_vrrp_master --instance staginglb2
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/keepalived_vrrp_master.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch --instance staginglb2
 "
 
 test_expect_success HAVE_NET_SNMP 'check_check_keepalived_vrrp w/ wildcard instance' "
-    test_expect_code 0 $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch -P 1661 \
-        -C keepalived_vrrp_master --instance stagingl*
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/keepalived_vrrp_master.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch --instance stagingl*
 "
 
 test_expect_success HAVE_NET_SNMP 'check_check_keepalived_vrrp w/ unknown instance' "
-    test_expect_code 2 $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch -P 1661 \
-        -C keepalived_vrrp_master --instance staginglb1
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/keepalived_vrrp_master.walk &&
+    test_expect_code 2 $WRAPPER $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch --instance staginglb1
 "
 
 test_expect_success HAVE_NET_SNMP 'check_check_keepalived_vrrp w/0 instance' "
-    test_expect_code 3 $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch -P 1661 \
-        -C keepalived_vrrp_none
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/keepalived_vrrp_none.walk &&
+    test_expect_code 3 $WRAPPER $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch
 "
 
 test_expect_success HAVE_NET_SNMP 'check_check_keepalived_vrrp w/ actvie slave' "
-    test_expect_code 1 $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch -P 1661 \
-        -C keepalived_vrrp_slave_active
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/keepalived_vrrp_slave_active.walk &&
+    test_expect_code 1 $WRAPPER $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch
 "
 
 test_expect_success HAVE_NET_SNMP 'check_check_keepalived_vrrp w/ actvie slave but different instance' "
-    test_expect_code 0 $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch -P 1661 \
-        -C keepalived_vrrp_slave_active --instance staginglb2
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/keepalived_vrrp_slave_active.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_keepalived_vrrp -H test.mp.durchmesser.ch --instance staginglb2
 "
 
 test_done
@@ -3,13 +3,13 @@
 . ./setup.sh
 
 test_expect_success HAVE_NET_SNMP 'check_qnap_vols' "
-    test_expect_code 0 $WRAPPER $BASE/snmp/check_qnap_vols -H test.mp.durchmesser.ch -P 1661 \
-        -C qnap
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/qnap_vols.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_qnap_vols -H test.mp.durchmesser.ch
 "
 
 test_expect_success HAVE_NET_SNMP 'check_qnap_vols w/ one disk missing' "
-    test_expect_code 2 $WRAPPER $BASE/snmp/check_qnap_vols -H test.mp.durchmesser.ch -P 1661 \
-        -C qnap_disk_missing
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/qnap_vols_missing.walk &&
+    test_expect_code 2 $WRAPPER $BASE/snmp/check_qnap_vols -H test.mp.durchmesser.ch
 "
 
 test_done
@@ -0,0 +1,25 @@
+#!/bin/sh
+
+. ./setup.sh
+
+test_expect_success HAVE_NET_SNMP 'check_snmp_ups' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/ups.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_snmp_ups -H test.mp.durchmesser.ch
+"
+
+test_expect_success HAVE_NET_SNMP 'check_snmp_ups w/ SNMPv1 and missing OID' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/ups.walk &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_snmp_ups -H test.mp.durchmesser.ch -S 1
+"
+
+test_expect_success HAVE_NET_SNMP 'check_snmp_ups w/ small agent msgMaxSize' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/ups.walk MP_SNMP_REPLAY_MAXSIZE=120 &&
+    test_expect_code 0 $WRAPPER $BASE/snmp/check_snmp_ups -H test.mp.durchmesser.ch -S 1
+"
+
+test_expect_success HAVE_NET_SNMP 'check_snmp_ups w/ dead agent' "
+    export MP_SNMP_REPLAY=$TESTDIR/snmp/ups.walk MP_SNMP_REPLAY_LOSS=100 &&
+    test_expect_code 2 $WRAPPER $BASE/snmp/check_snmp_ups -H test.mp.durchmesser.ch -T 1 -R 1
+"
+
+test_done